@@ -104,6 +104,21 @@ static void BM_EngineRunBatchWindowMultiAggWindow25Feature25(
     EngineRunBatchWindowMultiAggWindow25Feature25(
         &state, BENCHMARK, state.range(0), state.range(1));
 }
+static void BM_EngineRunBatchWindowMultiAggParallel(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowMultiAggParallel(&state, BENCHMARK, state.range(0),
+                                         state.range(1));
+}
+
+static void BM_EngineCompileProcedures(benchmark::State& state) {  // NOLINT
+    EngineCompileProcedures(&state, BENCHMARK, state.range(0), state.range(1));
+}
+
+static void BM_EngineRunBatchWindowIncrementalAgg(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowIncrementalAgg(&state, BENCHMARK, state.range(0),
+                                       state.range(1));
+}
 
 static void BM_EngineSimpleSelectVarchar(benchmark::State& state) {  // NOLINT
     EngineSimpleSelectVarchar(&state, BENCHMARK);
@@ -275,6 +290,27 @@ BENCHMARK(BM_EngineRunBatchWindowMultiAggWindow25Feature25)
     ->Args({100, 100})
     ->Args({1000, 1000})
     ->Args({10000, 10000});
+BENCHMARK(BM_EngineRunBatchWindowMultiAggParallel)
+    ->Args({1, 100000})
+    ->Args({2, 100000})
+    ->Args({4, 100000})
+    ->Args({8, 100000})
+    ->Args({16, 100000})
+    ->Args({32, 100000})
+    ->UseRealTime();
+// {incremental, window size}, the window of 1M rows is too slow for the
+// generated code which iterates the whole window for each row
+// {object cache, procedure num}, the cold start of a tablet with 100 deployments
+BENCHMARK(BM_EngineCompileProcedures)
+    ->Args({0, 100})
+    ->Args({1, 100})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EngineRunBatchWindowIncrementalAgg)
+    ->Args({0, 100})
+    ->Args({1, 100})
+    ->Args({0, 10000})
+    ->Args({1, 10000})
+    ->Args({1, 1000000});
 
 // batch engine window bm exclude current time
 BENCHMARK(BM_EngineRunBatchWindowSumFeature1ExcludeCurrentTime)
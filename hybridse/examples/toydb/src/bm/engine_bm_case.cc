@@ -15,6 +15,7 @@
  */
 
 #include "bm/engine_bm_case.h"
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
@@ -23,12 +24,14 @@
 #include "benchmark/benchmark.h"
 #include "codec/type_codec.h"
 #include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
@@ -306,6 +309,168 @@ void EngineRunBatchWindowSumFeature5Window5(benchmark::State* state, MODE mode,
         std::to_string(limit_cnt) + ";";
     EngineBatchMode(sql, mode, limit_cnt, size, state);
 }
+void EngineRunBatchWindowMultiAggParallel(benchmark::State* state, MODE mode,
+                                          int64_t thread_num,
+                                          int64_t size) {  // NOLINT
+    // no LIMIT, it runs the window in one thread
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum, "
+        "avg(col3) OVER w1 as w1_col3_avg, "
+        "max(col4) OVER w1 as w1_col4_max, "
+        "count(col2) OVER w2 as w2_col2_cnt, "
+        "min(col5) OVER w2 as w2_col5_min, "
+        "sum(col4) OVER w2 as w2_col4_sum, "
+        "avg(col1) OVER w3 as w3_col1_avg, "
+        "max(col3) OVER w3 as w3_col3_max, "
+        "count(col6) OVER w3 as w3_col6_cnt "
+        "FROM t1 WINDOW "
+        "w1 AS (PARTITION BY col0 ORDER BY col5 ROWS_RANGE BETWEEN 30d "
+        "PRECEDING AND CURRENT ROW), "
+        "w2 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN 100 "
+        "PRECEDING AND CURRENT ROW), "
+        "w3 AS (PARTITION BY col0 ORDER BY col5 ROWS_RANGE BETWEEN 1d "
+        "PRECEDING AND CURRENT ROW);";
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    // 100 rows of each key
+    auto catalog = vm::BuildMultiPkTableStorage(size, std::max<int64_t>(1, size / 100));
+    vm::EngineOptions options;
+    options.SetBatchWindowThreadNum(thread_num);
+    Engine engine(catalog, options);
+    BatchRunSession session;
+    base::Status query_status;
+    engine.Get(sql, "db", session, query_status);
+    std::ostringstream runner_oss;
+    session.GetCompileInfo()->DumpClusterJob(runner_oss, "");
+    LOG(INFO) << "runner plan:\n" << runner_oss.str() << std::endl;
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                std::vector<hybridse::codec::Row> outputs;
+                benchmark::DoNotOptimize(session.Run(outputs));
+            }
+            state->SetItemsProcessed(state->iterations() * size);
+            break;
+        }
+        case TEST: {
+            std::vector<hybridse::codec::Row> outputs;
+            if (0 != session.Run(outputs)) {
+                FAIL();
+            }
+            ASSERT_EQ(static_cast<uint64_t>(size), outputs.size());
+            break;
+        }
+    }
+}
+
+void EngineCompileProcedures(benchmark::State* state, MODE mode,
+                             int64_t object_cache,
+                             int64_t procedure_num) {  // NOLINT
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    // the procedures differ in the windows, so they are compiled into
+    // different object code
+    std::vector<std::string> sqls;
+    for (int64_t i = 0; i < procedure_num; i++) {
+        std::string features;
+        for (auto col : {"col1", "col2", "col3", "col4", "col5"}) {
+            for (auto fn : {"sum", "avg", "min", "max", "count"}) {
+                features += std::string(fn) + "(" + col + ") OVER w1 as w1_" + col + "_" + fn + ", ";
+            }
+        }
+        sqls.push_back("SELECT " + features +
+                       "col0 FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN " +
+                       std::to_string(i + 1) + " PRECEDING AND CURRENT ROW);");
+    }
+    auto catalog = vm::BuildMultiPkTableStorage(100, 10);
+    vm::EngineOptions options;
+    SmallString<128> dir;
+    if (object_cache) {
+        if (sys::fs::createUniqueDirectory("engine_bm_object_cache", dir)) {
+            FAIL();
+        }
+        options.jit_options().SetObjectCacheDir(dir.str().str());
+    }
+    // a tablet restarts with an empty compiling cache, the object code on
+    // disk is written by the first run
+    auto compile_all = [&]() {
+        Engine engine(catalog, options);
+        for (int64_t i = 0; i < procedure_num; i++) {
+            RequestRunSession session;
+            session.SetSpName("sp" + std::to_string(i));
+            base::Status status;
+            if (!engine.Get(sqls[i], "db", session, status)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (object_cache && !compile_all()) {
+        FAIL();
+    }
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                benchmark::DoNotOptimize(compile_all());
+            }
+            state->SetItemsProcessed(state->iterations() * procedure_num);
+            break;
+        }
+        case TEST: {
+            ASSERT_TRUE(compile_all());
+            break;
+        }
+    }
+    if (object_cache) {
+        sys::fs::remove_directories(dir);
+    }
+}
+
+void EngineRunBatchWindowIncrementalAgg(benchmark::State* state, MODE mode,
+                                        int64_t incremental,
+                                        int64_t window_size) {  // NOLINT
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum, "
+        "avg(col3) OVER w1 as w1_col3_avg, "
+        "count(col2) OVER w1 as w1_col2_cnt, "
+        "min(col4) OVER w1 as w1_col4_min, "
+        "max(col5) OVER w1 as w1_col5_max, "
+        "sum_where(col4, col1 > 50) OVER w1 as w1_col4_sum_where "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS BETWEEN " +
+        std::to_string(window_size - 1) + " PRECEDING AND CURRENT ROW);";
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    // one key, the windows of the second half of rows are full
+    int64_t size = window_size * 2;
+    auto catalog = vm::BuildMultiPkTableStorage(size, 1);
+    vm::EngineOptions options;
+    options.SetEnableIncrementalWindowAgg(incremental != 0);
+    Engine engine(catalog, options);
+    BatchRunSession session;
+    base::Status query_status;
+    engine.Get(sql, "db", session, query_status);
+    switch (mode) {
+        case BENCHMARK: {
+            for (auto _ : *state) {
+                std::vector<hybridse::codec::Row> outputs;
+                benchmark::DoNotOptimize(session.Run(outputs));
+            }
+            state->SetItemsProcessed(state->iterations() * size);
+            break;
+        }
+        case TEST: {
+            std::vector<hybridse::codec::Row> outputs;
+            if (0 != session.Run(outputs)) {
+                FAIL();
+            }
+            ASSERT_EQ(static_cast<uint64_t>(size), outputs.size());
+            break;
+        }
+    }
+}
+
 void EngineRunBatchWindowMultiAggWindow25Feature25(benchmark::State* state,
                                                    MODE mode, int64_t limit_cnt,
                                                    int64_t size) {  // NOLINT
@@ -55,6 +55,19 @@ void EngineRunBatchWindowSumFeature5Window5(benchmark::State* state, MODE mode,
 void EngineRunBatchWindowMultiAggWindow25Feature25(benchmark::State* state,
                                                    MODE mode, int64_t limit_cnt,
                                                    int64_t size);  // NOLINT
+// thread_num is the threads of each window aggregation
+void EngineRunBatchWindowMultiAggParallel(benchmark::State* state, MODE mode,
+                                          int64_t thread_num,
+                                          int64_t size);  // NOLINT
+// compile procedure_num procedures by a new engine, with the object code
+// cached on disk or not
+void EngineCompileProcedures(benchmark::State* state, MODE mode,
+                             int64_t object_cache,
+                             int64_t procedure_num);  // NOLINT
+// run the window of window_size rows by the generated code or incrementally
+void EngineRunBatchWindowIncrementalAgg(benchmark::State* state, MODE mode,
+                                        int64_t incremental,
+                                        int64_t window_size);  // NOLINT
 void EngineRunBatchWindowSumFeature5(benchmark::State* state, MODE mode,
                                      int64_t limit_cnt,
                                      int64_t size);  // NOLINT
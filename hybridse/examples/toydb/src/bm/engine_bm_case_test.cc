@@ -61,6 +61,20 @@ TEST_F(EngineBMCaseTest, EngineRunBatchWindowMultiAggWindow25Feature25_TEST) {
     EngineRunBatchWindowMultiAggWindow25Feature25(nullptr, TEST, 100L, 100L);
     EngineRunBatchWindowMultiAggWindow25Feature25(nullptr, TEST, 1000L, 1000L);
 }
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowMultiAggParallel_TEST) {
+    EngineRunBatchWindowMultiAggParallel(nullptr, TEST, 1L, 1000L);
+    EngineRunBatchWindowMultiAggParallel(nullptr, TEST, 4L, 1000L);
+    EngineRunBatchWindowMultiAggParallel(nullptr, TEST, 4L, 10L);
+}
+TEST_F(EngineBMCaseTest, EngineCompileProcedures_TEST) {
+    EngineCompileProcedures(nullptr, TEST, 0L, 2L);
+    EngineCompileProcedures(nullptr, TEST, 1L, 2L);
+}
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowIncrementalAgg_TEST) {
+    EngineRunBatchWindowIncrementalAgg(nullptr, TEST, 0L, 100L);
+    EngineRunBatchWindowIncrementalAgg(nullptr, TEST, 1L, 100L);
+    EngineRunBatchWindowIncrementalAgg(nullptr, TEST, 1L, 1000L);
+}
 TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumFeature1_TEST) {
     EngineRunBatchWindowSumFeature1(nullptr, TEST, 1L, 2L);
     EngineRunBatchWindowSumFeature1(nullptr, TEST, 1L, 10L);
@@ -48,6 +48,34 @@ TEST_P(EngineTest, TestBatchEngine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, TestBatchEngineWithWindowThreads) {
+    auto& sql_case = GetParam();
+    EngineOptions options;
+    options.SetBatchWindowThreadNum(4);
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        EngineCheck(sql_case, options, kBatchMode);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
+TEST_P(EngineTest, TestBatchEngineWithIncrementalWindowAgg) {
+    auto& sql_case = GetParam();
+    EngineOptions options;
+    options.SetEnableIncrementalWindowAgg(true);
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        EngineCheck(sql_case, options, kBatchMode);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 TEST_P(EngineTest, TestBatchRequestEngineForLastRow) {
     auto& sql_case = GetParam();
     EngineOptions options;
@@ -115,6 +143,37 @@ TEST_P(BatchRequestEngineTest, TestClusterBatchRequestEngine) {
     }
 }
 
+class BatchRequestUnionTest : public ::testing::TestWithParam<SqlCase> {};
+
+static void RunEngine(EngineTestRunner* engine_test, std::vector<Row>* outputs) {
+    ASSERT_TRUE(engine_test->InitEngineCatalog());
+    Status status = engine_test->Compile();
+    ASSERT_TRUE(status.isOK()) << status;
+    status = engine_test->PrepareData();
+    ASSERT_TRUE(status.isOK()) << status;
+    status = engine_test->Compute(outputs);
+    ASSERT_TRUE(status.isOK()) << status;
+}
+
+// the requests of a key share the window segments in batch request mode, the
+// outputs are the same as running the requests one by one
+TEST_P(BatchRequestUnionTest, TestBatchRequestSameAsRequest) {
+    auto& sql_case = GetParam();
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    EngineOptions options;
+    ToydbRequestEngineTestRunner request_test(sql_case, options);
+    std::vector<Row> request_outputs;
+    ASSERT_NO_FATAL_FAILURE(RunEngine(&request_test, &request_outputs));
+    ToydbBatchRequestEngineTestRunner batch_request_test(sql_case, options, {});
+    std::vector<Row> batch_request_outputs;
+    ASSERT_NO_FATAL_FAILURE(RunEngine(&batch_request_test, &batch_request_outputs));
+    ASSERT_EQ(sql_case.batch_request().rows_.size(), request_outputs.size());
+    CheckRows(request_test.GetSession()->GetSchema(), batch_request_outputs, request_outputs);
+}
+
+INSTANTIATE_TEST_SUITE_P(BatchRequestUnionQuery, BatchRequestUnionTest,
+                         testing::ValuesIn(sqlcase::InitCases("/cases/query/batch_request_union_query.yaml")));
+
 }  // namespace vm
 }  // namespace hybridse
 
@@ -118,12 +118,8 @@ std::shared_ptr<tablet::TabletCatalog> BuildCommonCatalog(
     return catalog;
 }
 
-std::shared_ptr<tablet::TabletCatalog> BuildOnePkTableStorage(
-    int32_t data_size) {
-    DLOG(INFO) << "insert window data";
-    type::TableDef table_def;
-    std::vector<Row> buffer;
-    CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+static std::shared_ptr<tablet::TabletCatalog> BuildTableStorage(
+    type::TableDef& table_def, const std::vector<Row>& buffer) {  // NOLINT
     // Build index
     ::hybridse::type::IndexDef* index = table_def.add_indexes();
     index->set_name("index1");
@@ -141,6 +137,24 @@ std::shared_ptr<tablet::TabletCatalog> BuildOnePkTableStorage(
     }
     return catalog;
 }
+
+std::shared_ptr<tablet::TabletCatalog> BuildOnePkTableStorage(
+    int32_t data_size) {
+    DLOG(INFO) << "insert window data";
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    CaseDataMock::BuildOnePkTableData(table_def, buffer, data_size);
+    return BuildTableStorage(table_def, buffer);
+}
+
+std::shared_ptr<tablet::TabletCatalog> BuildMultiPkTableStorage(
+    int32_t data_size, int32_t pk_cnt) {
+    DLOG(INFO) << "insert window data of " << pk_cnt << " keys";
+    type::TableDef table_def;
+    std::vector<Row> buffer;
+    CaseDataMock::BuildMultiPkTableData(table_def, buffer, data_size, pk_cnt);
+    return BuildTableStorage(table_def, buffer);
+}
 void BatchRequestEngineCheckWithCommonColumnIndices(
     const SqlCase& sql_case, const EngineOptions options,
     const std::set<size_t>& common_column_indices) {
@@ -43,6 +43,7 @@ bool InitToydbEngineCatalog(SqlCase& sql_case,  // NOLINT
                                 name_table_map,                                     // NOLINT
                             std::shared_ptr<vm::Engine> engine, std::shared_ptr<tablet::TabletCatalog> catalog);
 std::shared_ptr<tablet::TabletCatalog> BuildOnePkTableStorage(int32_t data_size);
+std::shared_ptr<tablet::TabletCatalog> BuildMultiPkTableStorage(int32_t data_size, int32_t pk_cnt);
 void BatchRequestEngineCheckWithCommonColumnIndices(const SqlCase& sql_case, const EngineOptions options,
                                                     const std::set<size_t>& common_column_indices);
 void BatchRequestEngineCheck(const SqlCase& sql_case, const EngineOptions options);
@@ -44,6 +44,7 @@ using ::hybridse::codec::Row;
 inline constexpr const char* LONG_WINDOWS = "long_windows";
 
 class Engine;
+class CompileCache;
 /// \brief An options class for controlling engine behaviour.
 class EngineOptions {
  public:
@@ -113,13 +114,57 @@ class EngineOptions {
         return enable_window_column_pruning_;
     }
 
-    /// Set the maximum number of cache entries, default is `50`.
+    /// Set the number of threads to run a window aggregation in batch mode, default `1`.
+    ///
+    /// The partition keys of the window are split into morsels and run by the
+    /// threads, the window with `LIMIT` or window join is run in one thread.
+    inline EngineOptions* SetBatchWindowThreadNum(uint32_t thread_num) {
+        batch_window_thread_num_ = thread_num;
+        return this;
+    }
+    /// Return the number of threads to run a window aggregation in batch mode.
+    inline uint32_t GetBatchWindowThreadNum() const { return batch_window_thread_num_; }
+
+    /// Set `true` to evaluate the window aggregation incrementally in batch mode, default `false`.
+    ///
+    /// If all the aggregations of a window are incremental udafs on columns, like
+    /// `sum`, `count`, `avg`, `min`, `max` and their `_where` variants, they are
+    /// updated by the rows going into and out of the window instead of iterating
+    /// the whole window for each row. The window with window join or excluding
+    /// the current row or time is run by the generated code.
+    inline EngineOptions* SetEnableIncrementalWindowAgg(bool flag) {
+        enable_incremental_window_agg_ = flag;
+        return this;
+    }
+    /// Return if the window aggregation is evaluated incrementally in batch mode.
+    inline bool IsEnableIncrementalWindowAgg() const { return enable_incremental_window_agg_; }
+
+    /// Set the maximum number of cache entries of a database, default is `50`.
     inline void SetMaxSqlCacheSize(uint32_t size) {
         max_sql_cache_size_ = size;
     }
     /// Return the maximum number of entries we can hold for compiling cache.
     inline uint32_t GetMaxSqlCacheSize() const { return max_sql_cache_size_; }
 
+    /// Set the maximum memory in bytes of all the cache entries, default is `0` which means unlimited.
+    ///
+    /// The memory of an entry is estimated by the size of its generated code and plan.
+    /// The least recently used entries are evicted if it is exceeded.
+    inline EngineOptions* SetSqlCacheCapacity(uint64_t capacity) {
+        sql_cache_capacity_ = capacity;
+        return this;
+    }
+    /// Return the maximum memory in bytes of all the cache entries.
+    inline uint64_t GetSqlCacheCapacity() const { return sql_cache_capacity_; }
+
+    /// Set the number of shards of the compiling cache, default is `16`.
+    inline EngineOptions* SetSqlCacheShardNum(uint32_t shard_num) {
+        sql_cache_shard_num_ = shard_num;
+        return this;
+    }
+    /// Return the number of shards of the compiling cache.
+    inline uint32_t GetSqlCacheShardNum() const { return sql_cache_shard_num_; }
+
     /// Return JitOptions
     inline hybridse::vm::JitOptions& jit_options() { return jit_options_; }
 
@@ -132,7 +177,11 @@ class EngineOptions {
     bool enable_expr_optimize_;
     bool enable_batch_window_parallelization_;
     bool enable_window_column_pruning_;
+    uint32_t batch_window_thread_num_;
+    bool enable_incremental_window_agg_;
     uint32_t max_sql_cache_size_;
+    uint64_t sql_cache_capacity_;
+    uint32_t sql_cache_shard_num_;
     JitOptions jit_options_;
 };
 
@@ -334,7 +383,8 @@ struct ExplainOutput {
 /// \brief An engine is responsible to compile SQL on the specific Catalog.
 ///
 /// An engine can be used to `compile sql and explain the compiling result.
-/// It maintains a LRU cache for compiling result.
+/// It maintains a LRU cache for compiling result. The same sql is compiled once
+/// if it is got by several threads at the same time.
 ///
 /// **Example**
 /// ```
@@ -415,18 +465,18 @@ class Engine {
     /// \brief Clear engine's compiling result cache
     void ClearCacheLocked(const std::string& db);
 
+    /// \brief Return the statistics of engine's compiling result cache by database
+    std::map<std::string, SqlCacheStats> GetCacheStats() const;
+
     /// \brief Get engine's options
     EngineOptions GetEngineOptions();
 
  private:
     bool GetDependentTables(const node::PlanNode* node, const std::string& default_db,
                             std::set<std::pair<std::string, std::string>>* db_tables, base::Status& status);  // NOLINT
-    std::shared_ptr<CompileInfo> GetCacheLocked(const std::string& db,
-                                                const std::string& sql,
-                                                EngineMode engine_mode);
-    bool SetCacheLocked(const std::string& db, const std::string& sql,
-                        EngineMode engine_mode,
-                        std::shared_ptr<CompileInfo> info);
+    std::shared_ptr<CompileInfo> Compile(const std::string& sql, const std::string& db,
+                                         RunSession& session,   // NOLINT
+                                         base::Status* status);
 
     bool IsCompatibleCache(RunSession& session,  // NOLINT
                            std::shared_ptr<CompileInfo> info,
@@ -438,8 +488,7 @@ class Engine {
                  ExplainOutput* explain_output, base::Status* status);
     std::shared_ptr<Catalog> cl_;
     EngineOptions options_;
-    base::SpinMutex mu_;
-    EngineLRUCache lru_cache_;
+    std::unique_ptr<CompileCache> cache_;
 };
 
 /// \brief Local tablet is responsible to run a task locally.
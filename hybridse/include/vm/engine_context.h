@@ -19,7 +19,6 @@
 #include <memory>
 #include <set>
 #include <string>
-#include "boost/compute/detail/lru_cache.hpp"
 #include "vm/physical_op.h"
 namespace hybridse {
 namespace vm {
@@ -47,6 +46,8 @@ class CompileInfo {
     virtual ~CompileInfo() {}
     virtual bool GetIRBuffer(const base::RawBuffer& buf) = 0;
     virtual size_t GetIRSize() = 0;
+    /// Return the estimated memory held by the compiling result in bytes
+    virtual size_t GetMemSize() const = 0;
     virtual const EngineMode GetEngineMode() const = 0;
     virtual const std::string& GetSql() const = 0;
     virtual const Schema& GetSchema() const = 0;
@@ -65,15 +66,15 @@ class CompileInfo {
                                 const std::string& tab) = 0;
 };
 
-/// @typedef EngineLRUCache
-/// - EngineMode
-///     - DB name
-///       - SQL string
-///           - CompileInfo
-typedef std::map<EngineMode,
-                std::map<std::string,
-                    boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>>>
-    EngineLRUCache;
+/// \brief The statistics of the compiling result cache of a database.
+struct SqlCacheStats {
+    uint64_t entry_num = 0;      ///< The number of cached compiling results
+    uint64_t mem_size = 0;       ///< The estimated memory of the cached compiling results in bytes
+    uint64_t hit_count = 0;      ///< The number of lookups found in the cache
+    uint64_t miss_count = 0;     ///< The number of lookups not found in the cache
+    uint64_t compile_count = 0;  ///< The number of misses compiled, the others wait for the same sql being compiled
+    uint64_t evict_count = 0;    ///< The number of compiling results evicted for the limits of the cache
+};
 
 class CompileInfoCache {
  public:
@@ -101,11 +102,22 @@ class JitOptions {
     bool IsEnablePerf() const { return enable_perf_; }
     void SetEnablePerf(bool flag) { enable_perf_ = flag; }
 
+    // the directory to keep the object code compiled by the jit, empty means disabled
+    const std::string& GetObjectCacheDir() const { return object_cache_dir_; }
+    void SetObjectCacheDir(const std::string& dir) { object_cache_dir_ = dir; }
+
+    // the size of the files in the object cache dir in bytes, the least recently used ones are removed
+    // beyond it. 0 means unlimited
+    uint64_t GetObjectCacheCapacity() const { return object_cache_capacity_; }
+    void SetObjectCacheCapacity(uint64_t capacity) { object_cache_capacity_ = capacity; }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    std::string object_cache_dir_;
+    uint64_t object_cache_capacity_ = 0;
 };
 }  // namespace vm
 }  // namespace hybridse
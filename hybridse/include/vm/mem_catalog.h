@@ -240,6 +240,16 @@ class MemTimeTableHandler : public TableHandler {
     OrderType order_type_;
 };
 
+// WindowListener is told of the rows going into the effective window at the
+// front and out of it at the back, the rows popped at the front by
+// `PopFrontData` are not told
+class WindowListener {
+ public:
+    virtual ~WindowListener() {}
+    virtual void OnAddRow(const Row& row) = 0;
+    virtual void OnPopRow(const Row& row) = 0;
+};
+
 class Window : public MemTimeTableHandler {
  public:
     enum WindowFrameType {
@@ -280,10 +290,27 @@ class Window : public MemTimeTableHandler {
     bool exclude_current_row() const { return exclude_current_row_; }
     void set_exclude_current_row(bool flag) { exclude_current_row_ = flag; }
 
+    void set_listener(WindowListener* listener) { listener_ = listener; }
+
  protected:
+    void AddEffectiveRow(uint64_t key, const Row& row) {
+        AddFrontRow(key, row);
+        if (listener_ != nullptr) {
+            listener_->OnAddRow(row);
+        }
+    }
+
+    void PopEffectiveRow() {
+        if (listener_ != nullptr) {
+            listener_->OnPopRow(GetBackRow().second);
+        }
+        PopBackRow();
+    }
+
     bool exclude_current_time_ = false;
     bool exclude_current_row_ = false;
     bool instance_not_in_window_ = false;
+    WindowListener* listener_ = nullptr;
 };
 class WindowRange {
  public:
@@ -460,7 +487,7 @@ class HistoryWindow : public Window {
     //
     // if `start_ts` is empty, no rows eliminated from window
     bool BufferEffectiveWindow(uint64_t key, const Row& row, std::optional<uint64_t> start_ts) {
-        AddFrontRow(key, row);
+        AddEffectiveRow(key, row);
         return Slide(start_ts);
     }
 
@@ -468,7 +495,7 @@ class HistoryWindow : public Window {
         auto cur_size = table_.size();
         while (window_range_.max_size_ > 0 &&
                cur_size > window_range_.max_size_) {
-            PopBackRow();
+            PopEffectiveRow();
             --cur_size;
         }
 
@@ -481,7 +508,7 @@ class HistoryWindow : public Window {
                 break;
             }
             if (kFrameRows == window_range_.frame_type_ || pair.first < start_ts) {
-                PopBackRow();
+                PopEffectiveRow();
                 --cur_size;
             } else {
                 break;
@@ -31,8 +31,24 @@ bool CaseDataMock::LoadResource(const std::string& resource_path,
 void CaseDataMock::BuildOnePkTableData(type::TableDef& table_def,  // NOLINT
                                        std::vector<Row>& buffer,   // NOLINT
                                        int64_t data_size) {
-    ::hybridse::sqlcase::Repeater<std::string> col0(
-        std::vector<std::string>({"hello"}));
+    BuildTableData(table_def, buffer, data_size, {"hello"});
+}
+
+void CaseDataMock::BuildMultiPkTableData(type::TableDef& table_def,  // NOLINT
+                                         std::vector<Row>& buffer,   // NOLINT
+                                         int64_t data_size, int64_t pk_cnt) {
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < pk_cnt; ++i) {
+        keys.push_back("hello" + std::to_string(i));
+    }
+    BuildTableData(table_def, buffer, data_size, keys);
+}
+
+void CaseDataMock::BuildTableData(type::TableDef& table_def,  // NOLINT
+                                  std::vector<Row>& buffer,   // NOLINT
+                                  int64_t data_size,
+                                  const std::vector<std::string>& keys) {
+    ::hybridse::sqlcase::Repeater<std::string> col0(keys);
     IntRepeater<int32_t> col1;
     col1.Range(1, 100, 1);
     IntRepeater<int16_t> col2;
@@ -87,12 +87,22 @@ class CaseDataMock {
     static void BuildOnePkTableData(type::TableDef& table_def,  // NOLINT
                                     std::vector<Row>& buffer,   // NOLINT
                                     int64_t data_size);
+    // the rows are spread over pk_cnt keys of col0 in turn
+    static void BuildMultiPkTableData(type::TableDef& table_def,  // NOLINT
+                                      std::vector<Row>& buffer,   // NOLINT
+                                      int64_t data_size, int64_t pk_cnt);
     static void BuildTableAndData(type::TableDef& table_def,  // NOLINT
                                   std::vector<Row>& buffer,   // NOLINT
                                   int64_t data_size);
     static bool LoadResource(const std::string& resource_path,
                              type::TableDef& table_def,  // NOLINT
                              std::vector<Row>& rows);    // NOLINT
+
+ private:
+    static void BuildTableData(type::TableDef& table_def,  // NOLINT
+                               std::vector<Row>& buffer,   // NOLINT
+                               int64_t data_size,
+                               const std::vector<std::string>& keys);
 };
 
 class CaseSchemaMock {
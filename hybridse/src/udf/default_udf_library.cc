@@ -2557,7 +2557,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
 
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double, Timestamp>();
+        .args_in<int16_t, int32_t, int64_t, float, double, Timestamp>()
+        .incremental();
 
     RegisterExprUdf("minimum").args<AnyArg, AnyArg>(
         [](UdfResolveContext* ctx, ExprNode* x, ExprNode* y) {
@@ -2605,7 +2606,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @since 0.1.0
         )")
         .args_in<int16_t, int32_t, int64_t, float, double, Timestamp, Date,
-                 StringRef>();
+                 StringRef>()
+        .incremental();
 
     RegisterUdafTemplate<MaxUdafDef>("max")
         .doc(R"(
@@ -2629,7 +2631,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @since 0.1.0
         )")
         .args_in<int16_t, int32_t, int64_t, float, double, Timestamp, Date,
-                 StringRef>();
+                 StringRef>()
+        .incremental();
 
     RegisterUdafTemplate<CountUdafDef>("count")
         .doc(R"(
@@ -2653,7 +2656,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @since 0.1.0
         )")
         .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp,
-                 Date, StringRef, LiteralTypedRow<>>();
+                 Date, StringRef, LiteralTypedRow<>>()
+        .incremental();
 
 
     RegisterUdafTemplate<AvgUdafDef>("avg")
@@ -2677,7 +2681,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
             @since 0.1.0
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double>();
+        .args_in<int16_t, int32_t, int64_t, float, double>()
+        .incremental();
 
     RegisterUdafTemplate<DistinctCountDef>("distinct_count")
         .doc(R"(
@@ -2725,7 +2730,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
             @since 0.1.0
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double>();
+        .args_in<int16_t, int32_t, int64_t, float, double>()
+        .incremental();
 
     RegisterUdafTemplate<CountWhereDef>("count_where")
         .doc(R"(
@@ -2750,7 +2756,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @since 0.1.0
         )")
         .args_in<bool, int16_t, int32_t, int64_t, float, double, Timestamp, Date,
-                 StringRef, LiteralTypedRow<>>();
+                 StringRef, LiteralTypedRow<>>()
+        .incremental();
 
     RegisterUdafTemplate<AvgWhereDef>("avg_where")
         .doc(R"(
@@ -2774,7 +2781,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
             @since 0.1.0
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double>();
+        .args_in<int16_t, int32_t, int64_t, float, double>()
+        .incremental();
 
     RegisterUdafTemplate<MinWhereDef>("min_where")
         .doc(R"(
@@ -2798,7 +2806,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
             @since 0.1.0
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double>();
+        .args_in<int16_t, int32_t, int64_t, float, double>()
+        .incremental();
 
     RegisterUdafTemplate<MaxWhereDef>("max_where")
         .doc(R"(
@@ -2822,7 +2831,8 @@ void DefaultUdfLibrary::InitUdaf() {
             @endcode
             @since 0.1.0
         )")
-        .args_in<int16_t, int32_t, int64_t, float, double>();
+        .args_in<int16_t, int32_t, int64_t, float, double>()
+        .incremental();
 
 
     RegisterUdafTemplate<TopKDef>("top")
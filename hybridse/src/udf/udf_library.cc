@@ -180,6 +180,18 @@ bool UdfLibrary::IsListReturn(const std::string& name) const {
     return iter->second->always_return_list;
 }
 
+bool UdfLibrary::IsIncrementalUdaf(const std::string& name) const {
+    std::string canonical_name = GetCanonicalName(name);
+    std::lock_guard<std::mutex> lock(mu_);
+    return incremental_udafs_.find(canonical_name) != incremental_udafs_.end();
+}
+
+void UdfLibrary::SetIncrementalUdaf(const std::string& name) {
+    std::string canonical_name = GetCanonicalName(name);
+    std::lock_guard<std::mutex> lock(mu_);
+    incremental_udafs_.insert(canonical_name);
+}
+
 ExprUdfRegistryHelper UdfLibrary::RegisterExprUdf(const std::string& name) {
     return ExprUdfRegistryHelper(GetCanonicalName(name), this);
 }
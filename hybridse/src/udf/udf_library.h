@@ -111,6 +111,11 @@ class UdfLibrary {
     bool RequireListAt(const std::string& name, size_t index) const;
     bool IsListReturn(const std::string& name) const;
 
+    // an incremental udaf can be evaluated on a sliding window by updating its
+    // state with the rows going into and out of the window
+    bool IsIncrementalUdaf(const std::string& name) const;
+    void SetIncrementalUdaf(const std::string& name);
+
     Status RegisterDynamicUdf(const std::string& name, node::DataType return_type,
             const std::vector<node::DataType>& arg_types, bool is_aggregate, const std::string& file);
 
@@ -172,6 +177,8 @@ class UdfLibrary {
     // external symbols
     std::unordered_map<std::string, void*> external_symbols_;
 
+    std::unordered_set<std::string> incremental_udafs_;
+
     node::NodeManager nm_;
 
     DynamicLibManager lib_manager_;
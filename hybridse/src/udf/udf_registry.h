@@ -1546,6 +1546,14 @@ class UdafRegistryHelper : public UdfRegistryHelper {
         SetAlwaysListAt(index, true);
         return *this;
     }
+
+    // declare that the udaf can be evaluated on a sliding window incrementally,
+    // the batch window aggregation is run without the generated code if all
+    // its udafs support it
+    auto& incremental() {
+        library()->SetIncrementalUdaf(name());
+        return *this;
+    }
 };
 
 template <typename OUT, typename ST, typename... IN>
@@ -1913,6 +1921,11 @@ class UdafTemplateRegistryHelper : public UdfRegistryHelper {
         return *this;
     }
 
+    auto& incremental() {
+        helper_.incremental();
+        return *this;
+    }
+
  private:
     template <typename T>
     int RegisterSingle(UdafRegistryHelper& helper) {  // NOLINT
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/compile_cache.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace hybridse {
+namespace vm {
+
+struct CompileCache::Entry {
+    std::string key;
+    std::string db;
+    std::shared_ptr<CompileInfo> info;
+    uint64_t mem_size;
+    // the tick of the last access, the smaller one is used less recently
+    uint64_t tick;
+    std::list<Entry*>::iterator shard_pos;
+    std::list<Entry*>::iterator db_pos;
+};
+
+struct CompileCache::DbState {
+    // the entries of the db in the shard, the most recently used one is at the front
+    std::list<Entry*> lru;
+    uint64_t mem_size = 0;
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t compile_count = 0;
+    uint64_t evict_count = 0;
+};
+
+struct CompileCache::Shard {
+    mutable base::SpinMutex mu;
+    std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    // all the entries of the shard, the most recently used one is at the front
+    std::list<Entry*> lru;
+    std::unordered_map<std::string, DbState> dbs;
+    // the sqls being compiled
+    std::unordered_map<std::string, std::shared_future<CompileResult>> flights;
+};
+
+CompileCache::CompileCache(uint32_t shard_num, uint32_t max_entries_per_db, uint64_t capacity)
+    : max_entries_per_db_(max_entries_per_db), capacity_(capacity), mem_size_(0), tick_(0), epoch_(0) {
+    shard_num = std::max<uint32_t>(shard_num, 1);
+    for (uint32_t i = 0; i < shard_num; i++) {
+        shards_.emplace_back(std::make_unique<Shard>());
+    }
+}
+
+CompileCache::~CompileCache() {}
+
+std::string CompileCache::BuildKey(EngineMode mode, const std::string& db, const std::string& sql,
+                                   const std::string& signature) {
+    std::string key;
+    key.reserve(db.size() + sql.size() + signature.size() + 32);
+    key.append(std::to_string(mode)).append(1, ':');
+    key.append(std::to_string(db.size())).append(1, ':').append(db);
+    key.append(std::to_string(signature.size())).append(1, ':').append(signature);
+    key.append(sql);
+    return key;
+}
+
+std::shared_ptr<CompileInfo> CompileCache::GetOrCompile(EngineMode mode, const std::string& db,
+                                                        const std::string& sql, const std::string& signature,
+                                                        const CompileFn& compile, base::Status* status) {
+    const std::string key = BuildKey(mode, db, sql, signature);
+    Shard* shard = shards_[std::hash<std::string>()(key) % shards_.size()].get();
+    std::promise<CompileResult> promise;
+    std::shared_future<CompileResult> future;
+    uint64_t epoch = 0;
+    bool leader = false;
+    {
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        auto& db_state = shard->dbs[db];
+        auto it = shard->entries.find(key);
+        if (it != shard->entries.end()) {
+            db_state.hit_count++;
+            Touch(shard, it->second.get());
+            return it->second->info;
+        }
+        db_state.miss_count++;
+        auto flight = shard->flights.find(key);
+        if (flight != shard->flights.end()) {
+            future = flight->second;
+        } else {
+            db_state.compile_count++;
+            leader = true;
+            epoch = epoch_.load(std::memory_order_acquire);
+            future = promise.get_future().share();
+            shard->flights.emplace(key, future);
+        }
+    }
+    if (!leader) {
+        DLOG(INFO) << "wait for the sql compiled by another thread: " << sql;
+        const CompileResult& result = future.get();
+        *status = result.status;
+        return result.info;
+    }
+
+    CompileResult result;
+    bool cached = false;
+    try {
+        result.info = compile(&result.status);
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        shard->flights.erase(key);
+        if (result.info && epoch == epoch_.load(std::memory_order_acquire)) {
+            Insert(shard, key, db, result.info);
+            cached = true;
+        }
+    } catch (...) {
+        // the waiters get the exception, and the sql is compiled again by the next caller
+        {
+            std::lock_guard<base::SpinMutex> lock(shard->mu);
+            shard->flights.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    promise.set_value(result);
+    if (cached) {
+        EvictOverLimit(db);
+    }
+    *status = result.status;
+    return result.info;
+}
+
+void CompileCache::Put(EngineMode mode, const std::string& db, const std::string& sql,
+                       const std::string& signature, const std::shared_ptr<CompileInfo>& info) {
+    const std::string key = BuildKey(mode, db, sql, signature);
+    Shard* shard = shards_[std::hash<std::string>()(key) % shards_.size()].get();
+    {
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        auto it = shard->entries.find(key);
+        if (it != shard->entries.end()) {
+            Remove(shard, it->second.get());
+        }
+        Insert(shard, key, db, info);
+    }
+    EvictOverLimit(db);
+}
+
+void CompileCache::EvictOverLimit(const std::string& db) {
+    if (max_entries_per_db_ > 0) {
+        Evict(&db, [this, &db]() { return GetEntryNum(db) > max_entries_per_db_; });
+    }
+    if (capacity_ > 0) {
+        Evict(nullptr, [this]() { return mem_size_.load(std::memory_order_relaxed) > capacity_; });
+    }
+}
+
+void CompileCache::Touch(Shard* shard, Entry* entry) {
+    entry->tick = tick_.fetch_add(1, std::memory_order_relaxed);
+    shard->lru.splice(shard->lru.begin(), shard->lru, entry->shard_pos);
+    auto& db_lru = shard->dbs[entry->db].lru;
+    db_lru.splice(db_lru.begin(), db_lru, entry->db_pos);
+}
+
+void CompileCache::Insert(Shard* shard, const std::string& key, const std::string& db,
+                          const std::shared_ptr<CompileInfo>& info) {
+    auto entry = std::make_unique<Entry>();
+    entry->key = key;
+    entry->db = db;
+    entry->info = info;
+    entry->mem_size = key.size() + info->GetMemSize();
+    entry->tick = tick_.fetch_add(1, std::memory_order_relaxed);
+    auto& db_state = shard->dbs[db];
+    shard->lru.push_front(entry.get());
+    entry->shard_pos = shard->lru.begin();
+    db_state.lru.push_front(entry.get());
+    entry->db_pos = db_state.lru.begin();
+    db_state.mem_size += entry->mem_size;
+    mem_size_.fetch_add(entry->mem_size, std::memory_order_relaxed);
+    shard->entries[key] = std::move(entry);
+}
+
+uint64_t CompileCache::Remove(Shard* shard, Entry* entry) {
+    uint64_t mem_size = entry->mem_size;
+    auto& db_state = shard->dbs[entry->db];
+    db_state.lru.erase(entry->db_pos);
+    db_state.mem_size -= mem_size;
+    shard->lru.erase(entry->shard_pos);
+    mem_size_.fetch_sub(mem_size, std::memory_order_relaxed);
+    // the key is owned by the entry
+    std::string key = std::move(entry->key);
+    shard->entries.erase(key);
+    return mem_size;
+}
+
+void CompileCache::Evict(const std::string* db, const std::function<bool()>& over_limit) {
+    while (over_limit()) {
+        // find the least recently used entry across the shards
+        Shard* victim = nullptr;
+        uint64_t min_tick = std::numeric_limits<uint64_t>::max();
+        for (auto& shard : shards_) {
+            std::lock_guard<base::SpinMutex> lock(shard->mu);
+            const std::list<Entry*>* lru = &shard->lru;
+            if (db != nullptr) {
+                auto it = shard->dbs.find(*db);
+                if (it == shard->dbs.end()) {
+                    continue;
+                }
+                lru = &it->second.lru;
+            }
+            if (!lru->empty() && lru->back()->tick < min_tick) {
+                min_tick = lru->back()->tick;
+                victim = shard.get();
+            }
+        }
+        if (victim == nullptr) {
+            return;
+        }
+        std::lock_guard<base::SpinMutex> lock(victim->mu);
+        std::list<Entry*>& lru = db == nullptr ? victim->lru : victim->dbs[*db].lru;
+        // the entry may be touched or removed by others after the scan, it is
+        // fine to evict the least recently used one of the shard instead
+        if (!lru.empty()) {
+            Entry* entry = lru.back();
+            victim->dbs[entry->db].evict_count++;
+            DLOG(INFO) << "evict the compiling result of db " << entry->db;
+            Remove(victim, entry);
+        }
+    }
+}
+
+uint64_t CompileCache::GetEntryNum(const std::string& db) const {
+    uint64_t num = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        auto it = shard->dbs.find(db);
+        if (it != shard->dbs.end()) {
+            num += it->second.lru.size();
+        }
+    }
+    return num;
+}
+
+void CompileCache::Clear(const std::string& db) {
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+    for (auto& shard : shards_) {
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        if (db.empty()) {
+            while (!shard->lru.empty()) {
+                Remove(shard.get(), shard->lru.back());
+            }
+            continue;
+        }
+        auto it = shard->dbs.find(db);
+        if (it == shard->dbs.end()) {
+            continue;
+        }
+        while (!it->second.lru.empty()) {
+            Remove(shard.get(), it->second.lru.back());
+        }
+    }
+}
+
+std::map<std::string, SqlCacheStats> CompileCache::GetStats() const {
+    std::map<std::string, SqlCacheStats> stats;
+    for (auto& shard : shards_) {
+        std::lock_guard<base::SpinMutex> lock(shard->mu);
+        for (auto& kv : shard->dbs) {
+            auto& db_stats = stats[kv.first];
+            db_stats.entry_num += kv.second.lru.size();
+            db_stats.mem_size += kv.second.mem_size;
+            db_stats.hit_count += kv.second.hit_count;
+            db_stats.miss_count += kv.second.miss_count;
+            db_stats.compile_count += kv.second.compile_count;
+            db_stats.evict_count += kv.second.evict_count;
+        }
+    }
+    return stats;
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_SRC_VM_COMPILE_CACHE_H_
+#define HYBRIDSE_SRC_VM_COMPILE_CACHE_H_
+
+#include <atomic>
+#include <functional>
+#include <future>  // NOLINT
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/fe_status.h"
+#include "base/spin_lock.h"
+#include "vm/engine_context.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * CompileCache caches the compiling results of the engine.
+ *
+ * - The entries are split into shards by the hash of their keys, a lookup
+ *   locks one shard only.
+ * - The sql is compiled once on a miss, the other callers of the same key wait
+ *   for the result of the first one instead of compiling it again.
+ * - An entry is evicted in the least recently used order if the entries of
+ *   its db exceed `max_entries_per_db` or the memory of all the entries exceeds
+ *   `capacity`. The order is kept by the ticks of the entries across the
+ *   shards, so it is the same as a single LRU list.
+ */
+class CompileCache {
+ public:
+    // compile the sql on a miss, return nullptr and set the status if it fails
+    using CompileFn = std::function<std::shared_ptr<CompileInfo>(base::Status*)>;
+
+    // capacity is the memory of all the entries in bytes, 0 means unlimited
+    CompileCache(uint32_t shard_num, uint32_t max_entries_per_db, uint64_t capacity);
+    ~CompileCache();
+    CompileCache(const CompileCache&) = delete;
+    CompileCache& operator=(const CompileCache&) = delete;
+
+    /**
+     * Return the cached compiling result of the sql, or compile it by
+     * `compile`. The signature is the session context the compiling result
+     * depends on besides the engine mode, db and sql.
+     */
+    std::shared_ptr<CompileInfo> GetOrCompile(EngineMode mode, const std::string& db, const std::string& sql,
+                                              const std::string& signature, const CompileFn& compile,
+                                              base::Status* status);
+
+    // cache the compiling result of the sql, the entry of it is overwritten if any
+    void Put(EngineMode mode, const std::string& db, const std::string& sql, const std::string& signature,
+             const std::shared_ptr<CompileInfo>& info);
+
+    // clear the entries of db, or all the entries if db is empty. The sql
+    // being compiled at the moment is not cached when it is done
+    void Clear(const std::string& db);
+
+    std::map<std::string, SqlCacheStats> GetStats() const;
+
+ private:
+    struct Entry;
+    struct DbState;
+    struct Shard;
+    struct CompileResult {
+        std::shared_ptr<CompileInfo> info;
+        base::Status status;
+    };
+
+    static std::string BuildKey(EngineMode mode, const std::string& db, const std::string& sql,
+                                const std::string& signature);
+
+    void Touch(Shard* shard, Entry* entry);
+    void Insert(Shard* shard, const std::string& key, const std::string& db, const std::shared_ptr<CompileInfo>& info);
+    // remove the entry and return its memory, the shard is locked by the caller
+    uint64_t Remove(Shard* shard, Entry* entry);
+
+    // evict the least recently used entries of db, or of all the dbs if db is
+    // nullptr, till `over_limit` returns false
+    void Evict(const std::string* db, const std::function<bool()>& over_limit);
+    // evict the entries over the limits after an entry of db is inserted
+    void EvictOverLimit(const std::string& db);
+    uint64_t GetEntryNum(const std::string& db) const;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    const uint32_t max_entries_per_db_;
+    const uint64_t capacity_;
+    std::atomic<uint64_t> mem_size_;
+    std::atomic<uint64_t> tick_;
+    // increased by Clear, the result of a compile started before it is not cached
+    std::atomic<uint64_t> epoch_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_COMPILE_CACHE_H_
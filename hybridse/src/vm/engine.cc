@@ -19,8 +19,6 @@
 #include <utility>
 #include <vector>
 #include "base/fe_strings.h"
-#include "boost/none.hpp"
-#include "boost/optional.hpp"
 #include "codec/fe_row_codec.h"
 #include "codec/fe_schema_codec.h"
 #include "codec/list_iterator_codec.h"
@@ -28,6 +26,7 @@
 #include "gflags/gflags.h"
 #include "llvm-c/Target.h"
 #include "udf/default_udf_library.h"
+#include "vm/compile_cache.h"
 #include "vm/local_tablet_handler.h"
 #include "vm/mem_catalog.h"
 #include "vm/sql_compiler.h"
@@ -48,12 +47,19 @@ EngineOptions::EngineOptions()
       enable_expr_optimize_(true),
       enable_batch_window_parallelization_(false),
       enable_window_column_pruning_(false),
-      max_sql_cache_size_(50) {
+      batch_window_thread_num_(1),
+      enable_incremental_window_agg_(false),
+      max_sql_cache_size_(50),
+      sql_cache_capacity_(0),
+      sql_cache_shard_num_(16) {
 }
 
-Engine::Engine(const std::shared_ptr<Catalog>& catalog) : cl_(catalog), options_(), mu_(), lru_cache_() {}
+Engine::Engine(const std::shared_ptr<Catalog>& catalog) : Engine(catalog, EngineOptions()) {}
 Engine::Engine(const std::shared_ptr<Catalog>& catalog, const EngineOptions& options)
-    : cl_(catalog), options_(options), mu_(), lru_cache_() {}
+    : cl_(catalog),
+      options_(options),
+      cache_(std::make_unique<CompileCache>(options.GetSqlCacheShardNum(), options.GetMaxSqlCacheSize(),
+                                            options.GetSqlCacheCapacity())) {}
 Engine::~Engine() {}
 void Engine::InitializeGlobalLLVM() {
     if (LLVM_IS_INITIALIZED) return;
@@ -200,22 +206,66 @@ bool Engine::IsCompatibleCache(RunSession& session,  // NOLINT
     return true;
 }
 
+// the session context the compiling result depends on besides the mode, db and sql. The result of a
+// procedure differs from the others in the jit options, see Engine::Compile
+static std::string CacheSignature(RunSession& session, bool is_procedure) {  // NOLINT
+    std::ostringstream oss;
+    oss << (is_procedure ? "sp" : "") << ";";
+    if (session.engine_mode() == kBatchMode) {
+        for (auto& column : dynamic_cast<BatchRunSession*>(&session)->GetParameterSchema()) {
+            oss << column.type() << ",";
+        }
+    } else if (session.engine_mode() == kBatchRequestMode) {
+        auto batch_req_sess = dynamic_cast<BatchRequestRunSession*>(&session);
+        if (batch_req_sess != nullptr) {
+            for (auto idx : batch_req_sess->common_column_indices()) {
+                oss << idx << ",";
+            }
+        }
+    }
+    oss << ";";
+    auto options = session.GetOptions();
+    if (options) {
+        std::map<std::string, std::string> sorted_options(options->begin(), options->end());
+        for (auto& kv : sorted_options) {
+            oss << kv.first.size() << ":" << kv.first << kv.second.size() << ":" << kv.second;
+        }
+    }
+    return oss.str();
+}
+
 bool Engine::Get(const std::string& sql, const std::string& db, RunSession& session,
                  base::Status& status) {  // NOLINT (runtime/references)
-    std::shared_ptr<CompileInfo> cached_info = GetCacheLocked(db, sql, session.engine_mode());
-    if (cached_info && IsCompatibleCache(session, cached_info, status)) {
-        session.SetCompileInfo(cached_info);
-        return true;
+    status = base::Status::OK();
+    auto compile = [this, &sql, &db, &session](base::Status* compile_status) {
+        return Compile(sql, db, session, compile_status);
+    };
+    const std::string signature = CacheSignature(session, !session.sp_name_.empty());
+    std::shared_ptr<CompileInfo> info =
+        cache_->GetOrCompile(session.engine_mode(), db, sql, signature, compile, &status);
+    if (!info) {
+        return false;
     }
-    // TODO(baoxinqi): IsCompatibleCache fail, return false, or reset status.
-    if (!status.isOK()) {
+    if (!IsCompatibleCache(session, info, status)) {
+        // compile the sql for the session and replace the cached result with it
         LOG(WARNING) << status;
         status = base::Status::OK();
+        info = compile(&status);
+        if (!info) {
+            return false;
+        }
+        cache_->Put(session.engine_mode(), db, sql, signature, info);
     }
+    session.SetCompileInfo(info);
+    return true;
+}
+
+std::shared_ptr<CompileInfo> Engine::Compile(const std::string& sql, const std::string& db,
+                                             RunSession& session,  // NOLINT
+                                             base::Status* status) {
     DLOG(INFO) << "Compile Engine ...";
-    status = base::Status::OK();
     std::shared_ptr<SqlCompileInfo> info = std::make_shared<SqlCompileInfo>();
-    auto& sql_context = std::dynamic_pointer_cast<SqlCompileInfo>(info)->get_sql_context();
+    auto& sql_context = info->get_sql_context();
     sql_context.sql = sql;
     sql_context.db = db;
     sql_context.engine_mode = session.engine_mode();
@@ -223,8 +273,14 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
     sql_context.is_batch_request_optimized = options_.IsBatchRequestOptimized();
     sql_context.enable_batch_window_parallelization = options_.IsEnableBatchWindowParallelization();
     sql_context.enable_window_column_pruning = options_.IsEnableWindowColumnPruning();
+    sql_context.batch_window_thread_num = options_.GetBatchWindowThreadNum();
+    sql_context.enable_incremental_window_agg = options_.IsEnableIncrementalWindowAgg();
     sql_context.enable_expr_optimize = options_.IsEnableExprOptimize();
     sql_context.jit_options = options_.jit_options();
+    if (session.sp_name_.empty()) {
+        // only the procedures are compiled again after restarting, the object code of the others is not kept
+        sql_context.jit_options.SetObjectCacheDir("");
+    }
     sql_context.options = session.GetOptions();
     if (session.engine_mode() == kBatchMode) {
         sql_context.parameter_types = dynamic_cast<BatchRunSession*>(&session)->GetParameterSchema();
@@ -235,20 +291,18 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
 
     SqlCompiler compiler(std::atomic_load_explicit(&cl_, std::memory_order_acquire), options_.IsKeepIr(), false,
                          options_.IsPlanOnly());
-    bool ok = compiler.Compile(info->get_sql_context(), status);
-    if (!ok || 0 != status.code) {
-        return false;
+    bool ok = compiler.Compile(info->get_sql_context(), *status);
+    if (!ok || 0 != status->code) {
+        return nullptr;
     }
     if (!options_.IsCompileOnly()) {
-        ok = compiler.BuildClusterJob(info->get_sql_context(), status);
-        if (!ok || 0 != status.code) {
-            LOG(WARNING) << "fail to build cluster job: " << status.msg;
-            return false;
+        ok = compiler.BuildClusterJob(info->get_sql_context(), *status);
+        if (!ok || 0 != status->code) {
+            LOG(WARNING) << "fail to build cluster job: " << status->msg;
+            return nullptr;
         }
     }
 
-    SetCacheLocked(db, sql, session.engine_mode(), info);
-    session.SetCompileInfo(info);
     if (session.is_debug_) {
         std::ostringstream plan_oss;
         if (nullptr != sql_context.physical_plan) {
@@ -259,7 +313,7 @@ bool Engine::Get(const std::string& sql, const std::string& db, RunSession& sess
         sql_context.cluster_job.Print(runner_oss, "");
         LOG(INFO) << "cluster job:\n" << runner_oss.str() << std::endl;
     }
-    return true;
+    return info;
 }
 
 base::Status Engine::RegisterExternalFunction(const std::string& name, node::DataType return_type,
@@ -366,69 +420,14 @@ bool Engine::Explain(const std::string& sql, const std::string& db, EngineMode e
     return Explain(sql, db, engine_mode, empty_schema, common_column_indices, explain_output, status);
 }
 
-void Engine::ClearCacheLocked(const std::string& db) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    if (db.empty()) {
-        lru_cache_.clear();
-        return;
-    }
-    for (auto& cache : lru_cache_) {
-        auto& mode_cache = cache.second;
-        mode_cache.erase(db);
-    }
-}
+void Engine::ClearCacheLocked(const std::string& db) { cache_->Clear(db); }
+
+std::map<std::string, SqlCacheStats> Engine::GetCacheStats() const { return cache_->GetStats(); }
 
 EngineOptions Engine::GetEngineOptions() {
     return options_;
 }
 
-std::shared_ptr<CompileInfo> Engine::GetCacheLocked(const std::string& db, const std::string& sql,
-                                                    EngineMode engine_mode) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-    // Check mode
-    auto mode_iter = lru_cache_.find(engine_mode);
-    if (mode_iter == lru_cache_.end()) {
-        return nullptr;
-    }
-    auto& mode_cache = mode_iter->second;
-    // Check db
-    auto db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        return nullptr;
-    }
-    auto& lru = db_iter->second;
-
-    // Check SQL
-    auto value = lru.get(sql);
-    if (value == boost::none) {
-        return nullptr;
-    } else {
-        return value.value();
-    }
-}
-
-bool Engine::SetCacheLocked(const std::string& db, const std::string& sql, EngineMode engine_mode,
-                            std::shared_ptr<CompileInfo> info) {
-    std::lock_guard<base::SpinMutex> lock(mu_);
-
-    auto& mode_cache = lru_cache_[engine_mode];
-    using BoostLRU = boost::compute::detail::lru_cache<std::string, std::shared_ptr<CompileInfo>>;
-    std::map<std::string, BoostLRU>::iterator db_iter = mode_cache.find(db);
-    if (db_iter == mode_cache.end()) {
-        db_iter = mode_cache.insert(db_iter, {db, BoostLRU(options_.GetMaxSqlCacheSize())});
-    }
-    auto& lru = db_iter->second;
-    auto value = lru.get(sql);
-    if (value == boost::none || engine_mode == kBatchRequestMode) {
-        lru.insert(sql, info);
-        return true;
-    } else {
-        // TODO(xxx): Ensure compile result is stable
-        DLOG(INFO) << "Engine cache already exists: " << engine_mode << " " << db << "\n" << sql;
-        return false;
-    }
-}
-
 RunSession::RunSession(EngineMode engine_mode) : engine_mode_(engine_mode), is_debug_(false), sp_name_("") {}
 RunSession::~RunSession() {}
 
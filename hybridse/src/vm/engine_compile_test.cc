@@ -14,11 +14,16 @@
  * limitations under the License.
  */
 
+#include <stdexcept>
+#include <thread>  // NOLINT
+
 #include "case/case_data_mock.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "testing/engine_test_base.h"
 #include "udf/openmldb_udf.h"
+#include "vm/compile_cache.h"
+#include "vm/sql_compiler.h"
 
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
@@ -157,6 +162,105 @@ TEST_F(EngineCompileTest, EngineWithParameterizedLRUCacheTest) {
 }
 
 
+TEST_F(EngineCompileTest, EngineConcurrentCompileCacheTest) {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.SetCompileOnly(true);
+    Engine engine(catalog, options);
+
+    // the sql is compiled once by the threads getting it at the same time
+    std::string sql = "select col1, col2 + 1 as c2 from t1;";
+    std::vector<std::shared_ptr<CompileInfo>> infos(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < infos.size(); i++) {
+        threads.emplace_back([&engine, &sql, &infos, i]() {
+            base::Status get_status;
+            BatchRunSession session;
+            if (engine.Get(sql, "simple_db", session, get_status)) {
+                infos[i] = session.GetCompileInfo();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& info : infos) {
+        ASSERT_TRUE(info != nullptr);
+        ASSERT_EQ(infos[0].get(), info.get());
+    }
+    auto stats = engine.GetCacheStats();
+    ASSERT_EQ(1u, stats["simple_db"].entry_num);
+    ASSERT_EQ(1u, stats["simple_db"].compile_count);
+    ASSERT_EQ(infos.size(), stats["simple_db"].hit_count + stats["simple_db"].miss_count);
+    ASSERT_GT(stats["simple_db"].mem_size, 0u);
+
+    engine.ClearCacheLocked("simple_db");
+    stats = engine.GetCacheStats();
+    ASSERT_EQ(0u, stats["simple_db"].entry_num);
+    ASSERT_EQ(0u, stats["simple_db"].mem_size);
+}
+
+TEST_F(EngineCompileTest, EngineCompileCacheCapacityTest) {
+    auto catalog = BuildSimpleCatalog();
+    hybridse::type::Database db;
+    db.set_name("simple_db");
+    hybridse::type::TableDef table_def;
+    sqlcase::CaseSchemaMock::BuildTableDef(table_def);
+    table_def.set_name("t1");
+    AddTable(db, table_def);
+    catalog->AddDatabase(db);
+
+    EngineOptions options;
+    options.SetCompileOnly(true);
+    // a byte is less than any compiling result, only the latest one is kept
+    options.SetSqlCacheCapacity(1);
+    Engine engine(catalog, options);
+
+    std::string sql = "select col1, col2 from t1;";
+    std::string sql2 = "select col1, col2 as cl2 from t1;";
+    base::Status get_status;
+    BatchRunSession bsession1;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession1, get_status)) << get_status;
+    BatchRunSession bsession2;
+    ASSERT_TRUE(engine.Get(sql2, "simple_db", bsession2, get_status)) << get_status;
+    BatchRunSession bsession3;
+    ASSERT_TRUE(engine.Get(sql, "simple_db", bsession3, get_status)) << get_status;
+    ASSERT_NE(bsession1.GetCompileInfo().get(), bsession3.GetCompileInfo().get());
+    auto stats = engine.GetCacheStats();
+    ASSERT_EQ(3u, stats["simple_db"].evict_count);
+    ASSERT_EQ(0u, stats["simple_db"].entry_num);
+}
+
+TEST_F(EngineCompileTest, CompileCacheExceptionAndPutTest) {
+    CompileCache cache(4, 0, 0);
+    base::Status status;
+    // the sql being compiled is abandoned if the compiling throws
+    auto throw_compile = [](base::Status*) -> std::shared_ptr<CompileInfo> {
+        throw std::runtime_error("fail to compile");
+    };
+    ASSERT_THROW(cache.GetOrCompile(kBatchMode, "db", "select 1;", "", throw_compile, &status), std::runtime_error);
+    auto info = std::make_shared<SqlCompileInfo>();
+    auto compile = [&info](base::Status*) -> std::shared_ptr<CompileInfo> { return info; };
+    ASSERT_EQ(info.get(), cache.GetOrCompile(kBatchMode, "db", "select 1;", "", compile, &status).get());
+    ASSERT_TRUE(status.isOK());
+
+    // the cached result is overwritten by Put
+    auto info2 = std::make_shared<SqlCompileInfo>();
+    cache.Put(kBatchMode, "db", "select 1;", "", info2);
+    ASSERT_EQ(info2.get(), cache.GetOrCompile(kBatchMode, "db", "select 1;", "", compile, &status).get());
+    auto stats = cache.GetStats();
+    ASSERT_EQ(1u, stats["db"].entry_num);
+    ASSERT_EQ(2u, stats["db"].compile_count);
+}
+
 TEST_F(EngineCompileTest, EngineEmptyDefaultDBLRUCacheTest) {
     // Build Simple Catalog
     auto catalog = BuildSimpleCatalog();
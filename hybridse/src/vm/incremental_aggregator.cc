@@ -0,0 +1,617 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/incremental_aggregator.h"
+
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "vm/internal/eval.h"
+
+namespace hybridse {
+namespace vm {
+
+class IncrementalAggregator {
+ public:
+    IncrementalAggregator(const IncrementalWindowAgg* agg, const IncrementalWindowAgg::Project* project)
+        : agg_(agg), project_(project) {}
+    virtual ~IncrementalAggregator() {}
+
+    virtual void Add(const Row& row) = 0;
+    virtual void Pop(const Row& row) = 0;
+    // append the aggregation of the window to the output row
+    virtual void Output(codec::RowBuilder* builder) = 0;
+
+ protected:
+    // return false if the row is not taken by the aggregation
+    bool Take(const Row& row) {
+        if (project_->has_column && agg_->IsNull(row, project_->column)) {
+            return false;
+        }
+        return agg_->EvalCond(row, *project_);
+    }
+    bool Take(const Row& row, int64_t* val) {
+        if (!agg_->GetInt(row, project_->column, val) || (project_->skip_zero && *val == 0)) {
+            return false;
+        }
+        return agg_->EvalCond(row, *project_);
+    }
+    bool Take(const Row& row, double* val) {
+        if (!agg_->GetDouble(row, project_->column, val) || (project_->skip_zero && *val == 0)) {
+            return false;
+        }
+        return agg_->EvalCond(row, *project_);
+    }
+
+    const IncrementalWindowAgg* agg_;
+    const IncrementalWindowAgg::Project* project_;
+};
+
+namespace {
+
+void AppendValue(codec::RowBuilder* builder, type::Type type, int64_t val) {
+    switch (type) {
+        case type::kInt16:
+            builder->AppendInt16(static_cast<int16_t>(val));
+            break;
+        case type::kInt32:
+            builder->AppendInt32(static_cast<int32_t>(val));
+            break;
+        case type::kInt64:
+            builder->AppendInt64(val);
+            break;
+        case type::kTimestamp:
+            builder->AppendTimestamp(val);
+            break;
+        case type::kFloat:
+            builder->AppendFloat(static_cast<float>(val));
+            break;
+        case type::kDouble:
+            builder->AppendDouble(static_cast<double>(val));
+            break;
+        default:
+            LOG(WARNING) << "incremental aggregation does not support output type " << type::Type_Name(type);
+            builder->AppendNULL();
+            break;
+    }
+}
+
+void AppendValue(codec::RowBuilder* builder, type::Type type, double val) {
+    switch (type) {
+        case type::kFloat:
+            builder->AppendFloat(static_cast<float>(val));
+            break;
+        case type::kDouble:
+            builder->AppendDouble(val);
+            break;
+        default:
+            LOG(WARNING) << "incremental aggregation does not support output type " << type::Type_Name(type);
+            builder->AppendNULL();
+            break;
+    }
+}
+
+class CountAggregator : public IncrementalAggregator {
+ public:
+    using IncrementalAggregator::IncrementalAggregator;
+
+    void Add(const Row& row) override {
+        if (Take(row)) {
+            cnt_++;
+        }
+    }
+    void Pop(const Row& row) override {
+        if (Take(row)) {
+            cnt_--;
+        }
+    }
+    void Output(codec::RowBuilder* builder) override { AppendValue(builder, project_->output_type, cnt_); }
+
+ private:
+    int64_t cnt_ = 0;
+};
+
+// sum of the integers, it wraps around the same as the generated code. The avg
+// of the integers is summed in double like the generated code, see FloatSumAggregator
+class IntSumAggregator : public IncrementalAggregator {
+ public:
+    using IncrementalAggregator::IncrementalAggregator;
+
+    void Add(const Row& row) override {
+        int64_t val = 0;
+        if (Take(row, &val)) {
+            sum_ += static_cast<uint64_t>(val);
+            cnt_++;
+        }
+    }
+    void Pop(const Row& row) override {
+        int64_t val = 0;
+        if (Take(row, &val)) {
+            sum_ -= static_cast<uint64_t>(val);
+            cnt_--;
+        }
+    }
+    void Output(codec::RowBuilder* builder) override {
+        if (cnt_ == 0) {
+            builder->AppendNULL();
+        } else {
+            AppendValue(builder, project_->output_type, static_cast<int64_t>(sum_));
+        }
+    }
+
+ private:
+    uint64_t sum_ = 0;
+    int64_t cnt_ = 0;
+};
+
+// sum and avg of the floats in T. The rows going in are pushed to the back
+// stack, and the rows going out are popped from the front stack of the sums
+// from the top down, which is refilled by the back stack once it is empty
+template <typename T>
+class FloatSumAggregator : public IncrementalAggregator {
+ public:
+    using IncrementalAggregator::IncrementalAggregator;
+
+    void Add(const Row& row) override {
+        double val = 0;
+        if (Take(row, &val)) {
+            back_.push_back(static_cast<T>(val));
+            back_sum_ += static_cast<T>(val);
+        }
+    }
+    void Pop(const Row& row) override {
+        double val = 0;
+        if (!Take(row, &val)) {
+            return;
+        }
+        if (front_.empty()) {
+            // the newest row is at the bottom and the oldest is at the top
+            T sum = 0;
+            for (auto iter = back_.rbegin(); iter != back_.rend(); ++iter) {
+                sum += *iter;
+                front_.push_back(sum);
+            }
+            back_.clear();
+            back_sum_ = 0;
+        }
+        front_.pop_back();
+    }
+    void Output(codec::RowBuilder* builder) override {
+        size_t cnt = front_.size() + back_.size();
+        if (cnt == 0) {
+            builder->AppendNULL();
+            return;
+        }
+        T sum = front_.empty() ? back_sum_ : front_.back() + back_sum_;
+        if (project_->agg_type == IncrementalWindowAgg::kAvg) {
+            AppendValue(builder, project_->output_type, static_cast<double>(sum) / cnt);
+        } else {
+            AppendValue(builder, project_->output_type, static_cast<double>(sum));
+        }
+    }
+
+ private:
+    std::vector<T> front_;
+    std::vector<T> back_;
+    T back_sum_ = 0;
+};
+
+// min or max in V. The deque keeps the rows which may be the result once the
+// rows before them go out, in the order they go in, so the values are monotonic
+// and the front is the result
+template <typename V, bool IS_MAX>
+class MinMaxAggregator : public IncrementalAggregator {
+ public:
+    using IncrementalAggregator::IncrementalAggregator;
+
+    void Add(const Row& row) override {
+        uint64_t seq = add_seq_++;
+        V val = 0;
+        if (!Take(row, &val)) {
+            return;
+        }
+        while (!candidates_.empty() &&
+               (IS_MAX ? candidates_.back().second <= val : candidates_.back().second >= val)) {
+            candidates_.pop_back();
+        }
+        candidates_.emplace_back(seq, val);
+    }
+    void Pop(const Row& row) override {
+        // the rows go out in the order they go in, so the seq tells the row
+        uint64_t seq = pop_seq_++;
+        if (!candidates_.empty() && candidates_.front().first == seq) {
+            candidates_.pop_front();
+        }
+    }
+    void Output(codec::RowBuilder* builder) override {
+        if (candidates_.empty()) {
+            builder->AppendNULL();
+        } else {
+            AppendValue(builder, project_->output_type, candidates_.front().second);
+        }
+    }
+
+ private:
+    uint64_t add_seq_ = 0;
+    uint64_t pop_seq_ = 0;
+    std::deque<std::pair<uint64_t, V>> candidates_;
+};
+
+bool IsIntType(type::Type type) {
+    return type == type::kInt16 || type == type::kInt32 || type == type::kInt64 || type == type::kTimestamp;
+}
+
+bool IsFloatType(type::Type type) { return type == type::kFloat || type == type::kDouble; }
+
+bool ResolveColumn(const SchemasContext* schemas_ctx, const node::ExprNode* expr,
+                   IncrementalWindowAgg::Column* column) {
+    if (expr->GetExprType() != node::kExprColumnRef) {
+        return false;
+    }
+    if (!schemas_ctx->ResolveColumnRefIndex(dynamic_cast<const node::ColumnRefNode*>(expr), &column->schema_idx,
+                                            &column->col_idx)
+             .isOK()) {
+        return false;
+    }
+    column->type = schemas_ctx->GetSchemaSource(column->schema_idx)->GetSchema()->Get(column->col_idx).type();
+    return true;
+}
+
+// the condition evaluated by `internal::EvalCond` the same as the generated code,
+// which is `column op constant` and the constant is of the column type
+bool IsSimpleCond(const SchemasContext* schemas_ctx, const node::ExprNode* cond) {
+    if (cond->GetExprType() != node::kExprBinary) {
+        return false;
+    }
+    auto bin_expr = dynamic_cast<const node::BinaryExpr*>(cond);
+    switch (bin_expr->GetOp()) {
+        case node::kFnOpLt:
+        case node::kFnOpLe:
+        case node::kFnOpGt:
+        case node::kFnOpGe:
+        case node::kFnOpEq:
+        case node::kFnOpNeq:
+            break;
+        default:
+            return false;
+    }
+    const node::ExprNode* col = bin_expr->GetChild(0);
+    const node::ExprNode* val = bin_expr->GetChild(1);
+    if (col->GetExprType() == node::kExprPrimary) {
+        std::swap(col, val);
+    }
+    IncrementalWindowAgg::Column column;
+    if (val->GetExprType() != node::kExprPrimary || !ResolveColumn(schemas_ctx, col, &column)) {
+        return false;
+    }
+    auto const_node = dynamic_cast<const node::ConstNode*>(val);
+    node::DataType const_type = const_node->GetDataType();
+    switch (column.type) {
+        case type::kInt16:
+        case type::kInt32:
+        case type::kInt64: {
+            if (const_type != node::kInt16 && const_type != node::kInt32 && const_type != node::kInt64) {
+                return false;
+            }
+            // the constant is cast to the column type
+            int64_t v = const_node->GetAsInt64();
+            if (column.type == type::kInt16) {
+                return v >= std::numeric_limits<int16_t>::min() && v <= std::numeric_limits<int16_t>::max();
+            } else if (column.type == type::kInt32) {
+                return v >= std::numeric_limits<int32_t>::min() && v <= std::numeric_limits<int32_t>::max();
+            }
+            return true;
+        }
+        case type::kFloat:
+            return const_type == node::kFloat;
+        case type::kDouble:
+            return const_type == node::kFloat || const_type == node::kDouble;
+        case type::kBool:
+            return const_type == node::kBool;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+IncrementalWindowAgg::IncrementalWindowAgg(const SchemasContext* input_schemas_ctx, const Schema* output_schema)
+    : output_schema_(output_schema), row_parser_(input_schemas_ctx) {
+    for (size_t i = 0; i < input_schemas_ctx->GetSchemaSourceSize(); ++i) {
+        row_views_.emplace_back(*input_schemas_ctx->GetSchemaSource(i)->GetSchema());
+    }
+}
+
+std::unique_ptr<IncrementalWindowAgg> IncrementalWindowAgg::Create(const ColumnProjects& projects,
+                                                                   const SchemasContext* input_schemas_ctx,
+                                                                   const udf::UdfLibrary* library) {
+    // udaf name -> (aggregation, is the `_where` variant)
+    static const std::unordered_map<std::string, std::pair<AggType, bool>> agg_types = {
+        {"sum", {kSum, false}},          {"count", {kCount, false}},      {"avg", {kAvg, false}},
+        {"min", {kMin, false}},          {"max", {kMax, false}},          {"sum_where", {kSum, true}},
+        {"count_where", {kCount, true}}, {"avg_where", {kAvg, true}},     {"min_where", {kMin, true}},
+        {"max_where", {kMax, true}}};
+
+    const Schema* output_schema = projects.fn_info().fn_schema();
+    if (output_schema->size() != static_cast<int>(projects.size())) {
+        return nullptr;
+    }
+    std::unique_ptr<IncrementalWindowAgg> agg(new IncrementalWindowAgg(input_schemas_ctx, output_schema));
+    for (size_t i = 0; i < projects.size(); ++i) {
+        const node::ExprNode* expr = projects.GetExpr(i);
+        Project project = {false, kCount, false, {0, 0, type::kNull}, nullptr, false,
+                           output_schema->Get(i).type()};
+        if (expr->GetExprType() == node::kExprColumnRef) {
+            // the column of the current row
+            if (!ResolveColumn(input_schemas_ctx, expr, &project.column) ||
+                project.column.type != project.output_type || project.column.type == type::kBlob ||
+                project.column.type == type::kNull) {
+                return nullptr;
+            }
+            agg->projects_.push_back(project);
+            continue;
+        }
+        if (expr->GetExprType() != node::kExprCall) {
+            return nullptr;
+        }
+        auto call = dynamic_cast<const node::CallExprNode*>(expr);
+        if (call->GetFnDef() == nullptr) {
+            return nullptr;
+        }
+        const std::string name = call->GetFnDef()->GetName();
+        auto iter = agg_types.find(name);
+        if (iter == agg_types.end() || !library->IsIncrementalUdaf(name)) {
+            return nullptr;
+        }
+        project.is_agg = true;
+        project.agg_type = iter->second.first;
+        bool is_where = iter->second.second;
+        if (call->GetChildNum() != (is_where ? 2u : 1u)) {
+            return nullptr;
+        }
+        if (is_where) {
+            project.cond = call->GetChild(1);
+            if (!IsSimpleCond(input_schemas_ctx, project.cond)) {
+                return nullptr;
+            }
+            project.skip_zero = project.agg_type == kSum || project.agg_type == kAvg;
+        }
+        const node::ExprNode* arg = call->GetChild(0);
+        if (arg->GetExprType() == node::kExprAll && project.agg_type == kCount) {
+            project.has_column = false;
+        } else if (ResolveColumn(input_schemas_ctx, arg, &project.column)) {
+            project.has_column = true;
+        } else {
+            return nullptr;
+        }
+        type::Type input_type = project.column.type;
+        switch (project.agg_type) {
+            case kCount:
+                break;
+            case kSum:
+            case kMin:
+            case kMax:
+                if (!IsIntType(input_type) && !IsFloatType(input_type)) {
+                    return nullptr;
+                }
+                break;
+            case kAvg:
+                if ((!IsIntType(input_type) && !IsFloatType(input_type)) || input_type == type::kTimestamp) {
+                    return nullptr;
+                }
+                break;
+        }
+        agg->projects_.push_back(project);
+    }
+    return agg;
+}
+
+bool IncrementalWindowAgg::GetInt(const Row& row, const Column& col, int64_t* val) const {
+    if (IsNull(row, col)) {
+        return false;
+    }
+    const int8_t* buf = row.buf(col.schema_idx);
+    const codec::RowView& row_view = row_views_[col.schema_idx];
+    switch (col.type) {
+        case type::kInt16: {
+            int16_t v = 0;
+            row_view.GetValue(buf, col.col_idx, col.type, &v);
+            *val = v;
+            return true;
+        }
+        case type::kInt32: {
+            int32_t v = 0;
+            row_view.GetValue(buf, col.col_idx, col.type, &v);
+            *val = v;
+            return true;
+        }
+        case type::kInt64:
+        case type::kTimestamp: {
+            return 0 == row_view.GetValue(buf, col.col_idx, col.type, val);
+        }
+        default:
+            return false;
+    }
+}
+
+bool IncrementalWindowAgg::GetDouble(const Row& row, const Column& col, double* val) const {
+    if (IsNull(row, col)) {
+        return false;
+    }
+    const int8_t* buf = row.buf(col.schema_idx);
+    const codec::RowView& row_view = row_views_[col.schema_idx];
+    switch (col.type) {
+        case type::kFloat: {
+            float v = 0;
+            row_view.GetValue(buf, col.col_idx, col.type, &v);
+            *val = v;
+            return true;
+        }
+        case type::kDouble: {
+            return 0 == row_view.GetValue(buf, col.col_idx, col.type, val);
+        }
+        default: {
+            int64_t v = 0;
+            if (!GetInt(row, col, &v)) {
+                return false;
+            }
+            *val = static_cast<double>(v);
+            return true;
+        }
+    }
+}
+
+bool IncrementalWindowAgg::EvalCond(const Row& row, const Project& project) const {
+    if (project.cond == nullptr) {
+        return true;
+    }
+    auto ret = internal::EvalCond(&row_parser_, row, project.cond);
+    // null is false
+    return ret.ok() && ret.value().value_or(false);
+}
+
+IncrementalWindowAgg::State::State(const IncrementalWindowAgg* agg)
+    : agg_(agg), row_builder_(*agg->output_schema_) {
+    for (auto& project : agg->projects_) {
+        if (!project.is_agg) {
+            aggregators_.emplace_back();
+            continue;
+        }
+        bool is_int = IsIntType(project.column.type);
+        switch (project.agg_type) {
+            case kCount:
+                aggregators_.emplace_back(new CountAggregator(agg, &project));
+                break;
+            case kSum:
+                if (is_int) {
+                    aggregators_.emplace_back(new IntSumAggregator(agg, &project));
+                } else if (project.column.type == type::kFloat) {
+                    aggregators_.emplace_back(new FloatSumAggregator<float>(agg, &project));
+                } else {
+                    aggregators_.emplace_back(new FloatSumAggregator<double>(agg, &project));
+                }
+                break;
+            case kAvg:
+                // the sum of integers may wrap around, so the avg is summed in double for all types
+                aggregators_.emplace_back(new FloatSumAggregator<double>(agg, &project));
+                break;
+            case kMin:
+                if (is_int) {
+                    aggregators_.emplace_back(new MinMaxAggregator<int64_t, false>(agg, &project));
+                } else {
+                    aggregators_.emplace_back(new MinMaxAggregator<double, false>(agg, &project));
+                }
+                break;
+            case kMax:
+                if (is_int) {
+                    aggregators_.emplace_back(new MinMaxAggregator<int64_t, true>(agg, &project));
+                } else {
+                    aggregators_.emplace_back(new MinMaxAggregator<double, true>(agg, &project));
+                }
+                break;
+        }
+    }
+}
+
+IncrementalWindowAgg::State::~State() {}
+
+void IncrementalWindowAgg::State::OnAddRow(const Row& row) {
+    for (auto& aggregator : aggregators_) {
+        if (aggregator) {
+            aggregator->Add(row);
+        }
+    }
+}
+
+void IncrementalWindowAgg::State::OnPopRow(const Row& row) {
+    for (auto& aggregator : aggregators_) {
+        if (aggregator) {
+            aggregator->Pop(row);
+        }
+    }
+}
+
+Row IncrementalWindowAgg::State::Output(const Row& row) {
+    auto& projects = agg_->projects_;
+    uint32_t str_len = 0;
+    for (auto& project : projects) {
+        if (!project.is_agg && project.column.type == type::kVarchar &&
+            !agg_->IsNull(row, project.column)) {
+            const char* str = nullptr;
+            uint32_t len = 0;
+            agg_->row_views_[project.column.schema_idx].GetValue(row.buf(project.column.schema_idx),
+                                                                 project.column.col_idx, &str, &len);
+            str_len += len;
+        }
+    }
+    uint32_t total_len = row_builder_.CalTotalLength(str_len);
+    int8_t* buf = static_cast<int8_t*>(malloc(total_len));
+    row_builder_.SetBuffer(buf, total_len);
+    for (size_t i = 0; i < projects.size(); ++i) {
+        auto& project = projects[i];
+        if (project.is_agg) {
+            aggregators_[i]->Output(&row_builder_);
+            continue;
+        }
+        auto& col = project.column;
+        if (agg_->IsNull(row, col)) {
+            row_builder_.AppendNULL();
+            continue;
+        }
+        const int8_t* row_buf = row.buf(col.schema_idx);
+        const codec::RowView& row_view = agg_->row_views_[col.schema_idx];
+        switch (col.type) {
+            case type::kBool: {
+                bool v = false;
+                row_view.GetValue(row_buf, col.col_idx, col.type, &v);
+                row_builder_.AppendBool(v);
+                break;
+            }
+            case type::kDate: {
+                int32_t v = 0;
+                row_view.GetValue(row_buf, col.col_idx, col.type, &v);
+                row_builder_.AppendDate(v);
+                break;
+            }
+            case type::kVarchar: {
+                const char* str = nullptr;
+                uint32_t len = 0;
+                row_view.GetValue(row_buf, col.col_idx, &str, &len);
+                row_builder_.AppendString(str, len);
+                break;
+            }
+            case type::kFloat:
+            case type::kDouble: {
+                double v = 0;
+                agg_->GetDouble(row, col, &v);
+                AppendValue(&row_builder_, col.type, v);
+                break;
+            }
+            default: {
+                int64_t v = 0;
+                agg_->GetInt(row, col, &v);
+                AppendValue(&row_builder_, col.type, v);
+                break;
+            }
+        }
+    }
+    return Row(base::RefCountedSlice::CreateManaged(buf, total_len));
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_SRC_VM_INCREMENTAL_AGGREGATOR_H_
+#define HYBRIDSE_SRC_VM_INCREMENTAL_AGGREGATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "codec/fe_row_codec.h"
+#include "codec/row.h"
+#include "udf/udf_library.h"
+#include "vm/mem_catalog.h"
+#include "vm/physical_op.h"
+#include "vm/schemas_context.h"
+
+namespace hybridse {
+namespace vm {
+
+class IncrementalAggregator;
+
+/**
+ * IncrementalWindowAgg evaluates the project of a window aggregation without
+ * the generated code. The aggregations are updated by the rows going into and
+ * out of the window, so an output row costs O(1) amortized instead of O(w) of
+ * iterating a window of w rows.
+ *
+ * - the integer sum and count are updated by adding and subtracting the rows
+ * - the float sum and the avg of all types keep two stacks of partial sums in
+ *   double, so the rows going out are never subtracted and the rounding errors
+ *   don't pile up. The avg of integers is not taken from the integer sum which
+ *   may wrap around
+ * - min and max keep the candidates in a monotonic deque
+ *
+ * The rows have to go out of the window in the order they go in, which is the
+ * case of `HistoryWindow` without excluding the current row or time.
+ */
+class IncrementalWindowAgg {
+ public:
+    /**
+     * The states of the aggregations on the window of a partition key. It is
+     * set as the listener of the window, and it is not shared by threads.
+     */
+    class State : public WindowListener {
+     public:
+        explicit State(const IncrementalWindowAgg* agg);
+        ~State();
+
+        void OnAddRow(const Row& row) override;
+        void OnPopRow(const Row& row) override;
+
+        // encode the project of the row with the aggregations of the window
+        Row Output(const Row& row);
+
+     private:
+        const IncrementalWindowAgg* agg_;
+        std::vector<std::unique_ptr<IncrementalAggregator>> aggregators_;
+        codec::RowBuilder row_builder_;
+    };
+
+    /**
+     * Return nullptr if any of the projects is neither an incremental udaf on
+     * a column of the window nor a column of the current row.
+     */
+    static std::unique_ptr<IncrementalWindowAgg> Create(const ColumnProjects& projects,
+                                                        const SchemasContext* input_schemas_ctx,
+                                                        const udf::UdfLibrary* library);
+
+    std::unique_ptr<State> NewState() const { return std::make_unique<State>(this); }
+
+    // the column at col_idx of the slice schema_idx of the input rows
+    struct Column {
+        size_t schema_idx;
+        size_t col_idx;
+        type::Type type;
+    };
+
+    enum AggType {
+        kSum,
+        kCount,
+        kAvg,
+        kMin,
+        kMax,
+    };
+
+    struct Project {
+        // the column of the current row if it is not an aggregation
+        bool is_agg;
+        AggType agg_type;
+        // `count(*)` has no column
+        bool has_column;
+        Column column;
+        // the filter condition of the `_where` variants
+        const node::ExprNode* cond;
+        // sum_where and avg_where take the rows of zero as false as well
+        bool skip_zero;
+        type::Type output_type;
+    };
+
+    bool IsNull(const Row& row, const Column& col) const {
+        return row_views_[col.schema_idx].IsNULL(row.buf(col.schema_idx), col.col_idx);
+    }
+    // return false if it is null
+    bool GetInt(const Row& row, const Column& col, int64_t* val) const;
+    // the integers are converted to double
+    bool GetDouble(const Row& row, const Column& col, double* val) const;
+    // return false if the row is not taken by the aggregation of the project
+    bool EvalCond(const Row& row, const Project& project) const;
+
+ private:
+    IncrementalWindowAgg(const SchemasContext* input_schemas_ctx, const Schema* output_schema);
+
+    const Schema* output_schema_;
+    RowParser row_parser_;
+    std::vector<codec::RowView> row_views_;
+    std::vector<Project> projects_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_INCREMENTAL_AGGREGATOR_H_
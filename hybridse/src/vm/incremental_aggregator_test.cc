@@ -0,0 +1,262 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/incremental_aggregator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+#include "vm/engine.h"
+#include "vm/runner.h"
+#include "vm/simple_catalog.h"
+#include "vm/sql_compiler.h"
+
+namespace hybridse {
+namespace vm {
+
+// the frames of the windows, the rows expire by the range, the rows and the maxsize
+static const char* kFrames[] = {
+    "ROWS_RANGE BETWEEN 10s PRECEDING AND CURRENT ROW",
+    "ROWS BETWEEN 7 PRECEDING AND CURRENT ROW",
+    "ROWS_RANGE BETWEEN 60s PRECEDING AND CURRENT ROW MAXSIZE 5",
+};
+
+/**
+ * The window aggregations are run in batch mode by the incremental aggregators
+ * and by the generated code, which computes the aggregations of each window
+ * from scratch, and the outputs are compared.
+ */
+class IncrementalAggregatorTest : public ::testing::Test {
+ public:
+    void SetUp() override {
+        catalog_ = std::make_shared<SimpleCatalog>(true);
+        type::Database db;
+        db.set_name("db");
+        type::TableDef* table = db.add_tables();
+        table->set_name("t1");
+        table->set_catalog("db");
+        for (auto& column : std::vector<std::pair<std::string, type::Type>>{{"k", type::kVarchar},
+                                                                              {"ts", type::kTimestamp},
+                                                                              {"i32", type::kInt32},
+                                                                              {"i64", type::kInt64},
+                                                                              {"f", type::kFloat},
+                                                                              {"d", type::kDouble},
+                                                                              {"c", type::kInt32}}) {
+            type::ColumnDef* column_def = table->add_columns();
+            column_def->set_name(column.first);
+            column_def->set_type(column.second);
+        }
+        type::IndexDef* index = table->add_indexes();
+        index->set_name("index1");
+        index->add_first_keys("k");
+        index->set_second_key("ts");
+        catalog_->AddDatabase(db);
+
+        // the partition sizes, the key c has one row
+        std::vector<std::pair<std::string, int>> keys = {{"a", 300}, {"b", 200}, {"c", 1}};
+        uint64_t seed = 42;
+        std::vector<Row> rows;
+        codec::RowBuilder builder(table->columns());
+        for (auto& key : keys) {
+            for (int i = 0; i < key.second; i++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                uint64_t x = seed >> 16;
+                uint32_t total_size = builder.CalTotalLength(key.first.size());
+                int8_t* buf = static_cast<int8_t*>(malloc(total_size));
+                builder.SetBuffer(buf, total_size);
+                builder.AppendString(key.first.c_str(), key.first.size());
+                // every 5th row has the same ts as the row before it, and there is a gap of 30s
+                // every 50 rows, so all the rows in the window expire
+                builder.AppendTimestamp(1590738990000 + (i - i / 5) * 1000 + (i / 50) * 30000);
+                if (x % 17 == 0) {
+                    builder.AppendNULL();
+                } else {
+                    builder.AppendInt32(x % 19 == 0 ? 0 : static_cast<int32_t>(x % 1000) - 500);
+                }
+                // the integers near the limits of int64, the sums wrap around
+                if (key.first == "a") {
+                    builder.AppendInt64(std::numeric_limits<int64_t>::max() - static_cast<int64_t>(x % 1000));
+                } else {
+                    builder.AppendInt64(std::numeric_limits<int64_t>::min() + static_cast<int64_t>(x % 1000));
+                }
+                if (x % 13 == 0) {
+                    builder.AppendNULL();
+                } else {
+                    builder.AppendFloat(static_cast<float>(static_cast<int64_t>((x >> 8) % 4000) - 2000) * 0.25f);
+                }
+                builder.AppendDouble(static_cast<double>((x >> 4) % 1000000) / 997.0 - 500);
+                if (x % 11 == 0) {
+                    builder.AppendNULL();
+                } else {
+                    builder.AppendInt32((x >> 12) % 8);
+                }
+                rows.emplace_back(base::RefCountedSlice::CreateManaged(buf, total_size));
+            }
+        }
+        ASSERT_TRUE(catalog_->InsertRows("db", "t1", rows));
+    }
+
+    // run the sql in batch mode, the window aggregations are incremental if incremental is true
+    void Run(const std::string& sql, bool incremental, Schema* schema, std::vector<Row>* outputs) {
+        EngineOptions options;
+        options.SetEnableIncrementalWindowAgg(incremental);
+        Engine engine(catalog_, options);
+        BatchRunSession session;
+        base::Status status;
+        ASSERT_TRUE(engine.Get(sql, "db", session, status)) << status;
+        auto& sql_ctx = std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo())->get_sql_context();
+        size_t window_num = 0;
+        size_t incremental_num = 0;
+        CountWindowAgg(sql_ctx.cluster_job.GetMainTask().GetRoot(), &window_num, &incremental_num);
+        ASSERT_GT(window_num, 0u);
+        ASSERT_EQ(incremental ? window_num : 0, incremental_num) << sql;
+        ASSERT_EQ(0, session.Run(*outputs));
+        *schema = session.GetSchema();
+    }
+
+    // run the select list over each frame with and without the incremental aggregators
+    void CheckIncremental(const std::string& select_list) {
+        for (const char* frame : kFrames) {
+            std::string sql = "SELECT k, ts, " + select_list +
+                              " FROM t1 WINDOW w AS (PARTITION BY k ORDER BY ts " + frame + ");";
+            SCOPED_TRACE(sql);
+            Schema schema;
+            std::vector<Row> outputs;
+            ASSERT_NO_FATAL_FAILURE(Run(sql, true, &schema, &outputs));
+            Schema expect_schema;
+            std::vector<Row> expect_outputs;
+            ASSERT_NO_FATAL_FAILURE(Run(sql, false, &expect_schema, &expect_outputs));
+            ASSERT_EQ(501u, outputs.size());
+            ASSERT_NO_FATAL_FAILURE(CheckRows(schema, outputs, expect_outputs));
+        }
+    }
+
+ private:
+    static void CountWindowAgg(Runner* runner, size_t* window_num, size_t* incremental_num) {
+        if (runner == nullptr) {
+            return;
+        }
+        if (runner->type_ == kRunnerWindowAgg) {
+            (*window_num)++;
+            if (dynamic_cast<WindowAggRunner*>(runner)->IsIncrementalAgg()) {
+                (*incremental_num)++;
+            }
+        }
+        for (auto producer : runner->GetProducers()) {
+            CountWindowAgg(producer, window_num, incremental_num);
+        }
+    }
+
+    // the sums of floats are added in another order, they are compared with a tolerance
+    static void CheckRows(const Schema& schema, const std::vector<Row>& rows, const std::vector<Row>& expect_rows) {
+        ASSERT_EQ(expect_rows.size(), rows.size());
+        codec::RowView row_view(schema);
+        codec::RowView expect_row_view(schema);
+        for (size_t i = 0; i < rows.size(); i++) {
+            row_view.Reset(rows[i].buf());
+            expect_row_view.Reset(expect_rows[i].buf());
+            for (int j = 0; j < schema.size(); j++) {
+                SCOPED_TRACE("row " + std::to_string(i) + " column " + schema.Get(j).name());
+                ASSERT_EQ(expect_row_view.IsNULL(j), row_view.IsNULL(j));
+                if (row_view.IsNULL(j)) {
+                    continue;
+                }
+                switch (schema.Get(j).type()) {
+                    case type::kFloat: {
+                        float expect = expect_row_view.GetFloatUnsafe(j);
+                        ASSERT_NEAR(expect, row_view.GetFloatUnsafe(j), 1e-5 * std::max(1.0f, std::fabs(expect)));
+                        break;
+                    }
+                    case type::kDouble: {
+                        double expect = expect_row_view.GetDoubleUnsafe(j);
+                        ASSERT_NEAR(expect, row_view.GetDoubleUnsafe(j), 1e-9 * std::max(1.0, std::fabs(expect)));
+                        break;
+                    }
+                    default: {
+                        ASSERT_EQ(expect_row_view.GetAsString(j), row_view.GetAsString(j));
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<SimpleCatalog> catalog_;
+};
+
+TEST_F(IncrementalAggregatorTest, MinMax) {
+    // the values are not monotonic, so the candidates are evicted from both ends of the deque
+    CheckIncremental(
+        "min(i32) OVER w AS min_i32, max(i32) OVER w AS max_i32, min(ts) OVER w AS min_ts, max(ts) OVER w AS "
+        "max_ts, min(f) OVER w AS min_f, max(f) OVER w AS max_f, min(d) OVER w AS min_d, max(d) OVER w AS max_d");
+}
+
+TEST_F(IncrementalAggregatorTest, FloatSum) {
+    CheckIncremental(
+        "sum(f) OVER w AS sum_f, sum(d) OVER w AS sum_d, avg(f) OVER w AS avg_f, avg(d) OVER w AS avg_d, "
+        "avg(i32) OVER w AS avg_i32");
+}
+
+TEST_F(IncrementalAggregatorTest, Where) {
+    // the rows of a false or null condition are skipped, and so are the zeros of sum_where and avg_where
+    CheckIncremental(
+        "sum_where(i32, c > 3) OVER w AS sum_i32, count_where(i32, c > 3) OVER w AS cnt_i32, "
+        "avg_where(d, c > 3) OVER w AS avg_d, min_where(i32, c < 5) OVER w AS min_i32, "
+        "max_where(f, c != 2) OVER w AS max_f, sum_where(f, c = 0) OVER w AS sum_f");
+}
+
+TEST_F(IncrementalAggregatorTest, Int64Limits) {
+    // the sums wrap around the same as the generated code, the avgs are summed in double
+    CheckIncremental("sum(i64) OVER w AS sum_i64, avg(i64) OVER w AS avg_i64, min(i64) OVER w AS min_i64, "
+                     "max(i64) OVER w AS max_i64, count(i64) OVER w AS cnt_i64");
+}
+
+TEST_F(IncrementalAggregatorTest, ExpiredRows) {
+    // the rows popped by the frames are taken out of the aggregations, and a window of only the
+    // current row after a gap of ts is aggregated from the empty states
+    CheckIncremental("count(*) OVER w AS cnt, count(i32) OVER w AS cnt_i32, sum(i32) OVER w AS sum_i32, "
+                     "sum(d) OVER w AS sum_d, min(f) OVER w AS min_f, max(i32) OVER w AS max_i32");
+    Schema schema;
+    std::vector<Row> outputs;
+    ASSERT_NO_FATAL_FAILURE(Run("SELECT k, count(*) OVER w AS cnt FROM t1 WINDOW w AS (PARTITION BY k ORDER BY ts "
+                                "ROWS_RANGE BETWEEN 10s PRECEDING AND CURRENT ROW);",
+                                true, &schema, &outputs));
+    codec::RowView row_view(schema);
+    int64_t max_cnt = 0;
+    for (auto& row : outputs) {
+        row_view.Reset(row.buf());
+        max_cnt = std::max(max_cnt, row_view.GetInt64Unsafe(1));
+    }
+    // the windows are much smaller than the partitions, so the rows expire
+    ASSERT_GT(max_cnt, 1);
+    ASSERT_LT(max_cnt, 20);
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    hybridse::vm::Engine::InitializeGlobalLLVM();
+    return RUN_ALL_TESTS();
+}
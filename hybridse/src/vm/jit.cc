@@ -150,8 +150,18 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    HybridSeJitBuilder builder;
+    if (!object_cache_dir_.empty()) {
+        object_cache_ = std::make_unique<JitObjectCache>(object_cache_dir_, object_cache_capacity_);
+        auto object_cache = object_cache_.get();
+        builder.setCompileFunctionCreator(
+            [object_cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<::llvm::orc::IRCompileLayer::CompileFunction> {
+                return ::llvm::orc::IRCompileLayer::CompileFunction(
+                    ::llvm::orc::ConcurrentIRCompiler(std::move(jtmb), object_cache));
+            });
+    }
+    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -169,6 +179,13 @@ bool HybridSeLlvmJitWrapper::Init() {
     return true;
 }
 
+bool HybridSeLlvmJitWrapper::FindCachedObject(const ::llvm::Module& module) {
+    if (object_cache_ == nullptr) {
+        return false;
+    }
+    return object_cache_->SetKey(JitObjectCache::BuildKey(module), module);
+}
+
 bool HybridSeLlvmJitWrapper::OptModule(::llvm::Module* module) {
     return jit_->OptModule(module);
 }
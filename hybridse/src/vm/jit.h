@@ -22,6 +22,7 @@
 #include <string>
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "vm/jit_object_cache.h"
 #include "vm/jit_wrapper.h"
 
 #ifdef LLVM_EXT_ENABLE
@@ -88,10 +89,16 @@ std::string LlvmToString(const T& value) {
 class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
  public:
     HybridSeLlvmJitWrapper() {}
+    // the object code is cached in object_cache_dir if it is not empty, the
+    // files are limited to object_cache_capacity bytes if it is not 0
+    HybridSeLlvmJitWrapper(const std::string& object_cache_dir, uint64_t object_cache_capacity)
+        : object_cache_dir_(object_cache_dir), object_cache_capacity_(object_cache_capacity) {}
     ~HybridSeLlvmJitWrapper() {}
 
     bool Init() override;
 
+    bool FindCachedObject(const ::llvm::Module& module) override;
+
     bool OptModule(::llvm::Module* module) override;
 
     bool AddModule(std::unique_ptr<llvm::Module> module,
@@ -103,6 +110,10 @@ class HybridSeLlvmJitWrapper : public HybridSeJitWrapper {
         const std::string& funcname) override;
 
  private:
+    std::string object_cache_dir_;
+    uint64_t object_cache_capacity_ = 0;
+    // used by the compiler of jit_, so it is destroyed after jit_
+    std::unique_ptr<JitObjectCache> object_cache_;
     std::unique_ptr<HybridSeJit> jit_;
     std::unique_ptr<::llvm::orc::MangleAndInterner> mi_;
 };
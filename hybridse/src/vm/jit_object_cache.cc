@@ -0,0 +1,229 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/jit_object_cache.h"
+
+#include <utime.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <map>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+// increase it if the way to compile a module is changed while the ir is not
+static const char kObjectCacheFormat[] = "hybridse-object-v1";
+// the file is the magic, the sha1 of the object code and the object code
+static const char kObjectFileMagic[] = "HSEOBJ01";
+static constexpr size_t kObjectFileMagicSize = sizeof(kObjectFileMagic) - 1;
+static constexpr size_t kSha1Size = 20;
+// a temporary file older than it is left by a crashed writer
+static constexpr std::chrono::hours kStaleTmpFileAge(1);
+
+static std::string Sha1(::llvm::StringRef data) {
+    ::llvm::SHA1 sha1;
+    sha1.update(data);
+    return sha1.final().str();
+}
+
+JitObjectCache::JitObjectCache(const std::string& dir, uint64_t capacity) : dir_(dir), capacity_(capacity) {}
+
+JitObjectCache::~JitObjectCache() {}
+
+std::string JitObjectCache::BuildKey(const ::llvm::Module& module) {
+    ::llvm::SHA1 sha1;
+    sha1.update(kObjectCacheFormat);
+    sha1.update(LLVM_VERSION_STRING);
+    sha1.update(::llvm::sys::getProcessTriple());
+    sha1.update(::llvm::sys::getHostCPUName());
+    ::llvm::StringMap<bool> host_features;
+    if (::llvm::sys::getHostCPUFeatures(host_features)) {
+        // the order of a StringMap is not stable
+        std::map<std::string, bool> features;
+        for (auto& feature : host_features) {
+            features.emplace(feature.getKey().str(), feature.getValue());
+        }
+        for (auto& feature : features) {
+            sha1.update(feature.second ? "+" : "-");
+            sha1.update(feature.first);
+        }
+    }
+    std::string ir;
+    ::llvm::raw_string_ostream ss(ir);
+    ss << module;
+    ss.flush();
+    sha1.update(ir);
+    return ::llvm::toHex(sha1.final(), true);
+}
+
+std::string JitObjectCache::GetPath() const {
+    ::llvm::SmallString<256> path(dir_);
+    ::llvm::sys::path::append(path, key_ + ".o");
+    return path.str().str();
+}
+
+bool JitObjectCache::IsKeyModule(const ::llvm::Module* module) const {
+    return module != nullptr && module == module_ && module->getModuleIdentifier() == module_id_;
+}
+
+bool JitObjectCache::SetKey(const std::string& key, const ::llvm::Module& module) {
+    key_ = key;
+    module_id_ = module.getModuleIdentifier();
+    module_ = &module;
+    cached_.reset();
+    auto buf = ::llvm::MemoryBuffer::getFile(GetPath(), -1, false);
+    if (!buf) {
+        return false;
+    }
+    ::llvm::StringRef data = (*buf)->getBuffer();
+    if (data.size() < kObjectFileMagicSize + kSha1Size ||
+        data.substr(0, kObjectFileMagicSize) != kObjectFileMagic) {
+        LOG(WARNING) << "invalid jit object cache file " << GetPath();
+        return false;
+    }
+    ::llvm::StringRef sha1 = data.substr(kObjectFileMagicSize, kSha1Size);
+    ::llvm::StringRef obj = data.drop_front(kObjectFileMagicSize + kSha1Size);
+    if (Sha1(obj) != sha1) {
+        LOG(WARNING) << "corrupted jit object cache file " << GetPath();
+        return false;
+    }
+    cached_ = ::llvm::MemoryBuffer::getMemBufferCopy(obj, GetPath());
+    // keep the modification time as the last used time, Prune removes the least recently used files
+    if (::utime(GetPath().c_str(), nullptr) != 0) {
+        PLOG(WARNING) << "fail to touch jit object cache file " << GetPath();
+    }
+    DLOG(INFO) << "load jit object from " << GetPath();
+    return true;
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> JitObjectCache::getObject(const ::llvm::Module* module) {
+    if (!cached_ || !IsKeyModule(module)) {
+        return nullptr;
+    }
+    // the address may be taken by another module after the module is freed
+    module_ = nullptr;
+    return ::llvm::MemoryBuffer::getMemBufferCopy(cached_->getBuffer(), cached_->getBufferIdentifier());
+}
+
+void JitObjectCache::notifyObjectCompiled(const ::llvm::Module* module, ::llvm::MemoryBufferRef obj) {
+    if (key_.empty() || cached_ || !IsKeyModule(module)) {
+        return;
+    }
+    module_ = nullptr;
+    std::error_code ec = ::llvm::sys::fs::create_directories(dir_);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object cache dir " << dir_ << ": " << ec.message();
+        return;
+    }
+    // write a temporary file and rename it, so a file is either whole or absent
+    // when it is written by several processes
+    const std::string path = GetPath();
+    int fd = -1;
+    ::llvm::SmallString<256> tmp_path;
+    ec = ::llvm::sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmp_path);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object cache file " << path << ": " << ec.message();
+        return;
+    }
+    {
+        ::llvm::raw_fd_ostream os(fd, true);
+        os << kObjectFileMagic << Sha1(obj.getBuffer()) << obj.getBuffer();
+        os.close();
+        if (os.has_error()) {
+            LOG(WARNING) << "fail to write jit object cache file " << tmp_path.str().str() << ": "
+                         << os.error().message();
+            os.clear_error();
+            ::llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+    }
+    ec = ::llvm::sys::fs::rename(tmp_path, path);
+    if (ec) {
+        LOG(WARNING) << "fail to rename jit object cache file " << path << ": " << ec.message();
+        ::llvm::sys::fs::remove(tmp_path);
+        return;
+    }
+    DLOG(INFO) << "save jit object to " << path;
+    Prune(path);
+}
+
+void JitObjectCache::Prune(const std::string& keep) {
+    struct CacheFile {
+        std::string path;
+        uint64_t size;
+        ::llvm::sys::TimePoint<> mtime;
+    };
+    std::vector<CacheFile> files;
+    uint64_t total_size = 0;
+    const auto now = std::chrono::system_clock::now();
+    std::error_code ec;
+    for (::llvm::sys::fs::directory_iterator it(dir_, ec), end; it != end && !ec; it.increment(ec)) {
+        ::llvm::sys::fs::file_status status;
+        if (::llvm::sys::fs::status(it->path(), status) || status.type() != ::llvm::sys::fs::file_type::regular_file) {
+            continue;
+        }
+        ::llvm::StringRef name = ::llvm::sys::path::filename(it->path());
+        if (name.endswith(".tmp")) {
+            if (now - status.getLastModificationTime() > kStaleTmpFileAge) {
+                ::llvm::sys::fs::remove(it->path());
+            }
+            continue;
+        }
+        if (!name.endswith(".o")) {
+            continue;
+        }
+        total_size += status.getSize();
+        if (it->path() != keep) {
+            files.push_back({it->path(), status.getSize(), status.getLastModificationTime()});
+        }
+    }
+    if (ec) {
+        LOG(WARNING) << "fail to list jit object cache dir " << dir_ << ": " << ec.message();
+        return;
+    }
+    if (capacity_ == 0 || total_size <= capacity_) {
+        return;
+    }
+    std::sort(files.begin(), files.end(),
+              [](const CacheFile& l, const CacheFile& r) { return l.mtime < r.mtime; });
+    for (auto& file : files) {
+        if (total_size <= capacity_) {
+            break;
+        }
+        // the file may be removed by another process at the same time
+        if (!::llvm::sys::fs::remove(file.path)) {
+            total_size -= file.size;
+            DLOG(INFO) << "remove jit object cache file " << file.path;
+        }
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+#define HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * JitObjectCache keeps the object code compiled by the jit in the files of a
+ * local directory, so the same module is not optimized and compiled again
+ * after restarting.
+ *
+ * A file is named by the key of the module, which is the hash of the ir
+ * before optimizing, the llvm version and the host cpu. The ir covers the sql,
+ * the schemas and the udfs, and the addresses of the process if any are put
+ * into the ir, so a stale file is never matched. The files can be removed at
+ * any time.
+ *
+ * A file is touched when it is loaded. After a file is written, the least
+ * recently used files are removed until all the files fit in `capacity`, and
+ * the temporary files left by a crashed writer are removed.
+ */
+class JitObjectCache : public ::llvm::ObjectCache {
+ public:
+    // capacity is the size of the files in bytes, 0 means unlimited
+    JitObjectCache(const std::string& dir, uint64_t capacity);
+    ~JitObjectCache() override;
+
+    static std::string BuildKey(const ::llvm::Module& module);
+
+    // set the key of the module compiled next, return true if its object code
+    // is loaded from the cache. The object code is served or saved only for
+    // the same module, another module compiled by the jit is left alone
+    bool SetKey(const std::string& key, const ::llvm::Module& module);
+
+    void notifyObjectCompiled(const ::llvm::Module* module, ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(const ::llvm::Module* module) override;
+
+ private:
+    std::string GetPath() const;
+
+    // whether the module is the one the key is set for
+    bool IsKeyModule(const ::llvm::Module* module) const;
+
+    // remove the stale temporary files and the least recently used files
+    // beyond the capacity except the file of keep
+    void Prune(const std::string& keep);
+
+    const std::string dir_;
+    const uint64_t capacity_;
+    std::string key_;
+    // the identifier and the address of the module of key_, the modules of
+    // the sqls share the same identifier
+    std::string module_id_;
+    const ::llvm::Module* module_ = nullptr;
+    std::unique_ptr<::llvm::MemoryBuffer> cached_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
@@ -76,14 +76,14 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
         return new HybridSeMcJitWrapper(jit_options);
 #else
         LOG(WARNING) << "McJit support is not enabled";
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options.GetObjectCacheDir(), jit_options.GetObjectCacheCapacity());
 #endif
     } else {
         if (jit_options.IsEnableVtune() || jit_options.IsEnablePerf() ||
             jit_options.IsEnableGdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options.GetObjectCacheDir(), jit_options.GetObjectCacheCapacity());
     }
 }
 
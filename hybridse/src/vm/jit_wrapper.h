@@ -48,6 +48,10 @@ class HybridSeJitWrapper {
 
     bool AddModuleFromBuffer(const base::RawBuffer&);
 
+    // return true if the object code of the module is cached, then it is
+    // loaded by AddModule instead of compiled, and the module needs no OptModule
+    virtual bool FindCachedObject(const ::llvm::Module& module) { return false; }
+
     virtual hybridse::vm::RawPtrHandle FindFunction(
         const std::string& funcname) = 0;
 
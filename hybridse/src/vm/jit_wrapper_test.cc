@@ -15,10 +15,17 @@
  */
 
 #include "vm/jit_wrapper.h"
+#include <stdlib.h>
+#include <utime.h>
+#include <fstream>
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
 #include "udf/udf.h"
 #include "vm/engine.h"
+#include "vm/jit_object_cache.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -74,24 +81,7 @@ std::shared_ptr<SqlCompileInfo> CompileNotPerformanceSensitive(
     return std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo());
 }
 
-void simple_test(const EngineOptions &options) {
-    auto catalog = GetTestCatalog();
-    std::string sql = "select col_1, col_2 from t1;";
-    auto compile_info = Compile(sql, options, catalog);
-    auto &sql_context = compile_info->get_sql_context();
-    std::string ir_str = sql_context.ir;
-    ASSERT_FALSE(ir_str.empty());
-    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
-    ASSERT_TRUE(jit->Init());
-    HybridSeJitWrapper::InitJitSymbols(jit);
-
-    base::RawBuffer ir_buf(const_cast<char *>(ir_str.data()), ir_str.size());
-    ASSERT_TRUE(jit->AddModuleFromBuffer(ir_buf));
-
-    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
-    auto fn = jit->FindFunction(fn_name);
-    ASSERT_TRUE(fn != nullptr);
-
+void check_simple_project(RawPtrHandle fn, std::shared_ptr<SimpleCatalog> catalog) {
     int8_t buf[1024];
     auto schema = catalog->GetTable("db", "t1")->GetSchema();
     codec::RowBuilder row_builder(*schema);
@@ -109,6 +99,26 @@ void simple_test(const EngineOptions &options) {
     ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
     ASSERT_EQ(c1, 3.14);
     ASSERT_EQ(c2, 42);
+}
+
+void simple_test(const EngineOptions &options) {
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    auto &sql_context = compile_info->get_sql_context();
+    std::string ir_str = sql_context.ir;
+    ASSERT_FALSE(ir_str.empty());
+    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
+    ASSERT_TRUE(jit->Init());
+    HybridSeJitWrapper::InitJitSymbols(jit);
+
+    base::RawBuffer ir_buf(const_cast<char *>(ir_str.data()), ir_str.size());
+    ASSERT_TRUE(jit->AddModuleFromBuffer(ir_buf));
+
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+    check_simple_project(fn, catalog);
     delete jit;
 }
 
@@ -130,6 +140,113 @@ TEST_F(JitWrapperTest, test_mcjit) {
 }
 #endif
 
+TEST_F(JitWrapperTest, test_object_cache) {
+    EngineOptions options;
+    options.SetKeepIr(true);
+    auto catalog = GetTestCatalog();
+    auto compile_info = Compile("select col_1, col_2 from t1;", options, catalog);
+    auto &sql_context = compile_info->get_sql_context();
+    std::string ir_str = sql_context.ir;
+    ASSERT_FALSE(ir_str.empty());
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+
+    char dir[] = "/tmp/jit_object_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    JitOptions jit_options;
+    jit_options.SetObjectCacheDir(dir);
+    // the object code is compiled and cached by the first jit, and loaded by the second one
+    for (int i = 0; i < 2; i++) {
+        std::unique_ptr<HybridSeJitWrapper> jit(HybridSeJitWrapper::Create(jit_options));
+        ASSERT_TRUE(jit->Init());
+        HybridSeJitWrapper::InitJitSymbols(jit.get());
+
+        ::llvm::SMDiagnostic diagnostic;
+        auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+        auto mem_buf = ::llvm::MemoryBuffer::getMemBuffer(ir_str);
+        auto llvm_module = ::llvm::parseIR(*mem_buf, diagnostic, *llvm_ctx);
+        ASSERT_TRUE(llvm_module != nullptr);
+        ASSERT_EQ(i > 0, jit->FindCachedObject(*llvm_module));
+        ASSERT_TRUE(jit->AddModule(std::move(llvm_module), std::move(llvm_ctx)));
+
+        auto fn = jit->FindFunction(fn_name);
+        ASSERT_TRUE(fn != nullptr);
+        check_simple_project(fn, catalog);
+    }
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
+TEST_F(JitWrapperTest, test_object_cache_prune) {
+    EngineOptions options;
+    options.SetKeepIr(true);
+    auto catalog = GetTestCatalog();
+    auto compile_info = Compile("select col_1, col_2 from t1;", options, catalog);
+    std::string ir_str = compile_info->get_sql_context().ir;
+    ASSERT_FALSE(ir_str.empty());
+
+    char dir[] = "/tmp/jit_object_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    const std::string old_file = std::string(dir) + "/old.o";
+    const std::string tmp_file = std::string(dir) + "/old.o.abcdef.tmp";
+    for (auto &path : {old_file, tmp_file}) {
+        std::ofstream(path) << "stale";
+        struct utimbuf times = {0, 0};
+        ASSERT_EQ(0, utime(path.c_str(), &times));
+    }
+    JitOptions jit_options;
+    jit_options.SetObjectCacheDir(dir);
+    jit_options.SetObjectCacheCapacity(1);
+    std::unique_ptr<HybridSeJitWrapper> jit(HybridSeJitWrapper::Create(jit_options));
+    ASSERT_TRUE(jit->Init());
+    HybridSeJitWrapper::InitJitSymbols(jit.get());
+    ::llvm::SMDiagnostic diagnostic;
+    auto llvm_ctx = ::llvm::make_unique<::llvm::LLVMContext>();
+    auto mem_buf = ::llvm::MemoryBuffer::getMemBuffer(ir_str);
+    auto llvm_module = ::llvm::parseIR(*mem_buf, diagnostic, *llvm_ctx);
+    ASSERT_TRUE(llvm_module != nullptr);
+    ASSERT_FALSE(jit->FindCachedObject(*llvm_module));
+    ASSERT_TRUE(jit->AddModule(std::move(llvm_module), std::move(llvm_ctx)));
+    auto fn_name = compile_info->get_sql_context().physical_plan->GetFnInfos()[0]->fn_name();
+    ASSERT_TRUE(jit->FindFunction(fn_name) != nullptr);
+
+    // the file just written is kept even if it is beyond the capacity, the others are removed
+    ASSERT_FALSE(::llvm::sys::fs::exists(old_file));
+    ASSERT_FALSE(::llvm::sys::fs::exists(tmp_file));
+    std::error_code ec;
+    int file_num = 0;
+    for (::llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+        file_num++;
+    }
+    ASSERT_EQ(1, file_num);
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
+TEST_F(JitWrapperTest, test_object_cache_other_module) {
+    char dir[] = "/tmp/jit_object_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    ::llvm::LLVMContext llvm_ctx;
+    ::llvm::Module module("sql", llvm_ctx);
+    ::llvm::Module other("sql", llvm_ctx);
+    const std::string key = JitObjectCache::BuildKey(module);
+    auto obj = ::llvm::MemoryBuffer::getMemBuffer("object code", "obj");
+    {
+        // the object code of a module compiled in between is not saved for the key
+        JitObjectCache cache(dir, 0);
+        ASSERT_FALSE(cache.SetKey(key, module));
+        ASSERT_TRUE(cache.getObject(&module) == nullptr);
+        cache.notifyObjectCompiled(&other, obj->getMemBufferRef());
+        JitObjectCache reader(dir, 0);
+        ASSERT_FALSE(reader.SetKey(key, module));
+        cache.notifyObjectCompiled(&module, obj->getMemBufferRef());
+    }
+    JitObjectCache cache(dir, 0);
+    ASSERT_TRUE(cache.SetKey(key, module));
+    ASSERT_TRUE(cache.getObject(&other) == nullptr);
+    auto cached = cache.getObject(&module);
+    ASSERT_TRUE(cached != nullptr);
+    ASSERT_EQ("object code", cached->getBuffer().str());
+    ::llvm::sys::fs::remove_directories(dir);
+}
+
 TEST_F(JitWrapperTest, test_window) {
     EngineOptions options;
     options.SetKeepIr(true);
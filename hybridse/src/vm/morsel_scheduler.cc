@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/morsel_scheduler.h"
+
+#include <algorithm>
+
+namespace hybridse {
+namespace vm {
+
+MorselScheduler* MorselScheduler::GetInstance() {
+    // the threads are stopped at exit
+    static MorselScheduler scheduler;
+    return &scheduler;
+}
+
+MorselScheduler::~MorselScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool MorselScheduler::Job::RunMorsels() {
+    size_t cnt = 0;
+    for (size_t i = next.fetch_add(1); i < morsel_cnt; i = next.fetch_add(1)) {
+        fn(i);
+        cnt++;
+    }
+    if (cnt == 0) {
+        return false;
+    }
+    if (done.fetch_add(cnt) + cnt == morsel_cnt) {
+        std::lock_guard<std::mutex> lock(mu);
+        cv.notify_all();
+    }
+    return true;
+}
+
+void MorselScheduler::Run(size_t morsel_cnt, uint32_t thread_num,
+                          const std::function<void(size_t)>& fn) {
+    if (morsel_cnt == 0) {
+        return;
+    }
+    uint32_t helper_cnt =
+        static_cast<uint32_t>(std::min<size_t>(thread_num, morsel_cnt)) - 1;
+    if (helper_cnt == 0) {
+        for (size_t i = 0; i < morsel_cnt; i++) {
+            fn(i);
+        }
+        return;
+    }
+    AddThreads(helper_cnt);
+    auto job = std::make_shared<Job>(morsel_cnt, fn);
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (uint32_t i = 0; i < helper_cnt; i++) {
+            jobs_.push_back(job);
+        }
+    }
+    cv_.notify_all();
+    // the caller runs the morsels too, so the job is done even if all the
+    // threads are busy with other jobs
+    job->RunMorsels();
+    std::unique_lock<std::mutex> lock(job->mu);
+    job->cv.wait(lock, [&job] { return job->done.load() == job->morsel_cnt; });
+}
+
+void MorselScheduler::AddThreads(uint32_t thread_cnt) {
+    std::lock_guard<std::mutex> lock(mu_);
+    while (threads_.size() < thread_cnt) {
+        threads_.emplace_back(&MorselScheduler::Work, this);
+    }
+}
+
+void MorselScheduler::Work() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            cv_.wait(lock, [this] { return stopped_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+        // the job may be done by the others already, fn is not touched then
+        job->RunMorsels();
+    }
+}
+
+}  // namespace vm
+}  // namespace hybridse
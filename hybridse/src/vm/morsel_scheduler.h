@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_SRC_VM_MORSEL_SCHEDULER_H_
+#define HYBRIDSE_SRC_VM_MORSEL_SCHEDULER_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace hybridse {
+namespace vm {
+
+/**
+ * MorselScheduler runs the morsels of a runner on a process wide pool of
+ * threads. The threads of a job take the next morsel from a shared counter
+ * once they finish the last one, so the ones on small morsels take over the
+ * rest of the job and a few large partitions don't leave the others idle.
+ */
+class MorselScheduler {
+ public:
+    static MorselScheduler* GetInstance();
+
+    // stop the threads once the jobs queued are taken
+    ~MorselScheduler();
+
+    /**
+     * Run `fn(i)` for each i in [0, morsel_cnt) with `thread_num` threads
+     * at most, the caller is one of them. Return when all of them are done.
+     */
+    void Run(size_t morsel_cnt, uint32_t thread_num,
+             const std::function<void(size_t)>& fn);
+
+ private:
+    struct Job {
+        Job(size_t cnt, const std::function<void(size_t)>& f)
+            : morsel_cnt(cnt), fn(f), next(0), done(0) {}
+        // run the morsels left, return false if there are none
+        bool RunMorsels();
+
+        const size_t morsel_cnt;
+        // a copy, as a thread may take the job after Run returns. it does
+        // not call fn then, but the job outlives the caller's function
+        const std::function<void(size_t)> fn;
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+        std::mutex mu;
+        std::condition_variable cv;
+    };
+
+    MorselScheduler() : mu_(), cv_(), jobs_(), threads_(), stopped_(false) {}
+    void AddThreads(uint32_t thread_cnt);
+    void Work();
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    // a job is pushed once for each thread it asks for
+    std::deque<std::shared_ptr<Job>> jobs_;
+    std::vector<std::thread> threads_;
+    bool stopped_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_MORSEL_SCHEDULER_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vm/morsel_scheduler.h"
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace hybridse {
+namespace vm {
+
+class MorselSchedulerTest : public ::testing::Test {};
+
+TEST_F(MorselSchedulerTest, RunAllMorsels) {
+    for (uint32_t thread_num : {1, 2, 8}) {
+        for (size_t morsel_cnt : {0, 1, 3, 1000}) {
+            std::vector<std::atomic<int>> runs(morsel_cnt);
+            MorselScheduler::GetInstance()->Run(morsel_cnt, thread_num, [&runs](size_t i) { runs[i]++; });
+            for (size_t i = 0; i < morsel_cnt; i++) {
+                ASSERT_EQ(1, runs[i].load());
+            }
+        }
+    }
+}
+
+TEST_F(MorselSchedulerTest, ConcurrentJobs) {
+    std::vector<std::thread> callers;
+    std::atomic<size_t> total(0);
+    for (int i = 0; i < 4; i++) {
+        callers.emplace_back([&total] {
+            for (int j = 0; j < 50; j++) {
+                MorselScheduler::GetInstance()->Run(64, 4, [&total](size_t) { total++; });
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    ASSERT_EQ(4u * 50 * 64, total.load());
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
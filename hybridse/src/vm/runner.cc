@@ -16,6 +16,7 @@
 
 #include "vm/runner.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,6 +32,7 @@
 #include "vm/internal/eval.h"
 #include "vm/jit_runtime.h"
 #include "vm/mem_catalog.h"
+#include "vm/morsel_scheduler.h"
 
 DECLARE_bool(enable_spark_unsaferow_format);
 
@@ -246,6 +248,15 @@ ClusterTask RunnerBuilder::Build(PhysicalOpNode* node, Status& status) {
                         &runner, id_++, op->schemas_ctx(), op->GetLimitCnt(), op->window_, op->project().fn_info(),
                         op->instance_not_in_window(), op->exclude_current_time(), op->exclude_current_row(),
                         op->need_append_input() ? node->GetProducer(0)->schemas_ctx()->GetSchemaSourceSize() : 0);
+                    runner->SetThreadNum(batch_window_thread_num_);
+                    // the rows go out of the window in the order they go in unless the
+                    // current row or time is excluded
+                    if (incremental_agg_library_ != nullptr && op->window_joins_.Empty() &&
+                        !op->instance_not_in_window() && !op->exclude_current_time() &&
+                        !op->exclude_current_row()) {
+                        runner->SetIncrementalAgg(IncrementalWindowAgg::Create(
+                            op->project(), node->GetProducer(0)->schemas_ctx(), incremental_agg_library_));
+                    }
                     size_t input_slices = input->output_schemas()->GetSchemaSourceSize();
                     if (!op->window_unions_.Empty()) {
                         for (auto window_union :
@@ -1448,6 +1459,36 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
 
     // Compute output
     std::shared_ptr<MemTableHandler> output_table = std::make_shared<MemTableHandler>();
+    // the limit is counted on the whole output, and the right rows of window
+    // join are shared by the keys while the ref count of row is not atomic
+    if (thread_num_ > 1 && !limit_cnt_.has_value() && !windows_join_gen_.Valid()) {
+        std::vector<std::string> keys;
+        while (instance_partition_iter->Valid()) {
+            keys.push_back(instance_partition_iter->GetKey().ToString());
+            instance_partition_iter->Next();
+        }
+        // morsels are a lot more than the threads, so the skewed keys are balanced
+        size_t morsel_size = std::max<size_t>(1, keys.size() / (thread_num_ * MORSELS_PER_THREAD));
+        size_t morsel_cnt = (keys.size() + morsel_size - 1) / morsel_size;
+        std::vector<std::shared_ptr<MemTableHandler>> morsel_outputs(morsel_cnt);
+        MorselScheduler::GetInstance()->Run(morsel_cnt, thread_num_, [&](size_t morsel) {
+            auto morsel_output = std::make_shared<MemTableHandler>();
+            size_t end = std::min(keys.size(), (morsel + 1) * morsel_size);
+            for (size_t i = morsel * morsel_size; i < end; i++) {
+                RunWindowAggOnKey(parameter, instance_partition, union_partitions, join_right_tables, keys[i],
+                                  morsel_output);
+            }
+            morsel_outputs[morsel] = morsel_output;
+        });
+        // merge in the order of keys, the same as running them one by one
+        for (auto& morsel_output : morsel_outputs) {
+            auto iter = morsel_output->GetIterator();
+            for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                output_table->AddRow(iter->GetValue());
+            }
+        }
+        return output_table;
+    }
     while (instance_partition_iter->Valid()) {
         auto key = instance_partition_iter->GetKey().ToString();
         RunWindowAggOnKey(parameter, instance_partition, union_partitions,
@@ -1516,6 +1557,11 @@ void WindowAggRunner::RunWindowAggOnKey(
     window.set_instance_not_in_window(instance_not_in_window_);
     window.set_exclude_current_time(exclude_current_time_);
     window.set_exclude_current_row(exclude_current_row_);
+    std::unique_ptr<IncrementalWindowAgg::State> agg_state;
+    if (incremental_agg_) {
+        agg_state = incremental_agg_->NewState();
+        window.set_listener(agg_state.get());
+    }
 
     while (instance_segment_iter->Valid()) {
         if (limit_cnt_.has_value() && cnt >= limit_cnt_) {
@@ -1547,7 +1593,9 @@ void WindowAggRunner::RunWindowAggOnKey(
             min_union_pos = IteratorStatus::FindLastIteratorWithMininumKey(union_segment_status);
         }
 
-        if (windows_join_gen_.Valid()) {
+        if (agg_state) {
+            output_table->AddRow(IncrementalProject(instance_order, instance_row, agg_state.get(), &window));
+        } else if (windows_join_gen_.Valid()) {
             Row row = windows_join_gen_.Join(instance_row, join_right_tables, parameter);
             output_table->AddRow(
                 window_project_gen_.Gen(instance_order, row, parameter, true, append_slices_, &window));
@@ -1561,6 +1609,24 @@ void WindowAggRunner::RunWindowAggOnKey(
     }
 }
 
+// buffer the row into window and output the project of it the same as
+// `Runner::WindowProject`, with the aggregations of state
+Row WindowAggRunner::IncrementalProject(uint64_t key, const Row& row, IncrementalWindowAgg::State* state,
+                                        Window* window) {
+    if (row.empty()) {
+        return row;
+    }
+    if (!window->BufferData(key, row)) {
+        LOG(WARNING) << "fail to buffer data";
+        return Row();
+    }
+    Row output = state->Output(row);
+    if (append_slices_ > 0 && !FLAGS_enable_spark_unsaferow_format) {
+        return Row(append_slices_, row, 1, output);
+    }
+    return output;
+}
+
 std::shared_ptr<DataHandler> RequestLastJoinRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {  // NOLINT
@@ -3227,6 +3293,13 @@ std::shared_ptr<DataHandler> RequestUnionRunner::Run(
 std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
     const Row& request, std::vector<std::shared_ptr<TableHandler>> union_segments, int64_t ts_gen,
     const WindowRange& window_range, bool output_request_row, bool exclude_current_time, bool exclude_current_row) {
+    UnionSegments segments(union_segments);
+    return RequestUnionWindow(request, &segments, ts_gen, window_range, output_request_row, exclude_current_time,
+                              exclude_current_row);
+}
+std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
+    const Row& request, UnionSegments* union_segments, int64_t ts_gen,
+    const WindowRange& window_range, bool output_request_row, bool exclude_current_time, bool exclude_current_row) {
     uint64_t start = 0;
     // end is empty means end value < 0, that there is no effective window range
     // this happend when `ts_gen` is 0 and exclude current_time needed
@@ -3266,30 +3339,7 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
 
     auto window_table = std::make_shared<MemTimeTableHandler>();
 
-    size_t unions_cnt = union_segments.size();
-    // Prepare Union Segment Iterators
-    std::vector<std::unique_ptr<RowIterator>> union_segment_iters(unions_cnt);
-    std::vector<IteratorStatus> union_segment_status(unions_cnt);
-
-    for (size_t i = 0; i < unions_cnt; i++) {
-        if (!union_segments[i]) {
-            union_segment_status[i] = IteratorStatus();
-            continue;
-        }
-        union_segment_iters[i] = union_segments[i]->GetIterator();
-        if (!union_segment_iters[i]) {
-            union_segment_status[i] = IteratorStatus();
-            continue;
-        }
-        union_segment_iters[i]->Seek(end.value_or(0));
-        if (!union_segment_iters[i]->Valid()) {
-            union_segment_status[i] = IteratorStatus();
-            continue;
-        }
-        uint64_t ts = union_segment_iters[i]->GetKey();
-        union_segment_status[i] = IteratorStatus(ts);
-    }
-    int32_t max_union_pos = IteratorStatus::FindFirstIteratorWithMaximizeKey(union_segment_status);
+    size_t pos = union_segments->LowerBound(end.value_or(0));
 
     uint64_t cnt = 0;
     auto range_status = window_range.GetWindowPositionStatus(
@@ -3302,38 +3352,176 @@ std::shared_ptr<TableHandler> RequestUnionRunner::RequestUnionWindow(
         cnt++;
     }
 
-    while (-1 != max_union_pos) {
+    for (; union_segments->Valid(pos); pos++) {
         if (max_size > 0 && cnt >= max_size) {
             break;
         }
-        auto range_status = window_range.GetWindowPositionStatus(
-            cnt > rows_start_preceding,
-            union_segment_status[max_union_pos].key_ > end,
-            union_segment_status[max_union_pos].key_ < start);
+        uint64_t key = union_segments->GetKey(pos);
+        auto range_status = window_range.GetWindowPositionStatus(cnt > rows_start_preceding, key > end, key < start);
         if (WindowRange::kExceedWindow == range_status) {
             break;
         }
         if (WindowRange::kInWindow == range_status) {
-            window_table->AddRow(
-                union_segment_status[max_union_pos].key_,
-                union_segment_iters[max_union_pos]->GetValue());
+            window_table->AddRow(key, union_segments->GetValue(pos));
             cnt++;
         }
-        // Update Iterator Status
-        union_segment_iters[max_union_pos]->Next();
-        if (!union_segment_iters[max_union_pos]->Valid()) {
-            union_segment_status[max_union_pos].MarkInValid();
-        } else {
-            union_segment_status[max_union_pos].set_key(
-                union_segment_iters[max_union_pos]->GetKey());
-        }
-        // Pick new mininum union pos
-        max_union_pos = IteratorStatus::FindFirstIteratorWithMaximizeKey(union_segment_status);
     }
     DLOG(INFO) << "REQUEST UNION cnt = " << window_table->GetCount();
     return window_table;
 }
 
+std::shared_ptr<DataHandlerList> RequestUnionRunner::BatchRequestRun(RunnerContext& ctx) {
+    // the common requests are run once by the default one
+    if (need_batch_cache_ || producers_.size() < 2u) {
+        return Runner::BatchRequestRun(ctx);
+    }
+    if (need_cache_) {
+        auto cached = ctx.GetBatchCache(id_);
+        if (cached != nullptr) {
+            DLOG(INFO) << "RUNNER ID " << id_ << " HIT CACHE!";
+            return cached;
+        }
+    }
+    auto left = producers_[0]->BatchRequestRun(ctx);
+    auto right = producers_[1]->BatchRequestRun(ctx);
+    if (!left || !right) {
+        LOG(WARNING) << "the result of producer is null";
+        return nullptr;
+    }
+    auto& parameter = ctx.GetParameterRow();
+    auto union_inputs = windows_union_gen_.RunInputs(ctx);
+
+    size_t request_size = ctx.GetRequestSize();
+    std::vector<Row> requests(request_size);
+    std::vector<int64_t> ts_gens(request_size, -1);
+    // the requests of each key in the order of the first request
+    std::unordered_map<std::string, size_t> key_pos;
+    std::vector<std::vector<size_t>> key_requests;
+    for (size_t idx = 0; idx < request_size; idx++) {
+        auto left_handler = left->Get(idx);
+        if (!left_handler || !right->Get(idx) || kRowHandler != left_handler->GetHandlerType()) {
+            continue;
+        }
+        requests[idx] = std::dynamic_pointer_cast<RowHandler>(left_handler)->GetValue();
+        if (range_gen_.Valid()) {
+            ts_gens[idx] = range_gen_.ts_gen_.Gen(requests[idx]);
+        }
+        auto it = key_pos.emplace(GetUnionKey(requests[idx], parameter), key_requests.size()).first;
+        if (it->second == key_requests.size()) {
+            key_requests.emplace_back();
+        }
+        key_requests[it->second].push_back(idx);
+    }
+
+    std::vector<std::shared_ptr<DataHandler>> windows(request_size);
+    for (auto& idxs : key_requests) {
+        // the window ends in the order of ts, so the later requests seek the rows read by the
+        // earlier ones. The window without ts ends at the top
+        auto window_end = [&ts_gens](size_t idx) { return ts_gens[idx] < 0 ? INT64_MAX : ts_gens[idx]; };
+        std::stable_sort(idxs.begin(), idxs.end(),
+                         [&window_end](size_t l, size_t r) { return window_end(l) > window_end(r); });
+        UnionSegments segments(windows_union_gen_.GetRequestWindows(requests[idxs[0]], parameter, union_inputs));
+        for (size_t idx : idxs) {
+            windows[idx] = RequestUnionWindow(requests[idx], &segments, ts_gens[idx], range_gen_.window_range_,
+                                              output_request_row_, exclude_current_time_, exclude_current_row_);
+        }
+    }
+    std::shared_ptr<DataHandlerVector> outputs = std::make_shared<DataHandlerVector>();
+    for (auto& window : windows) {
+        outputs->Add(window);
+    }
+    if (ctx.is_debug()) {
+        std::ostringstream oss;
+        oss << "RUNNER TYPE: " << RunnerTypeName(type_) << ", ID: " << id_ << ", KEYS: " << key_requests.size()
+            << "\n";
+        for (size_t idx = 0; idx < outputs->GetSize(); idx++) {
+            if (idx >= MAX_DEBUG_BATCH_SiZE) {
+                oss << ">= MAX_DEBUG_BATCH_SiZE...\n";
+                break;
+            }
+            Runner::PrintData(oss, output_schemas_, outputs->Get(idx));
+        }
+        LOG(INFO) << oss.str();
+    }
+    if (need_cache_) {
+        ctx.SetBatchCache(id_, outputs);
+    }
+    return outputs;
+}
+
+std::string RequestUnionRunner::GetUnionKey(const Row& request, const Row& parameter) {
+    std::string union_key;
+    for (auto& window_gen : windows_union_gen_.windows_gen_) {
+        for (const std::string& key : {window_gen.index_seek_gen_.index_key_gen_.Valid()
+                                           ? window_gen.index_seek_gen_.index_key_gen_.Gen(request, parameter)
+                                           : "",
+                                       window_gen.filter_gen_.GetKey(request, parameter)}) {
+            // the size is put ahead, so the keys are not mixed up
+            absl::StrAppend(&union_key, key.size(), ":", key);
+        }
+    }
+    return union_key;
+}
+
+UnionSegments::UnionSegments(const std::vector<std::shared_ptr<TableHandler>>& segments)
+    : segments_(segments),
+      iters_(segments.size()),
+      status_(segments.size()),
+      max_pos_(-1),
+      seeked_(false),
+      rows_() {}
+
+size_t UnionSegments::LowerBound(uint64_t key) {
+    if (!seeked_) {
+        seeked_ = true;
+        for (size_t i = 0; i < segments_.size(); i++) {
+            if (!segments_[i]) {
+                continue;
+            }
+            iters_[i] = segments_[i]->GetIterator();
+            if (!iters_[i]) {
+                continue;
+            }
+            iters_[i]->Seek(key);
+            if (iters_[i]->Valid()) {
+                status_[i] = IteratorStatus(iters_[i]->GetKey());
+            }
+        }
+        max_pos_ = IteratorStatus::FindFirstIteratorWithMaximizeKey(status_);
+    }
+    while ((rows_.empty() || rows_.back().first > key) && ReadNext()) {
+    }
+    // the rows are in the descending order of ts
+    return std::partition_point(rows_.begin(), rows_.end(),
+                                [key](const std::pair<uint64_t, Row>& row) { return row.first > key; }) -
+           rows_.begin();
+}
+
+bool UnionSegments::Valid(size_t pos) {
+    while (pos >= rows_.size()) {
+        if (!ReadNext()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UnionSegments::ReadNext() {
+    if (-1 == max_pos_) {
+        return false;
+    }
+    auto& iter = iters_[max_pos_];
+    rows_.emplace_back(status_[max_pos_].key_, iter->GetValue());
+    iter->Next();
+    if (!iter->Valid()) {
+        status_[max_pos_].MarkInValid();
+    } else {
+        status_[max_pos_].set_key(iter->GetKey());
+    }
+    max_pos_ = IteratorStatus::FindFirstIteratorWithMaximizeKey(status_);
+    return true;
+}
+
 std::shared_ptr<DataHandler> PostRequestUnionRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -17,6 +17,7 @@
 #ifndef HYBRIDSE_SRC_VM_RUNNER_H_
 #define HYBRIDSE_SRC_VM_RUNNER_H_
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
@@ -34,6 +35,7 @@
 #include "vm/catalog.h"
 #include "vm/catalog_wrapper.h"
 #include "vm/core_api.h"
+#include "vm/incremental_aggregator.h"
 #include "vm/mem_catalog.h"
 #include "vm/physical_op.h"
 namespace hybridse {
@@ -941,6 +943,13 @@ class WindowAggRunner : public Runner {
     void AddWindowUnion(const WindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
+    // run the partition keys in morsels with thread_num threads, 1 runs them in the caller
+    void SetThreadNum(uint32_t thread_num) { thread_num_ = std::max<uint32_t>(thread_num, 1); }
+    // evaluate the project by incremental_agg instead of the generated code
+    void SetIncrementalAgg(std::unique_ptr<IncrementalWindowAgg> incremental_agg) {
+        incremental_agg_ = std::move(incremental_agg);
+    }
+    bool IsIncrementalAgg() const { return incremental_agg_ != nullptr; }
     std::shared_ptr<DataHandler> Run(
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
@@ -962,6 +971,40 @@ class WindowAggRunner : public Runner {
     WindowUnionGenerator windows_union_gen_;
     WindowJoinGenerator windows_join_gen_;
     WindowProjectGenerator window_project_gen_;
+
+ private:
+    Row IncrementalProject(uint64_t key, const Row& row, IncrementalWindowAgg::State* state, Window* window);
+
+    static constexpr size_t MORSELS_PER_THREAD = 16;
+    uint32_t thread_num_ = 1;
+    std::unique_ptr<IncrementalWindowAgg> incremental_agg_;
+};
+
+// UnionSegments merges the union segments of a key in the descending order of
+// ts. The rows are read once and kept, so the windows of the requests of the
+// key are built from them instead of seeking the segments for each request.
+class UnionSegments {
+ public:
+    explicit UnionSegments(const std::vector<std::shared_ptr<TableHandler>>& segments);
+
+    // return the position of the first row with ts not larger than key. The
+    // segments are seeked to the key of the first call, so the keys of the
+    // following calls should not be larger than it.
+    size_t LowerBound(uint64_t key);
+    // return true if there is a row at pos, the rows are read until it
+    bool Valid(size_t pos);
+    uint64_t GetKey(size_t pos) const { return rows_[pos].first; }
+    const Row& GetValue(size_t pos) const { return rows_[pos].second; }
+
+ private:
+    bool ReadNext();
+
+    std::vector<std::shared_ptr<TableHandler>> segments_;
+    std::vector<std::unique_ptr<RowIterator>> iters_;
+    std::vector<IteratorStatus> status_;
+    int32_t max_pos_;
+    bool seeked_;
+    std::vector<std::pair<uint64_t, Row>> rows_;
 };
 
 class RequestUnionRunner : public Runner {
@@ -978,11 +1021,17 @@ class RequestUnionRunner : public Runner {
         RunnerContext& ctx,  // NOLINT
         const std::vector<std::shared_ptr<DataHandler>>& inputs)
         override;  // NOLINT
+    // the requests of the same key share the union segments, which are read once
+    std::shared_ptr<DataHandlerList> BatchRequestRun(RunnerContext& ctx) override;  // NOLINT
     static std::shared_ptr<TableHandler> RequestUnionWindow(const Row& request,
                                                             std::vector<std::shared_ptr<TableHandler>> union_segments,
                                                             int64_t request_ts, const WindowRange& window_range,
                                                             bool output_request_row, bool exclude_current_time,
                                                             bool exclude_current_row);
+    static std::shared_ptr<TableHandler> RequestUnionWindow(const Row& request, UnionSegments* union_segments,
+                                                            int64_t request_ts, const WindowRange& window_range,
+                                                            bool output_request_row, bool exclude_current_time,
+                                                            bool exclude_current_row);
     void AddWindowUnion(const RequestWindowOp& window, Runner* runner) {
         windows_union_gen_.AddWindowUnion(window, runner);
     }
@@ -991,6 +1040,10 @@ class RequestUnionRunner : public Runner {
     bool exclude_current_time_;
     bool exclude_current_row_ = false;
     bool output_request_row_;
+
+ private:
+    // the keys of the union segments of the request
+    std::string GetUnionKey(const Row& request, const Row& parameter);
 };
 
 class RequestAggUnionRunner : public Runner {
@@ -1487,6 +1540,10 @@ class RunnerBuilder {
           proxy_runner_map_(),
           batch_common_node_set_(batch_common_node_set) {}
     virtual ~RunnerBuilder() {}
+    // threads of each batch mode window aggregation runner
+    void SetBatchWindowThreadNum(uint32_t thread_num) { batch_window_thread_num_ = thread_num; }
+    // evaluate the batch mode window aggregations of the incremental udafs of library incrementally
+    void SetIncrementalWindowAgg(const udf::UdfLibrary* library) { incremental_agg_library_ = library; }
     ClusterTask RegisterTask(PhysicalOpNode* node, ClusterTask task) {
         task_map_[node] = task;
         if (batch_common_node_set_.find(node->node_id()) !=
@@ -1548,6 +1605,8 @@ class RunnerBuilder {
     std::unordered_map<hybridse::vm::Runner*, ::hybridse::vm::Runner*>
         proxy_runner_map_;
     std::set<size_t> batch_common_node_set_;
+    uint32_t batch_window_thread_num_ = 1;
+    const udf::UdfLibrary* incremental_agg_library_ = nullptr;
     ClusterTask MultipleInherit(const std::vector<const ClusterTask*>& children, Runner* runner,
                                                 const Key& index_key, const TaskBiasType bias);
     ClusterTask BinaryInherit(const ClusterTask& left, const ClusterTask& right,
@@ -49,6 +49,23 @@ SqlCompiler::SqlCompiler(const std::shared_ptr<Catalog>& cl, bool keep_ir,
 
 SqlCompiler::~SqlCompiler() {}
 
+// the bytes of the machine code and the relocations of an ir instruction
+static constexpr size_t kJitBytesPerInst = 32;
+// the memory of a plan or expression node
+static constexpr size_t kBytesPerNode = 128;
+// the memory manager, symbol table and so on of a jit instance
+static constexpr size_t kJitFixedBytes = 64 * 1024;
+
+size_t SqlCompileInfo::GetMemSize() const {
+    size_t size = sizeof(SqlCompileInfo) + sql_ctx.compiled_mem_size;
+    size += sql_ctx.sql.size() + sql_ctx.db.size() + sql_ctx.ir.size() + sql_ctx.logical_plan_str.size() +
+            sql_ctx.physical_plan_str.size() + sql_ctx.encoded_schema.size() +
+            sql_ctx.encoded_request_schema.size();
+    size += (sql_ctx.schema.size() + sql_ctx.request_schema.size() + sql_ctx.parameter_types.size()) *
+            sizeof(type::ColumnDef);
+    return size;
+}
+
 void SqlCompiler::KeepIR(SqlContext& ctx, llvm::Module* m) {
     if (m == NULL) {
         LOG(WARNING) << "module is null";
@@ -125,13 +142,17 @@ bool SqlCompiler::Compile(SqlContext& ctx, Status& status) {  // NOLINT
     }
     InitBuiltinJitSymbols(jit.get());
     ctx.udf_library->InitJITSymbols(jit.get());
-    if (!jit->OptModule(m.get())) {
+    // the cached object code is compiled from the optimized module
+    bool cached = jit->FindCachedObject(*m);
+    if (!cached && !jit->OptModule(m.get())) {
         LOG(WARNING) << "fail to opt ir module for sql " << ctx.sql;
         return false;
     }
     if (keep_ir_) {
         KeepIR(ctx, m.get());
     }
+    ctx.compiled_mem_size = kJitFixedBytes + m->getInstructionCount() * kJitBytesPerInst +
+                            ctx.nm.GetNodeListSize() * kBytesPerNode;
     if (!jit->AddModule(std::move(m), std::move(llvm_ctx))) {
         LOG(WARNING) << "fail to add ir module  for sql " << ctx.sql;
         return false;
@@ -308,6 +329,12 @@ bool SqlCompiler::BuildClusterJob(SqlContext& ctx, Status& status) {  // NOLINT
                                  ctx.is_cluster_optimized && is_request_mode,
                                  ctx.batch_request_info.common_column_indices,
                                  ctx.batch_request_info.common_node_set);
+    if (vm::kBatchMode == ctx.engine_mode) {
+        runner_builder.SetBatchWindowThreadNum(ctx.batch_window_thread_num);
+        if (ctx.enable_incremental_window_agg) {
+            runner_builder.SetIncrementalWindowAgg(ctx.udf_library);
+        }
+    }
     ctx.cluster_job = runner_builder.BuildClusterJob(ctx.physical_plan, status);
     return status.isOK();
 }
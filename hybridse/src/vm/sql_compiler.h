@@ -45,6 +45,8 @@ struct SqlContext {
     bool enable_expr_optimize = false;
     bool enable_batch_window_parallelization = true;
     bool enable_window_column_pruning = false;
+    uint32_t batch_window_thread_num = 1;
+    bool enable_incremental_window_agg = false;
 
     // the sql content
     std::string sql;
@@ -66,6 +68,8 @@ struct SqlContext {
     uint32_t row_size;
     uint32_t limit_cnt = 0;
     std::string ir;
+    // the estimated memory of the generated code and the plan nodes
+    size_t compiled_mem_size = 0;
     std::string logical_plan_str;
     std::string physical_plan_str;
     std::string encoded_schema;
@@ -92,6 +96,7 @@ class SqlCompileInfo : public CompileInfo {
         return buf.CopyFrom(str.data(), str.size());
     }
     size_t GetIRSize() { return this->sql_ctx.ir.size(); }
+    size_t GetMemSize() const override;
 
     const hybridse::vm::Schema& GetSchema() const { return sql_ctx.schema; }
 
@@ -661,6 +661,41 @@ TEST_F(WindowIteratorTest, PureHistoryWindowWithMaxSizeTest) {
     window.BufferData(1590739002000, row);
 }
 
+class CountWindowListener : public WindowListener {
+ public:
+    void OnAddRow(const Row& row) override { cnt_++; }
+    void OnPopRow(const Row& row) override { cnt_--; }
+    int64_t cnt_ = 0;
+};
+
+TEST_F(WindowIteratorTest, HistoryWindowListenerTest) {
+    int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));
+    *(reinterpret_cast<int32_t*>(ptr + 2)) = 1;
+    *(reinterpret_cast<int64_t*>(ptr + 2 + 4)) = 1;
+    Row row(base::RefCountedSlice::Create(ptr, 28));
+    // RowsRange between 3s preceding and 1s preceding MAXSIZE 2
+    vm::HistoryWindow window(
+        WindowRange(vm::Window::kFrameRowsRange, -3000, -1000, 0, 2));
+    CountWindowListener listener;
+    window.set_listener(&listener);
+    for (uint64_t ts : {1590738990000, 1590738991000, 1590738992000, 1590738993000, 1590738999000,
+                        1590739001000, 1590739002000}) {
+        ASSERT_TRUE(window.BufferData(ts, row));
+        ASSERT_EQ(static_cast<int64_t>(window.GetCount()), listener.cnt_);
+    }
+
+    // Rows between 2 preceding and current row
+    vm::CurrentHistoryWindow rows_window(
+        WindowRange(vm::Window::kFrameRows, 0, 0, 2, 0));
+    CountWindowListener rows_listener;
+    rows_window.set_listener(&rows_listener);
+    for (uint64_t ts = 1; ts < 10; ts++) {
+        ASSERT_TRUE(rows_window.BufferData(ts, row));
+        ASSERT_EQ(static_cast<int64_t>(rows_window.GetCount()), rows_listener.cnt_);
+    }
+    ASSERT_EQ(3, rows_listener.cnt_);
+}
+
 TEST_F(WindowIteratorTest, PureHistoryWindowRowsMergeRowsRangeWithMaxSizeTest) {
     std::vector<std::pair<uint64_t, Row>> rows;
     int8_t* ptr = reinterpret_cast<int8_t*>(malloc(28));
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_EPOCH_H_
+#define SRC_BASE_EPOCH_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>  // NOLINT
+
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace base {
+
+// EpochPin is the record of one pin, it keeps the epoch pinned by its owner
+struct EpochPin {
+    uint64_t epoch = 0;
+    uint32_t slot = 0;
+    EpochPin* prev = nullptr;
+    EpochPin* next = nullptr;
+};
+
+// EpochManager implements epoch based reclamation. A reader pins the current epoch
+// before it reaches shared nodes and unpins it when it is done. A writer unlinks
+// nodes, tags them with the current epoch and advances the epoch, a node can be
+// freed once its tag is less than GetSafeEpoch, as no reader that may still see it
+// is left.
+//
+// Every pin keeps its own epoch in a record linked to the slot of its thread, so a
+// nested pin or a pin of another thread sharing the slot never holds back the epoch
+// of the others. Threads are spread over a fixed number of slots, so pinning only
+// locks the cache line of its own slot.
+class EpochManager {
+ public:
+    static constexpr uint32_t SLOT_NUM = 32;
+
+    EpochManager() : epoch_(1) {}
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // pin the current epoch with the record, it can be nested and exited in another thread
+    void Enter(EpochPin* pin) {
+        pin->slot = GetThreadId() % SLOT_NUM;
+        Slot& slot = slots_[pin->slot];
+        std::lock_guard<SpinMutex> lock(slot.mu);
+        // the epoch is read in the lock, so a writer scanning the slot before sees the
+        // nodes unlinked and a writer scanning it after sees the pin
+        pin->epoch = epoch_.load(std::memory_order_acquire);
+        pin->prev = nullptr;
+        pin->next = slot.head;
+        if (slot.head != nullptr) {
+            slot.head->prev = pin;
+        }
+        slot.head = pin;
+    }
+
+    void Exit(EpochPin* pin) {
+        Slot& slot = slots_[pin->slot];
+        std::lock_guard<SpinMutex> lock(slot.mu);
+        if (pin->prev != nullptr) {
+            pin->prev->next = pin->next;
+        } else {
+            slot.head = pin->next;
+        }
+        if (pin->next != nullptr) {
+            pin->next->prev = pin->prev;
+        }
+        pin->prev = nullptr;
+        pin->next = nullptr;
+    }
+
+    uint64_t GetEpoch() const { return epoch_.load(std::memory_order_acquire); }
+
+    // the counter of epoch, for the structures which tag retired memory by themselves
+    const std::atomic<uint64_t>* GetEpochCounter() const { return &epoch_; }
+
+    // call it after the retired nodes are tagged, return the new epoch
+    uint64_t Advance() { return epoch_.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    // the nodes retired with an epoch less than it are not reachable by any reader
+    uint64_t GetSafeEpoch() const {
+        uint64_t safe = epoch_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < SLOT_NUM; i++) {
+            const Slot& slot = slots_[i];
+            std::lock_guard<SpinMutex> lock(slot.mu);
+            for (const EpochPin* pin = slot.head; pin != nullptr; pin = pin->next) {
+                if (pin->epoch < safe) {
+                    safe = pin->epoch;
+                }
+            }
+        }
+        return safe;
+    }
+
+ private:
+    static uint32_t GetThreadId() {
+        static std::atomic<uint32_t> next_id(0);
+        static thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    // the pins of the threads sharing the slot
+    struct alignas(64) Slot {
+        mutable SpinMutex mu;
+        EpochPin* head = nullptr;
+    };
+
+    std::atomic<uint64_t> epoch_;
+    Slot slots_[SLOT_NUM];
+};
+
+// EpochGuard pins the epoch of a manager in its scope. It can be reset to another
+// manager or released, a guard without manager pins nothing
+class EpochGuard {
+ public:
+    EpochGuard() : manager_(nullptr) {}
+    explicit EpochGuard(EpochManager* manager) : manager_(nullptr) { Reset(manager); }
+    ~EpochGuard() { Reset(nullptr); }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+    void Reset(EpochManager* manager) {
+        if (manager_ != nullptr) {
+            manager_->Exit(&pin_);
+        }
+        manager_ = manager;
+        if (manager_ != nullptr) {
+            manager_->Enter(&pin_);
+        }
+    }
+
+ private:
+    EpochManager* manager_;
+    EpochPin pin_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_EPOCH_H_
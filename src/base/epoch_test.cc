@@ -0,0 +1,186 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/epoch.h"
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <deque>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class EpochTest : public ::testing::Test {
+ public:
+    EpochTest() {}
+    ~EpochTest() {}
+};
+
+TEST_F(EpochTest, EnterAndExit) {
+    EpochManager manager;
+    uint64_t epoch = manager.GetEpoch();
+    ASSERT_EQ(epoch, manager.GetSafeEpoch());
+    {
+        EpochGuard guard(&manager);
+        uint64_t retired = manager.GetEpoch();
+        ASSERT_EQ(epoch + 1, manager.Advance());
+        // the reader pins the epoch before the advance
+        ASSERT_EQ(epoch, manager.GetSafeEpoch());
+        ASSERT_FALSE(retired < manager.GetSafeEpoch());
+        {
+            // the nested pin keeps the older epoch
+            EpochGuard nested(&manager);
+            manager.Advance();
+            ASSERT_EQ(epoch, manager.GetSafeEpoch());
+        }
+        ASSERT_EQ(epoch, manager.GetSafeEpoch());
+    }
+    ASSERT_EQ(epoch + 2, manager.GetSafeEpoch());
+    EpochGuard guard;
+    guard.Reset(&manager);
+    ASSERT_EQ(epoch + 2, manager.GetSafeEpoch());
+    manager.Advance();
+    ASSERT_EQ(epoch + 2, manager.GetSafeEpoch());
+    guard.Reset(nullptr);
+    ASSERT_EQ(epoch + 3, manager.GetSafeEpoch());
+}
+
+TEST_F(EpochTest, PinKeepsOwnEpoch) {
+    EpochManager manager;
+    uint64_t epoch = manager.GetEpoch();
+    auto* outer = new EpochGuard(&manager);
+    manager.Advance();
+    EpochGuard inner(&manager);
+    manager.Advance();
+    ASSERT_EQ(epoch, manager.GetSafeEpoch());
+    // the inner pin does not hold back the epoch after the outer one exits
+    delete outer;
+    ASSERT_EQ(epoch + 1, manager.GetSafeEpoch());
+    // so do the pins of other threads sharing the slots
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> pinned(0);
+    std::atomic<bool> stop(false);
+    for (uint32_t i = 0; i < EpochManager::SLOT_NUM * 2; i++) {
+        threads.emplace_back([&manager, &pinned, &stop] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                {
+                    EpochGuard guard(&manager);
+                    pinned.fetch_add(1, std::memory_order_relaxed);
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (pinned.load(std::memory_order_relaxed) < 10000) {
+        std::this_thread::yield();
+    }
+    uint64_t cur = manager.Advance();
+    inner.Reset(nullptr);
+    // the pins before the advance end soon, while the threads keep pinning
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (manager.GetSafeEpoch() < cur && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(cur, manager.GetSafeEpoch());
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+TEST_F(EpochTest, ExitInOtherThread) {
+    EpochManager manager;
+    EpochGuard* guard = nullptr;
+    std::thread t([&manager, &guard] { guard = new EpochGuard(&manager); });
+    t.join();
+    uint64_t epoch = manager.GetEpoch();
+    manager.Advance();
+    ASSERT_EQ(epoch, manager.GetSafeEpoch());
+    delete guard;
+    ASSERT_EQ(epoch + 1, manager.GetSafeEpoch());
+}
+
+struct Object {
+    explicit Object(uint64_t v) : value(v), alive(true) {}
+    ~Object() { alive = false; }
+
+    uint64_t value;
+    std::atomic<bool> alive;
+};
+
+TEST_F(EpochTest, Reclaim) {
+    EpochManager manager;
+    std::atomic<Object*> cur(new Object(0));
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> error_cnt(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&manager, &cur, &stop, &error_cnt] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                {
+                    EpochGuard guard(&manager);
+                    Object* obj = cur.load(std::memory_order_acquire);
+                    for (int j = 0; j < 10; j++) {
+                        if (!obj->alive.load(std::memory_order_relaxed)) {
+                            error_cnt.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    // objects are not freed at once so that the use after free can be detected by the flag
+    std::deque<std::pair<uint64_t, Object*>> retired;
+    std::vector<Object*> freed;
+    for (uint64_t i = 1; i <= 20000; i++) {
+        Object* old = cur.exchange(new Object(i), std::memory_order_acq_rel);
+        retired.emplace_back(manager.GetEpoch(), old);
+        manager.Advance();
+        uint64_t safe_epoch = manager.GetSafeEpoch();
+        while (!retired.empty() && retired.front().first < safe_epoch) {
+            retired.front().second->~Object();
+            freed.push_back(retired.front().second);
+            retired.pop_front();
+        }
+    }
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& t : readers) {
+        t.join();
+    }
+    ASSERT_EQ(0u, error_cnt.load());
+    ASSERT_LT(retired.size(), 20000u);
+    for (auto obj : freed) {
+        ::operator delete(obj);
+    }
+    for (auto& kv : retired) {
+        delete kv.second;
+    }
+    delete cur.load();
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
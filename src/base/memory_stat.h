@@ -46,14 +46,26 @@
 
 #pragma once
 
-namespace openmldb::base {
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #if defined(__linux__)
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#elif defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <mach/task.h>
+#include <mach/mach_init.h>
+#endif
 
-size_t GetRSS() {
+namespace openmldb::base {
+
+#if defined(__linux__)
+inline size_t GetRSS() {
     int page = sysconf(_SC_PAGESIZE);
     size_t rss;
     char buf[4096];
@@ -85,12 +97,7 @@ size_t GetRSS() {
     return rss;
 }
 #elif defined(__APPLE__)
-#include <sys/types.h>
-#include <sys/sysctl.h>
-#include <mach/task.h>
-#include <mach/mach_init.h>
-
-size_t GetRSS() {
+inline size_t GetRSS() {
     task_t task = MACH_PORT_NULL;
     struct task_basic_info t_info;
     mach_msg_type_number_t t_info_count = TASK_BASIC_INFO_COUNT;
@@ -20,10 +20,15 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <thread>  // NOLINT
 
 #include "base/random.h"
+#include "base/slab_allocator.h"
 
 namespace openmldb {
 namespace base {
@@ -45,14 +50,40 @@ class Node {
  public:
     // Set data reference and Node height
     Node(const K& key, V& value, uint8_t height)  // NOLINT
-        : height_(height), key_(key), value_(value) {
+        : height_(height), inline_nexts_(false), key_(key), value_(value) {
         nexts_ = new std::atomic<Node<K, V>*>[height];
     }
 
-    Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
+    Node(uint8_t height) : height_(height), inline_nexts_(false), key_(), value_() {  // NOLINT
         nexts_ = new std::atomic<Node<K, V>*>[height];
     }
 
+    // Create a node whose next pointers are placed right after it in one allocation.
+    // The node must be freed by Node::Free with the same allocator
+    static Node<K, V>* New(SlabAllocator* allocator, const K& key, V& value, uint8_t height) {  // NOLINT
+        if (allocator == nullptr) {
+            return new Node<K, V>(key, value, height);
+        }
+        void* mem = allocator->Allocate(ByteSize(height));
+        return new (mem) Node<K, V>(key, value, height, InlineNexts(mem));
+    }
+
+    static void Free(SlabAllocator* allocator, Node<K, V>* node) {
+        if (node == nullptr) {
+            return;
+        }
+        if (!node->inline_nexts_) {
+            delete node;
+            return;
+        }
+        size_t size = ByteSize(node->height_);
+        node->~Node();
+        allocator->Free(node, size);
+    }
+
+    // the byte size of node with inline next pointers
+    static size_t ByteSize(uint8_t height) { return sizeof(Node<K, V>) + height * sizeof(std::atomic<Node<K, V>*>); }
+
     // Set the next node with memory barrier
     void SetNext(uint8_t level, Node<K, V>* node) {
         assert(level < height_ && level >= 0);
@@ -77,14 +108,39 @@ class Node {
         return nexts_[level].load(std::memory_order_relaxed);
     }
 
+    // Set the next node only if the current next node is expected
+    bool CASNext(uint8_t level, Node<K, V>* expected, Node<K, V>* node) {
+        assert(level < height_ && level >= 0);
+        return nexts_[level].compare_exchange_strong(expected, node, std::memory_order_release,
+                                                     std::memory_order_relaxed);
+    }
+
     V& GetValue() { return value_; }
 
     const K& GetKey() const { return key_; }
 
-    ~Node() { delete[] nexts_; }
+    ~Node() {
+        if (!inline_nexts_) {
+            delete[] nexts_;
+        }
+    }
+
+ private:
+    Node(const K& key, V& value, uint8_t height, std::atomic<Node<K, V>*>* nexts)  // NOLINT
+        : height_(height), inline_nexts_(true), key_(key), value_(value), nexts_(nexts) {
+        for (uint8_t i = 0; i < height; i++) {
+            new (&nexts_[i]) std::atomic<Node<K, V>*>(nullptr);
+        }
+    }
+
+    static std::atomic<Node<K, V>*>* InlineNexts(void* mem) {
+        return reinterpret_cast<std::atomic<Node<K, V>*>*>(reinterpret_cast<char*>(mem) + sizeof(Node<K, V>));
+    }
 
  private:
     uint8_t const height_;
+    // whether nexts_ is allocated together with the node
+    bool const inline_nexts_;
     K const key_;
     V value_;
     std::atomic<Node<K, V>*>* nexts_;
@@ -93,6 +149,8 @@ class Node {
 template <class K, class V, class Comparator>
 class Skiplist {
  public:
+    // The list keeps no allocator. The nodes are allocated from the allocator passed to the
+    // inserting methods if it is not null, and the owner must free them with the same one
     Skiplist(uint8_t max_height, uint8_t branch, const Comparator& compare)
         : MaxHeight(max_height),
           Branch(branch),
@@ -110,7 +168,7 @@ class Skiplist {
     ~Skiplist() { delete head_; }
 
     // Insert need external synchronized
-    uint8_t Insert(const K& key, V& value) {  // NOLINT
+    uint8_t Insert(const K& key, V& value, SlabAllocator* allocator = nullptr) {  // NOLINT
         uint8_t height = RandomHeight();
         Node<K, V>* pre[MaxHeight];
         FindLessOrEqual(key, pre);
@@ -120,7 +178,7 @@ class Skiplist {
             }
             max_height_.store(height, std::memory_order_relaxed);
         }
-        Node<K, V>* node = NewNode(key, value, height);
+        Node<K, V>* node = NewNode(key, value, height, allocator);
         if (pre[0]->GetNext(0) == NULL) {
             tail_.store(node, std::memory_order_release);
         }
@@ -131,6 +189,18 @@ class Skiplist {
         return height;
     }
 
+    // Insert concurrently with other InsertConcurrently and InsertIfAbsentConcurrently callers,
+    // but Remove, Split and Clear still need to be excluded by external synchronization
+    uint8_t InsertConcurrently(const K& key, V& value, SlabAllocator* allocator = nullptr) {  // NOLINT
+        return InsertConcurrentlyInternal(key, value, false, allocator);
+    }
+
+    // Insert the key concurrently if it does not exist. Return the height of the new node,
+    // or 0 if the key exists and value is set to the value of the existing node
+    uint8_t InsertIfAbsentConcurrently(const K& key, V& value, SlabAllocator* allocator = nullptr) {  // NOLINT
+        return InsertConcurrentlyInternal(key, value, true, allocator);
+    }
+
     bool IsEmpty() {
         if (head_->GetNextNoBarrier(0) == NULL) {
             return true;
@@ -251,7 +321,18 @@ class Skiplist {
         return -1;
     }
 
-    Node<K, V>* GetLast() { return tail_.load(std::memory_order_acquire); }
+    Node<K, V>* GetLast() {
+        Node<K, V>* node = tail_.load(std::memory_order_acquire);
+        // tail_ may fall behind the last node when inserting concurrently
+        while (node != NULL) {
+            Node<K, V>* next = node->GetNext(0);
+            if (next == NULL) {
+                break;
+            }
+            node = next;
+        }
+        return node;
+    }
 
     uint32_t GetSize() {
         uint32_t cnt = 0;
@@ -268,8 +349,8 @@ class Skiplist {
         return cnt;
     }
 
-    // Need external synchronized
-    uint64_t Clear() {
+    // Need external synchronized, allocator is the one the nodes are inserted with
+    uint64_t Clear(SlabAllocator* allocator = nullptr) {
         uint64_t cnt = 0;
         Node<K, V>* node = head_->GetNext(0);
         // Unlink all next node
@@ -286,13 +367,13 @@ class Skiplist {
             for (uint8_t i = 0; i < tmp->Height(); i++) {
                 tmp->SetNextNoBarrier(i, NULL);
             }
-            delete tmp;
+            Node<K, V>::Free(allocator, tmp);
         }
         return cnt;
     }
 
     // Need external synchronized
-    bool AddToFirst(const K& key, V& value) {  // NOLINT
+    bool AddToFirst(const K& key, V& value, SlabAllocator* allocator = nullptr) {  // NOLINT
         {
             Node<K, V>* node = head_->GetNext(0);
             if (node != NULL && compare_(key, node->GetKey()) > 0) {
@@ -307,7 +388,7 @@ class Skiplist {
         if (height > GetMaxHeight()) {
             max_height_.store(height, std::memory_order_relaxed);
         }
-        Node<K, V>* node = NewNode(key, value, height);
+        Node<K, V>* node = NewNode(key, value, height, allocator);
         if (pre[0]->GetNext(0) == NULL) {
             tail_.store(node, std::memory_order_release);
         }
@@ -363,9 +444,8 @@ class Skiplist {
     Iterator* NewIterator() { return new Iterator(this); }
 
  private:
-    Node<K, V>* NewNode(const K& key, V& value, uint8_t height) {  // NOLINT
-        Node<K, V>* node = new Node<K, V>(key, value, height);
-        return node;
+    Node<K, V>* NewNode(const K& key, V& value, uint8_t height, SlabAllocator* allocator) {  // NOLINT
+        return Node<K, V>::New(allocator, key, value, height);
     }
 
     uint8_t RandomHeight() {
@@ -376,6 +456,73 @@ class Skiplist {
         return height;
     }
 
+    // rand_ is not thread safe, concurrent writers use the random of their own thread
+    uint8_t RandomHeightConcurrently() {
+        static thread_local Random rand(
+            static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        uint8_t height = 1;
+        while (height < MaxHeight && (rand.Next() % Branch) == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    uint8_t InsertConcurrentlyInternal(const K& key, V& value, bool unique, SlabAllocator* allocator) {  // NOLINT
+        uint8_t height = RandomHeightConcurrently();
+        uint8_t max_height = GetMaxHeight();
+        while (height > max_height) {
+            if (max_height_.compare_exchange_weak(max_height, height, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        Node<K, V>* pre[MaxHeight];
+        Node<K, V>* next[MaxHeight];
+        Node<K, V>* node = head_;
+        for (int level = std::max(height, GetMaxHeight()) - 1; level >= 0; level--) {
+            FindSpliceForLevel(key, node, level, &pre[level], &next[level]);
+            node = pre[level];
+        }
+        node = nullptr;
+        for (uint8_t i = 0; i < height; i++) {
+            while (true) {
+                if (i == 0 && unique && next[0] != NULL && compare_(next[0]->GetKey(), key) == 0) {
+                    if (node != nullptr) {
+                        Node<K, V>::Free(allocator, node);
+                    }
+                    value = next[0]->GetValue();
+                    return 0;
+                }
+                if (node == nullptr) {
+                    node = NewNode(key, value, height, allocator);
+                }
+                node->SetNextNoBarrier(i, next[i]);
+                if (pre[i]->CASNext(i, next[i], node)) {
+                    break;
+                }
+                // nodes are only added during inserting, so pre[i] is still before the key
+                FindSpliceForLevel(key, pre[i], i, &pre[i], &next[i]);
+            }
+            if (i == 0 && next[0] == NULL) {
+                tail_.store(node, std::memory_order_release);
+            }
+        }
+        return height;
+    }
+
+    // Find the nodes between which the key should be placed on the level, starting from the node start
+    void FindSpliceForLevel(const K& key, Node<K, V>* start, int level, Node<K, V>** pre, Node<K, V>** next) {
+        Node<K, V>* node = start;
+        while (true) {
+            Node<K, V>* nxt = node->GetNext(level);
+            if (!IsAfterNode(key, nxt)) {
+                *pre = node;
+                *next = nxt;
+                return;
+            }
+            node = nxt;
+        }
+    }
+
     Node<K, V>* FindLessOrEqual(const K& key, Node<K, V>** nodes) {
         assert(nodes != NULL);
         Node<K, V>* node = head_;
@@ -16,7 +16,9 @@
 
 #include "base/skiplist.h"
 
+#include <atomic>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/slice.h"
@@ -663,6 +665,86 @@ TEST_F(SkiplistTest, Duplicate) {
     ASSERT_FALSE(it->Valid());
 }
 
+TEST_F(SkiplistTest, InsertConcurrently) {
+    Comparator cmp;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
+    uint32_t thread_num = 8;
+    uint32_t key_num = 10000;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&sl, i, thread_num, key_num] {
+            for (uint32_t key = i; key < key_num; key += thread_num) {
+                uint32_t value = key;
+                ASSERT_GT(sl.InsertConcurrently(key, value), 0);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(key_num, sl.GetSize());
+    ASSERT_EQ(key_num - 1, sl.GetLast()->GetKey());
+    Skiplist<uint32_t, uint32_t, Comparator>::Iterator* it = sl.NewIterator();
+    it->SeekToFirst();
+    for (uint32_t key = 0; key < key_num; key++) {
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(key, it->GetKey());
+        ASSERT_EQ(key, it->GetValue());
+        it->Next();
+    }
+    ASSERT_FALSE(it->Valid());
+    delete it;
+}
+
+TEST_F(SkiplistTest, InsertIfAbsentConcurrently) {
+    Comparator cmp;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
+    uint32_t thread_num = 8;
+    uint32_t key_num = 1000;
+    std::atomic<uint32_t> inserted(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&sl, &inserted, i, key_num] {
+            // every thread inserts all keys, only one of them wins for each key
+            for (uint32_t key = 0; key < key_num; key++) {
+                uint32_t value = i;
+                if (sl.InsertIfAbsentConcurrently(key, value) > 0) {
+                    inserted.fetch_add(1);
+                } else {
+                    uint32_t exist = 0;
+                    ASSERT_EQ(0, sl.Get(key, exist));
+                    ASSERT_EQ(exist, value);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(key_num, inserted.load());
+    ASSERT_EQ(key_num, sl.GetSize());
+    uint32_t value = 0;
+    ASSERT_EQ(0, sl.InsertIfAbsentConcurrently(1, value));
+    ASSERT_LT(value, thread_num);
+}
+
+TEST_F(SkiplistTest, InsertWithAllocator) {
+    Comparator cmp;
+    SlabAllocator allocator;
+    Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp);
+    for (uint32_t i = 0; i < 100; i++) {
+        uint32_t value = i;
+        sl.Insert(i, value, &allocator);
+    }
+    uint32_t value = 0;
+    ASSERT_EQ(0, sl.InsertIfAbsentConcurrently(1, value, &allocator));
+    ASSERT_EQ(1u, value);
+    ASSERT_EQ(100u, sl.GetSize());
+    ASSERT_GT(allocator.GetAllocatedBytes(), 0u);
+    ASSERT_EQ(100u, sl.Clear(&allocator));
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
 }  // namespace base
 }  // namespace openmldb
 
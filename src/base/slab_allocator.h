@@ -0,0 +1,145 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_SLAB_ALLOCATOR_H_
+#define SRC_BASE_SLAB_ALLOCATOR_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <new>
+#include <vector>
+
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace base {
+
+// SlabAllocator carves small objects out of big chunks. Objects are grouped by
+// size class, a freed object is pushed to the free list of its class and will be
+// reused by the next allocation of the same class. Chunks are returned to the
+// system only when the allocator is destroyed, so the memory of one allocator
+// never gets fragmented by other allocations in the process.
+// Allocate and Free are thread safe, the caller must pass the same size to Free
+// as the one used in Allocate.
+class SlabAllocator {
+ public:
+    static constexpr uint32_t ALIGNMENT = 8;
+    // objects bigger than MAX_SLAB_SIZE are allocated on heap directly
+    static constexpr uint32_t MAX_SLAB_SIZE = 2048;
+    static constexpr uint32_t CHUNK_SIZE = 64 * 1024;
+
+    SlabAllocator() : allocated_bytes_(0), reserved_bytes_(0) {}
+
+    ~SlabAllocator() {
+        for (char* chunk : chunks_) {
+            delete[] chunk;
+        }
+        chunks_.clear();
+    }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    void* Allocate(size_t size) {
+        size_t real_size = AlignedSize(size);
+        allocated_bytes_.fetch_add(real_size, std::memory_order_relaxed);
+        if (real_size > MAX_SLAB_SIZE) {
+            return ::operator new(real_size);
+        }
+        SizeClass& sc = classes_[real_size / ALIGNMENT - 1];
+        std::lock_guard<SpinMutex> lock(sc.mu);
+        if (sc.free_list != nullptr) {
+            FreeObject* obj = sc.free_list;
+            sc.free_list = obj->next;
+            return obj;
+        }
+        if (sc.remain < real_size) {
+            sc.cur = NewChunk();
+            sc.remain = CHUNK_SIZE;
+        }
+        char* result = sc.cur;
+        sc.cur += real_size;
+        sc.remain -= real_size;
+        return result;
+    }
+
+    void Free(void* ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        size_t real_size = AlignedSize(size);
+        allocated_bytes_.fetch_sub(real_size, std::memory_order_relaxed);
+        if (real_size > MAX_SLAB_SIZE) {
+            ::operator delete(ptr);
+            return;
+        }
+        SizeClass& sc = classes_[real_size / ALIGNMENT - 1];
+        FreeObject* obj = reinterpret_cast<FreeObject*>(ptr);
+        std::lock_guard<SpinMutex> lock(sc.mu);
+        obj->next = sc.free_list;
+        sc.free_list = obj;
+    }
+
+    // the bytes which are held by callers
+    uint64_t GetAllocatedBytes() const { return allocated_bytes_.load(std::memory_order_relaxed); }
+
+    // the bytes of chunks which are requested from system
+    uint64_t GetReservedBytes() const { return reserved_bytes_.load(std::memory_order_relaxed); }
+
+    static size_t AlignedSize(size_t size) {
+        if (size == 0) {
+            return ALIGNMENT;
+        }
+        return (size + ALIGNMENT - 1) & ~(static_cast<size_t>(ALIGNMENT) - 1);
+    }
+
+ private:
+    struct FreeObject {
+        FreeObject* next;
+    };
+
+    struct SizeClass {
+        SizeClass() : mu(), free_list(nullptr), cur(nullptr), remain(0) {}
+        SpinMutex mu;
+        FreeObject* free_list;
+        char* cur;
+        size_t remain;
+    };
+
+    char* NewChunk() {
+        char* chunk = new char[CHUNK_SIZE];
+        {
+            std::lock_guard<SpinMutex> lock(chunk_mu_);
+            chunks_.push_back(chunk);
+        }
+        reserved_bytes_.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+        return chunk;
+    }
+
+ private:
+    SizeClass classes_[MAX_SLAB_SIZE / ALIGNMENT];
+    SpinMutex chunk_mu_;
+    std::vector<char*> chunks_;
+    std::atomic<uint64_t> allocated_bytes_;
+    std::atomic<uint64_t> reserved_bytes_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+
+#endif  // SRC_BASE_SLAB_ALLOCATOR_H_
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/slab_allocator.h"
+
+#include <string.h>
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/skiplist.h"
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class SlabAllocatorTest : public ::testing::Test {
+ public:
+    SlabAllocatorTest() {}
+    ~SlabAllocatorTest() {}
+};
+
+struct Comparator {
+    int operator()(const uint32_t a, const uint32_t b) const {
+        if (a > b) {
+            return 1;
+        } else if (a == b) {
+            return 0;
+        }
+        return -1;
+    }
+};
+
+TEST_F(SlabAllocatorTest, AllocateAndFree) {
+    SlabAllocator allocator;
+    ASSERT_EQ(8u, SlabAllocator::AlignedSize(0));
+    ASSERT_EQ(8u, SlabAllocator::AlignedSize(1));
+    ASSERT_EQ(16u, SlabAllocator::AlignedSize(9));
+    char* a = reinterpret_cast<char*>(allocator.Allocate(10));
+    memcpy(a, "0123456789", 10);
+    char* b = reinterpret_cast<char*>(allocator.Allocate(10));
+    ASSERT_NE(a, b);
+    ASSERT_EQ(32u, allocator.GetAllocatedBytes());
+    ASSERT_EQ(SlabAllocator::CHUNK_SIZE, allocator.GetReservedBytes());
+    allocator.Free(a, 10);
+    // the freed object is reused by the allocation of same size class
+    char* c = reinterpret_cast<char*>(allocator.Allocate(16));
+    ASSERT_EQ(a, c);
+    // the other size class uses another chunk
+    void* d = allocator.Allocate(100);
+    ASSERT_EQ(2 * SlabAllocator::CHUNK_SIZE, allocator.GetReservedBytes());
+    // big object is allocated on heap
+    void* e = allocator.Allocate(SlabAllocator::MAX_SLAB_SIZE + 1);
+    ASSERT_EQ(2 * SlabAllocator::CHUNK_SIZE, allocator.GetReservedBytes());
+    allocator.Free(b, 10);
+    allocator.Free(c, 16);
+    allocator.Free(d, 100);
+    allocator.Free(e, SlabAllocator::MAX_SLAB_SIZE + 1);
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
+TEST_F(SlabAllocatorTest, MultiThread) {
+    SlabAllocator allocator;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&allocator, i] {
+            std::vector<void*> objs;
+            for (int j = 0; j < 10000; j++) {
+                size_t size = 8 * (j % 16 + 1);
+                void* obj = allocator.Allocate(size);
+                memset(obj, i, size);
+                objs.push_back(obj);
+            }
+            for (int j = 0; j < 10000; j++) {
+                allocator.Free(objs[j], 8 * (j % 16 + 1));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
+TEST_F(SlabAllocatorTest, Skiplist) {
+    SlabAllocator allocator;
+    Comparator cmp;
+    {
+        Skiplist<uint32_t, uint32_t, Comparator> sl(12, 4, cmp, &allocator);
+        ASSERT_EQ(&allocator, sl.GetAllocator());
+        for (uint32_t i = 0; i < 1000; i++) {
+            sl.Insert(i, i);
+        }
+        uint32_t value = 0;
+        ASSERT_EQ(0, sl.Get(100, value));
+        ASSERT_EQ(100u, value);
+        Node<uint32_t, uint32_t>* node = sl.Remove(100);
+        ASSERT_TRUE(node != nullptr);
+        sl.FreeNode(node);
+        ASSERT_EQ(-1, sl.Get(100, value));
+        node = sl.Split(500);
+        while (node != nullptr) {
+            Node<uint32_t, uint32_t>* tmp = node;
+            node = node->GetNext(0);
+            sl.FreeNode(tmp);
+        }
+        ASSERT_EQ(499u, sl.GetSize());
+        ASSERT_EQ(499u, sl.Clear());
+    }
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
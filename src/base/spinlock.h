@@ -29,6 +29,8 @@
 //
 
 #pragma once
+#include <stdint.h>
+
 #include <atomic>
 #include <thread>  // NOLINT
 
@@ -75,5 +77,55 @@ class SpinMutex {
     std::atomic<bool> locked_;
 };
 
+// SharedSpinMutex is a writer preferring reader-writer spin lock. Once a writer is
+// waiting, new readers are blocked until the writer releases the lock.
+// It can be used with std::shared_lock, std::unique_lock or std::lock_guard.
+class SharedSpinMutex {
+ public:
+    SharedSpinMutex() : state_(0) {}
+
+    void lock() {
+        for (size_t tries = 0;; ++tries) {
+            uint32_t cur = state_.load(std::memory_order_relaxed);
+            if ((cur & WRITER) == 0 &&
+                state_.compare_exchange_weak(cur, cur | WRITER, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                break;
+            }
+            Pause(tries);
+        }
+        // wait for the readers holding the lock
+        for (size_t tries = 0; state_.load(std::memory_order_acquire) != WRITER; ++tries) {
+            Pause(tries);
+        }
+    }
+
+    void unlock() { state_.fetch_and(~WRITER, std::memory_order_release); }
+
+    void lock_shared() {
+        for (size_t tries = 0;; ++tries) {
+            uint32_t cur = state_.load(std::memory_order_relaxed);
+            if ((cur & WRITER) == 0 &&
+                state_.compare_exchange_weak(cur, cur + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                break;
+            }
+            Pause(tries);
+        }
+    }
+
+    void unlock_shared() { state_.fetch_sub(1, std::memory_order_release); }
+
+ private:
+    static void Pause(size_t tries) {
+        AsmVolatilePause();
+        if (tries > 100) {
+            std::this_thread::yield();
+        }
+    }
+
+    static constexpr uint32_t WRITER = 1u << 31;
+    std::atomic<uint32_t> state_;
+};
+
 }  // namespace base
 }  // namespace openmldb
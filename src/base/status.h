@@ -87,6 +87,11 @@ enum ReturnCode {
     kProcedureNotFound = 158,
     kCreateFunctionFailed = 159,
     kExceedMaxMemory = 160,
+    kPreLogIndexMismatch = 161,
+    kBlockCrcMismatch = 162,
+    // the put is written to the table and the binlog, but it is not durable as the table requires,
+    // e.g. the fsync fails or no follower acks it in time. the put must not be retried
+    kEntryNotDurable = 163,
     kNameserverIsNotLeader = 300,
     kAutoFailoverIsEnabled = 301,
     kEndpointIsNotExist = 302,
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_BASE_TOKEN_BUCKET_H_
+#define SRC_BASE_TOKEN_BUCKET_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+namespace openmldb {
+namespace base {
+
+// TokenBucket limits the rate of the bytes passed by all the threads sharing it.
+// The bucket fills at rate bytes per second up to burst bytes. A caller takes its
+// bytes at once, the bucket goes negative if there are not enough of them and the
+// caller sleeps until the debt is paid, so the callers are served in turn.
+class TokenBucket {
+ public:
+    // rate is bytes per second, 0 means unlimited
+    TokenBucket(uint64_t rate, uint64_t burst)
+        : rate_(rate), burst_(std::max<uint64_t>(burst, 1)), tokens_(0), last_time_(Now()) {}
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    // take bytes from the bucket, return the microseconds it slept
+    uint64_t Acquire(uint64_t bytes) {
+        uint64_t wait_us = Reserve(bytes);
+        if (wait_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+        }
+        return wait_us;
+    }
+
+    // take bytes from the bucket, return the microseconds the caller has to wait
+    uint64_t Reserve(uint64_t bytes) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (rate_ == 0) {
+            return 0;
+        }
+        Refill();
+        tokens_ -= bytes;
+        if (tokens_ >= 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(-tokens_ * 1000000 / rate_);
+    }
+
+    void SetRate(uint64_t rate) {
+        std::lock_guard<std::mutex> lock(mu_);
+        // the tokens before it are filled at the old rate
+        Refill();
+        rate_ = rate;
+    }
+
+    // set the rate and the burst, the tokens before it are filled at the old rate
+    void Reset(uint64_t rate, uint64_t burst) {
+        std::lock_guard<std::mutex> lock(mu_);
+        burst = std::max<uint64_t>(burst, 1);
+        if (rate == rate_ && burst == burst_) {
+            return;
+        }
+        Refill();
+        rate_ = rate;
+        burst_ = burst;
+        tokens_ = std::min<double>(tokens_, burst_);
+    }
+
+    uint64_t GetRate() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return rate_;
+    }
+
+ private:
+    void Refill() {
+        int64_t now = Now();
+        tokens_ = std::min<double>(tokens_ + static_cast<double>(now - last_time_) * rate_ / 1000000, burst_);
+        last_time_ = now;
+    }
+
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    std::mutex mu_;
+    uint64_t rate_;
+    uint64_t burst_;
+    double tokens_;
+    int64_t last_time_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+
+#endif  // SRC_BASE_TOKEN_BUCKET_H_
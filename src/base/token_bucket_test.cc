@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/token_bucket.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class TokenBucketTest : public ::testing::Test {
+ public:
+    TokenBucketTest() {}
+    ~TokenBucketTest() {}
+};
+
+TEST_F(TokenBucketTest, Unlimited) {
+    TokenBucket bucket(0, 1024);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(0u, bucket.Reserve(1024 * 1024));
+    }
+}
+
+TEST_F(TokenBucketTest, Reserve) {
+    TokenBucket bucket(1024 * 1024, 64 * 1024);
+    uint64_t wait_us = 0;
+    for (int i = 0; i < 10; i++) {
+        wait_us = bucket.Reserve(100 * 1024);
+    }
+    // one second of bytes is taken without waiting, the wait is about one second
+    ASSERT_GT(wait_us, 900000u);
+    ASSERT_LT(wait_us, 1000000u);
+    // the burst is not more than 64KB however long it is idle
+    bucket.SetRate(1024 * 1024 * 1024);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_GT(bucket.Reserve(10 * 1024 * 1024), 0u);
+    bucket.SetRate(0);
+    ASSERT_EQ(0u, bucket.Reserve(10 * 1024 * 1024));
+}
+
+TEST_F(TokenBucketTest, Reset) {
+    TokenBucket bucket(0, 1024);
+    ASSERT_EQ(0u, bucket.Reserve(1024 * 1024));
+    // the same config keeps the tokens, a new one takes effect at once
+    bucket.Reset(0, 1024);
+    ASSERT_EQ(0u, bucket.Reserve(1024 * 1024));
+    bucket.Reset(1024 * 1024, 64 * 1024);
+    ASSERT_EQ(1024 * 1024u, bucket.GetRate());
+    ASSERT_GT(bucket.Reserve(1024 * 1024), 900000u);
+    bucket.Reset(0, 64 * 1024);
+    ASSERT_EQ(0u, bucket.Reserve(1024 * 1024));
+}
+
+TEST_F(TokenBucketTest, Acquire) {
+    TokenBucket bucket(4 * 1024 * 1024, 16 * 1024);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&bucket] {
+            for (int j = 0; j < 20; j++) {
+                bucket.Acquire(16 * 1024);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // 1.25MB is passed by all the threads at 4MB/s
+    auto used = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ASSERT_GE(used.count(), 290);
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -29,6 +29,7 @@
 
 DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
+DECLARE_bool(put_use_attachment);
 DECLARE_uint32(latest_ttl_max);
 DECLARE_uint32(absolute_ttl_max);
 
@@ -245,7 +246,6 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
                        const std::vector<std::pair<std::string, uint32_t>>& dimensions) {
     ::openmldb::api::PutRequest request;
     request.set_time(time);
-    request.set_value(value);
     request.set_tid(tid);
     request.set_pid(pid);
     for (size_t i = 0; i < dimensions.size(); i++) {
@@ -254,8 +254,19 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
         d->set_idx(dimensions[i].second);
     }
     ::openmldb::api::PutResponse response;
-    bool ok =
-        client_.SendRequest(&::openmldb::api::TabletServer_Stub::Put, &request, &response, FLAGS_request_timeout_ms, 1);
+    bool ok = false;
+    if (FLAGS_put_use_attachment) {
+        request.set_use_attachment(true);
+        brpc::Controller cntl;
+        cntl.set_timeout_ms(FLAGS_request_timeout_ms);
+        cntl.set_max_retry(1);
+        cntl.request_attachment().append(value);
+        ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Put, &cntl, &request, &response);
+    } else {
+        request.set_value(value);
+        ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::Put, &request, &response,
+                                 FLAGS_request_timeout_ms, 1);
+    }
     if (ok && response.code() == 0) {
         return true;
     }
@@ -263,6 +274,36 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
     return false;
 }
 
+bool TabletClient::PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<PutBatchRow>& rows,
+                            bool* unsupported) {
+    ::openmldb::api::PutBatchRequest request;
+    request.set_tid(tid);
+    request.set_pid(pid);
+    for (const auto& row : rows) {
+        auto put_row = request.add_rows();
+        put_row->set_time(time);
+        put_row->set_value(*row.first);
+        for (const auto& dim : *row.second) {
+            ::openmldb::api::Dimension* d = put_row->add_dimensions();
+            d->set_key(dim.first);
+            d->set_idx(dim.second);
+        }
+    }
+    ::openmldb::api::PutBatchResponse response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(FLAGS_request_timeout_ms);
+    cntl.set_max_retry(1);
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::PutBatch, &cntl, &request, &response);
+    if (ok && response.code() == 0) {
+        return true;
+    }
+    if (unsupported != nullptr) {
+        *unsupported = cntl.Failed() && cntl.ErrorCode() == brpc::ENOMETHOD;
+    }
+    LOG(WARNING) << "fail to send put batch request for " << response.msg() << " and error code " << response.code();
+    return false;
+}
+
 bool TabletClient::Put(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, const std::string& value) {
     ::openmldb::api::PutRequest request;
     auto dim = request.add_dimensions();
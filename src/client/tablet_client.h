@@ -81,6 +81,14 @@ class TabletClient : public Client {
     bool Put(uint32_t tid, uint32_t pid, uint64_t time, const std::string& value,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions);
 
+    // a row of batch put, the value and the dimensions are owned by the caller
+    using PutBatchRow = std::pair<const std::string*, const std::vector<std::pair<std::string, uint32_t>>*>;
+
+    // put the rows in one request, the time is used by all rows. unsupported is set if
+    // the tablet is too old to have the method, nothing is written then
+    bool PutBatch(uint32_t tid, uint32_t pid, uint64_t time, const std::vector<PutBatchRow>& rows,
+                  bool* unsupported = nullptr);
+
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, std::string& value,  // NOLINT
              uint64_t& ts,                                                                          // NOLINT
              std::string& msg);                        ;                                             // NOLINT
@@ -163,6 +163,8 @@ class RowView {
         return *(reinterpret_cast<const uint8_t*>(ptr)) & (1 << (idx & 0x07));
     }
     inline uint32_t GetSize() const { return size_; }
+    // the length of header, bitmap and fixed size columns
+    inline uint32_t GetFixedLength() const { return str_field_start_offset_; }
 
     static inline uint32_t GetSize(const int8_t* row) {
         return *(reinterpret_cast<const uint32_t*>(row + VERSION_LENGTH));
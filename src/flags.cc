@@ -62,8 +62,15 @@ DEFINE_int32(gc_interval, 120, "the gc interval of tablet every two hour");
 DEFINE_int32(disk_gc_interval, 120, "the rocksdb gc interval of tablet");
 DEFINE_int32(gc_pool_size, 2, "the size of tablet gc thread pool");
 DEFINE_int32(gc_safe_offset, 1, "the safe offset of tablet gc in minute");
+DEFINE_uint32(gc_segment_thread_num, 4, "the thread num to make gc on the segments of one memtable index in parallel");
+DEFINE_uint64(gc_round_key_cnt, 0, "the max key count of one segment scanned in a gc round, 0 means unlimited");
+DEFINE_uint32(gc_round_time_ms, 0, "the max time in ms of one memtable index spent in a gc round, 0 means unlimited");
+DEFINE_uint32(gc_round_interval_ms, 1000, "the delay in ms before the next gc round of an unfinished memtable gc");
+DEFINE_uint32(gc_expire_wheel_bucket_ms, 0,
+              "the time span in ms of a bucket of the expire wheel which lets absolute ttl gc visit only the keys "
+              "with expired rows, 0 means disabled");
 DEFINE_uint64(gc_on_table_recover_count, 10000000, "make a gc on recover count");
-DEFINE_uint32(gc_deleted_pk_version_delta, 2, "config the gc version delta");
+DEFINE_uint32(gc_deleted_pk_version_delta, 2, "deprecated, deleted pks are freed once no reader can see them");
 DEFINE_double(mem_release_rate, 5, "specify memory release rate, which should be in 0 ~ 10");
 DEFINE_int32(task_pool_size, 3, "the size of tablet task thread pool");
 DEFINE_int32(io_pool_size, 2, "the size of tablet io task thread pool");
@@ -71,6 +78,14 @@ DEFINE_bool(use_name, false, "enable or disable use server name");
 DEFINE_string(data_dir, "./data", "the path of data dir");
 DEFINE_bool(enable_distsql, false, "enable or disable distribute sql");
 DEFINE_bool(enable_localtablet, true, "enable or disable local tablet opt when distribute sql circumstance");
+DEFINE_string(jit_object_cache_dir, "",
+              "the directory to keep the object code of the deployments compiled, which is loaded instead of "
+              "compiled again after restarting. empty means disabled");
+DEFINE_uint32(jit_object_cache_capacity_mb, 1024,
+              "the size of the files in jit_object_cache_dir in MB, the least recently used ones are removed beyond "
+              "it. 0 means unlimited");
+DEFINE_uint32(sql_cache_capacity_mb, 0,
+              "the memory of the compiled sqls cached by the engine in MB, 0 means it is limited by the sql number only");
 DEFINE_string(bucket_size, "1d", "the default bucket size in pre-aggr table");
 
 // scan configuration
@@ -81,7 +96,31 @@ DEFINE_uint32(preview_default_limit, 100, "config the default limit of preview")
 // binlog configuration
 DEFINE_int32(binlog_single_file_max_size, 1024 * 4, "the max size of single binlog file");
 DEFINE_int32(binlog_sync_batch_size, 32, "the batch size of sync binlog");
+DEFINE_int32(binlog_sync_window_size, 1,
+             "the max count of AppendEntries requests in flight to a follower. "
+             "the followers must reject the out of order requests if it is greater than 1");
+DEFINE_uint32(binlog_follower_ack_timeout_ms, 3000,
+              "the max time a put waits for the follower ack when the table requires it");
+DEFINE_uint32(binlog_cache_size_mb, 4,
+              "the size of recent binlog entries kept in memory by a leader partition, "
+              "which are sent to followers without reading the binlog file. 0 means disabled");
+DEFINE_uint32(binlog_preallocate_size_mb, 0,
+              "the disk space allocated ahead of the end of the binlog file being written, so that an fsync does "
+              "not update the allocation. 0 means the file grows on demand");
+DEFINE_uint32(binlog_sync_range_size_kb, 0,
+              "start the writeback of the binlog every time this size is flushed, so that an fsync or the flush of "
+              "the page cache has little to write. 0 means disabled");
+DEFINE_uint32(io_uring_read_depth, 0,
+              "the max number of reads of 256KB kept in flight with io_uring by a reader of a binlog or snapshot "
+              "file. 0 means the files are read synchronously, so are they if io_uring is not available");
 DEFINE_bool(binlog_notify_on_put, false, "config the sync log to follower strategy");
+DEFINE_bool(put_use_attachment, false,
+            "send the row of put in the rpc attachment, which saves the copies on tablet. "
+            "the tablets must support it");
+DEFINE_bool(insert_use_put_batch, false,
+            "put the rows of a batch insert with one request per partition instead of one per row. "
+            "the rows are put one by one to the tablets which do not support it");
+DEFINE_uint32(put_batch_max_row_num, 1000, "the max number of rows sent in one put batch request");
 DEFINE_bool(binlog_enable_crc, false, "enable crc");
 DEFINE_int32(binlog_coffee_time, 1000, "config the coffee time. unit is milliseconds");
 DEFINE_int32(binlog_sync_wait_time, 100, "config the sync log wait time. unit is milliseconds");
@@ -90,6 +129,9 @@ DEFINE_int32(binlog_sync_to_disk_interval, 20000,
 DEFINE_int32(binlog_delete_interval, 60000, "config the interval of delete binlog. unit is milliseconds");
 DEFINE_int32(binlog_match_logoffset_interval, 1000, "config the interval of match log offset. unit is milliseconds");
 DEFINE_int32(binlog_name_length, 8, "binlog name length");
+DEFINE_uint32(binlog_recover_thread_num, 4,
+              "the number of threads which decode and apply the binlog of a memory table on recovery, "
+              "the entries are replayed one by one if it is less than 2");
 DEFINE_uint32(check_binlog_sync_progress_delta, 100000, "config the delta of check binlog sync progress");
 DEFINE_uint32(go_back_max_try_cnt, 10, "config max try time of go back");
 
@@ -108,6 +150,11 @@ DEFINE_int32(request_timeout_ms, 20000, "rpc request timeout of misc. unit is mi
 DEFINE_int32(request_sleep_time, 1000, "the sleep time when request error. unit is milliseconds");
 
 DEFINE_uint32(max_memory_mb, 0, "max memory limit");
+DEFINE_uint32(mem_table_soft_limit_mb, 0,
+              "the memory of a table over it triggers a gc and throttles the puts. 0 means no limit");
+DEFINE_uint32(mem_table_hard_limit_mb, 0, "the puts to a table with memory over it are rejected. 0 means no limit");
+DEFINE_uint32(mem_table_throttle_max_us, 10000,
+              "the max delay of a put throttled by the soft limit, it grows with the memory towards the hard limit");
 
 DEFINE_uint32(max_traverse_pk_cnt, 5000, "max traverse iter pk cnt");
 DEFINE_uint32(max_traverse_cnt, 50000, "max traverse iter loop cnt");
@@ -121,7 +168,14 @@ DEFINE_int32(send_file_max_try, 3, "the max retry time when send file failed");
 DEFINE_int32(retry_send_file_wait_time_ms, 3000, "conf the wait time when retry send file. unit is milliseconds");
 DEFINE_int32(stream_close_wait_time_ms, 1000, "the wait time before close stream. unit is milliseconds");
 DEFINE_uint32(stream_block_size, 1 * 1204 * 1024, "config the write/read block size in streaming");
-DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024, "the limit bandwidth. Byte/Second");
+DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024,
+             "the limit bandwidth of all the files sent by the tablet. Byte/Second");
+// a flag with validator can be set by /flags at runtime, the senders take it at the next block
+static bool ValidateBandwidthLimit(const char* flag, int32_t value) { return true; }
+DEFINE_validator(stream_bandwidth_limit, &ValidateBandwidthLimit);
+DEFINE_uint32(send_file_stream_num, 1,
+              "the number of streams to send the blocks of a file in parallel. the receiver has to write the "
+              "blocks at their offsets if it is greater than 1");
 
 // if set 23, the task will execute 23:00 every day
 DEFINE_int32(make_snapshot_time, 23, "config the time to make snapshot");
@@ -132,8 +186,21 @@ DEFINE_uint32(make_snapshot_max_deleted_keys, 1000000, "config the max deleted k
 DEFINE_uint32(make_snapshot_offline_interval, 60 * 60 * 24,
               "config tablet self makesnapshot when how long time do not "
               "makesnapshot from ns. unit is second");
-DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib");
+DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib, zstd");
+DEFINE_uint32(snapshot_zstd_dict_size, 0,
+              "the max size in bytes of the zstd dictionary trained from the records of a memory table when its "
+              "snapshot is made, 0 means no dictionary. it works if snapshot_compression is zstd");
 DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making snapshot");
+DEFINE_uint32(make_snapshot_thread_num, 1,
+              "the number of threads writing the snapshot of a memory table, each of them writes a part file. "
+              "the followers which do not know snapshot parts load the first part only, so raise it after upgrade");
+DEFINE_uint32(snapshot_max_delta_num, 0,
+              "the max number of delta files of a memory table snapshot. the binlog since the last snapshot is "
+              "written to a delta file until it is reached, then all files are merged into a new snapshot. "
+              "0 means the snapshot is rewritten every time");
+DEFINE_bool(make_flat_snapshot, false,
+            "write a flat copy beside each snapshot file of a memory table, which is loaded by mmap without "
+            "decoding protobuf");
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000,
               "config the max wait time of load index. unit is milliseconds");
@@ -148,6 +215,10 @@ DEFINE_uint32(latest_ttl_max, 1000, "the max ttl of latest");
 DEFINE_uint32(absolute_ttl_max, 60 * 24 * 365 * 30, "the max ttl of absolute time");
 DEFINE_uint32(skiplist_max_height, 12, "the max height of skiplist");
 DEFINE_uint32(key_entry_max_height, 8, "the max height of key entry");
+DEFINE_bool(enable_memtable_slab_alloc, false,
+            "allocate rows, key entries and skiplist nodes of memtable from per segment slab allocators");
+DEFINE_uint32(mem_table_freeze_time, 0,
+              "freeze the rows of memtable older than it in minute into compressed blocks, 0 means disabled");
 DEFINE_uint32(latest_default_skiplist_height, 1, "the default height of skiplist for latest table");
 DEFINE_uint32(absolute_default_skiplist_height, 4, "the default height of skiplist for absolute table");
 DEFINE_uint32(max_col_display_length, 256, "config the max length of column display");
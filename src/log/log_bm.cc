@@ -0,0 +1,259 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "benchmark/benchmark.h"
+#include "config.h"  // NOLINT
+#include "log/log_reader.h"
+#include "log/log_writer.h"
+#include "proto/tablet.pb.h"
+
+using ::openmldb::base::Slice;
+
+DECLARE_uint32(io_uring_read_depth);
+
+namespace openmldb {
+namespace log {
+
+static std::string GetBmDir() {
+    static std::string dir = [] {
+        std::string dir = "/tmp/log_bm_" + std::to_string(getpid()) + "/";
+        ::openmldb::base::MkdirRecur(dir);
+        return dir;
+    }();
+    return dir;
+}
+
+// a row of a table of card transactions, the keys and values repeat like the rows written by the users
+static std::string GenRow(uint64_t i) {
+    ::openmldb::api::LogEntry entry;
+    entry.set_log_index(i);
+    entry.set_ts(1600000000000 + i * 37);
+    entry.set_term(1);
+    auto dimension = entry.add_dimensions();
+    dimension->set_key("card_" + std::to_string(i * 7919 % 100000));
+    dimension->set_idx(0);
+    dimension = entry.add_dimensions();
+    dimension->set_key("mcc_" + std::to_string(i % 200));
+    dimension->set_idx(1);
+    entry.set_value("card_" + std::to_string(i * 7919 % 100000) + "|mcc_" + std::to_string(i % 200) + "|" +
+                    std::to_string(i * 31 % 100000 / 100.0) + "|" + (i % 3 == 0 ? "online" : "offline") +
+                    "|shanghai|" + std::to_string(1600000000000 + i * 37));
+    std::string value;
+    entry.SerializeToString(&value);
+    return value;
+}
+
+static const std::vector<std::string>& GetCompressRows() {
+    static std::vector<std::string> rows = [] {
+        std::vector<std::string> rows;
+        for (uint64_t i = 0; i < 500000; i++) {
+            rows.push_back(GenRow(i));
+        }
+        return rows;
+    }();
+    return rows;
+}
+
+// write the rows of GenRow with the compress type, zstd_dict is zstd with a dictionary trained on them.
+// it returns the size of file
+static uint64_t WriteCompressed(const std::string& type, const std::string& full_path) {
+    const auto& rows = GetCompressRows();
+    std::string compress_type = type == "zstd_dict" ? "zstd" : type;
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    if (fd_w == NULL) {
+        return 0;
+    }
+    WriteHandle wh(compress_type, full_path, fd_w);
+    if (type == "zstd_dict") {
+        std::vector<std::string> samples(rows.begin(), rows.begin() + 10000);
+        wh.SetDictionary(TrainDictionary(samples, 64 * 1024));
+    }
+    for (const auto& row : rows) {
+        wh.Write(Slice(row), false);
+    }
+    wh.EndLog();
+    return wh.GetSize();
+}
+
+static void BM_WriteCompressed(benchmark::State& state, const std::string& type) {  // NOLINT
+    std::string full_path = GetBmDir() + type + ".log";
+    uint64_t raw_size = 0;
+    for (const auto& row : GetCompressRows()) {
+        raw_size += row.size();
+    }
+    uint64_t file_size = 0;
+    for (auto _ : state) {
+        file_size = WriteCompressed(type, full_path);
+    }
+    if (file_size == 0) {
+        state.SkipWithError("fail to write the log");
+        return;
+    }
+    state.SetBytesProcessed(state.iterations() * raw_size);
+    state.counters["ratio"] = static_cast<double>(raw_size) / file_size;
+    unlink(full_path.c_str());
+}
+
+static void BM_ReadCompressed(benchmark::State& state, const std::string& type) {  // NOLINT
+    std::string full_path = GetBmDir() + type + ".log";
+    if (WriteCompressed(type, full_path) == 0) {
+        state.SkipWithError("fail to write the log");
+        return;
+    }
+    uint64_t raw_size = 0;
+    for (const auto& row : GetCompressRows()) {
+        raw_size += row.size();
+    }
+    for (auto _ : state) {
+        FILE* fd_r = fopen(full_path.c_str(), "rb");
+        SequentialFile* rf = NewSeqFile(full_path, fd_r);
+        {
+            Reader reader(rf, NULL, true, 0, type != "off");
+            std::string scratch;
+            Slice value;
+            while (reader.ReadRecord(&value, &scratch).ok()) {
+                benchmark::DoNotOptimize(value);
+            }
+        }
+        delete rf;
+    }
+    state.SetBytesProcessed(state.iterations() * raw_size);
+    unlink(full_path.c_str());
+}
+
+BENCHMARK_CAPTURE(BM_WriteCompressed, off, std::string("off"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_WriteCompressed, zlib, std::string("zlib"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_WriteCompressed, snappy, std::string("snappy"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadCompressed, off, std::string("off"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadCompressed, zlib, std::string("zlib"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadCompressed, snappy, std::string("snappy"))->Unit(benchmark::kMillisecond);
+#ifdef ZSTD_ENABLE
+BENCHMARK_CAPTURE(BM_WriteCompressed, zstd, std::string("zstd"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_WriteCompressed, zstd_dict, std::string("zstd_dict"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadCompressed, zstd, std::string("zstd"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadCompressed, zstd_dict, std::string("zstd_dict"))->Unit(benchmark::kMillisecond);
+#endif
+
+// fsync after each batch of 32 binlog records, the file growing on demand or preallocated with its
+// writeback started every 256KB. the percentiles of the sync latency are reported in us
+static void BM_SyncLatency(benchmark::State& state) {  // NOLINT
+    bool prealloc = state.range(0) != 0;
+    std::vector<std::string> rows;
+    for (uint64_t i = 0; i < 32; i++) {
+        rows.push_back(GenRow(i) + std::string(1024, 'v'));
+    }
+    std::string full_path = GetBmDir() + (prealloc ? "prealloc.log" : "posix.log");
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    if (fd_w == NULL) {
+        state.SkipWithError("fail to open the log");
+        return;
+    }
+    WritableFile* wf = prealloc ? NewPreallocWritableFile(full_path, fd_w, 64 * 1024 * 1024, 256 * 1024)
+                                : NewWritableFile(full_path, fd_w);
+    std::vector<uint64_t> latency;
+    {
+        WriteHandle wh("off", wf);
+        for (auto _ : state) {
+            for (const auto& row : rows) {
+                wh.Write(Slice(row), false);
+            }
+            auto sync_start = std::chrono::steady_clock::now();
+            wh.Sync();
+            latency.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - sync_start)
+                                  .count());
+        }
+        state.SetBytesProcessed(wh.GetSize());
+    }
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&latency](double p) { return latency[static_cast<size_t>(p * (latency.size() - 1))]; };
+    state.counters["p50"] = percentile(0.5);
+    state.counters["p99"] = percentile(0.99);
+    state.counters["p999"] = percentile(0.999);
+    state.counters["max"] = latency.back();
+    unlink(full_path.c_str());
+}
+
+BENCHMARK(BM_SyncLatency)->ArgName("prealloc")->Arg(0)->Arg(1)->Iterations(4000);
+
+// read a binlog of 256MB from the disk, synchronously if the depth is 0 and with io_uring otherwise
+static void BM_ReadFromDisk(benchmark::State& state) {  // NOLINT
+    static std::string full_path = [] {
+        std::string full_path = GetBmDir() + "00000000.log";
+        FILE* fd_w = fopen(full_path.c_str(), "wb");
+        if (fd_w != NULL) {
+            WriteHandle wh("off", full_path, fd_w);
+            for (uint64_t i = 0; wh.GetSize() < 256 * 1024 * 1024; i++) {
+                wh.Write(Slice(GenRow(i)), false);
+            }
+            wh.EndLog();
+            wh.Sync();
+        }
+        return full_path;
+    }();
+    uint64_t file_size = 0;
+    if (!::openmldb::base::GetFileSize(full_path, file_size)) {
+        state.SkipWithError("fail to write the log");
+        return;
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        // the file is read from the disk
+        int fd = open(full_path.c_str(), O_RDONLY);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+        FLAGS_io_uring_read_depth = state.range(0);
+        FILE* fd_r = fopen(full_path.c_str(), "rb");
+        SequentialFile* rf = NewSeqFile(full_path, fd_r);
+        FLAGS_io_uring_read_depth = 0;
+        state.ResumeTiming();
+        {
+            Reader reader(rf, NULL, false, 0, false);
+            std::string scratch;
+            Slice value;
+            while (reader.ReadRecord(&value, &scratch).ok()) {
+                benchmark::DoNotOptimize(value);
+            }
+        }
+        delete rf;
+    }
+    state.SetBytesProcessed(state.iterations() * file_size);
+}
+
+BENCHMARK(BM_ReadFromDisk)->ArgName("depth")->Arg(0)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond);
+
+}  // namespace log
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::openmldb::base::RemoveDirRecursive(::openmldb::log::GetBmDir());
+    return 0;
+}
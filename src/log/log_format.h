@@ -41,7 +41,14 @@ enum RecordType {
     kEofType = 5
 };
 
-enum CompressType { kNoCompress = 0, kZlib = 1, kSnappy = 2 };
+enum CompressType {
+    kNoCompress = 0,
+    kZlib = 1,
+    kSnappy = 2,
+    kZstd = 3,
+    // not a compressed block but the zstd dictionary of the blocks after it
+    kZstdDictionary = 4
+};
 
 static const int kMaxRecordType = kEofType;
 
@@ -50,6 +57,10 @@ static const uint32_t kBlockSize = 4 * 1024;
 // for compressed snapshot
 static const uint32_t kCompressBlockSize = 1 * 1024 * 1024;
 
+// the max size of a compressed block, which is larger than a block of incompressible data
+// compressed by any of the codecs
+static const uint32_t kMaxCompressedBlockSize = kCompressBlockSize + kCompressBlockSize / 6 + 1024;
+
 // Header is checksum (4 bytes), length (2 bytes), type (1 byte).
 static const uint32_t kHeaderSize = 4 + 2 + 1;
 
@@ -62,6 +73,7 @@ static const uint32_t kHeaderSizeOfCompressBlock = 64;
 
 static const std::string ZLIB_COMPRESS_SUFFIX = ".zlib";      // NOLINT
 static const std::string SNAPPY_COMPRESS_SUFFIX = ".snappy";  // NOLINT
+static const std::string ZSTD_COMPRESS_SUFFIX = ".zstd";      // NOLINT
 
 }  // namespace log
 }  // namespace openmldb
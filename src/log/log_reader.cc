@@ -26,6 +26,11 @@
 #include <stdio.h>
 #include <zlib.h>
 
+#include "config.h"  // NOLINT
+#ifdef ZSTD_ENABLE
+#include <zstd.h>
+#endif
+
 #include "base/endianconv.h"
 #include "base/glog_wrapper.h"
 #include "base/strings.h"
@@ -55,16 +60,19 @@ Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum, uint64_t
       initial_offset_(initial_offset),
       resyncing_(initial_offset > 0),
       compressed_(compressed),
-      uncompress_buf_(nullptr) {
+      uncompress_buf_(nullptr),
+      zstd_dctx_(nullptr),
+      zstd_ddict_(nullptr) {
     if (compressed_) {
         block_size_ = kCompressBlockSize;
         uncompress_buf_ = new char[block_size_];
         header_size_ = kHeaderSizeForCompress;
+        backing_store_ = new char[kMaxCompressedBlockSize];
     } else {
         block_size_ = kBlockSize;
         header_size_ = kHeaderSize;
+        backing_store_ = new char[block_size_];
     }
-    backing_store_ = new char[block_size_];
     DLOG(INFO) << "block_size_: " << block_size_ << ", "
                << "header_size_: " << header_size_ << ", "
                << "compressed_: " << compressed_;
@@ -75,6 +83,10 @@ Reader::~Reader() {
     if (uncompress_buf_) {
         delete[] uncompress_buf_;
     }
+#ifdef ZSTD_ENABLE
+    ZSTD_freeDDict(zstd_ddict_);
+    ZSTD_freeDCtx(zstd_dctx_);
+#endif
 }
 
 bool Reader::SkipToInitialBlock() {
@@ -281,64 +293,99 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result, uint64_t& offset) {
         if (!compressed_) {
             status = file_->Read(block_size_, &buffer_, backing_store_);
         } else {
-            // read header of compressed data
-            Slice header_of_compress;
-            status = file_->Read(kHeaderSizeOfCompressBlock, &header_of_compress, backing_store_);
-            if (!status.ok()) {
-                PDLOG(WARNING, "fail to read file %s when reading header", status.ToString().c_str());
-                return kWaitRecord;
-            }
-            const char* data = header_of_compress.data();
-            uint32_t compress_len = 0;
-            memcpy(static_cast<void*>(&compress_len), data, sizeof(uint32_t));
-            memrev32ifbe(static_cast<void*>(&compress_len));
             CompressType compress_type = kNoCompress;
-            memcpy(static_cast<void*>(&compress_type), data + sizeof(uint32_t), 1);
-            DLOG(INFO) << "compress_len: " << compress_len << ", "
-                       << "compress_type: " << compress_type;
-            // read compressed data
+            uint32_t compress_len = 0;
             Slice block;
-            status = file_->Read(compress_len, &block, backing_store_);
-            if (!status.ok()) {
-                PDLOG(WARNING, "fail to read file %s when reading block", status.ToString().c_str());
-                return kWaitRecord;
-            }
+            do {
+                // read header of compressed data
+                Slice header_of_compress;
+                status = file_->Read(kHeaderSizeOfCompressBlock, &header_of_compress, backing_store_);
+                if (!status.ok()) {
+                    PDLOG(WARNING, "fail to read file %s when reading header", status.ToString().c_str());
+                    return kWaitRecord;
+                }
+                const char* data = header_of_compress.data();
+                memcpy(static_cast<void*>(&compress_len), data, sizeof(uint32_t));
+                memrev32ifbe(static_cast<void*>(&compress_len));
+                compress_type = static_cast<CompressType>(static_cast<uint8_t>(data[sizeof(uint32_t)]));
+                DLOG(INFO) << "compress_len: " << compress_len << ", "
+                           << "compress_type: " << compress_type;
+                if (compress_len > kMaxCompressedBlockSize) {
+                    PDLOG(WARNING, "bad record when reading block, compress_len: %u", compress_len);
+                    return kBadRecord;
+                }
+                // read compressed data
+                status = file_->Read(compress_len, &block, backing_store_);
+                if (!status.ok()) {
+                    PDLOG(WARNING, "fail to read file %s when reading block", status.ToString().c_str());
+                    return kWaitRecord;
+                }
+                if (compress_type == kZstdDictionary) {
+#ifdef ZSTD_ENABLE
+                    ZSTD_freeDDict(zstd_ddict_);
+                    zstd_ddict_ = ZSTD_createDDict(block.data(), block.size());
+                    if (zstd_ddict_ == nullptr) {
+                        PDLOG(WARNING, "bad record when loading zstd dictionary of %u bytes", compress_len);
+                        return kBadRecord;
+                    }
+#else
+                    PDLOG(WARNING, "zstd is not enabled in this build, the zstd dictionary cannot be loaded");
+                    return kBadRecord;
+#endif
+                }
+            } while (compress_type == kZstdDictionary);
             const char* block_data = block.data();
-            int32_t uncompress_len = 0;
+            size_t uncompress_len = 0;
             switch (compress_type) {
                 case kSnappy: {
-                    snappy::GetUncompressedLength(block_data, static_cast<size_t>(compress_len),
-                                                  reinterpret_cast<size_t*>(&uncompress_len));
-                    if (!snappy::RawUncompress(block_data, static_cast<size_t>(compress_len), uncompress_buf_)) {
+                    if (!snappy::GetUncompressedLength(block_data, static_cast<size_t>(compress_len),
+                                                       &uncompress_len) ||
+                        uncompress_len != block_size_ ||
+                        !snappy::RawUncompress(block_data, static_cast<size_t>(compress_len), uncompress_buf_)) {
                         PDLOG(WARNING, "bad record when uncompress block, compress type: %d", compress_type);
                         return kBadRecord;
                     }
                     break;
                 }
                 case kZlib: {
-                    uncompress_len = block_size_;
-#ifdef __APPLE__
-                    int res = uncompress((unsigned char*)uncompress_buf_, reinterpret_cast<uLongf*>(&uncompress_len),
-                                         (const unsigned char*)block_data, compress_len);
-#else
-                    // linux
-                    int res = uncompress((unsigned char*)uncompress_buf_, reinterpret_cast<uint64_t*>(&uncompress_len),
-                                         (const unsigned char*)block_data, compress_len);
-#endif
+                    uLongf dest_len = block_size_;
+                    int res = uncompress(reinterpret_cast<unsigned char*>(uncompress_buf_), &dest_len,
+                                         reinterpret_cast<const unsigned char*>(block_data), compress_len);
                     if (res != Z_OK) {
                         PDLOG(WARNING, "bad record when uncompress block, error code: %d, compress type: %d", res,
                               compress_type);
                         return kBadRecord;
                     }
+                    uncompress_len = dest_len;
                     break;
                 }
+#ifdef ZSTD_ENABLE
+                case kZstd: {
+                    if (zstd_dctx_ == nullptr) {
+                        zstd_dctx_ = ZSTD_createDCtx();
+                    }
+                    if (zstd_ddict_ != nullptr) {
+                        uncompress_len = ZSTD_decompress_usingDDict(zstd_dctx_, uncompress_buf_, block_size_,
+                                                                    block_data, compress_len, zstd_ddict_);
+                    } else {
+                        uncompress_len =
+                            ZSTD_decompressDCtx(zstd_dctx_, uncompress_buf_, block_size_, block_data, compress_len);
+                    }
+                    if (ZSTD_isError(uncompress_len)) {
+                        PDLOG(WARNING, "bad record when uncompress block, error: %s, compress type: %d",
+                              ZSTD_getErrorName(uncompress_len), compress_type);
+                        return kBadRecord;
+                    }
+                    break;
+                }
+#endif
                 default: {
                     PDLOG(WARNING, "unsupported compress type: %d", compress_type);
                     return kBadRecord;
                 }
             }
-            if (uncompress_len != static_cast<int32_t>(block_size_)) {
-                PDLOG(WARNING, "bad record when uncompress block, uncompress_len: %d, block_size_: %d", uncompress_len,
+            if (uncompress_len != block_size_) {
+                PDLOG(WARNING, "bad record when uncompress block, uncompress_len: %lu, block_size_: %d", uncompress_len,
                       block_size_);
                 return kBadRecord;
             }
@@ -462,6 +509,15 @@ bool LogReader::SetOffset(uint64_t start_offset) {
     return true;
 }
 
+void LogReader::ResetOffset(uint64_t start_offset) {
+    delete reader_;
+    reader_ = NULL;
+    delete sf_;
+    sf_ = NULL;
+    log_part_index_ = -1;
+    start_offset_ = start_offset;
+}
+
 void LogReader::GoBackToLastBlock() {
     if (sf_ == NULL || reader_ == NULL) {
         return;
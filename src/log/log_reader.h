@@ -32,6 +32,9 @@
 
 using ::openmldb::base::Slice;
 
+struct ZSTD_DCtx_s;
+struct ZSTD_DDict_s;
+
 namespace openmldb {
 namespace log {
 
@@ -115,6 +118,9 @@ class Reader {
     uint32_t header_size_;
     // buffer for uncompressed block
     char* uncompress_buf_;
+    ZSTD_DCtx_s* zstd_dctx_;
+    // the dictionary of the zstd blocks, which is read in front of them
+    ZSTD_DDict_s* zstd_ddict_;
 
     // Extend record types with the following special values
     enum {
@@ -162,6 +168,8 @@ class LogReader {
     int GetEndLogIndex();
     uint64_t GetLastRecordEndOffset();
     bool SetOffset(uint64_t start_offset);
+    // close the current log part, the part which has the start offset is opened at the next read
+    void ResetOffset(uint64_t start_offset);
     uint64_t GetMinOffset() const {
         return min_offset_;
     }
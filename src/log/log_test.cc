@@ -37,6 +37,7 @@ using ::openmldb::base::Slice;
 using ::openmldb::log::Status;
 
 DECLARE_string(snapshot_compression);
+DECLARE_uint32(io_uring_read_depth);
 bool compressed_ = true;
 uint32_t block_size_ = 1024 * 4;
 uint32_t header_size_ = 7;
@@ -141,6 +142,8 @@ std::string GetWritePath(const std::string& path) {
         return path + openmldb::log::ZLIB_COMPRESS_SUFFIX;
     } else if (FLAGS_snapshot_compression == "snappy") {
         return path + openmldb::log::SNAPPY_COMPRESS_SUFFIX;
+    } else if (FLAGS_snapshot_compression == "zstd") {
+        return path + openmldb::log::ZSTD_COMPRESS_SUFFIX;
     } else {
         return path;
     }
@@ -410,6 +413,207 @@ TEST_F(LogWRTest, TestInit) {
     ASSERT_EQ(compressed_, reader.GetCompressed());
 }
 
+
+// a row of a table of card transactions, the keys and values repeat like the rows written by the users
+std::string GenRow(uint64_t i) {
+    ::openmldb::api::LogEntry entry;
+    entry.set_log_index(i);
+    entry.set_ts(1600000000000 + i * 37);
+    entry.set_term(1);
+    auto dimension = entry.add_dimensions();
+    dimension->set_key("card_" + std::to_string(i * 7919 % 100000));
+    dimension->set_idx(0);
+    dimension = entry.add_dimensions();
+    dimension->set_key("mcc_" + std::to_string(i % 200));
+    dimension->set_idx(1);
+    entry.set_value("card_" + std::to_string(i * 7919 % 100000) + "|mcc_" + std::to_string(i % 200) + "|" +
+                    std::to_string(i * 31 % 100000 / 100.0) + "|" + (i % 3 == 0 ? "online" : "offline") +
+                    "|shanghai|" + std::to_string(1600000000000 + i * 37));
+    std::string value;
+    entry.SerializeToString(&value);
+    return value;
+}
+
+TEST_F(LogWRTest, TestDictionary) {
+    if (FLAGS_snapshot_compression != "zstd") {
+        Writer writer(FLAGS_snapshot_compression, NULL);
+        ASSERT_FALSE(writer.SetDictionary("dict").ok());
+        return;
+    }
+    std::vector<std::string> samples;
+    for (uint64_t i = 0; i < 1000; i++) {
+        samples.push_back(GenRow(i));
+    }
+    std::string dictionary = TrainDictionary(samples, 16 * 1024);
+    ASSERT_FALSE(dictionary.empty());
+    ASSERT_LE(dictionary.size(), 16 * 1024u);
+    ASSERT_TRUE(TrainDictionary(std::vector<std::string>(), 1024).empty());
+
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = GetWritePath(log_dir + "/test.log");
+    FILE* fd_w = fopen(full_path.c_str(), "ab+");
+    ASSERT_TRUE(fd_w != NULL);
+    WriteHandle wh(FLAGS_snapshot_compression, full_path, fd_w);
+    ASSERT_TRUE(wh.SetDictionary(dictionary).ok());
+    uint64_t cnt = 100000;
+    for (uint64_t i = 0; i < cnt; i++) {
+        ASSERT_TRUE(wh.Write(Slice(GenRow(i))).ok());
+        if (i == 0) {
+            // the dictionary is used by the blocks after it is set only
+            ASSERT_FALSE(wh.SetDictionary(dictionary).ok());
+        }
+    }
+    wh.EndLog();
+
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile(full_path, fd_r);
+    Reader reader(rf, NULL, true, 0, true);
+    std::string scratch;
+    Slice value;
+    for (uint64_t i = 0; i < cnt; i++) {
+        ASSERT_TRUE(reader.ReadRecord(&value, &scratch).ok());
+        ASSERT_EQ(GenRow(i), value.ToString());
+    }
+    ASSERT_TRUE(reader.ReadRecord(&value, &scratch).IsEof());
+    delete rf;
+}
+
+TEST_F(LogWRTest, TestPreallocWritableFile) {
+    if (FLAGS_snapshot_compression != "off") {
+        return;
+    }
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = log_dir + "/00000000.log";
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    ASSERT_TRUE(fd_w != NULL);
+    {
+        WriteHandle wh("off", NewPreallocWritableFile(full_path, fd_w, 1024 * 1024, 64 * 1024));
+        for (uint64_t i = 0; i < 20000; i++) {
+            ASSERT_TRUE(wh.Write(Slice(GenRow(i))).ok());
+            if (i % 1000 == 0) {
+                ASSERT_TRUE(wh.Sync().ok());
+            }
+            // the preallocated space is not seen by the readers
+            uint64_t file_size = 0;
+            ASSERT_TRUE(::openmldb::base::GetFileSize(full_path, file_size));
+            ASSERT_EQ(wh.GetSize(), file_size);
+        }
+        FILE* fd_r = fopen(full_path.c_str(), "rb");
+        ASSERT_TRUE(fd_r != NULL);
+        SequentialFile* rf = NewSeqFile(full_path, fd_r);
+        Reader reader(rf, NULL, true, 0, false);
+        std::string scratch;
+        Slice value;
+        for (uint64_t i = 0; i < 20000; i++) {
+            ASSERT_TRUE(reader.ReadRecord(&value, &scratch).ok());
+            ASSERT_EQ(GenRow(i), value.ToString());
+        }
+        ASSERT_TRUE(reader.ReadRecord(&value, &scratch).IsWaitRecord());
+        delete rf;
+    }
+    // the space after the end is released when the file is closed
+    struct stat st;
+    ASSERT_EQ(0, stat(full_path.c_str(), &st));
+    ASSERT_LE(static_cast<uint64_t>(st.st_blocks) * 512, static_cast<uint64_t>(st.st_size) + 64 * 1024);
+}
+
+TEST_F(LogWRTest, TestTruncate) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = log_dir + "/00000000.log";
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    ASSERT_TRUE(fd_w != NULL);
+    WriteHandle wh("off", NewPreallocWritableFile(full_path, fd_w, 1024 * 1024, 64 * 1024));
+    for (uint64_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(wh.Write(Slice(GenRow(i))).ok());
+    }
+    uint64_t mark = wh.GetSize();
+    // the records after the mark are dropped, the ones written then are read in their place
+    for (uint64_t i = 0; i < 1000; i++) {
+        ASSERT_TRUE(wh.Write(Slice(GenRow(i + 100000)), false).ok());
+    }
+    ASSERT_TRUE(wh.Truncate(mark).ok());
+    ASSERT_EQ(mark, wh.GetSize());
+    ASSERT_FALSE(wh.Truncate(mark + 1).ok());
+    for (uint64_t i = 100; i < 200; i++) {
+        ASSERT_TRUE(wh.Write(Slice(GenRow(i))).ok());
+    }
+    ASSERT_TRUE(wh.Sync().ok());
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile(full_path, fd_r);
+    Reader reader(rf, NULL, true, 0, false);
+    std::string scratch;
+    Slice value;
+    for (uint64_t i = 0; i < 200; i++) {
+        ASSERT_TRUE(reader.ReadRecord(&value, &scratch).ok());
+        ASSERT_EQ(GenRow(i), value.ToString());
+    }
+    ASSERT_TRUE(reader.ReadRecord(&value, &scratch).IsWaitRecord());
+    delete rf;
+}
+
+TEST_F(LogWRTest, TestUringSeqFile) {
+    if (FLAGS_snapshot_compression != "off") {
+        return;
+    }
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string full_path = log_dir + "/test.log";
+    std::string data;
+    for (uint32_t i = 0; data.size() < 3 * 1024 * 1024; i++) {
+        data.append(GenRow(i));
+    }
+    FILE* fd_w = fopen(full_path.c_str(), "wb");
+    ASSERT_TRUE(fd_w != NULL);
+    ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), fd_w));
+    fflush(fd_w);
+    FLAGS_io_uring_read_depth = 8;
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewSeqFile(full_path, fd_r);
+    FLAGS_io_uring_read_depth = 0;
+    std::vector<char> scratch(1024 * 1024);
+    Slice value;
+    uint64_t pos = 0;
+    // reads of different sizes cross the chunks
+    for (size_t n : {1ul, 4096ul, 300 * 1024ul, 7ul, 1024 * 1024ul}) {
+        ASSERT_TRUE(rf->Read(n, &value, scratch.data()).ok());
+        ASSERT_EQ(data.substr(pos, n), value.ToString());
+        pos += n;
+    }
+    ASSERT_TRUE(rf->Skip(100).ok());
+    pos += 100;
+    ASSERT_TRUE(rf->Read(10, &value, scratch.data()).ok());
+    ASSERT_EQ(data.substr(pos, 10), value.ToString());
+    pos += 10;
+    uint64_t tell = 0;
+    ASSERT_TRUE(rf->Tell(&tell).ok());
+    ASSERT_EQ(pos, tell);
+    ASSERT_TRUE(rf->Seek(5).ok());
+    ASSERT_TRUE(rf->Read(10, &value, scratch.data()).ok());
+    ASSERT_EQ(data.substr(5, 10), value.ToString());
+    pos = 15;
+    while (pos < data.size()) {
+        ASSERT_TRUE(rf->Read(scratch.size(), &value, scratch.data()).ok());
+        ASSERT_EQ(data.substr(pos, scratch.size()), value.ToString());
+        pos += value.size();
+    }
+    ASSERT_TRUE(rf->Read(10, &value, scratch.data()).ok());
+    ASSERT_EQ(0u, value.size());
+    // the records appended are read after the end
+    ASSERT_EQ(5u, fwrite("hello", 1, 5, fd_w));
+    fflush(fd_w);
+    ASSERT_TRUE(rf->Read(10, &value, scratch.data()).ok());
+    ASSERT_EQ("hello", value.ToString());
+    fclose(fd_w);
+    delete rf;
+    unlink(full_path.c_str());
+}
+
 }  // namespace log
 }  // namespace openmldb
 
@@ -418,7 +622,11 @@ int main(int argc, char** argv) {
     ::openmldb::base::SetLogLevel(DEBUG);
     ::testing::InitGoogleTest(&argc, argv);
     int ret = 0;
+#ifdef ZSTD_ENABLE
+    std::vector<std::string> vec{"off", "zlib", "snappy", "zstd"};
+#else
     std::vector<std::string> vec{"off", "zlib", "snappy"};
+#endif
     for (size_t i = 0; i < vec.size(); i++) {
         std::cout << "compress type: " << vec[i] << std::endl;
         FLAGS_snapshot_compression = vec[i];
@@ -24,6 +24,12 @@
 #include <stdint.h>
 #include <zlib.h>
 
+#include "config.h"  // NOLINT
+#ifdef ZSTD_ENABLE
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
 #include "base/endianconv.h"
 #include "base/glog_wrapper.h"
 #include "log/coding.h"
@@ -39,18 +45,45 @@ static void InitTypeCrc(uint32_t* type_crc) {
     }
 }
 
+std::string TrainDictionary(const std::vector<std::string>& samples, uint32_t max_size) {
+#ifndef ZSTD_ENABLE
+    PDLOG(WARNING, "zstd is not enabled in this build, no dictionary is trained");
+    return "";
+#else
+    std::string sample_buf;
+    std::vector<size_t> sample_sizes;
+    for (const auto& sample : samples) {
+        sample_buf.append(sample);
+        sample_sizes.push_back(sample.size());
+    }
+    std::string dictionary(max_size, '\0');
+    size_t size = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), sample_buf.data(), sample_sizes.data(),
+                                        sample_sizes.size());
+    if (ZDICT_isError(size)) {
+        PDLOG(WARNING, "fail to train dictionary from %lu samples. error: %s", samples.size(),
+              ZDICT_getErrorName(size));
+        return "";
+    }
+    dictionary.resize(size);
+    return dictionary;
+#endif
+}
+
 Writer::Writer(const std::string& compress_type, WritableFile* dest)
     : dest_(dest),
       block_offset_(0),
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      zstd_cctx_(nullptr),
+      zstd_cdict_(nullptr),
+      dictionary_written_(false) {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
         buffer_ = new char[block_size_];
-        compress_buf_ = new char[block_size_];
+        compress_buf_ = new char[kMaxCompressedBlockSize];
     } else {
         block_size_ = kBlockSize;
     }
@@ -64,12 +97,15 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest, uint64_t de
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
       buffer_(nullptr),
-      compress_buf_(nullptr) {
+      compress_buf_(nullptr),
+      zstd_cctx_(nullptr),
+      zstd_cdict_(nullptr),
+      dictionary_written_(false) {
     InitTypeCrc(type_crc_);
     if (compress_type_ != kNoCompress) {
         block_size_ = kCompressBlockSize;
         buffer_ = new char[block_size_];
-        compress_buf_ = new char[block_size_];
+        compress_buf_ = new char[kMaxCompressedBlockSize];
     } else {
         block_size_ = kBlockSize;
     }
@@ -86,6 +122,44 @@ Writer::~Writer() {
     if (compress_buf_) {
         delete[] compress_buf_;
     }
+#ifdef ZSTD_ENABLE
+    ZSTD_freeCDict(zstd_cdict_);
+    ZSTD_freeCCtx(zstd_cctx_);
+#endif
+}
+
+Status Writer::SetDictionary(const std::string& dictionary) {
+    if (compress_type_ != kZstd) {
+        return Status::NotSupported(Slice("dictionary is supported by zstd only"));
+    }
+    if (block_offset_ > 0 || dest_->GetSize() > 0) {
+        return Status::InvalidArgument(Slice("dictionary is set after records"));
+    }
+    if (dictionary.empty()) {
+        return Status::OK();
+    }
+#ifndef ZSTD_ENABLE
+    return Status::NotSupported(Slice("zstd is not enabled in this build"));
+#else
+    ZSTD_freeCDict(zstd_cdict_);
+    zstd_cdict_ = ZSTD_createCDict(dictionary.data(), dictionary.size(), ZSTD_CLEVEL_DEFAULT);
+    if (zstd_cdict_ == nullptr) {
+        return Status::InvalidArgument(Slice("invalid dictionary"));
+    }
+    dictionary_ = dictionary;
+    return Status::OK();
+#endif
+}
+
+Status Writer::Truncate(uint64_t size) {
+    if (compress_type_ != kNoCompress) {
+        return Status::NotSupported(Slice("truncate is not supported with compression"));
+    }
+    Status status = dest_->Truncate(size);
+    if (status.ok()) {
+        block_offset_ = size % block_size_;
+    }
+    return status;
 }
 
 Status Writer::EndLog() {
@@ -126,7 +200,7 @@ Status Writer::EndLog() {
     return s;
 }
 
-Status Writer::AddRecord(const Slice& slice) {
+Status Writer::AddRecord(const Slice& slice, bool flush) {
     const char* ptr = slice.data();
     size_t left = slice.size();
 
@@ -172,7 +246,7 @@ Status Writer::AddRecord(const Slice& slice) {
         } else {
             type = kMiddleType;
         }
-        s = EmitPhysicalRecord(type, ptr, fragment_length);
+        s = EmitPhysicalRecord(type, ptr, fragment_length, flush);
         ptr += fragment_length;
         left -= fragment_length;
         begin = false;
@@ -180,7 +254,7 @@ Status Writer::AddRecord(const Slice& slice) {
     return s;
 }
 
-Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
+Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n, bool flush) {
     if (compress_type_ == kNoCompress) {
         assert(n <= 0xffff);  // Must fit in two bytes
     } else {
@@ -211,7 +285,7 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
         Status s = dest_->Append(Slice(buf, header_size_));
         if (s.ok()) {
             s = dest_->Append(Slice(ptr, n));
-            if (s.ok()) {
+            if (s.ok() && flush) {
                 s = dest_->Flush();
             }
         }
@@ -239,54 +313,79 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
 
 Status Writer::CompressRecord() {
     Status s;
-    int32_t compress_len = -1;
+    uint32_t compress_len = 0;
     switch (compress_type_) {
         case kSnappy: {
-            snappy::RawCompress(buffer_, block_size_, compress_buf_, reinterpret_cast<size_t*>(&compress_len));
+            size_t dest_len = 0;
+            snappy::RawCompress(buffer_, block_size_, compress_buf_, &dest_len);
+            compress_len = dest_len;
             break;
         }
         case kZlib: {
-            uint32_t dest_len = compressBound(block_size_);
-
-#ifdef __APPLE__
-            int res = compress((unsigned char*)compress_buf_, reinterpret_cast<uLongf*>(&dest_len),
-                               (const unsigned char*)buffer_, block_size_);
-#else
-
-            int res = compress((unsigned char*)compress_buf_, reinterpret_cast<uint64_t*>(&dest_len),
-                               (const unsigned char*)buffer_, block_size_);
-#endif
+            uLongf dest_len = kMaxCompressedBlockSize;
+            int res = compress(reinterpret_cast<unsigned char*>(compress_buf_), &dest_len,
+                               reinterpret_cast<const unsigned char*>(buffer_), block_size_);
             if (res != Z_OK) {
-                s = Status::InvalidRecord(Slice("compress failed, error code: " + res));
+                s = Status::InvalidRecord(Slice("compress failed, error code: " + std::to_string(res)));
+                PDLOG(WARNING, "write error, compress_type: %d, msg: %s", compress_type_, s.ToString().c_str());
+                return s;
+            }
+            compress_len = dest_len;
+            break;
+        }
+#ifdef ZSTD_ENABLE
+        case kZstd: {
+            if (zstd_cctx_ == nullptr) {
+                zstd_cctx_ = ZSTD_createCCtx();
+            }
+            if (zstd_cdict_ != nullptr && !dictionary_written_) {
+                // the dictionary is read before the blocks compressed with it
+                s = AppendCompressedBlock(kZstdDictionary, dictionary_.data(), dictionary_.size());
+                if (!s.ok()) {
+                    return s;
+                }
+                dictionary_written_ = true;
+            }
+            size_t dest_len = 0;
+            if (zstd_cdict_ != nullptr) {
+                dest_len = ZSTD_compress_usingCDict(zstd_cctx_, compress_buf_, kMaxCompressedBlockSize, buffer_,
+                                                    block_size_, zstd_cdict_);
+            } else {
+                dest_len = ZSTD_compressCCtx(zstd_cctx_, compress_buf_, kMaxCompressedBlockSize, buffer_, block_size_,
+                                             ZSTD_CLEVEL_DEFAULT);
+            }
+            if (ZSTD_isError(dest_len)) {
+                s = Status::InvalidRecord(Slice(std::string("compress failed, error: ") + ZSTD_getErrorName(dest_len)));
                 PDLOG(WARNING, "write error, compress_type: %d, msg: %s", compress_type_, s.ToString().c_str());
                 return s;
             }
-            compress_len = static_cast<int32_t>(dest_len);
+            compress_len = dest_len;
             break;
         }
+#endif
         default: {
-            s = Status::InvalidRecord(Slice("unsupported compress type: " + compress_type_));
+            s = Status::InvalidRecord(Slice("unsupported compress type: " + std::to_string(compress_type_)));
             PDLOG(WARNING, "write error, compress_type: %d, msg: %s", compress_type_, s.ToString().c_str());
             return s;
         }
     }
-    if (compress_len < 0) {
-        s = Status::InvalidRecord(Slice("compress failed"));
-        PDLOG(WARNING, "write error, compress_type: %d, msg: %s", compress_type_, s.ToString().c_str());
-        return s;
-    }
     DLOG(INFO) << "compress_len: " << compress_len << ", "
                << "compress_type: " << compress_type_;
+    return AppendCompressedBlock(compress_type_, compress_buf_, compress_len);
+}
+
+Status Writer::AppendCompressedBlock(CompressType type, const char* data, uint32_t len) {
     // fill compressed data's header
     char head_of_compress[kHeaderSizeOfCompressBlock];
-    memrev32ifbe(static_cast<void*>(&compress_len));
-    memcpy(head_of_compress, static_cast<void*>(&compress_len), sizeof(int32_t));
-    memcpy(head_of_compress + sizeof(int32_t), static_cast<void*>(&compress_type_), 1);
-    memset(head_of_compress + sizeof(int32_t) + 1, 0, kHeaderSizeOfCompressBlock - sizeof(int32_t) - 1);
+    memrev32ifbe(static_cast<void*>(&len));
+    memcpy(head_of_compress, static_cast<void*>(&len), sizeof(uint32_t));
+    memrev32ifbe(static_cast<void*>(&len));
+    head_of_compress[sizeof(uint32_t)] = static_cast<char>(type);
+    memset(head_of_compress + sizeof(uint32_t) + 1, 0, kHeaderSizeOfCompressBlock - sizeof(uint32_t) - 1);
     // write header and compressed data
-    s = dest_->Append(Slice(head_of_compress, kHeaderSizeOfCompressBlock));
+    Status s = dest_->Append(Slice(head_of_compress, kHeaderSizeOfCompressBlock));
     if (s.ok()) {
-        s = dest_->Append(Slice(compress_buf_, compress_len));
+        s = dest_->Append(Slice(data, len));
         if (s.ok()) {
             s = dest_->Flush();
         }
@@ -302,6 +401,8 @@ CompressType Writer::GetCompressType(const std::string& compress_type) {
         return kZlib;
     } else if (compress_type == "snappy") {
         return kSnappy;
+    } else if (compress_type == "zstd") {
+        return kZstd;
     } else {
         return kNoCompress;
     }
@@ -24,6 +24,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "base/slice.h"
 #include "log/status.h"
@@ -32,9 +33,15 @@
 
 using ::openmldb::base::Slice;
 
+struct ZSTD_CCtx_s;
+struct ZSTD_CDict_s;
+
 namespace openmldb {
 namespace log {
 
+// train a zstd dictionary of at most max_size bytes from the samples, which is empty if it fails
+std::string TrainDictionary(const std::vector<std::string>& samples, uint32_t max_size);
+
 class Writer {
  public:
     // Create a writer that will append data to "*dest".
@@ -49,9 +56,18 @@ class Writer {
 
     ~Writer();
 
-    Status AddRecord(const Slice& slice);
+    // the record is flushed to the file unless flush is false, the records written without flush
+    // are flushed by a later record or Flush of the file
+    Status AddRecord(const Slice& slice, bool flush = true);
     Status EndLog();
 
+    // drop the records written after the file size was size, it's supported without compression only
+    Status Truncate(uint64_t size);
+
+    // compress the blocks with the zstd dictionary, which is written in front of them. it is
+    // set before the first record
+    Status SetDictionary(const std::string& dictionary);
+
     inline CompressType GetCompressType() { return compress_type_; }
 
     inline uint32_t GetBlockSize() { return block_size_; }
@@ -76,10 +92,15 @@ class Writer {
     char* buffer_;
     // buffer for compressed block
     char* compress_buf_;
+    ZSTD_CCtx_s* zstd_cctx_;
+    ZSTD_CDict_s* zstd_cdict_;
+    std::string dictionary_;
+    bool dictionary_written_;
     Status CompressRecord();
+    Status AppendCompressedBlock(CompressType type, const char* data, uint32_t len);
     Status AppendInternal(WritableFile* wf, int leftover);
 
-    Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length);
+    Status EmitPhysicalRecord(RecordType type, const char* ptr, size_t length, bool flush = true);
 
     // No copying allowed
     Writer(const Writer&);
@@ -96,11 +117,21 @@ struct WriteHandle {
         lw_ = new Writer(compress_type, wf_, dest_length);
     }
 
-    Status Write(const ::openmldb::base::Slice& slice) { return lw_->AddRecord(slice); }
+    // write to wf, which is owned by the handle
+    WriteHandle(const std::string& compress_type, WritableFile* wf) : fd_(NULL), wf_(wf), lw_(NULL) {
+        lw_ = new Writer(compress_type, wf_);
+    }
+
+    Status Write(const ::openmldb::base::Slice& slice, bool flush = true) { return lw_->AddRecord(slice, flush); }
+
+    Status SetDictionary(const std::string& dictionary) { return lw_->SetDictionary(dictionary); }
+
+    Status Flush() { return wf_->Flush(); }
 
     Status Sync() { return wf_->Sync(); }
 
     Status EndLog() { return lw_->EndLog(); }
+    Status Truncate(uint64_t size) { return lw_->Truncate(size); }
 
     uint64_t GetSize() { return wf_->GetSize(); }
 
@@ -21,11 +21,21 @@
 #include "log/sequential_file.h"
 
 #include <errno.h>
+#include <gflags/gflags.h>
 #include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
 
 #include "base/glog_wrapper.h"
 #include "base/slice.h"
 #include "log/status.h"
+#include "log/uring.h"
+
+DECLARE_uint32(io_uring_read_depth);
 
 using ::openmldb::base::Slice;
 using ::openmldb::log::Status;
@@ -91,7 +101,203 @@ class PosixSequentialFile : public SequentialFile {
     }
 };
 
-SequentialFile* NewSeqFile(const std::string& fname, FILE* f) { return new PosixSequentialFile(fname, f); }
+// UringSequentialFile keeps the reads of the chunks after the position in flight with io_uring. the number of
+// them doubles up to depth while the file is read through, and it is back to one at the end of the file, so a
+// reader waiting for the new records of a binlog does not read ahead
+class UringSequentialFile : public SequentialFile {
+ public:
+    UringSequentialFile(const std::string& fname, FILE* f, std::unique_ptr<IoUring> ring, uint32_t depth)
+        : filename_(fname),
+          file_(f),
+          fd_(fileno(f)),
+          depth_(depth),
+          ahead_(1),
+          pos_(0),
+          next_offset_(0),
+          ring_(std::move(ring)) {
+        int64_t pos = ftell(f);
+        pos_ = pos > 0 ? pos : 0;
+        next_offset_ = pos_;
+    }
+
+    virtual ~UringSequentialFile() {
+        Reset();
+        ring_.reset();
+        // the kernel may still write into the chunks whose reads are not completed, so they are leaked
+        for (auto& chunk : chunks_pool_) {
+            if (chunk->lost && !chunk->done) {
+                PDLOG(WARNING, "the read of %s at offset %lu is not completed", filename_.c_str(), chunk->offset);
+                chunk.release();
+            }
+        }
+        fclose(file_);
+    }
+
+    virtual Status Read(size_t n, Slice* result, char* scratch) {
+        size_t copied = 0;
+        while (copied < n) {
+            Status s = FillQueue();
+            if (!s.ok()) {
+                return s;
+            }
+            Chunk* chunk = chunks_.front();
+            s = WaitChunk(chunk);
+            if (!s.ok()) {
+                return s;
+            }
+            if (chunk->res < 0) {
+                Reset();
+                return Status::IOError(filename_, strerror(-chunk->res));
+            }
+            uint64_t end = chunk->offset + chunk->res;
+            if (pos_ < end) {
+                size_t len = std::min<uint64_t>(n - copied, end - pos_);
+                memcpy(scratch + copied, chunk->buf.get() + (pos_ - chunk->offset), len);
+                copied += len;
+                pos_ += len;
+            }
+            if (pos_ < end) {
+                continue;
+            }
+            bool eof = static_cast<uint32_t>(chunk->res) < CHUNK_SIZE;
+            chunks_.pop_front();
+            free_chunks_.emplace_back(chunk);
+            if (eof) {
+                // the chunks after the end are read again as the file grows
+                Reset();
+                ahead_ = 1;
+                break;
+            }
+            ahead_ = std::min(ahead_ * 2, depth_);
+        }
+        *result = Slice(scratch, copied);
+        return Status::OK();
+    }
+
+    virtual Status Skip(uint64_t n) {
+        pos_ += n;
+        if (pos_ >= next_offset_) {
+            Reset();
+        }
+        return Status::OK();
+    }
+
+    virtual Status Tell(uint64_t* pos) {
+        if (pos == NULL) {
+            return Status::InvalidArgument("invalid pos arg");
+        }
+        *pos = pos_;
+        return Status::OK();
+    }
+
+    virtual Status Seek(uint64_t pos) {
+        pos_ = pos;
+        Reset();
+        return Status::OK();
+    }
+
+ private:
+    static constexpr uint32_t CHUNK_SIZE = 256 * 1024;
+
+    struct Chunk {
+        std::unique_ptr<char[]> buf;
+        struct iovec iov;
+        uint64_t offset = 0;
+        int32_t res = 0;
+        bool done = false;
+        // the read can't be waited for, the chunk is never reused
+        bool lost = false;
+    };
+
+    Status FillQueue() {
+        bool submit = false;
+        while (chunks_.size() < ahead_) {
+            Chunk* chunk = nullptr;
+            if (free_chunks_.empty()) {
+                chunks_pool_.emplace_back(new Chunk());
+                chunk = chunks_pool_.back().get();
+                chunk->buf.reset(new char[CHUNK_SIZE]);
+            } else {
+                chunk = free_chunks_.back();
+                free_chunks_.pop_back();
+            }
+            chunk->iov.iov_base = chunk->buf.get();
+            chunk->iov.iov_len = CHUNK_SIZE;
+            chunk->offset = next_offset_;
+            chunk->res = 0;
+            chunk->done = false;
+            if (!ring_->PrepareRead(fd_, &chunk->iov, chunk->offset, reinterpret_cast<uint64_t>(chunk))) {
+                free_chunks_.push_back(chunk);
+                break;
+            }
+            chunks_.push_back(chunk);
+            next_offset_ += CHUNK_SIZE;
+            submit = true;
+        }
+        if (submit) {
+            int ret = ring_->Submit();
+            if (ret < 0) {
+                return Status::IOError(filename_, strerror(-ret));
+            }
+        }
+        return Status::OK();
+    }
+
+    Status WaitChunk(Chunk* chunk) {
+        while (!chunk->done) {
+            uint64_t user_data = 0;
+            int32_t res = 0;
+            int ret = ring_->WaitCompletion(&user_data, &res);
+            if (ret < 0) {
+                return Status::IOError(filename_, strerror(-ret));
+            }
+            Chunk* completed = reinterpret_cast<Chunk*>(user_data);
+            completed->res = res;
+            completed->done = true;
+        }
+        return Status::OK();
+    }
+
+    // drop the chunks read ahead, the buffers are reused after their reads are completed. a chunk whose read
+    // fails to be waited for is lost, as its buffer may be still written by the kernel
+    void Reset() {
+        for (Chunk* chunk : chunks_) {
+            if (WaitChunk(chunk).ok()) {
+                free_chunks_.push_back(chunk);
+            } else {
+                chunk->lost = true;
+            }
+        }
+        chunks_.clear();
+        next_offset_ = pos_;
+    }
+
+    std::string filename_;
+    FILE* file_;
+    int fd_;
+    uint32_t depth_;
+    uint32_t ahead_;
+    // the position of the next byte to read
+    uint64_t pos_;
+    // the offset of the next chunk to read ahead
+    uint64_t next_offset_;
+    std::deque<Chunk*> chunks_;
+    std::vector<Chunk*> free_chunks_;
+    std::vector<std::unique_ptr<Chunk>> chunks_pool_;
+    // declared after the chunks, so the ring is torn down before the buffers of its reads are freed
+    std::unique_ptr<IoUring> ring_;
+};
+
+SequentialFile* NewSeqFile(const std::string& fname, FILE* f) {
+    if (FLAGS_io_uring_read_depth > 0) {
+        auto ring = std::make_unique<IoUring>();
+        if (ring->Init(FLAGS_io_uring_read_depth)) {
+            return new UringSequentialFile(fname, f, std::move(ring), FLAGS_io_uring_read_depth);
+        }
+        PDLOG(WARNING, "io_uring is not available, read %s synchronously", fname.c_str());
+    }
+    return new PosixSequentialFile(fname, f);
+}
 
 }  // namespace log
 }  // namespace openmldb
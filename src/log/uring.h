@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_LOG_URING_H_
+#define SRC_LOG_URING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace openmldb {
+namespace log {
+
+// IoUring is an io_uring instance used by one thread, which submits reads and waits for their completions.
+// it is set up by the system calls directly, so it does not need liburing
+class IoUring {
+ public:
+    IoUring();
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // return false if io_uring is not supported by the kernel or the memory lock limit is reached
+    bool Init(uint32_t depth);
+
+    // queue a read of iov at offset of fd, it is submitted by Submit. iov has to be live until it is completed
+    bool PrepareRead(int fd, const struct iovec* iov, uint64_t offset, uint64_t user_data);
+
+    // submit the queued reads, return 0 or -errno
+    int Submit();
+
+    // wait for a completion, return 0 or -errno. res is the bytes read or -errno of the read
+    int WaitCompletion(uint64_t* user_data, int32_t* res);
+
+ private:
+    int ring_fd_;
+    uint32_t sq_entries_;
+    uint32_t to_submit_;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_ring_mask_;
+    unsigned* sq_array_;
+    struct io_uring_sqe* sqes_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_ring_mask_;
+    struct io_uring_cqe* cqes_;
+    void* sq_ptr_;
+    size_t sq_size_;
+    void* cq_ptr_;
+    size_t cq_size_;
+    size_t sqes_size_;
+};
+
+}  // namespace log
+}  // namespace openmldb
+
+#endif  // SRC_LOG_URING_H_
@@ -22,9 +22,13 @@
 #include "log/writable_file.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "base/slice.h"
 #include "log/status.h"
 
@@ -41,7 +45,7 @@ class PosixWritableFile : public WritableFile {
  public:
     PosixWritableFile(const std::string& fname, FILE* f) : filename_(fname), file_(f) {}
 
-    ~PosixWritableFile() {
+    virtual ~PosixWritableFile() {
         if (file_ != NULL) {
             // Ignoring any potential errors
             fclose(file_);
@@ -98,12 +102,125 @@ class PosixWritableFile : public WritableFile {
         return Status::OK();
     }
 
- private:
+    Status Truncate(uint64_t size) override {
+        if (size > wsize_) {
+            return Status::InvalidArgument(filename_, "truncate beyond the end");
+        }
+        // the bytes buffered are written first, or else they land after the truncation
+        Status status = PosixWritableFile::Flush();
+        if (!status.ok()) {
+            return status;
+        }
+        if (ftruncate(fileno(file_), size) != 0 || fseek(file_, size, SEEK_SET) != 0) {
+            return IOError(filename_, errno);
+        }
+        wsize_ = size;
+        return Status::OK();
+    }
+
+ protected:
     std::string filename_;
     FILE* file_;
 };
 
+class PreallocWritableFile : public PosixWritableFile {
+ public:
+    PreallocWritableFile(const std::string& fname, FILE* f, uint64_t prealloc_size, uint64_t sync_range_size)
+        : PosixWritableFile(fname, f),
+          prealloc_size_(prealloc_size),
+          sync_range_size_(sync_range_size),
+          prealloc_end_(0),
+          sync_range_start_(0) {
+        int64_t pos = ftell(f);
+        wsize_ = pos > 0 ? pos : 0;
+        prealloc_end_ = wsize_;
+        sync_range_start_ = wsize_;
+    }
+
+    ~PreallocWritableFile() {
+        if (file_ != NULL) {
+            TrimPrealloc();
+        }
+    }
+
+    Status Append(const Slice& data) override {
+#if __linux__
+        if (prealloc_size_ > 0 && wsize_ + data.size() > prealloc_end_) {
+            // the size is kept so that the readers stop at the end of the records
+            uint64_t end = wsize_ + data.size() + prealloc_size_;
+            if (fallocate(fileno(file_), FALLOC_FL_KEEP_SIZE, prealloc_end_, end - prealloc_end_) == 0) {
+                prealloc_end_ = end;
+            } else {
+                // the file grows on demand like before
+                prealloc_size_ = 0;
+            }
+        }
+#endif
+        return PosixWritableFile::Append(data);
+    }
+
+    Status Close() override {
+        if (file_ != NULL) {
+            TrimPrealloc();
+        }
+        return PosixWritableFile::Close();
+    }
+
+    Status Flush() override {
+        Status status = PosixWritableFile::Flush();
+#if __linux__
+        if (status.ok() && sync_range_size_ > 0 && wsize_ - sync_range_start_ >= sync_range_size_) {
+            // start the writeback without waiting for it
+            if (sync_file_range(fileno(file_), sync_range_start_, wsize_ - sync_range_start_,
+                                SYNC_FILE_RANGE_WRITE) != 0) {
+                return IOError(filename_, errno);
+            }
+            sync_range_start_ = wsize_;
+        }
+#endif
+        return status;
+    }
+
+    Status Sync() override {
+        Status status = PosixWritableFile::Sync();
+        if (status.ok()) {
+            sync_range_start_ = wsize_;
+        }
+        return status;
+    }
+
+    Status Truncate(uint64_t size) override {
+        Status status = PosixWritableFile::Truncate(size);
+        if (status.ok()) {
+            // the space allocated after the end is released by the truncation
+            prealloc_end_ = size;
+            sync_range_start_ = std::min(sync_range_start_, size);
+        }
+        return status;
+    }
+
+ private:
+    // release the space allocated after the end
+    void TrimPrealloc() {
+        if (prealloc_end_ > wsize_ && PosixWritableFile::Flush().ok()) {
+            if (ftruncate(fileno(file_), wsize_) == 0) {
+                prealloc_end_ = wsize_;
+            }
+        }
+    }
+
+    uint64_t prealloc_size_;
+    uint64_t sync_range_size_;
+    uint64_t prealloc_end_;
+    uint64_t sync_range_start_;
+};
+
 WritableFile* NewWritableFile(const std::string& fname, FILE* f) { return new PosixWritableFile(fname, f); }
 
+WritableFile* NewPreallocWritableFile(const std::string& fname, FILE* f, uint64_t prealloc_size,
+                                      uint64_t sync_range_size) {
+    return new PreallocWritableFile(fname, f, prealloc_size, sync_range_size);
+}
+
 }  // namespace log
 }  // namespace openmldb
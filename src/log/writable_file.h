@@ -37,6 +37,8 @@ class WritableFile {
     virtual Status Close() = 0;
     virtual Status Flush() = 0;
     virtual Status Sync() = 0;
+    // drop the bytes appended after size, the ones before it are flushed
+    virtual Status Truncate(uint64_t size) = 0;
     uint64_t GetSize() { return wsize_; }
 
  protected:
@@ -50,6 +52,12 @@ class WritableFile {
 
 WritableFile* NewWritableFile(const std::string& fname, FILE* f);
 
+// the file allocates its disk space prealloc_size bytes ahead of the end, without changing the file size seen by
+// the readers, and starts the writeback of every sync_range_size bytes flushed, so that a sync has little to write.
+// 0 disables each of them
+WritableFile* NewPreallocWritableFile(const std::string& fname, FILE* f, uint64_t prealloc_size,
+                                      uint64_t sync_range_size);
+
 }  // namespace log
 }  // namespace openmldb
 
@@ -2323,6 +2323,8 @@ int NameServerImpl::CreateTableOnTablet(const std::shared_ptr<::openmldb::namese
     table_meta.set_compress_type(compress_type);
     table_meta.set_storage_mode(table_info->storage_mode());
     table_meta.set_base_table_tid(table_info->base_table_tid());
+    table_meta.set_enable_pk_hash_index(table_info->enable_pk_hash_index());
+    table_meta.set_binlog_durability(table_info->binlog_durability());
     if (table_info->has_key_entry_max_height()) {
         table_meta.set_key_entry_max_height(table_info->key_entry_max_height());
     }
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/log_cache.h"
+
+#include <utility>
+
+namespace openmldb {
+namespace replica {
+
+LogCache::LogCache(uint64_t max_byte_size) : mu_(), max_byte_size_(max_byte_size), byte_size_(0), first_index_(0) {}
+
+void LogCache::Append(uint64_t log_index, std::string&& record) {
+    auto value = std::make_shared<const std::string>(std::move(record));
+    std::lock_guard<std::mutex> lock(mu_);
+    if (records_.empty() || first_index_ + records_.size() != log_index) {
+        records_.clear();
+        byte_size_ = 0;
+        first_index_ = log_index;
+    }
+    byte_size_ += value->size();
+    records_.push_back(std::move(value));
+    while (!records_.empty() && byte_size_ > max_byte_size_) {
+        byte_size_ -= records_.front()->size();
+        records_.pop_front();
+        first_index_++;
+    }
+}
+
+bool LogCache::Get(uint64_t start_index, uint32_t max_cnt,
+                   std::vector<std::shared_ptr<const std::string>>* records) {
+    records->clear();
+    std::lock_guard<std::mutex> lock(mu_);
+    if (records_.empty() || start_index < first_index_ || start_index >= first_index_ + records_.size()) {
+        return false;
+    }
+    for (uint64_t pos = start_index - first_index_; pos < records_.size() && records->size() < max_cnt; pos++) {
+        records->push_back(records_[pos]);
+    }
+    return true;
+}
+
+void LogCache::Clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    records_.clear();
+    byte_size_ = 0;
+    first_index_ = 0;
+}
+
+uint64_t LogCache::GetByteSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return byte_size_;
+}
+
+}  // namespace replica
+}  // namespace openmldb
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_LOG_CACHE_H_
+#define SRC_REPLICA_LOG_CACHE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace openmldb {
+namespace replica {
+
+// LogCache keeps the serialized entries recently appended by the leader, so the replicate
+// nodes ship them without reading the binlog again. It holds a continuous range of log
+// index and evicts the oldest entries when it is over the byte limit
+class LogCache {
+ public:
+    explicit LogCache(uint64_t max_byte_size);
+
+    LogCache(const LogCache&) = delete;
+    LogCache& operator=(const LogCache&) = delete;
+
+    // the entry is expected to follow the last one, otherwise the cache restarts from it
+    void Append(uint64_t log_index, std::string&& record);
+
+    // get at most max_cnt records from start_index, return false if start_index is not in the cache
+    bool Get(uint64_t start_index, uint32_t max_cnt, std::vector<std::shared_ptr<const std::string>>* records);
+
+    void Clear();
+
+    uint64_t GetByteSize();
+
+ private:
+    std::mutex mu_;
+    uint64_t max_byte_size_;
+    uint64_t byte_size_;
+    // the log index of the front record
+    uint64_t first_index_;
+    std::deque<std::shared_ptr<const std::string>> records_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_LOG_CACHE_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/log_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace replica {
+
+class LogCacheTest : public ::testing::Test {
+ public:
+    LogCacheTest() {}
+    ~LogCacheTest() {}
+};
+
+TEST_F(LogCacheTest, AppendAndGet) {
+    LogCache cache(100);
+    std::vector<std::shared_ptr<const std::string>> records;
+    ASSERT_FALSE(cache.Get(1, 10, &records));
+    for (uint64_t i = 1; i <= 5; i++) {
+        cache.Append(i, std::string(10, 'a' + i));
+    }
+    ASSERT_EQ(50u, cache.GetByteSize());
+    ASSERT_TRUE(cache.Get(2, 10, &records));
+    ASSERT_EQ(4u, records.size());
+    ASSERT_EQ(std::string(10, 'c'), *records[0]);
+    ASSERT_TRUE(cache.Get(1, 2, &records));
+    ASSERT_EQ(2u, records.size());
+    ASSERT_EQ(std::string(10, 'b'), *records[0]);
+    ASSERT_FALSE(cache.Get(6, 10, &records));
+    ASSERT_TRUE(records.empty());
+    // the oldest records are evicted over the limit
+    for (uint64_t i = 6; i <= 12; i++) {
+        cache.Append(i, std::string(10, 'a'));
+    }
+    ASSERT_EQ(100u, cache.GetByteSize());
+    ASSERT_FALSE(cache.Get(2, 10, &records));
+    ASSERT_TRUE(cache.Get(3, 20, &records));
+    ASSERT_EQ(10u, records.size());
+    // a gap restarts the cache
+    cache.Append(20, std::string(10, 'z'));
+    ASSERT_EQ(10u, cache.GetByteSize());
+    ASSERT_FALSE(cache.Get(12, 10, &records));
+    ASSERT_TRUE(cache.Get(20, 10, &records));
+    ASSERT_EQ(1u, records.size());
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetByteSize());
+    ASSERT_FALSE(cache.Get(20, 10, &records));
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -30,17 +30,27 @@
 #include "base/file_util.h"
 #include "base/glog_wrapper.h"
 #include "base/strings.h"
+#include "bvar/bvar.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/wire_format_lite.h"
 #include "log/log_format.h"
 #include "storage/segment.h"
 
 DECLARE_int32(binlog_single_file_max_size);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(binlog_cache_size_mb);
+DECLARE_uint32(binlog_follower_ack_timeout_ms);
+DECLARE_uint32(binlog_preallocate_size_mb);
+DECLARE_uint32(binlog_sync_range_size_kb);
 DECLARE_string(zk_cluster);
 
 namespace openmldb {
 namespace replica {
 
 static const ::openmldb::base::DefaultComparator scmp;
+// the puts of kBinlogFollowerAck tables which are not acked by a follower, exposed in /vars
+static bvar::Adder<uint64_t> g_follower_ack_fail_cnt("binlog_follower_ack_fail_count");
 
 LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path,
                              const std::map<std::string, std::string>& real_ep_map,
@@ -56,14 +66,24 @@ LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path
       real_ep_map_(real_ep_map),
       nodes_(),
       local_endpoints_(),
+      log_cache_(),
+      has_node_(false),
       term_(0),
       mu_(),
       cv_(),
-      wmu_() {
+      wmu_(),
+      durability_(::openmldb::api::BinlogDurability::kBinlogAsync),
+      gmu_(),
+      gcv_(),
+      pending_(),
+      committing_(false) {
     binlog_index_ = 0;
     snapshot_log_part_index_.store(-1, std::memory_order_relaxed);
     snapshot_last_offset_.store(0, std::memory_order_relaxed);
     follower_offset_.store(0);
+    if (FLAGS_binlog_cache_size_mb > 0) {
+        log_cache_ = std::make_unique<LogCache>(static_cast<uint64_t>(FLAGS_binlog_cache_size_mb) << 20);
+    }
 }
 
 LogReplicator::~LogReplicator() {
@@ -109,7 +129,8 @@ bool LogReplicator::Init() {
         for (const auto& kv : real_ep_map_) {
             std::shared_ptr<ReplicateNode> replicate_node =
                 std::make_shared<ReplicateNode>(kv.first, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second,
+                                                log_cache_.get());
             if (replicate_node->Init() < 0) {
                 PDLOG(WARNING, "init replicate node %s error", kv.first.c_str());
                 return false;
@@ -118,6 +139,7 @@ bool LogReplicator::Init() {
             local_endpoints_.push_back(kv.first);
             PDLOG(INFO, "add replica node with endpoint %s", kv.first.c_str());
         }
+        has_node_.store(!nodes_.empty(), std::memory_order_relaxed);
         PDLOG(INFO, "init leader node for path %s ok", path_.c_str());
     }
     if (!Recover()) {
@@ -343,11 +365,13 @@ int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& re
         if (tid == UINT32_MAX) {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second,
+                                                log_cache_.get());
         } else {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid, pid_, &term_, &log_offset_,
-                                                &mu_, &cv_, true, &follower_offset_, kv.second);
+                                                &mu_, &cv_, true, &follower_offset_, kv.second,
+                                                log_cache_.get());
         }
         if (replicate_node->Init() < 0) {
             PDLOG(WARNING, "init replicate node %s error", endpoint.c_str());
@@ -358,6 +382,7 @@ int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& re
             return -1;
         }
         nodes_.push_back(replicate_node);
+        has_node_.store(true, std::memory_order_relaxed);
         real_ep_map_.insert(std::make_pair(endpoint, kv.second));
         if (tid == UINT32_MAX) {
             local_endpoints_.push_back(endpoint);
@@ -387,6 +412,7 @@ int LogReplicator::DelReplicateNode(const std::string& endpoint) {
         }
         node = *it;
         nodes_.erase(it);
+        has_node_.store(!nodes_.empty(), std::memory_order_relaxed);
         real_ep_map_.erase(endpoint);
         local_endpoints_.erase(std::remove(local_endpoints_.begin(), local_endpoints_.end(), endpoint),
                                local_endpoints_.end());
@@ -421,9 +447,13 @@ bool LogReplicator::DelAllReplicateNode() {
         }
         PDLOG(INFO, "delete all replica. replica num [%u] tid[%u] pid[%u]", nodes_.size(), tid_, pid_);
         nodes_.clear();
+        has_node_.store(false, std::memory_order_relaxed);
         real_ep_map_.clear();
         local_endpoints_.clear();
     }
+    if (log_cache_) {
+        log_cache_->Clear();
+    }
     std::vector<std::shared_ptr<ReplicateNode>>::iterator it = copied_nodes.begin();
     for (; it != copied_nodes.end(); ++it) {
         DEBUGLOG("stop replicator node");
@@ -434,37 +464,195 @@ bool LogReplicator::DelAllReplicateNode() {
 }
 
 bool LogReplicator::AppendEntry(LogEntry& entry, ::google::protobuf::Closure* done) {
+    return AppendEntry(entry, ::openmldb::base::Slice(), done);
+}
+
+bool LogReplicator::AppendEntry(LogEntry& entry, const ::openmldb::base::Slice& value,
+                                ::google::protobuf::Closure* done, bool* written) {
+    PendingEntry pending = {&entry, &value, 1, done, false, 0, false};
+    Commit(&pending);
+    if (written != nullptr) {
+        *written = pending.written > 0;
+    }
+    if (!pending.ok) {
+        return false;
+    }
+    return WaitFollowerAck(entry.log_index());
+}
+
+void LogReplicator::Commit(PendingEntry* pending) {
+    std::unique_lock<bthread::Mutex> lock(gmu_);
+    pending_.push_back(pending);
+    while (!pending->finished && committing_) {
+        gcv_.wait(lock);
+    }
+    if (!pending->finished) {
+        // no group is being committed, commit the entries queued so far with this one
+        std::vector<PendingEntry*> group;
+        group.swap(pending_);
+        committing_ = true;
+        lock.unlock();
+        CommitGroup(group);
+        lock.lock();
+        committing_ = false;
+        gcv_.notify_all();
+    }
+}
+
+void LogReplicator::CommitGroup(const std::vector<PendingEntry*>& group) {
     std::lock_guard<std::mutex> lock(wmu_);
+    for (auto pending : group) {
+        pending->written = WriteEntries(pending->entries, pending->values, pending->count);
+    }
+    bool synced = SyncEntries();
+    for (auto pending : group) {
+        pending->ok = pending->written == pending->count && synced;
+        // the done updates the aggregators, so they run in the log order
+        if (pending->ok && pending->done) {
+            pending->done->Run();
+        }
+        pending->finished = true;
+    }
+}
+
+bool LogReplicator::SyncEntries() {
+    if (wh_ == NULL) {
+        return false;
+    }
+    ::openmldb::log::Status status;
+    if (durability_ == ::openmldb::api::BinlogDurability::kBinlogFsync) {
+        status = wh_->Sync();
+    } else {
+        status = wh_->Flush();
+    }
+    if (!status.ok()) {
+        PDLOG(WARNING, "fail to flush replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LogReplicator::WaitFollowerAck(uint64_t offset) {
+    if (durability_ != ::openmldb::api::BinlogDurability::kBinlogFollowerAck) {
+        return true;
+    }
+    uint64_t deadline = ::baidu::common::timer::get_micros() + FLAGS_binlog_follower_ack_timeout_ms * 1000ul;
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    if (local_endpoints_.empty()) {
+        // the leader advances follower_offset_ by itself to sync the remote replicas, no follower acks it
+        g_follower_ack_fail_cnt << 1;
+        PDLOG(WARNING, "no follower to ack offset %lu. tid %u pid %u", offset, tid_, pid_);
+        return false;
+    }
+    // wake up the replicate nodes at once
+    cv_.notify_all();
+    while (follower_offset_.load(std::memory_order_relaxed) < offset) {
+        uint64_t now = ::baidu::common::timer::get_micros();
+        if (now >= deadline) {
+            g_follower_ack_fail_cnt << 1;
+            PDLOG(WARNING, "wait follower ack of offset %lu timeout, the follower offset is %lu. tid %u pid %u",
+                  offset, follower_offset_.load(std::memory_order_relaxed), tid_, pid_);
+            return false;
+        }
+        cv_.wait_for(lock, deadline - now);
+    }
+    return true;
+}
+
+bool LogReplicator::AppendEntryBatch(std::vector<LogEntry>* entries,
+                                     const std::vector<::openmldb::base::Slice>& values,
+                                     ::google::protobuf::Closure* done, size_t* written) {
+    if (written != nullptr) {
+        *written = 0;
+    }
+    if (entries->size() != values.size()) {
+        PDLOG(WARNING, "the count of entries %lu mismatches the count of values %lu. tid %u pid %u", entries->size(),
+              values.size(), tid_, pid_);
+        return false;
+    }
+    PendingEntry pending = {entries->data(), values.data(), entries->size(), done, false, 0, false};
+    Commit(&pending);
+    if (written != nullptr) {
+        *written = pending.written;
+    }
+    if (!pending.ok) {
+        return false;
+    }
+    return entries->empty() || WaitFollowerAck(entries->back().log_index());
+}
+
+size_t LogReplicator::WriteEntries(LogEntry* entries, const ::openmldb::base::Slice* values, size_t count) {
+    using ::google::protobuf::internal::WireFormatLite;
+    if (count == 0) {
+        return 0;
+    }
     if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
         bool ok = RollWLogFile();
         if (!ok) {
-            return false;
+            return 0;
         }
     }
     uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
-    entry.set_log_index(1 + cur_offset);
-    std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer);
-    ::openmldb::log::Status status = wh_->Write(slice);
-    if (!status.ok()) {
-        PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
-        return false;
+    uint64_t mark = wh_->GetSize();
+    std::vector<std::string> buffers(count);
+    size_t written = 0;
+    for (; written < count; written++) {
+        LogEntry& entry = entries[written];
+        const ::openmldb::base::Slice& value = values[written];
+        std::string& buffer = buffers[written];
+        entry.set_log_index(cur_offset + written + 1);
+        if (value.empty()) {
+            entry.SerializeToString(&buffer);
+        } else {
+            // the fields can be in any order, so the value is appended after the others
+            buffer.reserve(entry.ByteSizeLong() + value.size() + 16);
+            {
+                ::google::protobuf::io::StringOutputStream output(&buffer);
+                ::google::protobuf::io::CodedOutputStream coded(&output);
+                entry.SerializeWithCachedSizes(&coded);
+                coded.WriteTag(WireFormatLite::MakeTag(LogEntry::kValueFieldNumber,
+                                                       WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+                coded.WriteVarint32(value.size());
+                coded.WriteRaw(value.data(), value.size());
+            }
+        }
+        ::openmldb::log::Status status = wh_->Write(::openmldb::base::Slice(buffer), false);
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(),
+                  status.ToString().c_str());
+            break;
+        }
     }
-    log_offset_.fetch_add(1, std::memory_order_relaxed);
-    if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
-                                     // sync to remote replica
-        follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+    if (written < count) {
+        ::openmldb::log::Status status = wh_->Truncate(mark);
+        if (status.ok()) {
+            written = 0;
+        } else {
+            // the log index of the entries left can't be reused, so they are kept as written
+            PDLOG(ERROR, "fail to truncate replication log in dir %s to %lu for %s, %lu of %lu entries are left",
+                  path_.c_str(), mark, status.ToString().c_str(), written, count);
+        }
     }
-    if (done) {
-        done->Run();
+    // the entries are cached before the offset is visible to the replicate nodes
+    if (log_cache_ && has_node_.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < written; i++) {
+            log_cache_->Append(cur_offset + i + 1, std::move(buffers[i]));
+        }
     }
-    return true;
+    log_offset_.fetch_add(written, std::memory_order_relaxed);
+    if (written > 0 && local_endpoints_.empty()) {  // if local replica are dead, leader direct
+                                                    // sync to remote replica. it is not an ack, see WaitFollowerAck
+        follower_offset_.store(cur_offset + written, std::memory_order_relaxed);
+    }
+    return written;
 }
 
 bool LogReplicator::RollWLogFile() {
     if (wh_ != NULL) {
         wh_->EndLog();
+        if (durability_ == ::openmldb::api::BinlogDurability::kBinlogFsync) {
+            wh_->Sync();
+        }
         delete wh_;
         wh_ = NULL;
     }
@@ -481,7 +669,13 @@ bool LogReplicator::RollWLogFile() {
     logs_->Insert(binlog_index_.load(std::memory_order_relaxed), offset);
     binlog_index_.fetch_add(1, std::memory_order_relaxed);
     PDLOG(INFO, "roll write log for name %s and start offset %lld. tid %u pid %u", name.c_str(), offset, tid_, pid_);
-    wh_ = new WriteHandle("off", name, fd);
+    if (FLAGS_binlog_preallocate_size_mb > 0 || FLAGS_binlog_sync_range_size_kb > 0) {
+        wh_ = new WriteHandle("off", ::openmldb::log::NewPreallocWritableFile(
+                                         name, fd, FLAGS_binlog_preallocate_size_mb * 1024ul * 1024,
+                                         FLAGS_binlog_sync_range_size_kb * 1024ul));
+    } else {
+        wh_ = new WriteHandle("off", name, fd);
+    }
     return true;
 }
 
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "base/skiplist.h"
+#include "base/slice.h"
 #include "bthread/bthread.h"
 #include "bthread/condition_variable.h"
 #include "common/thread_pool.h"
@@ -33,6 +34,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/log_cache.h"
 #include "replica/replicate_node.h"
 #include "storage/table.h"
 
@@ -66,6 +68,23 @@ class LogReplicator {
     // the master node append entry
     bool AppendEntry(::openmldb::api::LogEntry& entry, ::google::protobuf::Closure* done = nullptr);  // NOLINT
 
+    // the value is serialized into the log from the buffer of caller, so it is not copied into the entry.
+    // the value of entry must not be set.
+    // the concurrent callers are committed as a group, one of them writes the entries queued so far,
+    // makes them durable and runs their done in the log order. it returns after the entry is durable
+    // as the durability of replicator requires. if false is returned, written tells whether the entry
+    // is in the binlog anyway, i.e. it is only the durability that is not confirmed
+    bool AppendEntry(::openmldb::api::LogEntry& entry, const ::openmldb::base::Slice& value,  // NOLINT
+                     ::google::protobuf::Closure* done, bool* written = nullptr);
+
+    // append the entries of a batch, it is committed in the group like AppendEntry. values[i] is the value
+    // of entries[i], done runs after all of them are written. the batch is written as a whole, the entries
+    // written are truncated from the binlog if any of them fails. written is the count of the entries in
+    // the binlog if false is returned, it's the prefix left if the truncation fails too
+    bool AppendEntryBatch(std::vector<::openmldb::api::LogEntry>* entries,
+                          const std::vector<::openmldb::base::Slice>& values, ::google::protobuf::Closure* done,
+                          size_t* written = nullptr);
+
     //  data to slave nodes
     void Notify();
     // recover logs meta
@@ -110,9 +129,40 @@ class LogReplicator {
 
     const std::string& GetLogPath() {return log_path_;}
 
+    void SetDurability(::openmldb::api::BinlogDurability durability) { durability_ = durability; }
+
+    ::openmldb::api::BinlogDurability GetDurability() const { return durability_; }
+
  private:
     bool OpenSeqFile(const std::string& path, SequentialFile** sf);
 
+    // the entries of an append waiting for group commit
+    struct PendingEntry {
+        ::openmldb::api::LogEntry* entries;
+        const ::openmldb::base::Slice* values;
+        size_t count;
+        ::google::protobuf::Closure* done;
+        bool finished;
+        size_t written;
+        bool ok;
+    };
+
+    // queue the entries, commit the group with them if no group is being committed
+    void Commit(PendingEntry* pending);
+
+    void CommitGroup(const std::vector<PendingEntry*>& group);
+
+    // write the entries to binlog with wmu_ held, the values are appended if they are not empty. the entries
+    // written are truncated if any of them fails, it returns the count of entries left in the binlog
+    size_t WriteEntries(::openmldb::api::LogEntry* entries, const ::openmldb::base::Slice* values, size_t count);
+
+    // flush the entries written with wmu_ held, they are synced to disk if the durability requires
+    bool SyncEntries();
+
+    // wait until a follower has the entries up to offset if the durability requires. it fails at once
+    // if there is no follower in the same cluster, as follower_offset_ is advanced by the leader then
+    bool WaitFollowerAck(uint64_t offset);
+
  private:
     // the replicator root data path
     uint32_t tid_;
@@ -129,6 +179,9 @@ class LogReplicator {
     std::map<std::string, std::string> real_ep_map_;
     std::vector<std::shared_ptr<ReplicateNode> > nodes_;
     std::vector<std::string> local_endpoints_;
+    // the entries appended recently, they are cached only when there are replicate nodes
+    std::unique_ptr<LogCache> log_cache_;
+    std::atomic<bool> has_node_;
 
     std::atomic<uint64_t> term_;
     // sync mutex
@@ -139,6 +192,13 @@ class LogReplicator {
     std::atomic<uint64_t> snapshot_last_offset_;
 
     std::mutex wmu_;
+
+    ::openmldb::api::BinlogDurability durability_;
+    // the queue of group commit
+    bthread::Mutex gmu_;
+    bthread::ConditionVariable gcv_;
+    std::vector<PendingEntry*> pending_;
+    bool committing_;
 };
 
 }  // namespace replica
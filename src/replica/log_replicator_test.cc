@@ -24,8 +24,12 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "base/glog_wrapper.h"
 #include "base/status.h"
@@ -48,6 +52,8 @@ using ::openmldb::storage::TableIterator;
 using ::openmldb::storage::Ticket;
 
 DECLARE_int32(binlog_single_file_max_size);
+DECLARE_int32(binlog_sync_window_size);
+DECLARE_uint32(binlog_cache_size_mb);
 
 namespace openmldb {
 namespace replica {
@@ -86,6 +92,12 @@ class MockTabletImpl : public ::openmldb::api::TabletServer {
     void AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
                        ::openmldb::api::AppendEntriesResponse* response, Closure* done) {
         uint64_t last_log_offset = replicator_.GetOffset();
+        if (request->pre_log_index() > last_log_offset) {
+            response->set_code(::openmldb::base::ReturnCode::kPreLogIndexMismatch);
+            response->set_log_offset(last_log_offset);
+            done->Run();
+            return;
+        }
         for (int32_t i = 0; i < request->entries_size(); i++) {
             if (request->entries(i).log_index() <= last_log_offset) {
                 continue;
@@ -150,6 +162,62 @@ TEST_F(LogReplicatorTest, BenchMark) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(LogReplicatorTest, AppendEntryWithValue) {
+    std::map<std::string, std::string> map;
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / GenRand();
+    absl::Cleanup clean = [&folder]() { std::filesystem::remove_all(folder); };
+    LogReplicator replicator(1, 1, folder, map, kLeaderNode);
+    ASSERT_TRUE(replicator.Init());
+    int num = 1000;
+    std::vector<std::string> values = {std::string(1024, 'a'), std::string(10240, 'b')};
+    for (const auto& value : values) {
+        // the value copied into the entry
+        for (int i = 0; i < num; i++) {
+            ::openmldb::api::LogEntry entry;
+            entry.set_term(1);
+            entry.set_pk("key" + std::to_string(i));
+            entry.set_value(value);
+            entry.set_ts(9527);
+            ASSERT_TRUE(replicator.AppendEntry(entry));
+        }
+        // the value serialized from the buffer of caller
+        for (int i = 0; i < num; i++) {
+            ::openmldb::api::LogEntry entry;
+            entry.set_term(1);
+            entry.set_pk("key" + std::to_string(i));
+            entry.set_ts(9527);
+            ASSERT_TRUE(replicator.AppendEntry(entry, ::openmldb::base::Slice(value), nullptr));
+        }
+    }
+    LogReader reader(replicator.GetLogPart(), replicator.GetLogPath(), false);
+    ASSERT_TRUE(reader.SetOffset(0));
+    ::openmldb::api::LogEntry entry;
+    std::string buffer;
+    ::openmldb::base::Slice record;
+    int last_log_index = reader.GetLogIndex();
+    int cnt = 0;
+    // the reader waits at the end of the binlog being written, so it stops at the count
+    while (cnt < num * 4) {
+        buffer.clear();
+        ::openmldb::log::Status status = reader.ReadNextRecord(&record, &buffer);
+        if (status.IsEof()) {
+            if (reader.GetLogIndex() != last_log_index) {
+                last_log_index = reader.GetLogIndex();
+                continue;
+            }
+            break;
+        }
+        ASSERT_TRUE(status.ok()) << cnt << ": " << status.ToString();
+        ASSERT_TRUE(entry.ParseFromString(record.ToString()));
+        ASSERT_EQ(static_cast<uint64_t>(cnt + 1), entry.log_index());
+        ASSERT_EQ("key" + std::to_string(cnt % num), entry.pk());
+        ASSERT_EQ(9527u, entry.ts());
+        ASSERT_EQ(values[cnt / (num * 2)], entry.value());
+        cnt++;
+    }
+    ASSERT_EQ(num * 4, cnt);
+}
+
 TEST_F(LogReplicatorTest, LogReader) {
     // set to 1 MB, every binlog file will be a little larger than 2 MB
     // as the checking logic is: (wh_->GetSize() / (1024 * 1024)) > (uint32_t)FLAGS_binlog_single_file_max_size
@@ -731,6 +799,273 @@ TEST_F(LogReplicatorTest, Leader_Remove_local_follower) {
     }
 }
 
+void SyncPerf(int32_t window_size, uint32_t cache_size_mb, const std::string& follower_addr) {
+    FLAGS_binlog_sync_window_size = window_size;
+    FLAGS_binlog_cache_size_mb = cache_size_mb;
+    absl::Cleanup reset = []() {
+        FLAGS_binlog_sync_window_size = 1;
+        FLAGS_binlog_cache_size_mb = 4;
+    };
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    std::filesystem::path follower_folder = std::filesystem::temp_directory_path() / GenRand();
+    std::filesystem::path leader_folder = std::filesystem::temp_directory_path() / GenRand();
+    absl::Cleanup clean = [&follower_folder, &leader_folder]() {
+        std::filesystem::remove_all(follower_folder);
+        std::filesystem::remove_all(leader_folder);
+    };
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, table);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start(follower_addr.c_str(), &options));
+    LogReplicator leader(1, 1, leader_folder, g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair(follower_addr, ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    const uint64_t cnt = 20000;
+    std::string value(512, 'a');
+    uint64_t max_lag = 0;
+    uint64_t start = ::baidu::common::timer::get_micros();
+    for (uint64_t i = 0; i < cnt; i++) {
+        ::openmldb::api::LogEntry entry;
+        ::openmldb::test::AddDimension(0, "key" + std::to_string(i % 100), &entry);
+        entry.set_value(::openmldb::test::EncodeKV("key", value));
+        entry.set_ts(i + 1);
+        ASSERT_TRUE(leader.AppendEntry(entry));
+        if (i % 64 == 0) {
+            leader.Notify();
+            std::map<std::string, uint64_t> info;
+            leader.GetReplicateInfo(info);
+            max_lag = std::max(max_lag, i + 1 - info[follower_addr]);
+        }
+    }
+    leader.Notify();
+    uint64_t append_time = ::baidu::common::timer::get_micros() - start;
+    uint64_t synced = 0;
+    for (int retry = 0; retry < 3000 && synced < cnt; retry++) {
+        std::map<std::string, uint64_t> info;
+        leader.GetReplicateInfo(info);
+        synced = info[follower_addr];
+        if (synced < cnt) {
+            usleep(10000);
+        }
+    }
+    uint64_t sync_time = ::baidu::common::timer::get_micros() - start;
+    leader.DelAllReplicateNode();
+    server.Stop(1000);
+    server.Join();
+    ASSERT_EQ(cnt, synced);
+    ASSERT_EQ(cnt, table->GetRecordCnt());
+    printf("window %d cache %u MB: append %lu us, synced %lu us, %lu entries/s, max lag %lu entries\n", window_size,
+           cache_size_mb, append_time, sync_time, cnt * 1000000 / sync_time, max_lag);
+}
+
+class RecordIndexClosure : public ::google::protobuf::Closure {
+ public:
+    RecordIndexClosure(const ::openmldb::api::LogEntry* entry, std::vector<uint64_t>* indexes)
+        : entry_(entry), indexes_(indexes) {}
+    void Run() override { indexes_->push_back(entry_->log_index()); }
+
+ private:
+    const ::openmldb::api::LogEntry* entry_;
+    std::vector<uint64_t>* indexes_;
+};
+
+TEST_F(LogReplicatorTest, GroupCommit) {
+    std::map<std::string, std::string> map;
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / GenRand();
+    absl::Cleanup clean = [&folder]() { std::filesystem::remove_all(folder); };
+    LogReplicator replicator(1, 1, folder, map, kLeaderNode);
+    ASSERT_TRUE(replicator.Init());
+    replicator.SetDurability(::openmldb::api::BinlogDurability::kBinlogFsync);
+    // the done of a group are run by the committing thread one by one
+    std::vector<uint64_t> indexes;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> fail_cnt(0);
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&replicator, &indexes, &fail_cnt, i] {
+            for (int j = 0; j < 500; j++) {
+                ::openmldb::api::LogEntry entry;
+                ::openmldb::test::AddDimension(0, "key" + std::to_string(i), &entry);
+                entry.set_ts(j + 1);
+                std::string value = ::openmldb::test::EncodeKV("key", std::to_string(j));
+                RecordIndexClosure closure(&entry, &indexes);
+                if (!replicator.AppendEntry(entry, ::openmldb::base::Slice(value), &closure)) {
+                    fail_cnt.fetch_add(1);
+                }
+            }
+        });
+    }
+    // the batches are committed in the same groups, the entries of a batch are contiguous in the log
+    std::atomic<uint32_t> split_cnt(0);
+    threads.emplace_back([&replicator, &indexes, &fail_cnt, &split_cnt] {
+        for (int j = 0; j < 100; j++) {
+            std::vector<::openmldb::api::LogEntry> entries(5);
+            std::vector<std::string> values;
+            for (auto& entry : entries) {
+                ::openmldb::test::AddDimension(0, "batch", &entry);
+                entry.set_ts(j + 1);
+                values.push_back(::openmldb::test::EncodeKV("batch", std::to_string(j)));
+            }
+            std::vector<::openmldb::base::Slice> slices(values.begin(), values.end());
+            RecordIndexClosure closure(&entries.back(), &indexes);
+            if (!replicator.AppendEntryBatch(&entries, slices, &closure)) {
+                fail_cnt.fetch_add(1);
+            }
+            if (entries.back().log_index() != entries.front().log_index() + 4) {
+                split_cnt.fetch_add(1);
+            }
+        }
+    });
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(0u, fail_cnt.load());
+    ASSERT_EQ(0u, split_cnt.load());
+    ASSERT_EQ(4500u, replicator.GetOffset());
+    ASSERT_EQ(4100u, indexes.size());
+    for (uint64_t i = 1; i < indexes.size(); i++) {
+        ASSERT_LT(indexes[i - 1], indexes[i]);
+    }
+    // all entries are in binlog
+    LogReader reader(replicator.GetLogPart(), replicator.GetLogPath(), false);
+    ASSERT_TRUE(reader.SetOffset(0));
+    int last_log_index = reader.GetLogIndex();
+    uint64_t cnt = 0;
+    while (cnt < 4500) {
+        std::string buffer;
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = reader.ReadNextRecord(&record, &buffer);
+        if (status.IsEof()) {
+            if (reader.GetLogIndex() != last_log_index) {
+                last_log_index = reader.GetLogIndex();
+                continue;
+            }
+            break;
+        }
+        ASSERT_TRUE(status.ok()) << cnt << ": " << status.ToString();
+        ::openmldb::api::LogEntry entry;
+        ASSERT_TRUE(entry.ParseFromString(record.ToString()));
+        ASSERT_EQ(++cnt, entry.log_index());
+    }
+    ASSERT_EQ(4500u, cnt);
+}
+
+TEST_F(LogReplicatorTest, FollowerAckWithoutFollower) {
+    std::map<std::string, std::string> map;
+    std::filesystem::path folder = std::filesystem::temp_directory_path() / GenRand();
+    absl::Cleanup clean = [&folder]() { std::filesystem::remove_all(folder); };
+    LogReplicator replicator(1, 1, folder, map, kLeaderNode);
+    ASSERT_TRUE(replicator.Init());
+    replicator.SetDurability(::openmldb::api::BinlogDurability::kBinlogFollowerAck);
+    // no follower acks the entry, but it is in binlog
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::test::AddDimension(0, "key", &entry);
+    entry.set_ts(1);
+    std::string value = ::openmldb::test::EncodeKV("key", "value");
+    bool written = false;
+    ASSERT_FALSE(replicator.AppendEntry(entry, ::openmldb::base::Slice(value), nullptr, &written));
+    ASSERT_TRUE(written);
+    ASSERT_EQ(1u, replicator.GetOffset());
+    std::vector<::openmldb::api::LogEntry> entries(2);
+    std::vector<::openmldb::base::Slice> values(2, ::openmldb::base::Slice(value));
+    for (auto& e : entries) {
+        ::openmldb::test::AddDimension(0, "key", &e);
+        e.set_ts(2);
+    }
+    size_t written_cnt = 0;
+    ASSERT_FALSE(replicator.AppendEntryBatch(&entries, values, nullptr, &written_cnt));
+    ASSERT_EQ(2u, written_cnt);
+    ASSERT_EQ(3u, replicator.GetOffset());
+    ASSERT_EQ(3u, entries.back().log_index());
+    // the durability of async is met once written
+    replicator.SetDurability(::openmldb::api::BinlogDurability::kBinlogAsync);
+    ::openmldb::api::LogEntry async_entry;
+    ::openmldb::test::AddDimension(0, "key", &async_entry);
+    async_entry.set_ts(3);
+    ASSERT_TRUE(replicator.AppendEntry(async_entry, ::openmldb::base::Slice(value), nullptr, &written));
+}
+
+void DurabilityPerf(::openmldb::api::BinlogDurability durability, const std::string& follower_addr) {
+    brpc::ServerOptions options;
+    brpc::Server server;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    std::filesystem::path follower_folder = std::filesystem::temp_directory_path() / GenRand();
+    std::filesystem::path leader_folder = std::filesystem::temp_directory_path() / GenRand();
+    absl::Cleanup clean = [&follower_folder, &leader_folder]() {
+        std::filesystem::remove_all(follower_folder);
+        std::filesystem::remove_all(leader_folder);
+    };
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, table);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server.Start(follower_addr.c_str(), &options));
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair(follower_addr, ""));
+    LogReplicator leader(1, 1, leader_folder, map, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    ASSERT_TRUE(leader.StartSyncing());
+    leader.SetDurability(durability);
+    const int thread_cnt = 8;
+    const int cnt = 1000;
+    std::atomic<uint64_t> total_latency(0);
+    std::vector<std::thread> threads;
+    uint64_t start = ::baidu::common::timer::get_micros();
+    for (int i = 0; i < thread_cnt; i++) {
+        threads.emplace_back([&leader, &total_latency, i] {
+            std::string value = ::openmldb::test::EncodeKV("key", std::string(256, 'a'));
+            for (int j = 0; j < cnt; j++) {
+                ::openmldb::api::LogEntry entry;
+                ::openmldb::test::AddDimension(0, "key" + std::to_string(i), &entry);
+                entry.set_ts(j + 1);
+                uint64_t begin = ::baidu::common::timer::get_micros();
+                leader.AppendEntry(entry, ::openmldb::base::Slice(value), nullptr);
+                leader.Notify();
+                total_latency.fetch_add(::baidu::common::timer::get_micros() - begin);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    uint64_t time = ::baidu::common::timer::get_micros() - start;
+    leader.DelAllReplicateNode();
+    server.Stop(1000);
+    server.Join();
+    ASSERT_EQ((uint64_t)thread_cnt * cnt, leader.GetOffset());
+    printf("durability %s: %lu entries/s, avg latency %lu us\n",
+           ::openmldb::api::BinlogDurability_Name(durability).c_str(), thread_cnt * cnt * 1000000ul / time,
+           total_latency.load() / (thread_cnt * cnt));
+}
+
+TEST_F(LogReplicatorTest, DISABLED_DurabilityPerfAsync) {
+    DurabilityPerf(::openmldb::api::BinlogDurability::kBinlogAsync, "127.0.0.1:18641");
+}
+
+TEST_F(LogReplicatorTest, DISABLED_DurabilityPerfFsync) {
+    DurabilityPerf(::openmldb::api::BinlogDurability::kBinlogFsync, "127.0.0.1:18642");
+}
+
+TEST_F(LogReplicatorTest, DISABLED_DurabilityPerfFollowerAck) {
+    DurabilityPerf(::openmldb::api::BinlogDurability::kBinlogFollowerAck, "127.0.0.1:18643");
+}
+
+TEST_F(LogReplicatorTest, DISABLED_SyncPerfFile) { SyncPerf(1, 0, "127.0.0.1:18631"); }
+
+TEST_F(LogReplicatorTest, DISABLED_SyncPerfCache) { SyncPerf(1, 4, "127.0.0.1:18632"); }
+
+TEST_F(LogReplicatorTest, DISABLED_SyncPerfPipeline) { SyncPerf(4, 4, "127.0.0.1:18633"); }
+
 }  // namespace replica
 }  // namespace openmldb
 
@@ -19,11 +19,15 @@
 #include <gflags/gflags.h>
 
 #include <algorithm>
+#include <utility>
 
 #include "base/glog_wrapper.h"
+#include "base/status.h"
 #include "base/strings.h"
+#include "brpc/controller.h"
 
 DECLARE_int32(binlog_sync_batch_size);
+DECLARE_int32(binlog_sync_window_size);
 DECLARE_int32(binlog_sync_wait_time);
 DECLARE_int32(binlog_coffee_time);
 DECLARE_int32(binlog_match_logoffset_interval);
@@ -49,9 +53,16 @@ static void* RunSyncTask(void* args) {
 ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid,
                              uint32_t pid, std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset,
                              bthread::Mutex* mu, bthread::ConditionVariable* cv, bool rep_follower,
-                             std::atomic<uint64_t>* follower_offset, const std::string& real_point)
-    : log_reader_(logs, log_path, false),
+                             std::atomic<uint64_t>* follower_offset, const std::string& real_point,
+                             LogCache* log_cache)
+    : logs_(logs),
+      log_reader_(logs, log_path, false),
+      log_cache_(log_cache),
+      reader_stale_(false),
+      use_cache_(false),
       cache_(),
+      windows_(),
+      send_offset_(0),
       endpoint_(point),
       last_sync_offset_(0),
       log_matched_(false),
@@ -124,6 +135,7 @@ void ReplicateNode::SyncData() {
                           "replicate log to endpoint %s for table #tid %u #pid "
                           "%u exist",
                           endpoint_.c_str(), tid_, pid_);
+                    ClearWindows();
                     return;
                 }
             }
@@ -138,10 +150,24 @@ void ReplicateNode::SyncData() {
             coffee_time = FLAGS_binlog_coffee_time;
         }
     }
+    ClearWindows();
     PDLOG(INFO, "replicate log to endpoint %s for table #tid %u #pid %u exist", endpoint_.c_str(), tid_, pid_);
 }
 
-int ReplicateNode::GetLogIndex() { return log_reader_.GetLogIndex(); }
+int ReplicateNode::GetLogIndex() {
+    if (!use_cache_.load(std::memory_order_relaxed)) {
+        return log_reader_.GetLogIndex();
+    }
+    // the reader stays behind when the entries are shipped from the log cache, use the part of the synced offset
+    uint64_t offset = last_sync_offset_;
+    std::unique_ptr<LogParts::Iterator> it(logs_->NewIterator());
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        if (it->GetValue() <= offset) {
+            return it->GetKey();
+        }
+    }
+    return -1;
+}
 
 bool ReplicateNode::IsLogMatched() { return log_matched_; }
 
@@ -164,6 +190,8 @@ int ReplicateNode::MatchLogOffsetFromNode() {
         last_sync_offset_ = response.log_offset();
         log_matched_ = true;
         log_reader_.SetOffset(last_sync_offset_);
+        send_offset_ = last_sync_offset_;
+        reader_stale_ = false;
         PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), last_sync_offset_, tid_,
               pid_);
         return 0;
@@ -178,79 +206,93 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
         PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset_);
         return 1;
     }
-    ::openmldb::api::AppendEntriesRequest request;
-    ::openmldb::api::AppendEntriesResponse response;
-    uint64_t sync_log_offset = last_sync_offset_;
-    bool request_from_cache = false;
+    if (!cache_.empty()) {
+        return SyncCachedRequest();
+    }
     bool need_wait = false;
-    if (cache_.size() > 0) {
-        request_from_cache = true;
-        request = cache_[0];
-        if (request.entries_size() <= 0) {
-            cache_.clear();
-            PDLOG(WARNING, "empty append entry request from node %s cache", endpoint_.c_str());
-            return -1;
+    uint32_t window_size = std::max(FLAGS_binlog_sync_window_size, 1);
+    while (windows_.size() < window_size && send_offset_ < log_offset) {
+        auto request = std::make_shared<::openmldb::api::AppendEntriesRequest>();
+        uint64_t end_offset = send_offset_;
+        need_wait = BuildRequest(log_offset, request.get(), &end_offset);
+        if (request->entries_size() > 0) {
+            SendWindow(request, end_offset);
         }
-        const ::openmldb::api::LogEntry& entry = request.entries(request.entries_size() - 1);
-        if (entry.log_index() <= last_sync_offset_) {
-            DEBUGLOG("duplicate log index from node %s cache", endpoint_.c_str());
-            cache_.clear();
-            return -1;
+        if (need_wait) {
+            break;
         }
-        PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", entry.log_index(), tid_, pid_);
-        sync_log_offset = entry.log_index();
-    } else {
-        request.set_tid(tid_);
-        request.set_pid(pid_);
-        request.set_pre_log_index(last_sync_offset_);
-        if (!FLAGS_zk_cluster.empty()) {
-            request.set_term(term_->load(std::memory_order_relaxed));
+    }
+    if (!windows_.empty() && FinishWindow() != 0) {
+        need_wait = true;
+    }
+    if (need_wait) {
+        return 1;
+    }
+    return 0;
+}
+
+bool ReplicateNode::BuildRequest(uint64_t log_offset, ::openmldb::api::AppendEntriesRequest* request,
+                                 uint64_t* end_offset) {
+    request->set_tid(tid_);
+    request->set_pid(pid_);
+    request->set_pre_log_index(send_offset_);
+    if (!FLAGS_zk_cluster.empty()) {
+        request->set_term(term_->load(std::memory_order_relaxed));
+    }
+    uint64_t sync_log_offset = send_offset_;
+    uint32_t batchSize = std::min(log_offset - send_offset_, (uint64_t)FLAGS_binlog_sync_batch_size);
+    std::vector<std::shared_ptr<const std::string>> records;
+    if (log_cache_ != nullptr && log_cache_->Get(send_offset_ + 1, batchSize, &records)) {
+        bool ok = true;
+        for (const auto& record : records) {
+            ::openmldb::api::LogEntry* entry = request->add_entries();
+            if (!entry->ParseFromString(*record)) {
+                PDLOG(WARNING, "bad protobuf format in log cache. size %lu tid %u pid %u", record->size(), tid_, pid_);
+                ok = false;
+                break;
+            }
+            sync_log_offset = entry->log_index();
         }
-        uint32_t batchSize = log_offset - last_sync_offset_;
-        batchSize = std::min(batchSize, (uint32_t)FLAGS_binlog_sync_batch_size);
-        for (uint64_t i = 0; i < batchSize;) {
-            std::string buffer;
-            ::openmldb::base::Slice record;
-            ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
-            if (status.ok()) {
-                ::openmldb::api::LogEntry* entry = request.add_entries();
-                if (!entry->ParseFromString(record.ToString())) {
-                    PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
-                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_,
-                          pid_);
-                    request.mutable_entries()->RemoveLast();
-                    break;
-                }
-                DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
-                if (entry->log_index() <= sync_log_offset) {
-                    DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
-                    request.mutable_entries()->RemoveLast();
-                    continue;
-                }
-                // the log index should incr by 1
-                if ((sync_log_offset + 1) != entry->log_index()) {
-                    PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
-                          entry->log_index(), tid_, pid_);
-                    request.mutable_entries()->RemoveLast();
-                    if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
-                        log_reader_.GoBackToStart();
-                        go_back_cnt_ = 0;
-                        PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
-                    } else {
-                        log_reader_.GoBackToLastBlock();
-                        go_back_cnt_++;
-                    }
-                    need_wait = true;
-                    break;
-                }
-                sync_log_offset = entry->log_index();
-            } else if (status.IsWaitRecord()) {
-                DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
-                need_wait = true;
+        if (ok) {
+            use_cache_.store(true, std::memory_order_relaxed);
+            reader_stale_ = true;
+            *end_offset = sync_log_offset;
+            return false;
+        }
+        request->clear_entries();
+        sync_log_offset = send_offset_;
+    }
+    // the entries are not in the log cache any more, read them from the binlog file
+    if (reader_stale_) {
+        log_reader_.ResetOffset(send_offset_);
+        reader_stale_ = false;
+    }
+    use_cache_.store(false, std::memory_order_relaxed);
+    bool need_wait = false;
+    for (uint64_t i = 0; i < batchSize;) {
+        std::string buffer;
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry* entry = request->add_entries();
+            if (!entry->ParseFromString(record.ToString())) {
+                PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
+                      ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_,
+                      pid_);
+                request->mutable_entries()->RemoveLast();
                 break;
-            } else if (status.IsInvalidRecord()) {
-                DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
+            }
+            DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
+            if (entry->log_index() <= sync_log_offset) {
+                DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
+                request->mutable_entries()->RemoveLast();
+                continue;
+            }
+            // the log index should incr by 1
+            if ((sync_log_offset + 1) != entry->log_index()) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
+                      entry->log_index(), tid_, pid_);
+                request->mutable_entries()->RemoveLast();
                 if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
                     log_reader_.GoBackToStart();
                     go_back_cnt_ = 0;
@@ -259,41 +301,136 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
                     log_reader_.GoBackToLastBlock();
                     go_back_cnt_++;
                 }
-                break;
-            } else {
-                PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
                 need_wait = true;
                 break;
             }
-            i++;
-            go_back_cnt_ = 0;
-        }
-    }
-    if (request.entries_size() > 0) {
-        bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
-                                           FLAGS_request_timeout_ms, FLAGS_request_max_retry);
-        if (ret && response.code() == 0) {
-            DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
-            last_sync_offset_ = sync_log_offset;
-            if (!rep_node_.load(std::memory_order_relaxed) &&
-                (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
-                follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
-            }
-            if (request_from_cache) {
-                cache_.clear();
+            sync_log_offset = entry->log_index();
+        } else if (status.IsWaitRecord()) {
+            DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
+            need_wait = true;
+            break;
+        } else if (status.IsInvalidRecord()) {
+            DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            need_wait = true;
+            if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
+                log_reader_.GoBackToStart();
+                go_back_cnt_ = 0;
+                PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
+            } else {
+                log_reader_.GoBackToLastBlock();
+                go_back_cnt_++;
             }
+            break;
         } else {
-            if (!request_from_cache) {
-                cache_.push_back(request);
-            }
+            PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
             need_wait = true;
-            PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
+            break;
         }
+        i++;
+        go_back_cnt_ = 0;
     }
-    if (need_wait) {
+    *end_offset = sync_log_offset;
+    return need_wait;
+}
+
+void ReplicateNode::SendWindow(const std::shared_ptr<::openmldb::api::AppendEntriesRequest>& request,
+                               uint64_t end_offset) {
+    auto response = std::make_shared<::openmldb::api::AppendEntriesResponse>();
+    auto cntl = std::make_shared<brpc::Controller>();
+    cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+    cntl->set_max_retry(FLAGS_request_max_retry);
+    auto callback = new RpcCallback<::openmldb::api::AppendEntriesResponse>(response, cntl);
+    // one reference is released by the rpc and the other one by FinishWindow
+    callback->Ref();
+    rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, cntl.get(), request.get(),
+                            response.get(), callback);
+    windows_.push_back({request, callback, end_offset});
+    send_offset_ = end_offset;
+}
+
+int ReplicateNode::FinishWindow() {
+    SyncWindow window = windows_.front();
+    windows_.pop_front();
+    const std::shared_ptr<brpc::Controller>& cntl = window.callback->GetController();
+    brpc::Join(cntl->call_id());
+    const auto& response = window.callback->GetResponse();
+    if (!cntl->Failed() && response->code() == 0) {
+        DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), window.end_offset);
+        UpdateSyncOffset(window.end_offset);
+        window.callback->UnRef();
+        return 0;
+    }
+    // the follower rejects a request which arrives before the previous one, it is resent at once
+    bool out_of_order =
+        !cntl->Failed() && response->code() == ::openmldb::base::ReturnCode::kPreLogIndexMismatch;
+    if (!out_of_order) {
+        PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
+    }
+    cache_.push_back(std::move(*window.request));
+    window.callback->UnRef();
+    for (auto& later : windows_) {
+        brpc::Join(later.callback->GetController()->call_id());
+        cache_.push_back(std::move(*later.request));
+        later.callback->UnRef();
+    }
+    windows_.clear();
+    return out_of_order ? 0 : 1;
+}
+
+void ReplicateNode::ClearWindows() {
+    for (auto& window : windows_) {
+        brpc::Join(window.callback->GetController()->call_id());
+        window.callback->UnRef();
+    }
+    windows_.clear();
+}
+
+int ReplicateNode::SyncCachedRequest() {
+    const ::openmldb::api::AppendEntriesRequest& request = cache_.front();
+    if (request.entries_size() <= 0) {
+        cache_.erase(cache_.begin());
+        PDLOG(WARNING, "empty append entry request from node %s cache", endpoint_.c_str());
+        return -1;
+    }
+    uint64_t sync_log_offset = request.entries(request.entries_size() - 1).log_index();
+    if (sync_log_offset <= last_sync_offset_) {
+        DEBUGLOG("duplicate log index from node %s cache", endpoint_.c_str());
+        cache_.erase(cache_.begin());
+        return -1;
+    }
+    PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", sync_log_offset, tid_, pid_);
+    ::openmldb::api::AppendEntriesResponse response;
+    bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
+                                       FLAGS_request_timeout_ms, FLAGS_request_max_retry);
+    if (ret && response.code() == 0) {
+        DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
+        UpdateSyncOffset(sync_log_offset);
+        cache_.erase(cache_.begin());
+        return 0;
+    }
+    if (ret && response.code() == ::openmldb::base::ReturnCode::kPreLogIndexMismatch) {
+        // the previous requests are done, so the follower is behind the synced offset. restart from its offset
+        PDLOG(WARNING, "node %s log offset %lu is behind the synced offset %lu, sync from it. tid %u pid %u",
+              endpoint_.c_str(), response.log_offset(), last_sync_offset_, tid_, pid_);
+        cache_.clear();
+        last_sync_offset_ = response.log_offset();
+        send_offset_ = last_sync_offset_;
+        reader_stale_ = true;
         return 1;
     }
-    return 0;
+    PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
+    return 1;
+}
+
+void ReplicateNode::UpdateSyncOffset(uint64_t offset) {
+    last_sync_offset_ = offset;
+    if (!rep_node_.load(std::memory_order_relaxed) &&
+        (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
+        // wake up the puts waiting for the follower ack
+        std::lock_guard<bthread::Mutex> lock(*mu_);
+        follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
+        cv_->notify_all();
+    }
 }
 
 void ReplicateNode::Stop() {
@@ -18,6 +18,8 @@
 #define SRC_REPLICA_REPLICATE_NODE_H_
 
 #include <atomic>
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,6 +30,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/log_cache.h"
 #include "rpc/rpc_client.h"
 
 namespace openmldb {
@@ -41,7 +44,7 @@ class ReplicateNode {
     ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid, uint32_t pid,
                   std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset, bthread::Mutex* mu,
                   bthread::ConditionVariable* cv, bool rep_follower, std::atomic<uint64_t>* follower_offset,
-                  const std::string& real_point);
+                  const std::string& real_point, LogCache* log_cache = nullptr);
     int Init();
 
     int Start();
@@ -51,6 +54,8 @@ class ReplicateNode {
     // sync data to follower node
     void SyncData();
 
+    // send the entries up to log_offset, at most FLAGS_binlog_sync_window_size requests are in flight.
+    // return 1 if it has to wait for a while
     int SyncData(uint64_t log_offset);
 
     void SetLastSyncOffset(uint64_t offset);
@@ -72,9 +77,45 @@ class ReplicateNode {
  private:
     int MatchLogOffsetFromNode();
 
+    // fill the entries after send_offset_ into request from the log cache or the binlog file,
+    // return true if it has to wait for the log
+    bool BuildRequest(uint64_t log_offset, ::openmldb::api::AppendEntriesRequest* request,
+                      uint64_t* end_offset);
+
+    void SendWindow(const std::shared_ptr<::openmldb::api::AppendEntriesRequest>& request, uint64_t end_offset);
+
+    // wait the oldest window. the failed one and the later ones are moved to cache_ to be resent in order.
+    // return 1 if it has to wait for a while
+    int FinishWindow();
+
+    // wait and drop all windows in flight
+    void ClearWindows();
+
+    // resend the first request in cache_
+    int SyncCachedRequest();
+
+    void UpdateSyncOffset(uint64_t offset);
+
  private:
+    // an AppendEntries request in flight
+    struct SyncWindow {
+        std::shared_ptr<::openmldb::api::AppendEntriesRequest> request;
+        RpcCallback<::openmldb::api::AppendEntriesResponse>* callback;
+        uint64_t end_offset;
+    };
+
+    LogParts* logs_;
     LogReader log_reader_;
+    // the entries are read from it before the binlog file, it is owned by the replicator
+    LogCache* log_cache_;
+    // the reader is behind send_offset_ after the entries are shipped from the log cache
+    bool reader_stale_;
+    std::atomic<bool> use_cache_;
+    // the requests failed to send, they are resent in order before the new entries
     std::vector<::openmldb::api::AppendEntriesRequest> cache_;
+    std::deque<SyncWindow> windows_;
+    // the last log index sent, including the windows in flight and the requests in cache_
+    uint64_t send_offset_;
     std::string endpoint_;
     uint64_t last_sync_offset_;
     bool log_matched_;
@@ -50,6 +50,7 @@ const char* DEFAULT_YAML_PATH = "/cases/benchmark/batch_request_benchmark.yaml";
 
 DEFINE_BATCH_REQUEST_CASE(TwoWindow, DEFAULT_YAML_PATH, "0");
 DEFINE_BATCH_REQUEST_CASE(CommonWindow, DEFAULT_YAML_PATH, "1");
+DEFINE_BATCH_REQUEST_CASE(KeyLocality, DEFAULT_YAML_PATH, "4");
 
 int main(int argc, char** argv) {
     ::google::ParseCommandLineFlags(&argc, &argv, true);
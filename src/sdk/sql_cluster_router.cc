@@ -58,6 +58,8 @@
 
 DECLARE_string(bucket_size);
 DECLARE_uint32(replica_num);
+DECLARE_bool(insert_use_put_batch);
+DECLARE_uint32(put_batch_max_row_num);
 
 namespace openmldb {
 namespace sdk {
@@ -1364,6 +1366,58 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
     return true;
 }
 
+bool SQLClusterRouter::PutRows(uint32_t tid, const std::shared_ptr<SQLInsertRows>& rows,
+                               const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                               ::hybridse::sdk::Status* status) {
+    RET_FALSE_IF_NULL_AND_WARN(status, "output status is nullptr");
+    // the rows of a partition are put in one request
+    std::map<uint32_t, std::vector<::openmldb::client::TabletClient::PutBatchRow>> pid_rows;
+    for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
+        std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
+        for (const auto& kv : row->GetDimensions()) {
+            pid_rows[kv.first].emplace_back(&row->GetRow(), &kv.second);
+        }
+    }
+    uint64_t cur_ts = ::baidu::common::timer::get_micros() / 1000;
+    for (const auto& kv : pid_rows) {
+        uint32_t pid = kv.first;
+        std::shared_ptr<::openmldb::client::TabletClient> client;
+        if (pid < tablets.size() && tablets[pid]) {
+            client = tablets[pid]->GetClient();
+        }
+        if (!client) {
+            SET_STATUS_AND_WARN(status, StatusCode::kCmdError, "fail to get tablet client. pid " + std::to_string(pid));
+            return false;
+        }
+        DLOG(INFO) << "put batch to endpoint " << client->GetEndpoint() << " with row size " << kv.second.size();
+        const auto& pid_row = kv.second;
+        size_t max_row_num = std::max<uint32_t>(FLAGS_put_batch_max_row_num, 1);
+        bool unsupported = false;
+        for (size_t pos = 0; pos < pid_row.size() && !unsupported; pos += max_row_num) {
+            std::vector<::openmldb::client::TabletClient::PutBatchRow> chunk(
+                pid_row.begin() + pos, pid_row.begin() + std::min(pid_row.size(), pos + max_row_num));
+            if (client->PutBatch(tid, pid, cur_ts, chunk, &unsupported)) {
+                continue;
+            }
+            if (!unsupported) {
+                SET_STATUS_AND_WARN(status, StatusCode::kCmdError,
+                                    "fail to make a put batch request to table. tid " + std::to_string(tid));
+                return false;
+            }
+            // the tablet is older than put batch, put the rest rows one by one
+            LOG(WARNING) << "put batch is not supported by " << client->GetEndpoint() << ", put the rows one by one";
+            for (size_t i = pos; i < pid_row.size(); i++) {
+                if (!client->Put(tid, pid, cur_ts, *pid_row[i].first, *pid_row[i].second)) {
+                    SET_STATUS_AND_WARN(status, StatusCode::kCmdError,
+                                        "fail to make a put request to table. tid " + std::to_string(tid));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
                                      hybridse::sdk::Status* status) {
     RET_FALSE_IF_NULL_AND_WARN(status, "output status is nullptr");
@@ -1379,6 +1433,9 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             status->msg = "fail to get table " + cache->GetTableName() + " tablet";
             return false;
         }
+        if (FLAGS_insert_use_put_batch) {
+            return PutRows(cache->GetTableId(), rows, tablets, status);
+        }
         for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
             std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
             if (!PutRow(cache->GetTableId(), row, tablets, status)) {
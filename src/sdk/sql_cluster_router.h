@@ -262,6 +262,11 @@ class SQLClusterRouter : public SQLRouter {
 
     void GetTables(::hybridse::vm::PhysicalOpNode* node, std::set<std::string>* tables);
 
+    // put the rows with one request per chunk of partition, see insert_use_put_batch
+    bool PutRows(uint32_t tid, const std::shared_ptr<SQLInsertRows>& rows,
+                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                 ::hybridse::sdk::Status* status);
+
     bool PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>& row,
                 const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
                 ::hybridse::sdk::Status* status);
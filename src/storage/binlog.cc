@@ -16,7 +16,10 @@
 
 #include "storage/binlog.h"
 
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <map>
+#include <mutex>  // NOLINT
 #include <set>
 #include <utility>
 #include <vector>
@@ -24,18 +27,254 @@
 #include "base/glog_wrapper.h"
 #include "base/hash.h"
 #include "base/strings.h"
+#include "base/taskpool.hpp"
+#include "boost/bind.hpp"
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
 #include "log/log_writer.h"
 #include "log/status.h"
+#include "storage/mem_table.h"
 
 DECLARE_uint64(gc_on_table_recover_count);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(binlog_recover_thread_num);
 
 namespace openmldb {
 namespace storage {
 
+static const uint32_t RECOVER_CHUNK_SIZE = 1024;
+// the chunks queued by each apply worker
+static const uint32_t RECOVER_APPLY_QUEUE_SIZE = 4;
+
+// check the offset of an entry, return false if it has been replayed
+static bool CheckEntryOffset(uint32_t tid, uint32_t pid, uint64_t cur_offset,
+                             const ::openmldb::api::LogEntry& entry) {
+    if (cur_offset >= entry.log_index()) {
+        DEBUGLOG("offset %lu has been made snapshot", entry.log_index());
+        return false;
+    }
+    if (cur_offset + 1 != entry.log_index()) {
+        PDLOG(WARNING,
+              "missing log entry cur_offset %lu , new entry offset %lu for "
+              "tid %u, pid %u",
+              cur_offset, entry.log_index(), tid, pid);
+    }
+    return true;
+}
+
+static void CountEntry(Table* table, uint64_t cur_offset, uint64_t succ_cnt, uint64_t failed_cnt) {
+    table->SetRecoverProgress(cur_offset, succ_cnt);
+    if (succ_cnt % 100000 == 0) {
+        PDLOG(INFO,
+              "[Recover] load data from binlog succ_cnt %lu, failed_cnt "
+              "%lu for tid %u, pid %u",
+              succ_cnt, failed_cnt, table->GetId(), table->GetPid());
+    }
+    if (succ_cnt % FLAGS_gc_on_table_recover_count == 0) {
+        table->SchedGc();
+    }
+}
+
+// RecoverPipeline replays the binlog of a memory table in three stages. The records read by the caller are
+// grouped into chunks and decoded by a pool, then the chunks are dispatched in order: the offsets are
+// checked, the blocks are allocated and the puts and deletes go to the worker owning their segment. A
+// worker owns the segments at the same position of all indexes, so the entries of a key are applied in
+// the order of the binlog, while the entries of different segments are applied concurrently
+class RecoverPipeline {
+ public:
+    RecoverPipeline(Table* table, MemTable* mem_table, uint32_t thread_num, uint64_t offset)
+        : table_(table),
+          mem_table_(mem_table),
+          cur_offset_(offset),
+          succ_cnt_(0),
+          failed_cnt_(0),
+          max_decoding_(thread_num * 2),
+          decode_pool_(thread_num, thread_num * 2) {
+        for (uint32_t i = 0; i < thread_num; i++) {
+            apply_pools_.emplace_back(new ::openmldb::base::TaskPool(1, RECOVER_APPLY_QUEUE_SIZE));
+        }
+    }
+
+    RecoverPipeline(const RecoverPipeline&) = delete;
+    RecoverPipeline& operator=(const RecoverPipeline&) = delete;
+
+    void Add(const ::openmldb::base::Slice& record) {
+        if (!chunk_) {
+            chunk_ = std::make_shared<Chunk>();
+            chunk_->records.reserve(RECOVER_CHUNK_SIZE);
+        }
+        chunk_->records.emplace_back(record.data(), record.size());
+        if (chunk_->records.size() >= RECOVER_CHUNK_SIZE) {
+            Submit();
+        }
+    }
+
+    // wait for all the entries added to be applied
+    void Finish() {
+        if (chunk_) {
+            Submit();
+        }
+        DispatchDecoded(true);
+        decode_pool_.Stop();
+        for (auto& pool : apply_pools_) {
+            pool->Stop();
+        }
+    }
+
+    uint64_t GetOffset() const { return cur_offset_; }
+    uint64_t GetSuccCnt() const { return succ_cnt_; }
+    uint64_t GetFailedCnt() const { return failed_cnt_; }
+
+ private:
+    struct Item {
+        ::openmldb::api::LogEntry entry;
+        // the keys of the row refer to the dimensions of the entry, so items are never moved
+        MemTable::ParsedRow row;
+        DataBlock* block = nullptr;
+        bool ok = false;
+        bool row_ok = false;
+    };
+
+    struct Chunk {
+        std::vector<std::string> records;
+        std::vector<Item> items;
+        bool decoded = false;
+    };
+
+    // the put of an item to its segment at seg_pos, or the delete of the item if seg_pos is negative
+    struct Op {
+        uint32_t item;
+        int32_t seg_pos;
+    };
+
+    typedef std::vector<std::shared_ptr<std::vector<Op>>> WorkerOps;
+
+    void Submit() {
+        chunk_->items.resize(chunk_->records.size());
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            decoding_.push_back(chunk_);
+        }
+        decode_pool_.AddTask(boost::bind(&RecoverPipeline::Decode, this, chunk_));
+        chunk_.reset();
+        DispatchDecoded(false);
+    }
+
+    void Decode(std::shared_ptr<Chunk> chunk) {
+        for (uint32_t i = 0; i < chunk->records.size(); i++) {
+            Item& item = chunk->items[i];
+            item.ok = item.entry.ParseFromString(chunk->records[i]);
+            if (!item.ok) {
+                PDLOG(WARNING, "fail parse record for tid %u, pid %u with value %s", table_->GetId(),
+                      table_->GetPid(), ::openmldb::base::DebugString(chunk->records[i]).c_str());
+                continue;
+            }
+            const auto& entry = item.entry;
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                continue;
+            }
+            item.row_ok = mem_table_->ParseRow(entry.ts(), entry.value().data(), entry.value().size(),
+                                               entry.dimensions(), &item.row);
+        }
+        std::vector<std::string>().swap(chunk->records);
+        std::lock_guard<std::mutex> lock(mu_);
+        chunk->decoded = true;
+        cv_.notify_all();
+    }
+
+    // dispatch the decoded chunks in order, wait for the oldest one only if too many are in flight
+    void DispatchDecoded(bool wait_all) {
+        while (true) {
+            std::shared_ptr<Chunk> chunk;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                if (decoding_.empty()) {
+                    break;
+                }
+                if (!decoding_.front()->decoded) {
+                    if (!wait_all && decoding_.size() < max_decoding_) {
+                        break;
+                    }
+                    cv_.wait(lock, [this] { return decoding_.front()->decoded; });
+                }
+                chunk = decoding_.front();
+                decoding_.pop_front();
+            }
+            Dispatch(chunk);
+        }
+    }
+
+    void AddOp(WorkerOps* ops, uint32_t seg_idx, uint32_t item, int32_t seg_pos) {
+        auto& worker_ops = (*ops)[seg_idx % ops->size()];
+        if (!worker_ops) {
+            worker_ops = std::make_shared<std::vector<Op>>();
+        }
+        worker_ops->push_back({item, seg_pos});
+    }
+
+    void Dispatch(const std::shared_ptr<Chunk>& chunk) {
+        WorkerOps ops(apply_pools_.size());
+        for (uint32_t i = 0; i < chunk->items.size(); i++) {
+            Item& item = chunk->items[i];
+            if (!item.ok) {
+                failed_cnt_++;
+                continue;
+            }
+            const auto& entry = item.entry;
+            if (!CheckEntryOffset(table_->GetId(), table_->GetPid(), cur_offset_, entry)) {
+                continue;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                if (entry.dimensions_size() == 0) {
+                    PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", table_->GetId(), table_->GetPid(),
+                          entry.log_index());
+                } else {
+                    AddOp(&ops, mem_table_->GetSegIdx(entry.dimensions(0).key()), i, -1);
+                }
+            } else if (item.row_ok) {
+                item.block = mem_table_->NewDataBlock(item.row, entry.value().data(), entry.value().size());
+                for (uint32_t pos = 0; pos < item.row.segments.size(); pos++) {
+                    AddOp(&ops, item.row.seg_idxs[pos], i, pos);
+                }
+            }
+            cur_offset_ = entry.log_index();
+            succ_cnt_++;
+            CountEntry(table_, cur_offset_, succ_cnt_, failed_cnt_);
+        }
+        for (uint32_t i = 0; i < ops.size(); i++) {
+            if (ops[i]) {
+                apply_pools_[i]->AddTask(boost::bind(&RecoverPipeline::Apply, this, chunk, ops[i]));
+            }
+        }
+    }
+
+    void Apply(std::shared_ptr<Chunk> chunk, std::shared_ptr<std::vector<Op>> ops) {
+        for (const auto& op : *ops) {
+            const Item& item = chunk->items[op.item];
+            if (op.seg_pos < 0) {
+                table_->Delete(item.entry.dimensions(0).key(), item.entry.dimensions(0).idx());
+            } else {
+                mem_table_->PutSegment(item.row, op.seg_pos, item.block);
+            }
+        }
+    }
+
+    Table* table_;
+    MemTable* mem_table_;
+    uint64_t cur_offset_;
+    uint64_t succ_cnt_;
+    uint64_t failed_cnt_;
+    std::shared_ptr<Chunk> chunk_;
+    uint32_t max_decoding_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    // the chunks submitted to decode in the order of the binlog
+    std::deque<std::shared_ptr<Chunk>> decoding_;
+    ::openmldb::base::TaskPool decode_pool_;
+    std::vector<std::unique_ptr<::openmldb::base::TaskPool>> apply_pools_;
+};
+
 Binlog::Binlog(LogParts* log_part, const std::string& binlog_path) : log_part_(log_part), log_path_(binlog_path) {}
 
 bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, uint64_t& latest_offset) {
@@ -52,6 +291,12 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
     uint64_t consumed = ::baidu::common::timer::now_time();
     int last_log_index = log_reader.GetLogIndex();
     bool reach_end_log = true;
+    std::unique_ptr<RecoverPipeline> pipeline;
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    if (mem_table != nullptr && FLAGS_binlog_recover_thread_num > 1) {
+        pipeline.reset(new RecoverPipeline(table.get(), mem_table, FLAGS_binlog_recover_thread_num, offset));
+    }
+    table->SetRecoverProgress(offset, 0);
     while (true) {
         buffer.clear();
         ::openmldb::base::Slice record;
@@ -67,11 +312,6 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
                       tid, pid, cur_log_index, end_log_index, cur_offset);
                 continue;
             }
-            consumed = ::baidu::common::timer::now_time() - consumed;
-            PDLOG(INFO,
-                  "table tid %u pid %u completed, succ_cnt %lu, failed_cnt "
-                  "%lu, consumed %us",
-                  tid, pid, succ_cnt, failed_cnt, consumed);
             reach_end_log = false;
             break;
         }
@@ -87,6 +327,10 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             failed_cnt++;
             continue;
         }
+        if (pipeline) {
+            pipeline->Add(record);
+            continue;
+        }
         bool ok = entry.ParseFromString(record.ToString());
         if (!ok) {
             PDLOG(WARNING, "fail parse record for tid %u, pid %u with value %s", tid, pid,
@@ -95,18 +339,10 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             continue;
         }
 
-        if (cur_offset >= entry.log_index()) {
-            DEBUGLOG("offset %lu has been made snapshot", entry.log_index());
+        if (!CheckEntryOffset(tid, pid, cur_offset, entry)) {
             continue;
         }
 
-        if (cur_offset + 1 != entry.log_index()) {
-            PDLOG(WARNING,
-                  "missing log entry cur_offset %lu , new entry offset %lu for "
-                  "tid %u, pid %u",
-                  cur_offset, entry.log_index(), tid, pid);
-        }
-
         if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
             if (entry.dimensions_size() == 0) {
                 PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid, pid, entry.log_index());
@@ -118,15 +354,21 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
         }
         cur_offset = entry.log_index();
         succ_cnt++;
-        if (succ_cnt % 100000 == 0) {
-            PDLOG(INFO,
-                  "[Recover] load data from binlog succ_cnt %lu, failed_cnt "
-                  "%lu for tid %u, pid %u",
-                  succ_cnt, failed_cnt, tid, pid);
-        }
-        if (succ_cnt % FLAGS_gc_on_table_recover_count == 0) {
-            table->SchedGc();
-        }
+        CountEntry(table.get(), cur_offset, succ_cnt, failed_cnt);
+    }
+    if (pipeline) {
+        pipeline->Finish();
+        cur_offset = pipeline->GetOffset();
+        succ_cnt = pipeline->GetSuccCnt();
+        failed_cnt += pipeline->GetFailedCnt();
+        table->SetRecoverProgress(cur_offset, succ_cnt);
+    }
+    if (!reach_end_log) {
+        consumed = ::baidu::common::timer::now_time() - consumed;
+        PDLOG(INFO,
+              "table tid %u pid %u completed, succ_cnt %lu, failed_cnt "
+              "%lu, consumed %us",
+              tid, pid, succ_cnt, failed_cnt, consumed);
     }
     latest_offset = cur_offset;
     if (!reach_end_log) {
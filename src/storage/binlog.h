@@ -32,6 +32,9 @@ class Binlog {
  public:
     Binlog(LogParts* log_part, const std::string& binlog_path);
     ~Binlog() = default;
+    // replay the entries after offset. the binlog of a memory table is replayed by a pipeline if
+    // binlog_recover_thread_num is more than 1: the records are read in this thread, decoded by a pool
+    // and applied by the workers which own the segments, so the entries of a key keep their order
     bool RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset,
                            uint64_t& latest_offset);  // NOLINT
 
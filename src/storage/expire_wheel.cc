@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/expire_wheel.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace openmldb {
+namespace storage {
+
+ExpireWheel::ExpireWheel(uint64_t bucket_width) : bucket_width_(bucket_width == 0 ? 1 : bucket_width), key_cnt_(0) {}
+
+void ExpireWheel::Add(const Slice& key, uint64_t ts) {
+    uint64_t bucket = ts / bucket_width_;
+    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+    buckets_[bucket].emplace_back(key.data(), key.size());
+    key_cnt_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ExpireWheel::AddDeferred(const Slice& key, uint64_t ts) {
+    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+    deferred_.emplace_back(ts / bucket_width_, std::string(key.data(), key.size()));
+    key_cnt_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ExpireWheel::FlushDeferred() {
+    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+    for (auto& kv : deferred_) {
+        buckets_[kv.first].push_back(std::move(kv.second));
+    }
+    deferred_.clear();
+}
+
+bool ExpireWheel::Pop(uint64_t ts, uint64_t max_cnt, std::vector<std::string>* keys) {
+    uint64_t last_bucket = ts / bucket_width_;
+    size_t start = keys->size();
+    bool finished = true;
+    {
+        std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+        auto it = buckets_.begin();
+        while (it != buckets_.end() && it->first <= last_bucket) {
+            std::vector<std::string>& bucket = it->second;
+            if (max_cnt > 0 && keys->size() - start + bucket.size() > max_cnt) {
+                // take the tail part of the bucket
+                size_t cnt = max_cnt - (keys->size() - start);
+                std::move(bucket.end() - cnt, bucket.end(), std::back_inserter(*keys));
+                bucket.resize(bucket.size() - cnt);
+                key_cnt_.fetch_sub(cnt, std::memory_order_relaxed);
+                finished = false;
+                break;
+            }
+            key_cnt_.fetch_sub(bucket.size(), std::memory_order_relaxed);
+            std::move(bucket.begin(), bucket.end(), std::back_inserter(*keys));
+            it = buckets_.erase(it);
+        }
+    }
+    std::sort(keys->begin() + start, keys->end());
+    keys->erase(std::unique(keys->begin() + start, keys->end()), keys->end());
+    return finished;
+}
+
+void ExpireWheel::Clear() {
+    std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+    buckets_.clear();
+    deferred_.clear();
+    key_cnt_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_EXPIRE_WHEEL_H_
+#define SRC_STORAGE_EXPIRE_WHEEL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::Slice;
+
+// ExpireWheel groups the keys of a segment into buckets of time by the earliest
+// ts of their rows, so that absolute ttl gc only visits the keys in the buckets
+// which have crossed the expire time instead of all keys of the segment.
+//
+// A key is added when its earliest ts moves into a lower bucket, which happens
+// once for a key whose rows come in time order. It's taken out by gc and added
+// back with its new earliest ts if it still has rows. A key may be left in a
+// bucket after it's deleted or moved lower, gc just skips or revisits it.
+class ExpireWheel {
+ public:
+    // bucket_width is the time span of a bucket in ms
+    explicit ExpireWheel(uint64_t bucket_width);
+
+    ExpireWheel(const ExpireWheel&) = delete;
+    ExpireWheel& operator=(const ExpireWheel&) = delete;
+
+    // whether a key whose earliest ts changes from old_ts to ts should be added
+    bool NeedAdd(uint64_t old_ts, uint64_t ts) const {
+        return old_ts == UINT64_MAX || ts / bucket_width_ < old_ts / bucket_width_;
+    }
+
+    void Add(const Slice& key, uint64_t ts);
+
+    // keep the key out of the buckets until FlushDeferred. it's for the keys left in the buckets being
+    // collected, so that a gc pass stopped by the budget won't take them again
+    void AddDeferred(const Slice& key, uint64_t ts);
+
+    void FlushDeferred();
+
+    // whether the bucket of ts is taken by Pop with expire_time
+    bool IsCollected(uint64_t ts, uint64_t expire_time) const {
+        return ts / bucket_width_ <= expire_time / bucket_width_;
+    }
+
+    // take the keys out of the buckets which may hold rows at or before ts, from the oldest
+    // bucket. at most max_cnt keys are taken if it's not 0. the keys are sorted and unique.
+    // return true if no key is left in such buckets
+    bool Pop(uint64_t ts, uint64_t max_cnt, std::vector<std::string>* keys);
+
+    // the count of keys in the buckets and the deferred ones including the stale ones
+    uint64_t GetKeyCnt() const { return key_cnt_.load(std::memory_order_relaxed); }
+
+    uint64_t GetBucketCnt() {
+        std::lock_guard<::openmldb::base::SpinMutex> lock(mu_);
+        return buckets_.size();
+    }
+
+    void Clear();
+
+ private:
+    const uint64_t bucket_width_;
+    ::openmldb::base::SpinMutex mu_;
+    std::map<uint64_t, std::vector<std::string>> buckets_;
+    std::vector<std::pair<uint64_t, std::string>> deferred_;
+    std::atomic<uint64_t> key_cnt_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_EXPIRE_WHEEL_H_
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/expire_wheel.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class ExpireWheelTest : public ::testing::Test {
+ public:
+    ExpireWheelTest() {}
+    ~ExpireWheelTest() {}
+};
+
+TEST_F(ExpireWheelTest, NeedAdd) {
+    ExpireWheel wheel(100);
+    ASSERT_TRUE(wheel.NeedAdd(UINT64_MAX, 1000));
+    ASSERT_TRUE(wheel.NeedAdd(1000, 899));
+    ASSERT_FALSE(wheel.NeedAdd(1000, 1050));
+    ASSERT_FALSE(wheel.NeedAdd(1050, 1000));
+}
+
+TEST_F(ExpireWheelTest, AddAndPop) {
+    ExpireWheel wheel(100);
+    wheel.Add("key1", 150);
+    wheel.Add("key2", 250);
+    wheel.Add("key3", 350);
+    wheel.Add("key1", 120);
+    ASSERT_EQ(4u, wheel.GetKeyCnt());
+    ASSERT_EQ(3u, wheel.GetBucketCnt());
+    std::vector<std::string> keys;
+    ASSERT_TRUE(wheel.Pop(99, 0, &keys));
+    ASSERT_TRUE(keys.empty());
+    // the bucket of the expire time may hold rows later than it, so it's taken too
+    ASSERT_TRUE(wheel.Pop(210, 0, &keys));
+    ASSERT_EQ((std::vector<std::string>{"key1", "key2"}), keys);
+    ASSERT_EQ(1u, wheel.GetKeyCnt());
+    ASSERT_EQ(1u, wheel.GetBucketCnt());
+    wheel.Clear();
+    ASSERT_EQ(0u, wheel.GetKeyCnt());
+    ASSERT_EQ(0u, wheel.GetBucketCnt());
+}
+
+TEST_F(ExpireWheelTest, PopLimit) {
+    ExpireWheel wheel(10);
+    for (int i = 0; i < 100; i++) {
+        wheel.Add("key" + std::to_string(i), i);
+    }
+    std::vector<std::string> keys;
+    uint32_t round = 0;
+    bool finished = false;
+    while (!finished) {
+        finished = wheel.Pop(49, 15, &keys);
+        round++;
+    }
+    ASSERT_EQ(4u, round);
+    ASSERT_EQ(50u, keys.size());
+    ASSERT_EQ(50u, wheel.GetKeyCnt());
+    keys.clear();
+    ASSERT_TRUE(wheel.Pop(1000, 0, &keys));
+    ASSERT_EQ(50u, keys.size());
+    ASSERT_EQ(0u, wheel.GetKeyCnt());
+}
+
+TEST_F(ExpireWheelTest, Deferred) {
+    ExpireWheel wheel(100);
+    wheel.Add("key1", 150);
+    ASSERT_TRUE(wheel.IsCollected(199, 150));
+    ASSERT_FALSE(wheel.IsCollected(200, 150));
+    wheel.AddDeferred("key2", 160);
+    ASSERT_EQ(2u, wheel.GetKeyCnt());
+    std::vector<std::string> keys;
+    ASSERT_TRUE(wheel.Pop(150, 0, &keys));
+    ASSERT_EQ((std::vector<std::string>{"key1"}), keys);
+    wheel.FlushDeferred();
+    keys.clear();
+    ASSERT_TRUE(wheel.Pop(150, 0, &keys));
+    ASSERT_EQ((std::vector<std::string>{"key2"}), keys);
+    ASSERT_EQ(0u, wheel.GetKeyCnt());
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
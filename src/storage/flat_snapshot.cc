@@ -0,0 +1,252 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/flat_snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/glog_wrapper.h"
+#include "log/coding.h"
+#include "log/crc32c.h"
+#include "log/log_reader.h"
+#include "log/sequential_file.h"
+#include "log/status.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::log::DecodeFixed32;
+using ::openmldb::log::DecodeFixed64;
+using ::openmldb::log::EncodeFixed32;
+using ::openmldb::log::EncodeFixed64;
+
+// "FLAT" in little endian
+static constexpr uint32_t FLAT_MAGIC = 0x54414c46;
+// version 1 has no data_crc
+static constexpr uint32_t FLAT_VERSION = 2;
+static constexpr uint32_t FLAT_USED_HEADER_SIZE = 28;
+// size, dim_cnt, ts and value_size
+static constexpr uint32_t FLAT_RECORD_HEAD_SIZE = 20;
+static constexpr uint32_t FLAT_DIMENSION_HEAD_SIZE = 8;
+
+static inline uint64_t AlignRecordSize(uint64_t size) { return (size + 7) & ~static_cast<uint64_t>(7); }
+
+FlatSnapshotWriter::~FlatSnapshotWriter() {
+    if (fd_ != nullptr) {
+        fclose(fd_);
+    }
+}
+
+bool FlatSnapshotWriter::Open(const std::string& path) {
+    fd_ = fopen(path.c_str(), "wb");
+    if (fd_ == nullptr) {
+        PDLOG(WARNING, "fail to create file %s", path.c_str());
+        return false;
+    }
+    path_ = path;
+    // the header is filled in Close
+    std::string header(FlatSnapshotReader::FLAT_HEADER_SIZE, '\0');
+    if (fwrite(header.data(), 1, header.size(), fd_) != header.size()) {
+        PDLOG(WARNING, "fail to write header of %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FlatSnapshotWriter::Append(const ::openmldb::api::LogEntry& entry) {
+    if (fd_ == nullptr) {
+        return false;
+    }
+    uint64_t size = FLAT_RECORD_HEAD_SIZE + entry.value().size();
+    for (const auto& dimension : entry.dimensions()) {
+        size += FLAT_DIMENSION_HEAD_SIZE + dimension.key().size();
+    }
+    size = AlignRecordSize(size);
+    if (size > UINT32_MAX) {
+        PDLOG(WARNING, "record of %lu bytes is too large for %s", size, path_.c_str());
+        return false;
+    }
+    buf_.assign(size, '\0');
+    char* pos = &buf_[0];
+    EncodeFixed32(pos, size);
+    EncodeFixed32(pos + 4, entry.dimensions_size());
+    EncodeFixed64(pos + 8, entry.ts());
+    EncodeFixed32(pos + 16, entry.value().size());
+    pos += FLAT_RECORD_HEAD_SIZE;
+    for (const auto& dimension : entry.dimensions()) {
+        EncodeFixed32(pos, dimension.idx());
+        EncodeFixed32(pos + 4, dimension.key().size());
+        memcpy(pos + FLAT_DIMENSION_HEAD_SIZE, dimension.key().data(), dimension.key().size());
+        pos += FLAT_DIMENSION_HEAD_SIZE + dimension.key().size();
+    }
+    memcpy(pos, entry.value().data(), entry.value().size());
+    if (fwrite(buf_.data(), 1, buf_.size(), fd_) != buf_.size()) {
+        PDLOG(WARNING, "fail to write %s", path_.c_str());
+        return false;
+    }
+    count_++;
+    data_size_ += size;
+    data_crc_ = ::openmldb::log::Extend(data_crc_, buf_.data(), buf_.size());
+    return true;
+}
+
+bool FlatSnapshotWriter::Close() {
+    if (fd_ == nullptr) {
+        return false;
+    }
+    char header[FLAT_USED_HEADER_SIZE];
+    EncodeFixed32(header, FLAT_MAGIC);
+    EncodeFixed32(header + 4, FLAT_VERSION);
+    EncodeFixed64(header + 8, count_);
+    EncodeFixed64(header + 16, data_size_);
+    EncodeFixed32(header + 24, ::openmldb::log::Mask(data_crc_));
+    bool ok = fflush(fd_) == 0 && fseek(fd_, 0, SEEK_SET) == 0 &&
+              fwrite(header, 1, sizeof(header), fd_) == sizeof(header) && fflush(fd_) == 0 && fsync(fileno(fd_)) == 0;
+    if (!ok) {
+        PDLOG(WARNING, "fail to write header of %s", path_.c_str());
+    }
+    fclose(fd_);
+    fd_ = nullptr;
+    return ok;
+}
+
+int64_t FlatSnapshotWriter::Convert(const std::string& src_path, bool compressed, const std::string& dst_path) {
+    FILE* fd = fopen(src_path.c_str(), "rb");
+    if (fd == nullptr) {
+        PDLOG(WARNING, "fail to open path %s for error %s", src_path.c_str(), strerror(errno));
+        return -1;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(src_path, fd);
+    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
+    FlatSnapshotWriter writer;
+    bool has_error = !writer.Open(dst_path);
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    while (!has_error) {
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsEof()) {
+            break;
+        }
+        if (!status.ok() || !entry.ParseFromString(record.ToString())) {
+            PDLOG(WARNING, "fail to read record of %s. status[%s]", src_path.c_str(), status.ToString().c_str());
+            has_error = true;
+            break;
+        }
+        has_error = !writer.Append(entry);
+    }
+    delete seq_file;
+    if (!writer.Close() || has_error) {
+        unlink(dst_path.c_str());
+        return -1;
+    }
+    return writer.GetCount();
+}
+
+FlatSnapshotReader::~FlatSnapshotReader() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+bool FlatSnapshotReader::Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    char header[FLAT_USED_HEADER_SIZE];
+    bool ok = fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= FLAT_HEADER_SIZE &&
+              pread(fd, header, sizeof(header), 0) == sizeof(header) && DecodeFixed32(header) == FLAT_MAGIC &&
+              DecodeFixed32(header + 4) == FLAT_VERSION;
+    if (ok) {
+        count_ = DecodeFixed64(header + 8);
+        size_ = FLAT_HEADER_SIZE + DecodeFixed64(header + 16);
+        data_crc_ = ::openmldb::log::Unmask(DecodeFixed32(header + 24));
+        ok = size_ <= static_cast<uint64_t>(st.st_size);
+    }
+    if (!ok) {
+        PDLOG(WARNING, "%s is not a complete flat snapshot", path.c_str());
+        close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping is kept after the fd is closed
+    close(fd);
+    if (addr == MAP_FAILED) {
+        PDLOG(WARNING, "fail to mmap %s for error %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    data_ = reinterpret_cast<char*>(addr);
+    madvise(data_, size_, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool FlatSnapshotReader::Verify() const {
+    if (data_ == nullptr) {
+        return false;
+    }
+    return ::openmldb::log::Value(GetData(), GetDataSize()) == data_crc_;
+}
+
+uint32_t FlatSnapshotReader::GetRecordSize(const char* data, uint64_t avail) {
+    if (avail < FLAT_RECORD_HEAD_SIZE) {
+        return 0;
+    }
+    uint32_t size = DecodeFixed32(data);
+    if (size < FLAT_RECORD_HEAD_SIZE || size > avail || size % 8 != 0) {
+        return 0;
+    }
+    return size;
+}
+
+uint32_t FlatSnapshotReader::DecodeRecord(const char* data, uint64_t avail, Row* row) {
+    uint32_t size = GetRecordSize(data, avail);
+    if (size == 0) {
+        return 0;
+    }
+    uint32_t dim_cnt = DecodeFixed32(data + 4);
+    row->ts = DecodeFixed64(data + 8);
+    uint32_t value_size = DecodeFixed32(data + 16);
+    row->dimensions.clear();
+    uint64_t pos = FLAT_RECORD_HEAD_SIZE;
+    for (uint32_t i = 0; i < dim_cnt; i++) {
+        if (pos + FLAT_DIMENSION_HEAD_SIZE > size) {
+            return 0;
+        }
+        uint32_t idx = DecodeFixed32(data + pos);
+        uint32_t key_size = DecodeFixed32(data + pos + 4);
+        pos += FLAT_DIMENSION_HEAD_SIZE;
+        if (pos + key_size > size) {
+            return 0;
+        }
+        row->dimensions.emplace_back(idx, Slice(data + pos, key_size));
+        pos += key_size;
+    }
+    if (pos + value_size > size) {
+        return 0;
+    }
+    row->value.reset(data + pos, value_size);
+    return size;
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_FLAT_SNAPSHOT_H_
+#define SRC_STORAGE_FLAT_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::Slice;
+
+// the suffix of the flat copy of a snapshot file, it sits beside the file
+const char FLAT_SNAPSHOT_SUFFIX[] = ".flat";
+
+// A flat snapshot file keeps the rows of a snapshot file in a layout which is read
+// in place, so that it is loaded by mmap without decoding protobuf.
+//
+//   header  | magic(4) version(4) count(8) data_size(8) data_crc(4), padded to FLAT_HEADER_SIZE
+//   records | size(4) dim_cnt(4) ts(8) value_size(4) {idx(4) key_size(4) key}* value
+//
+// size is the length of the whole record which is padded to 8 bytes. data_crc is the
+// masked crc32c of all the records. Integers are little endian as in the log files.
+class FlatSnapshotWriter {
+ public:
+    FlatSnapshotWriter() : fd_(nullptr), count_(0), data_size_(0), data_crc_(0) {}
+    ~FlatSnapshotWriter();
+
+    FlatSnapshotWriter(const FlatSnapshotWriter&) = delete;
+    FlatSnapshotWriter& operator=(const FlatSnapshotWriter&) = delete;
+
+    bool Open(const std::string& path);
+
+    bool Append(const ::openmldb::api::LogEntry& entry);
+
+    // write the header and close the file, the file is not valid before it
+    bool Close();
+
+    uint64_t GetCount() const { return count_; }
+
+    // convert a snapshot file of log format, return the count of rows or -1 on error
+    static int64_t Convert(const std::string& src_path, bool compressed, const std::string& dst_path);
+
+ private:
+    FILE* fd_;
+    std::string path_;
+    uint64_t count_;
+    uint64_t data_size_;
+    uint32_t data_crc_;
+    std::string buf_;
+};
+
+// FlatSnapshotReader maps a flat snapshot file to memory. The rows it decodes refer to
+// the mapped file, so they are valid in the lifetime of the reader
+class FlatSnapshotReader {
+ public:
+    struct Row {
+        uint64_t ts = 0;
+        Slice value;
+        // the index id and the key of each dimension
+        std::vector<std::pair<uint32_t, Slice>> dimensions;
+    };
+
+    FlatSnapshotReader() : data_(nullptr), size_(0), count_(0), data_crc_(0) {}
+    ~FlatSnapshotReader();
+
+    FlatSnapshotReader(const FlatSnapshotReader&) = delete;
+    FlatSnapshotReader& operator=(const FlatSnapshotReader&) = delete;
+
+    // fail if the file is not a complete flat snapshot
+    bool Open(const std::string& path);
+
+    // check the records against the crc in header, which reads the whole file
+    bool Verify() const;
+
+    uint64_t GetCount() const { return count_; }
+
+    // the records, which start at a page boundary
+    const char* GetData() const { return data_ == nullptr ? nullptr : data_ + FLAT_HEADER_SIZE; }
+    uint64_t GetDataSize() const { return data_ == nullptr ? 0 : size_ - FLAT_HEADER_SIZE; }
+
+    // the size of the record at data, 0 if it is broken
+    static uint32_t GetRecordSize(const char* data, uint64_t avail);
+
+    // decode the record at data, return its size or 0 if it is broken
+    static uint32_t DecodeRecord(const char* data, uint64_t avail, Row* row);
+
+    static constexpr uint32_t FLAT_HEADER_SIZE = 4096;
+
+ private:
+    char* data_;
+    // the size of header and records, the bytes after them are not mapped
+    uint64_t size_;
+    uint64_t count_;
+    uint32_t data_crc_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+
+#endif  // SRC_STORAGE_FLAT_SNAPSHOT_H_
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/flat_snapshot.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "log/log_writer.h"
+#include "test/util.h"
+
+namespace openmldb {
+namespace storage {
+
+class FlatSnapshotTest : public ::testing::Test {
+ public:
+    FlatSnapshotTest() {}
+    ~FlatSnapshotTest() {}
+};
+
+::openmldb::api::LogEntry GenEntry(uint64_t i) {
+    ::openmldb::api::LogEntry entry;
+    entry.set_log_index(i);
+    entry.set_ts(1000 + i);
+    // values of different lengths so that the records are padded differently
+    entry.set_value("value" + std::string(i % 11, 'v'));
+    for (uint32_t idx = 0; idx < i % 3 + 1; idx++) {
+        auto dimension = entry.add_dimensions();
+        dimension->set_key("key" + std::to_string(i % 7) + "_" + std::to_string(idx));
+        dimension->set_idx(idx);
+    }
+    return entry;
+}
+
+void CheckFlatFile(const std::string& path, uint64_t cnt) {
+    FlatSnapshotReader reader;
+    ASSERT_TRUE(reader.Open(path));
+    ASSERT_EQ(cnt, reader.GetCount());
+    ASSERT_TRUE(reader.Verify());
+    const char* data = reader.GetData();
+    uint64_t size = reader.GetDataSize();
+    FlatSnapshotReader::Row row;
+    uint64_t pos = 0;
+    for (uint64_t i = 0; i < cnt; i++) {
+        uint32_t record_size = FlatSnapshotReader::DecodeRecord(data + pos, size - pos, &row);
+        ASSERT_GT(record_size, 0u);
+        ASSERT_EQ(0u, record_size % 8);
+        auto entry = GenEntry(i);
+        ASSERT_EQ(entry.ts(), row.ts);
+        ASSERT_EQ(entry.value(), row.value.ToString());
+        ASSERT_EQ(static_cast<size_t>(entry.dimensions_size()), row.dimensions.size());
+        for (int j = 0; j < entry.dimensions_size(); j++) {
+            ASSERT_EQ(entry.dimensions(j).idx(), row.dimensions[j].first);
+            ASSERT_EQ(entry.dimensions(j).key(), row.dimensions[j].second.ToString());
+        }
+        pos += record_size;
+    }
+    ASSERT_EQ(size, pos);
+}
+
+TEST_F(FlatSnapshotTest, WriteAndRead) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.CreateTempPath("flat") + "/snapshot.sdb.flat";
+    FlatSnapshotWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    for (uint64_t i = 0; i < 1000; i++) {
+        ASSERT_TRUE(writer.Append(GenEntry(i)));
+    }
+    // the header is written in close
+    FlatSnapshotReader incomplete;
+    ASSERT_FALSE(incomplete.Open(path));
+    ASSERT_TRUE(writer.Close());
+    CheckFlatFile(path, 1000);
+
+    std::string record;
+    uint64_t data_size = 0;
+    {
+        FlatSnapshotReader reader;
+        ASSERT_TRUE(reader.Open(path));
+        data_size = reader.GetDataSize();
+        record.assign(reader.GetData(), FlatSnapshotReader::GetRecordSize(reader.GetData(), data_size));
+    }
+    // a flipped byte keeps the sizes valid, it is found by the crc
+    {
+        FILE* fd = fopen(path.c_str(), "r+b");
+        ASSERT_TRUE(fd != NULL);
+        ASSERT_EQ(0, fseek(fd, FlatSnapshotReader::FLAT_HEADER_SIZE + record.size() - 1, SEEK_SET));
+        ASSERT_EQ(1u, fwrite("x", 1, 1, fd));
+        fclose(fd);
+        FlatSnapshotReader reader;
+        ASSERT_TRUE(reader.Open(path));
+        ASSERT_GT(FlatSnapshotReader::GetRecordSize(reader.GetData(), reader.GetDataSize()), 0u);
+        ASSERT_FALSE(reader.Verify());
+    }
+    // a truncated file is not loaded
+    ASSERT_EQ(0, truncate(path.c_str(), FlatSnapshotReader::FLAT_HEADER_SIZE + data_size - 8));
+    FlatSnapshotReader truncated;
+    ASSERT_FALSE(truncated.Open(path));
+    // a broken record is detected by its sizes
+    FlatSnapshotReader::Row row;
+    ASSERT_EQ(0u, FlatSnapshotReader::DecodeRecord(record.data(), record.size() - 8, &row));
+    record[16] = 127;
+    ASSERT_EQ(0u, FlatSnapshotReader::DecodeRecord(record.data(), record.size(), &row));
+    unlink(path.c_str());
+}
+
+TEST_F(FlatSnapshotTest, Convert) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string dir = tmp_path.CreateTempPath("flat");
+    for (const std::string compress_type : {"off", "snappy", "zlib"}) {
+        std::string path = dir + "/snapshot.sdb." + compress_type;
+        FILE* fd = fopen(path.c_str(), "ab+");
+        ASSERT_TRUE(fd != NULL);
+        ::openmldb::log::WriteHandle wh(compress_type, path, fd);
+        for (uint64_t i = 0; i < 10000; i++) {
+            std::string buffer;
+            GenEntry(i).SerializeToString(&buffer);
+            ASSERT_TRUE(wh.Write(::openmldb::base::Slice(buffer)).ok());
+        }
+        wh.EndLog();
+        ASSERT_EQ(10000, FlatSnapshotWriter::Convert(path, compress_type != "off", path + FLAT_SNAPSHOT_SUFFIX));
+        CheckFlatFile(path + FLAT_SNAPSHOT_SUFFIX, 10000);
+        unlink(path.c_str());
+        unlink((path + FLAT_SNAPSHOT_SUFFIX).c_str());
+    }
+    ASSERT_EQ(-1, FlatSnapshotWriter::Convert(dir + "/not_exist.sdb", false, dir + "/not_exist.sdb.flat"));
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
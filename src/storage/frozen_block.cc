@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/frozen_block.h"
+
+#include <snappy.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "base/glog_wrapper.h"
+
+namespace openmldb {
+namespace storage {
+
+static void PutVarint(std::string* dst, uint64_t v) {
+    while (v >= 0x80) {
+        dst->push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    dst->push_back(static_cast<char>(v));
+}
+
+static bool GetVarint(const char** p, const char* limit, uint64_t* v) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift <= 63 && *p < limit; shift += 7) {
+        uint64_t byte = static_cast<unsigned char>(**p);
+        (*p)++;
+        result |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+FrozenBlock* FrozenBlock::Build(const std::vector<std::pair<uint64_t, Slice>>& rows, uint32_t fixed_len) {
+    if (rows.empty() || rows.size() > MAX_ROW_CNT) {
+        return nullptr;
+    }
+    uint32_t min_size = UINT32_MAX;
+    for (const auto& row : rows) {
+        min_size = std::min(min_size, static_cast<uint32_t>(row.second.size()));
+    }
+    fixed_len = std::min(fixed_len, min_size);
+    // layout: time deltas | row sizes | fixed part column by column | remaining part row by row
+    std::string raw;
+    for (size_t i = 1; i < rows.size(); i++) {
+        PutVarint(&raw, rows[i - 1].first - rows[i].first);
+    }
+    for (const auto& row : rows) {
+        PutVarint(&raw, row.second.size());
+    }
+    for (uint32_t pos = 0; pos < fixed_len; pos++) {
+        for (const auto& row : rows) {
+            raw.push_back(row.second.data()[pos]);
+        }
+    }
+    for (const auto& row : rows) {
+        raw.append(row.second.data() + fixed_len, row.second.size() - fixed_len);
+    }
+    std::string compressed;
+    ::snappy::Compress(raw.data(), raw.size(), &compressed);
+    FrozenBlock* block = new FrozenBlock();
+    block->cnt_ = rows.size();
+    block->max_time_ = rows.front().first;
+    block->min_time_ = rows.back().first;
+    block->fixed_len_ = fixed_len;
+    block->size_ = compressed.size();
+    block->data_ = new char[compressed.size()];
+    memcpy(block->data_, compressed.data(), compressed.size());
+    return block;
+}
+
+bool FrozenBlock::Decode(std::vector<uint64_t>* times, std::vector<uint32_t>* offsets, std::string* data) const {
+    std::string raw;
+    if (!::snappy::Uncompress(data_, size_, &raw)) {
+        PDLOG(WARNING, "fail to uncompress frozen block");
+        return false;
+    }
+    const char* p = raw.data();
+    const char* limit = raw.data() + raw.size();
+    times->resize(cnt_);
+    (*times)[0] = max_time_;
+    for (uint32_t i = 1; i < cnt_; i++) {
+        uint64_t delta = 0;
+        if (!GetVarint(&p, limit, &delta)) {
+            return false;
+        }
+        (*times)[i] = (*times)[i - 1] - delta;
+    }
+    offsets->resize(cnt_ + 1);
+    (*offsets)[0] = 0;
+    for (uint32_t i = 0; i < cnt_; i++) {
+        uint64_t size = 0;
+        if (!GetVarint(&p, limit, &size)) {
+            return false;
+        }
+        (*offsets)[i + 1] = (*offsets)[i] + size;
+    }
+    if (static_cast<uint64_t>(limit - p) != (*offsets)[cnt_]) {
+        PDLOG(WARNING, "frozen block is corrupted");
+        return false;
+    }
+    data->resize((*offsets)[cnt_]);
+    char* out = &(*data)[0];
+    for (uint32_t pos = 0; pos < fixed_len_; pos++) {
+        for (uint32_t i = 0; i < cnt_; i++) {
+            out[(*offsets)[i] + pos] = *p++;
+        }
+    }
+    for (uint32_t i = 0; i < cnt_; i++) {
+        uint32_t len = (*offsets)[i + 1] - (*offsets)[i] - fixed_len_;
+        memcpy(out + (*offsets)[i] + fixed_len_, p, len);
+        p += len;
+    }
+    return true;
+}
+
+void FrozenBlockIterator::Load(FrozenBlock* block) {
+    idx_ = 0;
+    if (block != nullptr && block == block_ && !times_.empty()) {
+        // the block is decoded already
+        return;
+    }
+    block_ = block;
+    while (block_ != nullptr && !block_->Decode(&times_, &offsets_, &data_)) {
+        block_ = block_->GetNext();
+    }
+    if (block_ == nullptr) {
+        times_.clear();
+    }
+}
+
+void FrozenBlockIterator::Next() {
+    if (++idx_ >= times_.size() && block_ != nullptr) {
+        Load(block_->GetNext());
+    }
+}
+
+void FrozenBlockIterator::Seek(uint64_t time) {
+    FrozenBlock* block = head_;
+    while (block != nullptr && block->GetMinTime() > time) {
+        block = block->GetNext();
+    }
+    Load(block);
+    if (block_ == nullptr) {
+        return;
+    }
+    // times are in descending order
+    idx_ = std::lower_bound(times_.begin(), times_.end(), time, std::greater<uint64_t>()) - times_.begin();
+}
+
+void FrozenBlockIterator::SeekToFirst() { Load(head_); }
+
+void FrozenBlockIterator::SeekToLast() {
+    FrozenBlock* block = head_;
+    while (block != nullptr && block->GetNext() != nullptr) {
+        block = block->GetNext();
+    }
+    Load(block);
+    if (block_ != nullptr) {
+        idx_ = times_.size() - 1;
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
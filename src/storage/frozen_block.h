@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_FROZEN_BLOCK_H_
+#define SRC_STORAGE_FROZEN_BLOCK_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/slice.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::Slice;
+
+// FrozenBlock keeps the cold rows of one key entry in a compressed immutable
+// form. The times are delta encoded, and the fixed part of rows (header, bitmap
+// and fixed size columns in row codec) is laid out column by column, so that
+// the values of one column sit together before the block is compressed.
+// Blocks of a key entry are chained from the newest to the oldest.
+class FrozenBlock {
+ public:
+    static constexpr uint32_t MAX_ROW_CNT = 256;
+
+    // rows must be in descending order of time and no more than MAX_ROW_CNT.
+    // fixed_len is the length of the fixed part of rows, 0 means no column layout
+    static FrozenBlock* Build(const std::vector<std::pair<uint64_t, Slice>>& rows, uint32_t fixed_len);
+
+    ~FrozenBlock() { delete[] data_; }
+
+    FrozenBlock(const FrozenBlock&) = delete;
+    FrozenBlock& operator=(const FrozenBlock&) = delete;
+
+    // decode the block, the i-th row is data[offsets[i], offsets[i + 1]) with time times[i]
+    bool Decode(std::vector<uint64_t>* times, std::vector<uint32_t>* offsets, std::string* data) const;
+
+    uint32_t GetCount() const { return cnt_; }
+    uint64_t GetMaxTime() const { return max_time_; }
+    uint64_t GetMinTime() const { return min_time_; }
+    uint64_t GetByteSize() const { return sizeof(FrozenBlock) + size_; }
+
+    // the count of rows of which data block was released when they were frozen into
+    // this index, the rows are counted as records when the block is freed
+    uint32_t GetOwnedCount() const { return owned_cnt_; }
+    void SetOwnedCount(uint32_t cnt) { owned_cnt_ = cnt; }
+
+    FrozenBlock* GetNext() const { return next_; }
+    void SetNext(FrozenBlock* next) { next_ = next; }
+
+ private:
+    FrozenBlock()
+        : cnt_(0), owned_cnt_(0), max_time_(0), min_time_(0), fixed_len_(0), size_(0), data_(nullptr), next_(nullptr) {}
+
+ private:
+    uint32_t cnt_;
+    uint32_t owned_cnt_;
+    uint64_t max_time_;
+    uint64_t min_time_;
+    uint32_t fixed_len_;
+    uint32_t size_;
+    char* data_;
+    FrozenBlock* next_;
+};
+
+// iterate the rows of a chain of frozen blocks in descending order of time. Only the block
+// under the iterator is decoded, the value points into it and is valid until the iterator
+// leaves the block
+class FrozenBlockIterator {
+ public:
+    explicit FrozenBlockIterator(FrozenBlock* head) : head_(head), block_(nullptr), idx_(0) {}
+
+    bool Valid() const { return block_ != nullptr && idx_ < times_.size(); }
+    void Next();
+    const uint64_t& GetKey() const { return times_[idx_]; }
+    Slice GetValue() const { return Slice(data_.data() + offsets_[idx_], offsets_[idx_ + 1] - offsets_[idx_]); }
+    // seek to the first row of which time is not greater than the time
+    void Seek(uint64_t time);
+    void SeekToFirst();
+    void SeekToLast();
+
+ private:
+    void Load(FrozenBlock* block);
+
+ private:
+    FrozenBlock* const head_;
+    FrozenBlock* block_;
+    uint32_t idx_;
+    std::vector<uint64_t> times_;
+    std::vector<uint32_t> offsets_;
+    std::string data_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_FROZEN_BLOCK_H_
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/frozen_block.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class FrozenBlockTest : public ::testing::Test {
+ public:
+    FrozenBlockTest() {}
+    ~FrozenBlockTest() {}
+};
+
+std::string GenRow(uint64_t ts) {
+    // a fixed part of 16 bytes and a variable part
+    std::string row(16, static_cast<char>(ts % 7));
+    row.append("value" + std::to_string(ts));
+    return row;
+}
+
+TEST_F(FrozenBlockTest, BuildAndDecode) {
+    std::vector<std::string> values;
+    std::vector<std::pair<uint64_t, Slice>> rows;
+    for (uint64_t ts = 2000; ts > 1800; ts--) {
+        values.push_back(GenRow(ts));
+    }
+    for (uint32_t i = 0; i < values.size(); i++) {
+        rows.emplace_back(2000 - i, Slice(values[i]));
+    }
+    std::unique_ptr<FrozenBlock> block(FrozenBlock::Build(rows, 16));
+    ASSERT_TRUE(block);
+    ASSERT_EQ(200u, block->GetCount());
+    ASSERT_EQ(2000u, block->GetMaxTime());
+    ASSERT_EQ(1801u, block->GetMinTime());
+    std::vector<uint64_t> times;
+    std::vector<uint32_t> offsets;
+    std::string data;
+    ASSERT_TRUE(block->Decode(&times, &offsets, &data));
+    ASSERT_EQ(200u, times.size());
+    for (uint32_t i = 0; i < times.size(); i++) {
+        ASSERT_EQ(rows[i].first, times[i]);
+        ASSERT_EQ(values[i], data.substr(offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    // the fixed part is longer than the shortest row
+    std::vector<std::pair<uint64_t, Slice>> short_rows = {{10, Slice("ab")}, {9, Slice("abcdef")}};
+    block.reset(FrozenBlock::Build(short_rows, 16));
+    ASSERT_TRUE(block->Decode(&times, &offsets, &data));
+    ASSERT_EQ("ab", data.substr(offsets[0], offsets[1] - offsets[0]));
+    ASSERT_EQ("abcdef", data.substr(offsets[1], offsets[2] - offsets[1]));
+    std::vector<std::pair<uint64_t, Slice>> empty_rows;
+    ASSERT_EQ(nullptr, FrozenBlock::Build(empty_rows, 16));
+}
+
+TEST_F(FrozenBlockTest, Iterator) {
+    std::vector<std::string> values;
+    for (uint64_t ts = 1000; ts > 0; ts--) {
+        values.push_back(GenRow(ts));
+    }
+    // chain the blocks from the newest to the oldest
+    FrozenBlock* head = nullptr;
+    FrozenBlock* tail = nullptr;
+    for (uint32_t pos = 0; pos < values.size(); pos += FrozenBlock::MAX_ROW_CNT) {
+        std::vector<std::pair<uint64_t, Slice>> rows;
+        for (uint32_t i = pos; i < values.size() && i < pos + FrozenBlock::MAX_ROW_CNT; i++) {
+            rows.emplace_back(1000 - i, Slice(values[i]));
+        }
+        FrozenBlock* block = FrozenBlock::Build(rows, 16);
+        if (tail == nullptr) {
+            head = block;
+        } else {
+            tail->SetNext(block);
+        }
+        tail = block;
+    }
+    FrozenBlockIterator it(head);
+    it.SeekToFirst();
+    for (uint32_t i = 0; i < values.size(); i++) {
+        ASSERT_TRUE(it.Valid());
+        ASSERT_EQ(1000 - i, it.GetKey());
+        ASSERT_EQ(values[i], it.GetValue().ToString());
+        it.Next();
+    }
+    ASSERT_FALSE(it.Valid());
+    it.Seek(600);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(600u, it.GetKey());
+    it.Seek(2000);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(1000u, it.GetKey());
+    it.Seek(0);
+    ASSERT_FALSE(it.Valid());
+    it.SeekToLast();
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(1u, it.GetKey());
+    while (head != nullptr) {
+        FrozenBlock* tmp = head;
+        head = head->GetNext();
+        delete tmp;
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
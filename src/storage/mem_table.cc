@@ -18,11 +18,13 @@
 
 #include <snappy.h>
 #include <algorithm>
+#include <condition_variable>  // NOLINT
 #include <utility>
 
 #include "base/glog_wrapper.h"
 #include "base/hash.h"
 #include "base/slice.h"
+#include "base/taskpool.hpp"
 #include "common/timer.h"
 #include "gflags/gflags.h"
 #include "storage/record.h"
@@ -34,6 +36,12 @@ DECLARE_uint32(key_entry_max_height);
 DECLARE_uint32(absolute_default_skiplist_height);
 DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_bool(enable_memtable_slab_alloc);
+DECLARE_uint32(mem_table_freeze_time);
+DECLARE_uint32(gc_segment_thread_num);
+DECLARE_uint64(gc_round_key_cnt);
+DECLARE_uint32(gc_round_time_ms);
+DECLARE_uint32(gc_expire_wheel_bucket_ms);
 
 namespace openmldb {
 namespace storage {
@@ -49,7 +57,12 @@ MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t
       enable_gc_(true),
       record_cnt_(0),
       segment_released_(false),
-      record_byte_size_(0) {}
+      record_byte_size_(0),
+      gc_finished_(true),
+      gc_consumed_time_(0),
+      gc_total_record_cnt_(0),
+      gc_total_idx_cnt_(0),
+      mem_gc_pending_(false) {}
 
 MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     : Table(table_meta.storage_mode(), table_meta.name(), table_meta.tid(), table_meta.pid(), 0, true, 60 * 1000,
@@ -61,11 +74,18 @@ MemTable::MemTable(const ::openmldb::api::TableMeta& table_meta)
     record_cnt_ = 0;
     segment_released_ = false;
     record_byte_size_ = 0;
+    gc_finished_ = true;
+    gc_consumed_time_ = 0;
+    gc_total_record_cnt_ = 0;
+    gc_total_idx_cnt_ = 0;
+    mem_gc_pending_ = false;
     diskused_ = 0;
     table_meta_ = std::make_shared<::openmldb::api::TableMeta>(table_meta);
 }
 
 MemTable::~MemTable() {
+    // the gc rounds wait for their tasks, so the pool is idle here
+    gc_pool_.reset();
     if (segments_.empty()) {
         return;
     }
@@ -95,6 +115,10 @@ bool MemTable::Init() {
         table_meta_->key_entry_max_height() > 0) {
         global_key_entry_max_height = table_meta_->key_entry_max_height();
     }
+    if (FLAGS_enable_memtable_slab_alloc) {
+        block_allocator_ = std::make_unique<SlabAllocator>();
+    }
+    epoch_ = std::make_unique<::openmldb::base::EpochManager>();
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (uint32_t i = 0; i < inner_indexs->size(); i++) {
         const std::vector<uint32_t>& ts_vec = inner_indexs->at(i)->GetTsIdx();
@@ -108,13 +132,22 @@ bool MemTable::Init() {
         Segment** seg_arr = new Segment*[seg_cnt_];
         if (!ts_vec.empty()) {
             for (uint32_t j = 0; j < seg_cnt_; j++) {
-                seg_arr[j] = new Segment(cur_key_entry_max_height, ts_vec);
+                seg_arr[j] = new Segment(cur_key_entry_max_height, ts_vec, table_meta_->enable_pk_hash_index(),
+                                         epoch_.get());
+                seg_arr[j]->SetBlockAllocator(block_allocator_.get());
+                if (FLAGS_gc_expire_wheel_bucket_ms > 0) {
+                    seg_arr[j]->EnableExpireWheel(FLAGS_gc_expire_wheel_bucket_ms);
+                }
                 PDLOG(INFO, "init %u, %u segment. height %u, ts col num %u. tid %u pid %u", i, j,
                       cur_key_entry_max_height, ts_vec.size(), id_, pid_);
             }
         } else {
             for (uint32_t j = 0; j < seg_cnt_; j++) {
-                seg_arr[j] = new Segment(cur_key_entry_max_height);
+                seg_arr[j] = new Segment(cur_key_entry_max_height, table_meta_->enable_pk_hash_index(), epoch_.get());
+                seg_arr[j]->SetBlockAllocator(block_allocator_.get());
+                if (FLAGS_gc_expire_wheel_bucket_ms > 0) {
+                    seg_arr[j]->EnableExpireWheel(FLAGS_gc_expire_wheel_bucket_ms);
+                }
                 PDLOG(INFO, "init %u, %u segment. height %u tid %u pid %u", i, j, cur_key_entry_max_height, id_, pid_);
             }
         }
@@ -144,12 +177,80 @@ bool MemTable::Put(const std::string& pk, uint64_t time, const char* data, uint3
 }
 
 bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& dimensions) {
-    if (dimensions.empty()) {
-        PDLOG(WARNING, "empty dimension. tid %u pid %u", id_, pid_);
+    return Put(time, value.data(), value.size(), dimensions);
+}
+
+bool MemTable::Put(uint64_t time, const char* value, uint32_t size, const Dimensions& dimensions) {
+    ParsedRow row;
+    if (!ParseRow(time, value, size, dimensions, &row)) {
         return false;
     }
-    if (value.length() < codec::HEADER_LENGTH) {
-        PDLOG(WARNING, "invalid value. tid %u pid %u", id_, pid_);
+    auto* block = DataBlock::New(block_allocator_.get(), row.ref_cnt, value, size);
+    for (const auto& kv : row.segments) {
+        kv.first->Put(kv.second, row.ts_map, block);
+    }
+    record_cnt_.fetch_add(1, std::memory_order_relaxed);
+    record_byte_size_.fetch_add(GetRecordSize(size));
+    return true;
+}
+
+bool MemTable::Put(uint64_t time, const char* value, uint32_t size,
+                   const std::vector<std::pair<uint32_t, Slice>>& dimensions) {
+    ParsedRow row;
+    if (!ParseRow(time, value, size, dimensions, &row)) {
+        return false;
+    }
+    auto* block = NewDataBlock(row, value, size);
+    for (uint32_t pos = 0; pos < row.segments.size(); pos++) {
+        PutSegment(row, pos, block);
+    }
+    return true;
+}
+
+bool MemTable::PutBatch(const std::vector<BatchPutRow>& rows) {
+    std::vector<ParsedRow> parsed_rows;
+    if (!ParseBatch(rows, &parsed_rows)) {
+        return false;
+    }
+    PutBatch(rows, parsed_rows);
+    return true;
+}
+
+bool MemTable::ParseBatch(const std::vector<BatchPutRow>& rows, std::vector<ParsedRow>* parsed_rows) {
+    parsed_rows->clear();
+    parsed_rows->resize(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        const auto& row = rows[i];
+        if (!ParseRow(row.time, row.value.data(), row.value.size(), *row.dimensions, &(*parsed_rows)[i])) {
+            PDLOG(WARNING, "invalid row %lu of batch. tid %u pid %u", i, id_, pid_);
+            return false;
+        }
+    }
+    return true;
+}
+
+void MemTable::PutBatch(const std::vector<BatchPutRow>& rows, const std::vector<ParsedRow>& parsed_rows) {
+    std::map<Segment*, std::vector<Segment::BatchRow>> segment_rows;
+    uint64_t byte_size = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const auto& value = rows[i].value;
+        auto* block = DataBlock::New(block_allocator_.get(), parsed_rows[i].ref_cnt, value.data(), value.size());
+        for (const auto& kv : parsed_rows[i].segments) {
+            segment_rows[kv.first].push_back({kv.second, &parsed_rows[i].ts_map, block});
+        }
+        byte_size += GetRecordSize(value.size());
+    }
+    for (const auto& kv : segment_rows) {
+        kv.first->PutBatch(kv.second);
+    }
+    record_cnt_.fetch_add(rows.size(), std::memory_order_relaxed);
+    record_byte_size_.fetch_add(byte_size);
+}
+
+bool MemTable::ParseRow(uint64_t time, const char* value, uint32_t size, const Dimensions& dimensions,
+                        ParsedRow* row) {
+    if (dimensions.empty()) {
+        PDLOG(WARNING, "empty dimension. tid %u pid %u", id_, pid_);
         return false;
     }
     std::map<int32_t, Slice> inner_index_key_map;
@@ -161,11 +262,37 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         }
         inner_index_key_map.emplace(inner_pos, iter->key());
     }
-    uint32_t real_ref_cnt = 0;
-    const int8_t* data = reinterpret_cast<const int8_t*>(value.data());
+    return ParseRow(time, value, size, inner_index_key_map, row);
+}
+
+bool MemTable::ParseRow(uint64_t time, const char* value, uint32_t size,
+                        const std::vector<std::pair<uint32_t, Slice>>& dimensions, ParsedRow* row) {
+    if (dimensions.empty()) {
+        PDLOG(WARNING, "empty dimension. tid %u pid %u", id_, pid_);
+        return false;
+    }
+    std::map<int32_t, Slice> inner_index_key_map;
+    for (const auto& kv : dimensions) {
+        int32_t inner_pos = table_index_.GetInnerIndexPos(kv.first);
+        if (inner_pos < 0) {
+            PDLOG(WARNING, "invalid dimension. dimension idx %u, tid %u pid %u", kv.first, id_, pid_);
+            return false;
+        }
+        inner_index_key_map.emplace(inner_pos, kv.second);
+    }
+    return ParseRow(time, value, size, inner_index_key_map, row);
+}
+
+bool MemTable::ParseRow(uint64_t time, const char* value, uint32_t size,
+                        const std::map<int32_t, Slice>& inner_index_key_map, ParsedRow* row) {
+    if (size < codec::HEADER_LENGTH) {
+        PDLOG(WARNING, "invalid value. tid %u pid %u", id_, pid_);
+        return false;
+    }
+    const int8_t* data = reinterpret_cast<const int8_t*>(value);
     std::string uncompress_data;
     if (GetCompressType() == openmldb::type::kSnappy) {
-        snappy::Uncompress(value.data(), value.size(), &uncompress_data);
+        snappy::Uncompress(value, size, &uncompress_data);
         data = reinterpret_cast<const int8_t*>(uncompress_data.data());
     }
     uint8_t version = codec::RowView::GetSchemaVersion(data);
@@ -174,13 +301,13 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         PDLOG(WARNING, "invalid schema version %u, tid %u pid %u", version, id_, pid_);
         return false;
     }
-    std::map<int32_t, uint64_t> ts_map;
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         if (!inner_index) {
             PDLOG(WARNING, "invalid inner index pos %d. tid %u pid %u", kv.first, id_, pid_);
             return false;
         }
+        bool need_put = false;
         for (const auto& index_def : inner_index->GetIndex()) {
             auto ts_col = index_def->GetTsColumn();
             if (ts_col) {
@@ -195,25 +322,12 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
                     PDLOG(WARNING, "ts %ld is negative. tid %u pid %u", ts, id_, pid_);
                     return false;
                 }
-                ts_map.emplace(ts_col->GetId(), ts);
+                row->ts_map.emplace(ts_col->GetId(), ts);
             }
-            if (index_def->IsReady()) {
-                real_ref_cnt++;
-            }
-        }
-    }
-    if (ts_map.empty()) {
-        return false;
-    }
-    auto* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
-    for (const auto& kv : inner_index_key_map) {
-        auto inner_index = table_index_.GetInnerIndex(kv.first);
-        bool need_put = false;
-        for (const auto& index_def : inner_index->GetIndex()) {
             if (index_def->IsReady()) {
                 // TODO(hw): if we don't find this ts(has_found_ts==false), but it's ready, will put too?
                 need_put = true;
-                break;
+                row->ref_cnt++;
             }
         }
         if (need_put) {
@@ -221,13 +335,25 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
             if (seg_cnt_ > 1) {
                 seg_idx = ::openmldb::base::hash(kv.second.data(), kv.second.size(), SEED) % seg_cnt_;
             }
-            Segment* segment = segments_[kv.first][seg_idx];
-            segment->Put(::openmldb::base::Slice(kv.second), ts_map, block);
+            row->segments.emplace_back(segments_[kv.first][seg_idx], kv.second);
+            row->seg_idxs.push_back(seg_idx);
         }
     }
+    return !row->ts_map.empty();
+}
+
+DataBlock* MemTable::NewDataBlock(const ParsedRow& row, const char* value, uint32_t size) {
+    auto* block = DataBlock::New(block_allocator_.get(), row.ref_cnt, value, size);
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(value.length()));
-    return true;
+    record_byte_size_.fetch_add(GetRecordSize(size));
+    return block;
+}
+
+uint32_t MemTable::GetSegIdx(const std::string& key) const {
+    if (seg_cnt_ > 1) {
+        return ::openmldb::base::hash(key.data(), key.size(), SEED) % seg_cnt_;
+    }
+    return 0;
 }
 
 bool MemTable::Delete(const std::string& pk, uint32_t idx) {
@@ -265,12 +391,59 @@ uint64_t MemTable::Release() {
     return total_cnt;
 }
 
+bool MemTable::GcSegment(Segment* segment, const std::map<uint32_t, TTLSt>& ttl_st_map, const GcBudget& budget,
+                         bool need_freeze, uint64_t freeze_time, uint32_t fixed_len, SegmentGcStat* stat) {
+    // the deferred free list and the gc version only move forward once per pass
+    if (segment->IsGcPassStart()) {
+        segment->IncrGcVersion();
+        segment->GcFreeList(stat->gc_idx_cnt, stat->gc_record_cnt, stat->gc_record_byte_size);
+    }
+    bool finished = false;
+    if (ttl_st_map.size() == 1) {
+        finished = segment->ExecuteGc(ttl_st_map.begin()->second, stat->gc_idx_cnt, stat->gc_record_cnt,
+                                      stat->gc_record_byte_size, budget);
+    } else {
+        finished = segment->ExecuteGc(ttl_st_map, stat->gc_idx_cnt, stat->gc_record_cnt, stat->gc_record_byte_size,
+                                      budget);
+    }
+    if (finished && need_freeze) {
+        segment->Freeze(freeze_time, fixed_len, stat->freeze_cnt, stat->freed_byte_size, stat->frozen_byte_size);
+    }
+    return finished;
+}
+
 void MemTable::SchedGc() {
+    // the rounds of a table never overlap, skip it if the table is under gc by another thread
+    std::unique_lock<std::mutex> lock(gc_mu_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        PDLOG(INFO, "skip the gc round as gc is running for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
+        return;
+    }
+    GcRound();
+}
+
+void MemTable::SchedFullGc() {
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    do {
+        GcRound();
+    } while (!gc_finished_.load(std::memory_order_relaxed));
+}
+
+void MemTable::GcRound() {
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    PDLOG(INFO, "start making gc for table %s, tid %u, pid %u", name_.c_str(), id_, pid_);
-    uint64_t gc_idx_cnt = 0;
-    uint64_t gc_record_cnt = 0;
-    uint64_t gc_record_byte_size = 0;
+    // a round continues the pass left by the last one if it was stopped by the budget
+    bool resume = !gc_finished_.load(std::memory_order_relaxed);
+    PDLOG(INFO, "start making gc for table %s, tid %u, pid %u, resume %d", name_.c_str(), id_, pid_, resume);
+    SegmentGcStat total;
+    bool finished = true;
+    uint32_t fixed_len = 0;
+    if (FLAGS_mem_table_freeze_time > 0) {
+        auto schema = GetSchema();
+        if (schema) {
+            codec::RowView row_view(*schema);
+            fixed_len = row_view.GetFixedLength();
+        }
+    }
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (uint32_t i = 0; i < inner_indexs->size(); i++) {
         const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
@@ -316,29 +489,96 @@ void MemTable::SchedGc() {
         if (deleted_num == real_index.size() || ttl_st_map.empty()) {
             continue;
         }
-        for (uint32_t j = 0; j < seg_cnt_; j++) {
+        // frozen rows are only dropped by absolute ttl, so the other ttl types are not frozen
+        bool need_freeze = FLAGS_mem_table_freeze_time > 0 && ttl_st_map.size() == 1 &&
+                           ttl_st_map.begin()->second.ttl_type == ::openmldb::storage::TTLType::kAbsoluteTime;
+        uint64_t freeze_time = ::baidu::common::timer::get_micros() / 1000 -
+                               static_cast<uint64_t>(FLAGS_mem_table_freeze_time) * 60 * 1000;
+        // the rows frozen before the ttl type is changed are moved back, or else they are never dropped
+        bool need_thaw = ttl_st_map.size() != 1 ||
+                         ttl_st_map.begin()->second.ttl_type != ::openmldb::storage::TTLType::kAbsoluteTime;
+        GcBudget budget;
+        budget.max_key_cnt = FLAGS_gc_round_key_cnt;
+        if (FLAGS_gc_round_time_ms > 0) {
+            budget.deadline =
+                ::baidu::common::timer::get_micros() + static_cast<uint64_t>(FLAGS_gc_round_time_ms) * 1000;
+        }
+        // the segments of one index share no data block, so they can make gc in parallel.
+        // the indexes are still done one by one as they share the data blocks
+        std::vector<SegmentGcStat> stats(seg_cnt_);
+        std::vector<uint8_t> seg_finished(seg_cnt_, 1);
+        auto gc_segment = [&, i](uint32_t j) {
             uint64_t seg_gc_time = ::baidu::common::timer::get_micros() / 1000;
             Segment* segment = segments_[i][j];
-            segment->IncrGcVersion();
-            segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            if (ttl_st_map.size() == 1) {
-                segment->ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            } else {
-                segment->ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            // the segment has finished its pass in the former rounds
+            if (resume && segment->IsGcPassStart()) {
+                return;
             }
+            if (need_thaw) {
+                segment->Thaw(stats[j].thaw_cnt, stats[j].thaw_record_cnt, stats[j].thaw_byte_size,
+                              stats[j].freed_byte_size);
+            }
+            seg_finished[j] = GcSegment(segment, ttl_st_map, budget, need_freeze, freeze_time, fixed_len, &stats[j]);
             seg_gc_time = ::baidu::common::timer::get_micros() / 1000 - seg_gc_time;
-            PDLOG(INFO, "gc segment[%u][%u] done consumed %lu for table %s tid %u pid %u", i, j, seg_gc_time,
-                  name_.c_str(), id_, pid_);
+            PDLOG(INFO, "gc segment[%u][%u] done consumed %lu finished %u for table %s tid %u pid %u", i, j,
+                  seg_gc_time, seg_finished[j], name_.c_str(), id_, pid_);
+        };
+        uint32_t thread_num = std::min(FLAGS_gc_segment_thread_num, seg_cnt_);
+        if (thread_num <= 1) {
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                gc_segment(j);
+            }
+        } else {
+            if (!gc_pool_) {
+                gc_pool_ = std::make_unique<::openmldb::base::TaskPool>(thread_num, seg_cnt_);
+            }
+            std::mutex done_mu;
+            std::condition_variable done_cv;
+            uint32_t done_cnt = 0;
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                gc_pool_->AddTask([&, j] {
+                    gc_segment(j);
+                    std::lock_guard<std::mutex> lock(done_mu);
+                    if (++done_cnt == seg_cnt_) {
+                        done_cv.notify_one();
+                    }
+                });
+            }
+            std::unique_lock<std::mutex> lock(done_mu);
+            done_cv.wait(lock, [&] { return done_cnt == seg_cnt_; });
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            total.Merge(stats[j]);
+            finished = finished && seg_finished[j];
         }
     }
     consumed = ::baidu::common::timer::get_micros() - consumed;
-    record_cnt_.fetch_sub(gc_record_cnt, std::memory_order_relaxed);
-    record_byte_size_.fetch_sub(gc_record_byte_size, std::memory_order_relaxed);
+    record_cnt_.fetch_sub(total.gc_record_cnt, std::memory_order_relaxed);
+    record_byte_size_.fetch_sub(total.gc_record_byte_size, std::memory_order_relaxed);
+    record_byte_size_.fetch_add(total.frozen_byte_size, std::memory_order_relaxed);
+    record_byte_size_.fetch_sub(total.freed_byte_size, std::memory_order_relaxed);
+    record_cnt_.fetch_add(total.thaw_record_cnt, std::memory_order_relaxed);
+    record_byte_size_.fetch_add(total.thaw_byte_size, std::memory_order_relaxed);
+    gc_finished_.store(finished, std::memory_order_relaxed);
+    gc_consumed_time_.store(consumed / 1000, std::memory_order_relaxed);
+    gc_total_record_cnt_.fetch_add(total.gc_record_cnt, std::memory_order_relaxed);
+    gc_total_idx_cnt_.fetch_add(total.gc_idx_cnt, std::memory_order_relaxed);
     PDLOG(INFO,
-          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
+          "gc %s, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
           "table %s tid %u pid %u",
-          gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
-    UpdateTTL();
+          finished ? "finished" : "paused", total.gc_idx_cnt, total.gc_record_cnt, consumed / 1000, name_.c_str(),
+          id_, pid_);
+    if (total.freeze_cnt > 0) {
+        PDLOG(INFO, "freeze %lu rows, freed byte size %lu, frozen byte size %lu for table %s tid %u pid %u",
+              total.freeze_cnt, total.freed_byte_size, total.frozen_byte_size, name_.c_str(), id_, pid_);
+    }
+    if (total.thaw_cnt > 0) {
+        PDLOG(INFO, "thaw %lu frozen rows, thawed byte size %lu for table %s tid %u pid %u", total.thaw_cnt,
+              total.thaw_byte_size, name_.c_str(), id_, pid_);
+    }
+    if (finished) {
+        UpdateTTL();
+    }
 }
 
 // tll as ms
@@ -501,6 +741,51 @@ uint64_t MemTable::GetRecordIdxByteSize() {
     return record_idx_byte_size;
 }
 
+uint64_t MemTable::GetFrozenByteSize() {
+    uint64_t frozen_byte_size = 0;
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (size_t i = 0; i < inner_indexs->size(); i++) {
+        if (segments_[i] == nullptr) {
+            continue;
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            frozen_byte_size += segments_[i][j]->GetFrozenByteSize();
+        }
+    }
+    return frozen_byte_size;
+}
+
+uint64_t MemTable::GetMemByteSize() {
+    uint64_t byte_size = record_byte_size_.load(std::memory_order_relaxed);
+    auto inner_indexs = table_index_.GetAllInnerIndex();
+    for (size_t i = 0; i < inner_indexs->size() && i < segments_.size(); i++) {
+        if (segments_[i] == nullptr) {
+            continue;
+        }
+        for (uint32_t j = 0; j < seg_cnt_; j++) {
+            // the frozen blocks are counted in the record byte size
+            byte_size += segments_[i][j]->GetIdxByteSize() + segments_[i][j]->GetRetiredByteSize();
+        }
+    }
+    return byte_size;
+}
+
+bool MemTable::GetSegmentMemByteSize(uint32_t idx, std::vector<uint64_t>* sizes) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(idx);
+    if (!index_def || !index_def->IsReady()) {
+        return false;
+    }
+    uint32_t inner_idx = index_def->GetInnerPos();
+    if (inner_idx >= segments_.size() || segments_[inner_idx] == nullptr) {
+        return false;
+    }
+    sizes->clear();
+    for (uint32_t i = 0; i < seg_cnt_; i++) {
+        sizes->push_back(segments_[inner_idx][i]->GetMemByteSize());
+    }
+    return true;
+}
+
 uint64_t MemTable::GetRecordIdxCnt() {
     uint64_t record_idx_cnt = 0;
     std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(0);
@@ -625,7 +910,12 @@ bool MemTable::AddIndex(const ::openmldb::common::ColumnKey& column_key) {
         uint32_t inner_id = table_index_.GetAllInnerIndex()->size();
         Segment** seg_arr = new Segment*[seg_cnt_];
         for (uint32_t j = 0; j < seg_cnt_; j++) {
-            seg_arr[j] = new Segment(FLAGS_absolute_default_skiplist_height, ts_vec);
+            seg_arr[j] = new Segment(FLAGS_absolute_default_skiplist_height, ts_vec,
+                                     table_meta->enable_pk_hash_index(), epoch_.get());
+            seg_arr[j]->SetBlockAllocator(block_allocator_.get());
+            if (FLAGS_gc_expire_wheel_bucket_ms > 0) {
+                seg_arr[j]->EnableExpireWheel(FLAGS_gc_expire_wheel_bucket_ms);
+            }
             PDLOG(INFO, "init %u, %u segment. height %u, ts col num %u. tid %u pid %u", inner_id, j,
                   FLAGS_absolute_default_skiplist_height, ts_vec.size(), id_, pid_);
         }
@@ -822,7 +1112,7 @@ MemTableTraverseIterator::MemTableTraverseIterator(Segment** segments, uint32_t
       record_idx_(0),
       ts_idx_(0),
       expire_value_(expire_time, expire_cnt, ttl_type),
-      ticket_(),
+      guard_(segments[0]->GetEpochManager()),
       traverse_cnt_(0) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
@@ -855,7 +1145,6 @@ void MemTableTraverseIterator::NextPK() {
     delete it_;
     it_ = nullptr;
     do {
-        ticket_.Pop();
         if (pk_it_->Valid()) {
             pk_it_->Next();
         }
@@ -879,12 +1168,10 @@ void MemTableTraverseIterator::NextPK() {
         }
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[0];  // NOLINT
-            it_ = entry->entries.NewIterator();
-            ticket_.Push(entry);
+            it_ = entry->NewIterator();
         } else {
             it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                      ->entries.NewIterator();
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+                      ->NewIterator();
         }
         it_->SeekToFirst();
         record_idx_ = 1;
@@ -904,7 +1191,6 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
         delete it_;
         it_ = nullptr;
     }
-    ticket_.Pop();
     if (seg_cnt_ > 1) {
         seg_idx_ = ::openmldb::base::hash(key.c_str(), key.length(), SEED) % seg_cnt_;
     }
@@ -914,12 +1200,10 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
     if (pk_it_->Valid()) {
         if (segments_[seg_idx_]->GetTsCnt() > 1) {
             KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-            ticket_.Push(entry);
-            it_ = entry->entries.NewIterator();
+            it_ = entry->NewIterator();
         } else {
-            ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
-            it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                      ->entries.NewIterator();
+            it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
+                      ->NewIterator();
         }
         if (spk.compare(pk_it_->GetKey()) != 0) {
             it_->SeekToFirst();
@@ -955,7 +1239,7 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
 }
 
 openmldb::base::Slice MemTableTraverseIterator::GetValue() const {
-    return openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
+    return it_->GetValue();
 }
 
 uint64_t MemTableTraverseIterator::GetKey() const {
@@ -973,7 +1257,6 @@ std::string MemTableTraverseIterator::GetPK() const {
 }
 
 void MemTableTraverseIterator::SeekToFirst() {
-    ticket_.Pop();
     if (pk_it_ != nullptr) {
         delete pk_it_;
         pk_it_ = nullptr;
@@ -988,12 +1271,10 @@ void MemTableTraverseIterator::SeekToFirst() {
         while (pk_it_->Valid()) {
             if (segments_[seg_idx_]->GetTsCnt() > 1) {
                 KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-                ticket_.Push(entry);
-                it_ = entry->entries.NewIterator();
+                it_ = entry->NewIterator();
             } else {
-                ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
-                it_ = ((KeyEntry*)pk_it_->GetValue())         // NOLINT
-                          ->entries.NewIterator();
+                it_ = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
+                          ->NewIterator();
             }
             it_->SeekToFirst();
             traverse_cnt_++;
@@ -1004,7 +1285,6 @@ void MemTableTraverseIterator::SeekToFirst() {
             delete it_;
             it_ = nullptr;
             pk_it_->Next();
-            ticket_.Pop();
             if (traverse_cnt_ >= FLAGS_max_traverse_cnt) {
                 return;
             }
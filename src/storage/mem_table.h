@@ -20,9 +20,12 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/epoch.h"
 #include "proto/tablet.pb.h"
 #include "storage/iterator.h"
 #include "storage/segment.h"
@@ -34,10 +37,37 @@ using ::openmldb::api::LogEntry;
 using ::openmldb::base::Slice;
 
 namespace openmldb {
+namespace base {
+class TaskPool;
+}  // namespace base
 namespace storage {
 
 typedef google::protobuf::RepeatedPtrField<::openmldb::api::Dimension> Dimensions;
 
+struct SegmentGcStat {
+    uint64_t gc_idx_cnt = 0;
+    uint64_t gc_record_cnt = 0;
+    uint64_t gc_record_byte_size = 0;
+    uint64_t freeze_cnt = 0;
+    uint64_t freed_byte_size = 0;
+    uint64_t frozen_byte_size = 0;
+    uint64_t thaw_cnt = 0;
+    uint64_t thaw_record_cnt = 0;
+    uint64_t thaw_byte_size = 0;
+
+    void Merge(const SegmentGcStat& other) {
+        gc_idx_cnt += other.gc_idx_cnt;
+        gc_record_cnt += other.gc_record_cnt;
+        gc_record_byte_size += other.gc_record_byte_size;
+        freeze_cnt += other.freeze_cnt;
+        freed_byte_size += other.freed_byte_size;
+        frozen_byte_size += other.frozen_byte_size;
+        thaw_cnt += other.thaw_cnt;
+        thaw_record_cnt += other.thaw_record_cnt;
+        thaw_byte_size += other.thaw_byte_size;
+    }
+};
+
 class MemTableTraverseIterator : public TraverseIterator {
  public:
     MemTableTraverseIterator(Segment** segments, uint32_t seg_cnt, ::openmldb::storage::TTLType ttl_type,
@@ -58,11 +88,12 @@ class MemTableTraverseIterator : public TraverseIterator {
     uint32_t const seg_cnt_;
     uint32_t seg_idx_;
     KeyEntries::Iterator* pk_it_;
-    TimeEntries::Iterator* it_;
+    TimeEntryIterator* it_;
     uint32_t record_idx_;
     uint32_t ts_idx_;
     TTLSt expire_value_;
-    Ticket ticket_;
+    // pin the epoch in the lifetime of iterator, the keys and rows it stays on are not freed
+    ::openmldb::base::EpochGuard guard_;
     uint64_t traverse_cnt_;
 };
 
@@ -82,6 +113,16 @@ class MemTable : public Table {
 
     bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) override;
 
+    bool Put(uint64_t time, const char* value, uint32_t size, const Dimensions& dimensions) override;
+
+    // the dimensions are pairs of index id and key, for the rows which are not decoded to protobuf
+    bool Put(uint64_t time, const char* value, uint32_t size,
+             const std::vector<std::pair<uint32_t, Slice>>& dimensions);
+
+    // all rows are checked before any of them is put, and the rows of a segment are put with its lock
+    // acquired once
+    bool PutBatch(const std::vector<BatchPutRow>& rows) override;
+
     bool GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response);
 
     bool BulkLoad(const std::vector<DataBlock*>& data_blocks,
@@ -101,14 +142,39 @@ class MemTable : public Table {
     // release all memory allocated
     uint64_t Release();
 
+    // make a gc round. the round may stop early by the budget of gc_round_key_cnt and gc_round_time_ms,
+    // then the next round resumes from where it stopped. the round is skipped if the table is under gc by
+    // another thread
     void SchedGc() override;
 
+    // make gc rounds till the pass is finished, wait for the running round of another thread if any
+    void SchedFullGc();
+
+    // false if the last gc round was stopped by the budget
+    bool IsGcFinished() const { return gc_finished_.load(std::memory_order_relaxed); }
+    // the time in ms consumed by the last gc round
+    uint64_t GetGcConsumedTime() const { return gc_consumed_time_.load(std::memory_order_relaxed); }
+    // the total count of records and index entries reclaimed by gc
+    uint64_t GetGcRecordCnt() const { return gc_total_record_cnt_.load(std::memory_order_relaxed); }
+    uint64_t GetGcIdxCnt() const { return gc_total_idx_cnt_.load(std::memory_order_relaxed); }
+
     int GetCount(uint32_t index, const std::string& pk, uint64_t& count) override;  // NOLINT
 
     uint64_t GetRecordIdxCnt() override;
     bool GetRecordIdxCnt(uint32_t idx, uint64_t** stat, uint32_t* size) override;
     uint64_t GetRecordIdxByteSize() override;
     uint64_t GetRecordPkCnt() override;
+    // the byte size of frozen blocks, which is included in the record byte size
+    uint64_t GetFrozenByteSize();
+    // the bytes held by the table, which are the rows, the index structures and the memory retired by gc
+    // but not freed yet. the rows are shared by the segments so they are counted once
+    uint64_t GetMemByteSize();
+    // the bytes held by each segment of the index, see Segment::GetMemByteSize
+    bool GetSegmentMemByteSize(uint32_t idx, std::vector<uint64_t>* sizes);
+
+    // mark a gc scheduled for the memory limit, return false if one is pending already
+    bool TryMarkMemGc() { return !mem_gc_pending_.exchange(true, std::memory_order_relaxed); }
+    void ClearMemGc() { mem_gc_pending_.store(false, std::memory_order_relaxed); }
 
     void SetCompressType(::openmldb::type::CompressType compress_type);
     ::openmldb::type::CompressType GetCompressType();
@@ -133,11 +199,53 @@ class MemTable : public Table {
 
     bool AddIndex(const ::openmldb::common::ColumnKey& column_key);
 
+    // the segments a row is put into, the position of each segment in its index and the ts of its indexes
+    struct ParsedRow {
+        std::vector<std::pair<Segment*, Slice>> segments;
+        std::vector<uint32_t> seg_idxs;
+        std::map<int32_t, uint64_t> ts_map;
+        uint32_t ref_cnt = 0;
+    };
+
+    // PutBatch in steps, the rows are checked by ParseBatch before the binlog is written and put after it.
+    // the parsed rows refer to the dimensions of rows, rows may be a prefix of the ones parsed
+    bool ParseBatch(const std::vector<BatchPutRow>& rows, std::vector<ParsedRow>* parsed_rows);
+
+    void PutBatch(const std::vector<BatchPutRow>& rows, const std::vector<ParsedRow>& parsed_rows);
+
+    // Put in steps for the binlog recovery, which parses rows in parallel and puts a row to its segments
+    // from different threads. ParseRow is thread safe, the keys of the row refer to the dimensions
+    bool ParseRow(uint64_t time, const char* value, uint32_t size, const Dimensions& dimensions, ParsedRow* row);
+
+    bool ParseRow(uint64_t time, const char* value, uint32_t size,
+                  const std::vector<std::pair<uint32_t, Slice>>& dimensions, ParsedRow* row);
+
+    // allocate the block shared by the segments of a parsed row, the row is counted here
+    DataBlock* NewDataBlock(const ParsedRow& row, const char* value, uint32_t size);
+
+    // put the block to the segment at pos of the row, the rows put to a segment must keep their order
+    void PutSegment(const ParsedRow& row, uint32_t pos, DataBlock* block) {
+        row.segments[pos].first->Put(row.segments[pos].second, row.ts_map, block);
+    }
+
+    // the position of the segment a key goes to, it is the same in all indexes
+    uint32_t GetSegIdx(const std::string& key) const;
+
  private:
+    // the keys are mapped from the inner position of their indexes
+    bool ParseRow(uint64_t time, const char* value, uint32_t size, const std::map<int32_t, Slice>& inner_index_key_map,
+                  ParsedRow* row);
+
     bool CheckAbsolute(const TTLSt& ttl, uint64_t ts);
 
     bool CheckLatest(uint32_t index_id, const std::string& key, uint64_t ts);
 
+    // make a gc round with gc_mu_ held
+    void GcRound();
+
+    bool GcSegment(Segment* segment, const std::map<uint32_t, TTLSt>& ttl_st_map, const GcBudget& budget,
+                   bool need_freeze, uint64_t freeze_time, uint32_t fixed_len, SegmentGcStat* stat);
+
  private:
     uint32_t seg_cnt_;
     std::vector<Segment**> segments_;
@@ -147,6 +255,20 @@ class MemTable : public Table {
     bool segment_released_;
     std::atomic<uint64_t> record_byte_size_;
     uint32_t key_entry_max_height_;
+    // serializes the gc rounds of the table, e.g. the periodic gc and the gc by memory limit
+    std::mutex gc_mu_;
+    std::atomic<bool> gc_finished_;
+    std::atomic<uint64_t> gc_consumed_time_;
+    std::atomic<uint64_t> gc_total_record_cnt_;
+    std::atomic<uint64_t> gc_total_idx_cnt_;
+    // runs gc on the segments of an index in parallel, created by the first gc round which
+    // needs it and guarded by gc_mu_
+    std::unique_ptr<::openmldb::base::TaskPool> gc_pool_;
+    // the allocator of data blocks which are shared by all segments, null if slab allocation is disabled
+    std::unique_ptr<SlabAllocator> block_allocator_;
+    // shared by all segments as data blocks are shared by the segments of different indexes
+    std::unique_ptr<::openmldb::base::EpochManager> epoch_;
+    std::atomic<bool> mem_gc_pending_;
 };
 
 }  // namespace storage
@@ -23,6 +23,7 @@
 #include <snappy.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
 #include <utility>
 
@@ -40,6 +41,8 @@
 #include "log/log_reader.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/flat_snapshot.h"
+#include "storage/mem_table.h"
 
 using google::protobuf::RepeatedPtrField;
 using ::openmldb::codec::SchemaCodec;
@@ -51,6 +54,10 @@ DECLARE_uint32(load_table_batch);
 DECLARE_uint32(load_table_thread_num);
 DECLARE_uint32(load_table_queue_size);
 DECLARE_string(snapshot_compression);
+DECLARE_uint32(make_snapshot_thread_num);
+DECLARE_bool(make_flat_snapshot);
+DECLARE_uint32(snapshot_max_delta_num);
+DECLARE_uint32(snapshot_zstd_dict_size);
 
 namespace openmldb {
 namespace storage {
@@ -58,6 +65,71 @@ namespace storage {
 const std::string SNAPSHOT_SUBFIX = ".sdb";  // NOLINT
 const uint32_t KEY_NUM_DISPLAY = 1000000;    // NOLINT
 const std::string MANIFEST = "MANIFEST";     // NOLINT
+// the binlog entries handed to a part writer at a time
+const uint32_t SNAPSHOT_WRITE_BATCH = 1024;
+const uint32_t SNAPSHOT_PART_QUEUE_SIZE = 4;
+// the records sampled to train the zstd dictionary, a dictionary is not trained from fewer of them
+const uint32_t DICT_SAMPLE_NUM = 10000;
+const uint32_t DICT_MIN_SAMPLE_NUM = 100;
+
+// SnapshotReader reads the records of the files of a snapshot one after another
+class SnapshotReader {
+ public:
+    SnapshotReader(const std::string& snapshot_path, const std::vector<std::string>& names)
+        : snapshot_path_(snapshot_path), names_(names), next_(0), seq_file_(nullptr) {}
+    ~SnapshotReader() { Close(); }
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // the same as Reader::ReadRecord, it returns Eof after the last file
+    ::openmldb::log::Status ReadRecord(::openmldb::base::Slice* record, std::string* scratch) {
+        while (true) {
+            if (!reader_) {
+                if (next_ >= names_.size()) {
+                    return ::openmldb::log::Status::Eof();
+                }
+                std::string path = snapshot_path_ + "/" + names_[next_++];
+                FILE* fd = fopen(path.c_str(), "rb");
+                if (fd == NULL) {
+                    PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+                    return ::openmldb::log::Status::IOError("fail to open file", path);
+                }
+                seq_file_ = ::openmldb::log::NewSeqFile(path, fd);
+                reader_.reset(new ::openmldb::log::Reader(seq_file_, NULL, false, 0,
+                                                          MemTableSnapshot::IsCompressed(path)));
+            }
+            ::openmldb::log::Status status = reader_->ReadRecord(record, scratch);
+            if (!status.IsEof()) {
+                return status;
+            }
+            Close();
+        }
+    }
+
+ private:
+    void Close() {
+        reader_.reset();
+        // will close the fd
+        delete seq_file_;
+        seq_file_ = nullptr;
+    }
+
+    std::string snapshot_path_;
+    std::vector<std::string> names_;
+    uint32_t next_;
+    ::openmldb::log::SequentialFile* seq_file_;
+    std::unique_ptr<::openmldb::log::Reader> reader_;
+};
+
+// write the entry to the flat file, a record rewritten by RemoveDeletedKey is parsed again for the dimensions left
+static bool AppendFlat(FlatSnapshotWriter* flat, const ::openmldb::api::LogEntry& entry,
+                       const ::openmldb::base::Slice& record, bool rewritten) {
+    if (!rewritten) {
+        return flat->Append(entry);
+    }
+    ::openmldb::api::LogEntry new_entry;
+    return new_entry.ParseFromArray(record.data(), record.size()) && flat->Append(new_entry);
+}
 
 MemTableSnapshot::MemTableSnapshot(uint32_t tid, uint32_t pid, LogParts* log_part, const std::string& db_root_path)
     : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path) {}
@@ -84,7 +156,7 @@ bool MemTableSnapshot::Recover(std::shared_ptr<Table> table, uint64_t& latest_of
         return false;
     }
     if (ret == 0) {
-        RecoverFromSnapshot(manifest.name(), manifest.count(), table);
+        RecoverFromSnapshot(GetSnapshotFiles(manifest), manifest.count(), table);
         latest_offset = manifest.offset();
         offset_ = latest_offset;
     }
@@ -93,20 +165,41 @@ bool MemTableSnapshot::Recover(std::shared_ptr<Table> table, uint64_t& latest_of
 
 void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt,
                                            std::shared_ptr<Table> table) {
-    std::string full_path = snapshot_path_ + "/" + snapshot_name;
+    RecoverFromSnapshot(std::vector<std::string>{snapshot_name}, expect_cnt, table);
+}
+
+void MemTableSnapshot::RecoverFromSnapshot(const std::vector<std::string>& snapshot_names, uint64_t expect_cnt,
+                                           std::shared_ptr<Table> table) {
     std::atomic<uint64_t> g_succ_cnt(0);
     std::atomic<uint64_t> g_failed_cnt(0);
-    RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
+    if (snapshot_names.size() == 1) {
+        RecoverSingleSnapshot(snapshot_path_ + "/" + snapshot_names[0], table, &g_succ_cnt, &g_failed_cnt);
+    } else if (!snapshot_names.empty()) {
+        // the parts are read concurrently, each of them puts its records by its own pool
+        uint32_t thread_num = std::max(1u, std::min<uint32_t>(snapshot_names.size(), FLAGS_load_table_thread_num));
+        ::openmldb::base::TaskPool read_pool(thread_num, snapshot_names.size());
+        for (const auto& name : snapshot_names) {
+            read_pool.AddTask(boost::bind(&MemTableSnapshot::RecoverSingleSnapshot, this, snapshot_path_ + "/" + name,
+                                          table, &g_succ_cnt, &g_failed_cnt));
+        }
+        read_pool.Stop();
+    }
     PDLOG(INFO, "[Recover] progress done stat: success count %lu, failed count %lu",
           g_succ_cnt.load(std::memory_order_relaxed), g_failed_cnt.load(std::memory_order_relaxed));
     if (g_succ_cnt.load(std::memory_order_relaxed) != expect_cnt) {
-        PDLOG(WARNING, "snapshot %s , expect cnt %lu but succ_cnt %lu", snapshot_name.c_str(), expect_cnt,
+        PDLOG(WARNING, "snapshot %s of %lu files, expect cnt %lu but succ_cnt %lu",
+              snapshot_names.empty() ? "" : snapshot_names[0].c_str(), snapshot_names.size(), expect_cnt,
               g_succ_cnt.load(std::memory_order_relaxed));
     }
 }
 
 void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table,
                                              std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
+    // load the flat copy of the file if there is one
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    if (mem_table != nullptr && RecoverFlatSnapshot(path + FLAT_SNAPSHOT_SUFFIX, mem_table, g_succ_cnt, g_failed_cnt)) {
+        return;
+    }
     ::openmldb::base::TaskPool load_pool_(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
     std::atomic<uint64_t> succ_cnt, failed_cnt;
     succ_cnt = failed_cnt = 0;
@@ -194,29 +287,142 @@ void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std
     }
 }
 
+bool MemTableSnapshot::RecoverFlatSnapshot(const std::string& path, MemTable* table,
+                                           std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
+    if (access(path.c_str(), F_OK) != 0) {
+        return false;
+    }
+    FlatSnapshotReader reader;
+    if (!reader.Open(path)) {
+        return false;
+    }
+    uint64_t consumed = ::baidu::common::timer::now_time();
+    // the whole file is checked before a row is put, so the snapshot file can be loaded instead on a mismatch
+    if (!reader.Verify()) {
+        PDLOG(WARNING, "crc mismatch of flat snapshot %s, load the snapshot file instead", path.c_str());
+        return false;
+    }
+    std::atomic<uint64_t> succ_cnt(0);
+    std::atomic<uint64_t> failed_cnt(0);
+    {
+        ::openmldb::base::TaskPool load_pool(FLAGS_load_table_thread_num, FLAGS_load_table_batch);
+        // only the sizes of records are read here, the records are decoded and put by the pool
+        const char* data = reader.GetData();
+        uint64_t size = reader.GetDataSize();
+        uint64_t pos = 0;
+        uint64_t batch_pos = 0;
+        uint32_t batch_cnt = 0;
+        while (pos < size) {
+            uint32_t record_size = FlatSnapshotReader::GetRecordSize(data + pos, size - pos);
+            if (record_size == 0) {
+                PDLOG(WARNING, "broken record at %lu of %s", pos, path.c_str());
+                failed_cnt.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            pos += record_size;
+            if (++batch_cnt >= FLAGS_load_table_batch) {
+                load_pool.AddTask(boost::bind(&MemTableSnapshot::PutFlat, this, boost::cref(path), table,
+                                              data + batch_pos, pos - batch_pos, &succ_cnt, &failed_cnt));
+                batch_pos = pos;
+                batch_cnt = 0;
+            }
+        }
+        if (batch_cnt > 0) {
+            load_pool.AddTask(boost::bind(&MemTableSnapshot::PutFlat, this, boost::cref(path), table, data + batch_pos,
+                                          pos - batch_pos, &succ_cnt, &failed_cnt));
+        }
+        load_pool.Stop();
+    }
+    consumed = ::baidu::common::timer::now_time() - consumed;
+    PDLOG(INFO,
+          "read flat path %s for table tid %u pid %u completed, "
+          "succ_cnt %lu, failed_cnt %lu, consumed %us",
+          path.c_str(), tid_, pid_, succ_cnt.load(std::memory_order_relaxed),
+          failed_cnt.load(std::memory_order_relaxed), consumed);
+    if (succ_cnt.load(std::memory_order_relaxed) != reader.GetCount()) {
+        PDLOG(WARNING, "flat snapshot %s has %lu records but succ_cnt %lu", path.c_str(), reader.GetCount(),
+              succ_cnt.load(std::memory_order_relaxed));
+    }
+    if (g_succ_cnt) {
+        g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    }
+    if (g_failed_cnt) {
+        g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void MemTableSnapshot::PutFlat(const std::string& path, MemTable* table, const char* data, uint64_t size,
+                               std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt) {
+    FlatSnapshotReader::Row row;
+    uint64_t pos = 0;
+    while (pos < size) {
+        uint32_t record_size = FlatSnapshotReader::DecodeRecord(data + pos, size - pos, &row);
+        if (record_size == 0) {
+            failed_cnt->fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pos += record_size;
+        auto scount = succ_cnt->fetch_add(1, std::memory_order_relaxed);
+        if (scount % 100000 == 0) {
+            PDLOG(INFO, "load snapshot %s with succ_cnt %lu, failed_cnt %lu", path.c_str(), scount,
+                  failed_cnt->load(std::memory_order_relaxed));
+        }
+        // the value is copied to the data block, the keys are copied by the segments
+        table->Put(row.ts, row.value.data(), row.value.size(), row.dimensions);
+    }
+}
+
 int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
                                   WriteHandle* wh, uint64_t& count, uint64_t& expired_key_num,
                                   uint64_t& deleted_key_num) {
-    std::string full_path = snapshot_path_ + manifest.name();
+    std::set<uint32_t> deleted_index;
+    for (const auto& it : table->GetAllIndex()) {
+        if (it->GetStatus() != ::openmldb::storage::IndexStatus::kReady) {
+            deleted_index.insert(it->GetId());
+        }
+    }
+    bool has_error = false;
+    uint64_t read_cnt = 0;
+    for (const auto& name : GetSnapshotFiles(manifest)) {
+        if (FilterSnapshotFile(table, name, manifest.count(), deleted_index, wh, nullptr, &read_cnt, &count,
+                               &expired_key_num, &deleted_key_num) < 0) {
+            has_error = true;
+            break;
+        }
+    }
+    if (!has_error && read_cnt != manifest.count()) {
+        PDLOG(WARNING,
+              "key num not match! total key num[%lu] load key num[%lu] ttl key "
+              "num[%lu]",
+              manifest.count(), count, expired_key_num);
+        has_error = true;
+    }
+    if (has_error) {
+        return -1;
+    }
+    PDLOG(INFO, "load snapshot success. load key num[%lu] ttl key num[%lu]", count, expired_key_num);
+    return 0;
+}
+
+int MemTableSnapshot::FilterSnapshotFile(std::shared_ptr<Table> table, const std::string& name, uint64_t total,
+                                         const std::set<uint32_t>& deleted_index, WriteHandle* wh,
+                                         FlatSnapshotWriter* flat, uint64_t* read_cnt, uint64_t* count,
+                                         uint64_t* expired_key_num, uint64_t* deleted_key_num) {
+    std::string full_path = snapshot_path_ + name;
     FILE* fd = fopen(full_path.c_str(), "rb");
     if (fd == NULL) {
         PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
         return -1;
     }
     bool compressed = IsCompressed(full_path);
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(name, fd);
     ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
 
     std::string buffer;
     std::string tmp_buf;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
-    std::set<uint32_t> deleted_index;
-    for (const auto& it : table->GetAllIndex()) {
-        if (it->GetStatus() != ::openmldb::storage::IndexStatus::kReady) {
-            deleted_index.insert(it->GetId());
-        }
-    }
     while (true) {
         ::openmldb::base::Slice record;
         ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
@@ -235,15 +441,16 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
             has_error = true;
             break;
         }
+        (*read_cnt)++;
         int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
         if (ret == 1) {
-            deleted_key_num++;
+            (*deleted_key_num)++;
             continue;
         } else if (ret == 2) {
             record.reset(tmp_buf.data(), tmp_buf.size());
         }
         if (table->IsExpire(entry)) {
-            expired_key_num++;
+            (*expired_key_num)++;
             continue;
         }
         status = wh->Write(record);
@@ -252,24 +459,18 @@ int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb
             has_error = true;
             break;
         }
-        if ((count + expired_key_num + deleted_key_num) % KEY_NUM_DISPLAY == 0) {
-            PDLOG(INFO, "tackled key num[%lu] total[%lu]", count + expired_key_num, manifest.count());
+        if (flat != nullptr && !AppendFlat(flat, entry, record, ret == 2)) {
+            PDLOG(WARNING, "fail to write flat snapshot of %s", name.c_str());
+            has_error = true;
+            break;
         }
-        count++;
+        if ((*count + *expired_key_num + *deleted_key_num) % KEY_NUM_DISPLAY == 0) {
+            PDLOG(INFO, "tackled key num[%lu] total[%lu]", *count + *expired_key_num, total);
+        }
+        (*count)++;
     }
     delete seq_file;
-    if (expired_key_num + count + deleted_key_num != manifest.count()) {
-        PDLOG(WARNING,
-              "key num not match! total key num[%lu] load key num[%lu] ttl key "
-              "num[%lu]",
-              manifest.count(), count, expired_key_num);
-        has_error = true;
-    }
-    if (has_error) {
-        return -1;
-    }
-    PDLOG(INFO, "load snapshot success. load key num[%lu] ttl key num[%lu]", count, expired_key_num);
-    return 0;
+    return has_error ? -1 : 0;
 }
 
 uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
@@ -341,6 +542,68 @@ uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
     return cur_offset;
 }
 
+void MemTableSnapshot::FilterSnapshotPart(std::shared_ptr<Table> table, const std::string& name, uint64_t total,
+                                          const std::set<uint32_t>& deleted_index, SnapshotPart* part) {
+    if (part->has_error) {
+        return;
+    }
+    if (FilterSnapshotFile(table, name, total, deleted_index, part->wh, part->flat.get(), &part->snapshot_read_cnt,
+                           &part->write_count, &part->expired_key_num, &part->deleted_key_num) < 0) {
+        part->has_error = true;
+    }
+}
+
+void MemTableSnapshot::WriteSnapshotPart(std::shared_ptr<Table> table, std::shared_ptr<SnapshotBatch> batch,
+                                         const std::set<uint32_t>& deleted_index, SnapshotPart* part) {
+    if (part->has_error) {
+        return;
+    }
+    std::string tmp_buf;
+    for (uint32_t i = 0; i < batch->entries.size(); i++) {
+        const auto& entry = batch->entries[i];
+        ::openmldb::base::Slice record(batch->records[i]);
+        int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
+        if (ret == 1) {
+            part->deleted_key_num++;
+            continue;
+        } else if (ret == 2) {
+            record.reset(tmp_buf.data(), tmp_buf.size());
+        }
+        if (table->IsExpire(entry)) {
+            part->expired_key_num++;
+            continue;
+        }
+        ::openmldb::log::Status status = part->wh->Write(record);
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to write snapshot. path[%s] status[%s]", part->name.c_str(),
+                  status.ToString().c_str());
+            part->has_error = true;
+            return;
+        }
+        if (part->flat && !AppendFlat(part->flat.get(), entry, record, ret == 2)) {
+            PDLOG(WARNING, "fail to write flat snapshot of %s", part->name.c_str());
+            part->has_error = true;
+            return;
+        }
+        part->write_count++;
+        if ((part->write_count + part->expired_key_num + part->deleted_key_num) % KEY_NUM_DISPLAY == 0) {
+            PDLOG(INFO, "has write key num[%lu] expired key num[%lu] to %s", part->write_count,
+                  part->expired_key_num, part->name.c_str());
+        }
+    }
+}
+
+void MemTableSnapshot::RemoveSnapshotFiles(const ::openmldb::api::Manifest& manifest,
+                                           const std::vector<std::string>& keep) {
+    for (const auto& name : GetSnapshotFiles(manifest)) {
+        if (std::find(keep.begin(), keep.end(), name) == keep.end()) {
+            DEBUGLOG("old snapshot[%s] has deleted", name.c_str());
+            unlink((snapshot_path_ + name).c_str());
+            unlink((snapshot_path_ + name + FLAT_SNAPSHOT_SUFFIX).c_str());
+        }
+    }
+}
+
 int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset,
                                    uint64_t term) {
     if (making_snapshot_.load(std::memory_order_acquire)) {
@@ -352,41 +615,98 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
         return -1;
     }
     making_snapshot_.store(true, std::memory_order_release);
-    std::string now_time = ::openmldb::base::GetNowTime();
-    std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
-    if (FLAGS_snapshot_compression != "off") {
-        snapshot_name.append(".");
-        snapshot_name.append(FLAGS_snapshot_compression);
-    }
-    std::string snapshot_name_tmp = snapshot_name + ".tmp";
-    std::string full_path = snapshot_path_ + snapshot_name;
-    std::string tmp_file_path = snapshot_path_ + snapshot_name_tmp;
-    FILE* fd = fopen(tmp_file_path.c_str(), "ab+");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
+    ::openmldb::api::Manifest manifest;
+    int result = GetLocalManifest(snapshot_path_ + MANIFEST, manifest);
+    if (result < 0) {
+        // parse manifest error
         making_snapshot_.store(false, std::memory_order_release);
         return -1;
     }
     uint64_t collected_offset = CollectDeletedKey(end_offset);
+    std::string snapshot_name = GenSnapshotName();
+    std::vector<std::string> old_files = GetSnapshotFiles(manifest);
+    // the binlog since the last snapshot is written to a delta if it has puts only, as the deleted keys have to be
+    // removed from the old files. the old files are merged into a new snapshot once there are enough deltas
+    bool is_delta = false;
+    if (result == 0 && FLAGS_snapshot_max_delta_num > 0 && deleted_keys_.empty() &&
+        static_cast<uint32_t>(manifest.deltas_size()) < FLAGS_snapshot_max_delta_num) {
+        std::string delta_name = snapshot_name;
+        delta_name.insert(delta_name.find(SNAPSHOT_SUBFIX), "_d" + std::to_string(manifest.deltas_size() + 1));
+        if (std::find(old_files.begin(), old_files.end(), delta_name) == old_files.end()) {
+            is_delta = true;
+            snapshot_name = delta_name;
+        }
+    }
+    if (is_delta && collected_offset <= offset_) {
+        PDLOG(INFO, "no binlog after offset %lu, skip delta snapshot. tid %u pid %u", offset_, tid_, pid_);
+        out_offset = offset_;
+        making_snapshot_.store(false, std::memory_order_release);
+        return 0;
+    }
+    // the snapshot is written to a part file by each thread, the first part is named as a snapshot of one file
+    uint32_t part_num = is_delta ? 1 : std::max(1u, FLAGS_make_snapshot_thread_num);
+    std::vector<std::unique_ptr<SnapshotPart>> parts;
+    std::vector<std::string> part_names;
+    std::string dictionary = TrainSnapshotDictionary(result == 0 ? old_files : std::vector<std::string>(),
+                                                     collected_offset);
+    for (uint32_t i = 0; i < part_num; i++) {
+        std::string name = snapshot_name;
+        if (i > 0) {
+            name.insert(name.find(SNAPSHOT_SUBFIX), "_" + std::to_string(i));
+        }
+        std::string tmp_file_path = snapshot_path_ + name + ".tmp";
+        FILE* fd = fopen(tmp_file_path.c_str(), "ab+");
+        if (fd == NULL) {
+            PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
+            for (auto& part : parts) {
+                delete part->wh;
+                unlink((snapshot_path_ + part->name + ".tmp").c_str());
+                unlink((snapshot_path_ + part->name + FLAT_SNAPSHOT_SUFFIX + ".tmp").c_str());
+            }
+            deleted_keys_.clear();
+            making_snapshot_.store(false, std::memory_order_release);
+            return -1;
+        }
+        auto part = std::make_unique<SnapshotPart>();
+        part->name = name;
+        part->wh = new WriteHandle(FLAGS_snapshot_compression, name + ".tmp", fd);
+        if (!dictionary.empty()) {
+            // the part is compressed without the dictionary if it fails
+            part->wh->SetDictionary(dictionary);
+        }
+        if (FLAGS_make_flat_snapshot) {
+            // the flat copy is optional, the part is written without it if it fails
+            part->flat.reset(new FlatSnapshotWriter());
+            std::string flat_tmp_path = snapshot_path_ + name + FLAT_SNAPSHOT_SUFFIX + ".tmp";
+            if (!part->flat->Open(flat_tmp_path)) {
+                part->flat.reset();
+                unlink(flat_tmp_path.c_str());
+            }
+        }
+        parts.push_back(std::move(part));
+        part_names.push_back(name);
+    }
     uint64_t start_time = ::baidu::common::timer::now_time();
-    WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, snapshot_name_tmp, fd);
-    ::openmldb::api::Manifest manifest;
+    for (auto& part : parts) {
+        part->pool.reset(new ::openmldb::base::TaskPool(1, SNAPSHOT_PART_QUEUE_SIZE));
+    }
     bool has_error = false;
-    uint64_t write_count = 0;
-    uint64_t expired_key_num = 0;
-    uint64_t deleted_key_num = 0;
     uint64_t last_term = term;
-    int result = GetLocalManifest(snapshot_path_ + MANIFEST, manifest);
+    // the old snapshot is filtered by ttl, each of its files by one of the parts
+    std::set<uint32_t> not_ready_index;
+    for (const auto& it : table->GetAllIndex()) {
+        if (it->GetStatus() != ::openmldb::storage::IndexStatus::kReady) {
+            not_ready_index.insert(it->GetId());
+        }
+    }
     if (result == 0) {
-        // filter old snapshot
-        if (TTLSnapshot(table, manifest, wh, write_count, expired_key_num, deleted_key_num) < 0) {
-            has_error = true;
+        for (uint32_t i = 0; !is_delta && i < old_files.size(); i++) {
+            SnapshotPart* part = parts[i % part_num].get();
+            part->pool->AddTask(boost::bind(&MemTableSnapshot::FilterSnapshotPart, this, table, old_files[i],
+                                            manifest.count(), boost::cref(not_ready_index), part));
         }
         last_term = manifest.term();
         DEBUGLOG("old manifest term is %lu", last_term);
-    } else if (result < 0) {
-        // parse manifest error
-        has_error = true;
     }
 
     // get deleted index
@@ -396,11 +716,13 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             deleted_index.insert(it->GetId());
         }
     }
+    // the entries of the binlog are handed to the parts in batches by turns
     ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
     log_reader.SetOffset(offset_);
     uint64_t cur_offset = offset_;
     std::string buffer;
-    std::string tmp_buf;
+    uint32_t batch_cnt = 0;
+    auto batch = std::make_shared<SnapshotBatch>();
     while (!has_error && cur_offset < collected_offset) {
         buffer.clear();
         ::openmldb::base::Slice record;
@@ -428,27 +750,13 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             if (entry.has_term()) {
                 last_term = entry.term();
             }
-            int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
-            if (ret == 1) {
-                deleted_key_num++;
-                continue;
-            } else if (ret == 2) {
-                record.reset(tmp_buf.data(), tmp_buf.size());
-            }
-            if (table->IsExpire(entry)) {
-                expired_key_num++;
-                continue;
-            }
-            ::openmldb::log::Status status = wh->Write(record);
-            if (!status.ok()) {
-                PDLOG(WARNING, "fail to write snapshot. path[%s] status[%s]", tmp_file_path.c_str(),
-                      status.ToString().c_str());
-                has_error = true;
-                break;
-            }
-            write_count++;
-            if ((write_count + expired_key_num + deleted_key_num) % KEY_NUM_DISPLAY == 0) {
-                PDLOG(INFO, "has write key num[%lu] expired key num[%lu]", write_count, expired_key_num);
+            batch->records.emplace_back(record.data(), record.size());
+            batch->entries.push_back(std::move(entry));
+            if (batch->entries.size() >= SNAPSHOT_WRITE_BATCH) {
+                SnapshotPart* part = parts[batch_cnt++ % part_num].get();
+                part->pool->AddTask(boost::bind(&MemTableSnapshot::WriteSnapshotPart, this, table, batch,
+                                                boost::cref(deleted_index), part));
+                batch = std::make_shared<SnapshotBatch>();
             }
         } else if (status.IsEof()) {
             continue;
@@ -472,42 +780,96 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             break;
         }
     }
-    if (wh != NULL) {
-        wh->EndLog();
-        delete wh;
-        wh = NULL;
+    if (!has_error && !batch->entries.empty()) {
+        SnapshotPart* part = parts[batch_cnt++ % part_num].get();
+        part->pool->AddTask(boost::bind(&MemTableSnapshot::WriteSnapshotPart, this, table, batch,
+                                        boost::cref(deleted_index), part));
+    }
+    uint64_t write_count = 0;
+    uint64_t expired_key_num = 0;
+    uint64_t deleted_key_num = 0;
+    uint64_t snapshot_read_cnt = 0;
+    for (auto& part : parts) {
+        part->pool->Stop();
+        part->wh->EndLog();
+        delete part->wh;
+        part->wh = NULL;
+        if (part->flat && !part->flat->Close()) {
+            part->flat.reset();
+            unlink((snapshot_path_ + part->name + FLAT_SNAPSHOT_SUFFIX + ".tmp").c_str());
+        }
+        has_error = has_error || part->has_error;
+        write_count += part->write_count;
+        expired_key_num += part->expired_key_num;
+        deleted_key_num += part->deleted_key_num;
+        snapshot_read_cnt += part->snapshot_read_cnt;
+    }
+    if (!has_error && result == 0 && !is_delta && snapshot_read_cnt != manifest.count()) {
+        PDLOG(WARNING, "key num not match! total key num[%lu] read key num[%lu]", manifest.count(),
+              snapshot_read_cnt);
+        has_error = true;
+    }
+    uint32_t renamed_cnt = 0;
+    if (!has_error) {
+        for (; renamed_cnt < part_num; renamed_cnt++) {
+            const std::string& name = part_names[renamed_cnt];
+            if (rename((snapshot_path_ + name + ".tmp").c_str(), (snapshot_path_ + name).c_str()) != 0) {
+                PDLOG(WARNING, "rename[%s] failed", name.c_str());
+                has_error = true;
+                break;
+            }
+        }
+    }
+    if (!has_error) {
+        int gen_ret = 0;
+        if (is_delta) {
+            std::vector<std::string> base_parts(manifest.parts().begin(), manifest.parts().end());
+            std::vector<std::string> deltas(manifest.deltas().begin(), manifest.deltas().end());
+            deltas.push_back(snapshot_name);
+            gen_ret = GenManifest(manifest.name(), manifest.count() + write_count, cur_offset, last_term,
+                                  base_parts, deltas);
+        } else {
+            gen_ret = GenManifest(snapshot_name, write_count, cur_offset, last_term,
+                                  part_num > 1 ? part_names : std::vector<std::string>());
+        }
+        if (gen_ret != 0) {
+            PDLOG(WARNING, "GenManifest failed. delete snapshot file[%s]", snapshot_name.c_str());
+            has_error = true;
+        }
     }
     int ret = 0;
     if (has_error) {
-        unlink(tmp_file_path.c_str());
+        for (uint32_t i = 0; i < part_num; i++) {
+            std::string path = snapshot_path_ + part_names[i];
+            unlink(i < renamed_cnt ? path.c_str() : (path + ".tmp").c_str());
+            if (parts[i]->flat) {
+                unlink((path + FLAT_SNAPSHOT_SUFFIX + ".tmp").c_str());
+            }
+        }
         ret = -1;
     } else {
-        if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
-            if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
-                // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
+        for (auto& part : parts) {
+            if (part->flat) {
+                std::string flat_path = snapshot_path_ + part->name + FLAT_SNAPSHOT_SUFFIX;
+                if (rename((flat_path + ".tmp").c_str(), flat_path.c_str()) != 0) {
+                    PDLOG(WARNING, "rename[%s] failed", flat_path.c_str());
+                    unlink((flat_path + ".tmp").c_str());
                 }
-                uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
-                PDLOG(INFO,
-                      "make snapshot[%s] success. update offset from %lu to %lu."
-                      "use %lu second. write key %lu expired key %lu deleted key "
-                      "%lu",
-                      snapshot_name.c_str(), offset_, cur_offset, consumed, write_count, expired_key_num,
-                      deleted_key_num);
-                offset_ = cur_offset;
-                out_offset = cur_offset;
-            } else {
-                PDLOG(WARNING, "GenManifest failed. delete snapshot file[%s]", full_path.c_str());
-                unlink(full_path.c_str());
-                ret = -1;
             }
-        } else {
-            PDLOG(WARNING, "rename[%s] failed", snapshot_name.c_str());
-            unlink(tmp_file_path.c_str());
-            ret = -1;
         }
+        // delete old snapshot, which is merged into the new one
+        if (!is_delta) {
+            RemoveSnapshotFiles(manifest, part_names);
+        }
+        uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
+        PDLOG(INFO,
+              "make %s snapshot[%s] of %u parts success. update offset from %lu to %lu."
+              "use %lu second. write key %lu expired key %lu deleted key "
+              "%lu",
+              is_delta ? "delta" : "full", snapshot_name.c_str(), part_num, offset_, cur_offset, consumed,
+              write_count, expired_key_num, deleted_key_num);
+        offset_ = cur_offset;
+        out_offset = cur_offset;
     }
     deleted_keys_.clear();
     making_snapshot_.store(false, std::memory_order_release);
@@ -670,15 +1032,7 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         }
         index_vec.push_back(index_def);
     }
-    std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
-        return base::Status(base::ReturnCode::kError, "fail to open file");
-    }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
+    SnapshotReader reader(snapshot_path_, GetSnapshotFiles(manifest));
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -770,7 +1124,6 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         }
         (*count)++;
     }
-    delete seq_file;
     if (*expired_key_num + write_count + *deleted_key_num != manifest.count()) {
         PDLOG(WARNING, "key num not match! total key[%lu] load key[%lu] ttl key[%lu] delete key [%lu], tid %u pid %u",
                 manifest.count(), *count, *expired_key_num, *deleted_key_num, tid, pid);
@@ -790,15 +1143,7 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
                                                uint64_t& expired_key_num, uint64_t& deleted_key_num) {
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
-    std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
-        return -1;
-    }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
+    SnapshotReader reader(snapshot_path_, GetSnapshotFiles(manifest));
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -928,7 +1273,6 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
         }
         count++;
     }
-    delete seq_file;
     if (expired_key_num + count + deleted_key_num + schame_size_less_count + other_error_count != manifest.count()) {
         LOG(WARNING) << "key num not match ! total key num[" << manifest.count() << "] load key num[" << count
                      << "] ttl key num[" << expired_key_num << "] schema size less num[" << schame_size_less_count
@@ -946,6 +1290,60 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
     return 0;
 }
 
+std::string MemTableSnapshot::TrainSnapshotDictionary(const std::vector<std::string>& old_files,
+                                                      uint64_t end_offset) {
+    if (FLAGS_snapshot_compression != "zstd" || FLAGS_snapshot_zstd_dict_size == 0) {
+        return "";
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::vector<std::string> samples;
+    std::string buffer;
+    // the new records are sampled first
+    ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
+    log_reader.SetOffset(offset_);
+    uint64_t cur_offset = offset_;
+    while (samples.size() < DICT_SAMPLE_NUM && cur_offset < end_offset) {
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            ::openmldb::api::LogEntry entry;
+            if (!entry.ParseFromString(record.ToString())) {
+                break;
+            }
+            if (entry.log_index() <= cur_offset) {
+                continue;
+            }
+            cur_offset = entry.log_index();
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                continue;
+            }
+            samples.push_back(record.ToString());
+        } else if (status.IsEof()) {
+            continue;
+        } else if (status.IsWaitRecord() && log_reader.GetEndLogIndex() > log_reader.GetLogIndex()) {
+            log_reader.RollRLogFile();
+        } else {
+            break;
+        }
+    }
+    SnapshotReader snapshot_reader(snapshot_path_, old_files);
+    while (samples.size() < DICT_SAMPLE_NUM) {
+        ::openmldb::base::Slice record;
+        if (!snapshot_reader.ReadRecord(&record, &buffer).ok()) {
+            break;
+        }
+        samples.push_back(record.ToString());
+    }
+    if (samples.size() < DICT_MIN_SAMPLE_NUM) {
+        PDLOG(INFO, "%lu records are too few to train dictionary. tid %u pid %u", samples.size(), tid_, pid_);
+        return "";
+    }
+    std::string dictionary = ::openmldb::log::TrainDictionary(samples, FLAGS_snapshot_zstd_dict_size);
+    PDLOG(INFO, "train dictionary of %lu bytes from %lu records, use %lu us. tid %u pid %u", dictionary.size(),
+          samples.size(), ::baidu::common::timer::get_micros() - start_time, tid_, pid_);
+    return dictionary;
+}
+
 std::string MemTableSnapshot::GenSnapshotName() {
     std::string now_time = ::openmldb::base::GetNowTime();
     std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
@@ -1161,10 +1559,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table,
         if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
             if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
                 // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
-                }
+                RemoveSnapshotFiles(manifest, {snapshot_name});
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
                       "make snapshot[%s] success. update offset from %lu to %lu."
@@ -1427,10 +1822,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
         if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
             if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
                 // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
-                }
+                RemoveSnapshotFiles(manifest, {snapshot_name});
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
                       "make snapshot[%s] success. update offset from %lu to %lu."
@@ -1548,14 +1940,7 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
     std::string path = snapshot_path_ + "/" + manifest.name();
     uint64_t succ_cnt = 0;
     uint64_t failed_cnt = 0;
-    FILE* fd = fopen(path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
-        return false;
-    }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
-    bool compressed = IsCompressed(path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
+    SnapshotReader reader(snapshot_path_, GetSnapshotFiles(manifest));
     ::openmldb::api::LogEntry entry;
     std::string buffer;
     std::string entry_buff;
@@ -1593,7 +1978,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         ::openmldb::base::Slice new_record(entry_str);
         status = whs[index_pid]->Write(new_record);
         if (!status.ok()) {
-            delete seq_file;
             PDLOG(WARNING,
                   "fail to dump index entrylog in snapshot to pid[%u]. tid "
                   "%u pid %u",
@@ -1602,7 +1986,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         }
         succ_cnt++;
     }
-    delete seq_file;
     return true;
 }
 
@@ -1790,7 +2173,8 @@ int MemTableSnapshot::DecodeData(std::shared_ptr<Table> table, const openmldb::a
 
 bool MemTableSnapshot::IsCompressed(const std::string& path) {
     if (path.find(openmldb::log::ZLIB_COMPRESS_SUFFIX) != std::string::npos ||
-        path.find(openmldb::log::SNAPPY_COMPRESS_SUFFIX) != std::string::npos) {
+        path.find(openmldb::log::SNAPPY_COMPRESS_SUFFIX) != std::string::npos ||
+        path.find(openmldb::log::ZSTD_COMPRESS_SUFFIX) != std::string::npos) {
         return true;
     }
     return false;
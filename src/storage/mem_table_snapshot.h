@@ -24,11 +24,13 @@
 #include <vector>
 
 #include "base/status.h"
+#include "base/taskpool.hpp"
 #include "codec/schema_codec.h"
 #include "log/log_reader.h"
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/flat_snapshot.h"
 #include "storage/snapshot.h"
 
 using ::openmldb::api::LogEntry;
@@ -39,6 +41,8 @@ using ::openmldb::log::WriteHandle;
 
 typedef ::openmldb::base::Skiplist<uint32_t, uint64_t, ::openmldb::base::DefaultComparator> LogParts;
 
+class MemTable;
+
 // table snapshot
 class MemTableSnapshot : public Snapshot {
  public:
@@ -52,6 +56,10 @@ class MemTableSnapshot : public Snapshot {
 
     void RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt, std::shared_ptr<Table> table);
 
+    // the files of a snapshot are recovered concurrently
+    void RecoverFromSnapshot(const std::vector<std::string>& snapshot_names, uint64_t expect_cnt,
+                             std::shared_ptr<Table> table);
+
     int MakeSnapshot(std::shared_ptr<Table> table,
                      uint64_t& out_offset,  // NOLINT
                      uint64_t end_offset,
@@ -115,18 +123,66 @@ class MemTableSnapshot : public Snapshot {
     int RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
                          std::string* buffer);
 
+    static bool IsCompressed(const std::string& path);
+
  private:
+    // a part file of the snapshot being made, it is written by the single thread of its pool
+    struct SnapshotPart {
+        std::string name;
+        WriteHandle* wh = nullptr;
+        // the flat copy of the part, null if make_flat_snapshot is off
+        std::unique_ptr<FlatSnapshotWriter> flat;
+        std::unique_ptr<::openmldb::base::TaskPool> pool;
+        uint64_t snapshot_read_cnt = 0;
+        uint64_t write_count = 0;
+        uint64_t expired_key_num = 0;
+        uint64_t deleted_key_num = 0;
+        bool has_error = false;
+    };
+
+    // the binlog entries handed to a part with their records
+    struct SnapshotBatch {
+        std::vector<std::string> records;
+        std::vector<::openmldb::api::LogEntry> entries;
+    };
+
+    // write the records of a file of the old snapshot which are not deleted or expired, to the flat file too
+    // if flat is not null
+    int FilterSnapshotFile(std::shared_ptr<Table> table, const std::string& name, uint64_t total,
+                           const std::set<uint32_t>& deleted_index, WriteHandle* wh, FlatSnapshotWriter* flat,
+                           uint64_t* read_cnt, uint64_t* count, uint64_t* expired_key_num,
+                           uint64_t* deleted_key_num);
+
+    void FilterSnapshotPart(std::shared_ptr<Table> table, const std::string& name, uint64_t total,
+                            const std::set<uint32_t>& deleted_index, SnapshotPart* part);
+
+    void WriteSnapshotPart(std::shared_ptr<Table> table, std::shared_ptr<SnapshotBatch> batch,
+                           const std::set<uint32_t>& deleted_index, SnapshotPart* part);
+
+    // remove the files of the snapshot in the manifest except the ones to keep
+    void RemoveSnapshotFiles(const ::openmldb::api::Manifest& manifest, const std::vector<std::string>& keep);
+
     // load single snapshot to table
     void RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
                                std::atomic<uint64_t>* g_failed_cnt);
 
+    // load the flat copy of a snapshot file, return false if there is no complete one or its crc mismatches
+    bool RecoverFlatSnapshot(const std::string& path, MemTable* table, std::atomic<uint64_t>* g_succ_cnt,
+                             std::atomic<uint64_t>* g_failed_cnt);
+
+    // put the flat records in [data, data + size)
+    void PutFlat(const std::string& path, MemTable* table, const char* data, uint64_t size,
+                 std::atomic<uint64_t>* succ_cnt, std::atomic<uint64_t>* failed_cnt);
+
     uint64_t CollectDeletedKey(uint64_t end_offset);
 
+    // train the zstd dictionary of the snapshot from the records of the binlog before end_offset and then the old
+    // files, it is empty if the dictionary is off or there are too few records
+    std::string TrainSnapshotDictionary(const std::vector<std::string>& old_files, uint64_t end_offset);
+
     int DecodeData(std::shared_ptr<Table> table, const openmldb::api::LogEntry& entry, uint32_t maxIdx,
                    std::vector<std::string>& row);  // NOLINT
 
-    inline bool IsCompressed(const std::string& path);
-
  private:
     LogParts* log_part_;
     std::string log_path_;
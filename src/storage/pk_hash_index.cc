@@ -0,0 +1,295 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pk_hash_index.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <shared_mutex>  // NOLINT
+#include <vector>
+
+#include "base/glog_wrapper.h"
+#include "base/hash.h"
+
+namespace openmldb {
+namespace storage {
+
+// differ from the seed used to choose segment, or else the keys of one segment
+// share the low bits of hash
+static const uint32_t HASH_SEED = 0x9747b28c;
+
+PkHashIndex::PkHashIndex(const std::atomic<uint64_t>* gc_version, SlabAllocator* allocator)
+    : table_(nullptr),
+      old_table_(nullptr),
+      resize_mu_(),
+      migrate_mu_(),
+      migrate_pos_(0),
+      size_(0),
+      byte_size_(0),
+      gc_version_(gc_version),
+      allocator_(allocator) {
+    table_.store(NewTable(INIT_BUCKET_NUM), std::memory_order_release);
+}
+
+PkHashIndex::~PkHashIndex() {
+    Clear();
+    FreeTable(table_.load(std::memory_order_relaxed));
+}
+
+uint64_t PkHashIndex::Hash(const Slice& key) {
+    return ::openmldb::base::MurmurHash64A(key.data(), key.size(), HASH_SEED);
+}
+
+bool PkHashIndex::Match(const HashNode* node, uint32_t hash, const Slice& key) {
+    return node->hash == hash && node->key_size == key.size() && memcmp(node->key, key.data(), key.size()) == 0;
+}
+
+PkHashIndex::BucketTable* PkHashIndex::NewTable(uint32_t bucket_num) {
+    BucketTable* table = new BucketTable();
+    table->mask = bucket_num - 1;
+    table->buckets = new std::atomic<HashNode*>[bucket_num];
+    for (uint32_t i = 0; i < bucket_num; i++) {
+        table->buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+    byte_size_.fetch_add(sizeof(std::atomic<HashNode*>) * bucket_num, std::memory_order_relaxed);
+    return table;
+}
+
+void PkHashIndex::FreeTable(BucketTable* table) {
+    byte_size_.fetch_sub(sizeof(std::atomic<HashNode*>) * (table->mask + 1), std::memory_order_relaxed);
+    delete[] table->buckets;
+    delete table;
+}
+
+PkHashIndex::HashNode* PkHashIndex::NewNode(uint32_t hash, const char* key, uint32_t key_size, void* value) {
+    HashNode* node = nullptr;
+    if (allocator_ != nullptr) {
+        node = reinterpret_cast<HashNode*>(allocator_->Allocate(sizeof(HashNode)));
+    } else {
+        node = new HashNode();
+    }
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->value = value;
+    node->key = key;
+    node->key_size = key_size;
+    node->hash = hash;
+    byte_size_.fetch_add(sizeof(HashNode), std::memory_order_relaxed);
+    return node;
+}
+
+void PkHashIndex::FreeNode(HashNode* node) {
+    byte_size_.fetch_sub(sizeof(HashNode), std::memory_order_relaxed);
+    if (allocator_ != nullptr) {
+        allocator_->Free(node, sizeof(HashNode));
+    } else {
+        delete node;
+    }
+}
+
+bool PkHashIndex::Find(const BucketTable* table, uint64_t h, const Slice& key, void*& value) {
+    uint32_t hash = static_cast<uint32_t>(h >> 32);
+    HashNode* node = table->buckets[h & table->mask].load(std::memory_order_acquire);
+    while (node != nullptr) {
+        if (Match(node, hash, key)) {
+            value = node->value;
+            return true;
+        }
+        node = node->next.load(std::memory_order_acquire);
+    }
+    return false;
+}
+
+bool PkHashIndex::Get(const Slice& key, void*& value) const {
+    uint64_t h = Hash(key);
+    while (true) {
+        BucketTable* table = table_.load(std::memory_order_acquire);
+        BucketTable* old_table = old_table_.load(std::memory_order_acquire);
+        // a bucket of the old table is emptied after its nodes are in the new one,
+        // so the old table is looked into first
+        if (old_table != nullptr && old_table != table && Find(old_table, h, key, value)) {
+            return true;
+        }
+        if (Find(table, h, key, value)) {
+            return true;
+        }
+        // the key may be moved out of the table read while a resizing starts
+        if (table == table_.load(std::memory_order_acquire) &&
+            old_table == old_table_.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+}
+
+void PkHashIndex::Insert(const Slice& key, void* value) {
+    uint64_t h = Hash(key);
+    HashNode* node = NewNode(static_cast<uint32_t>(h >> 32), key.data(), key.size(), value);
+    uint32_t bucket_num = 0;
+    {
+        std::shared_lock<::openmldb::base::SharedSpinMutex> lock(resize_mu_);
+        BucketTable* table = table_.load(std::memory_order_acquire);
+        std::atomic<HashNode*>& bucket = table->buckets[h & table->mask];
+        HashNode* head = bucket.load(std::memory_order_relaxed);
+        do {
+            node->next.store(head, std::memory_order_relaxed);
+        } while (!bucket.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        bucket_num = table->mask + 1;
+    }
+    if (size_.fetch_add(1, std::memory_order_relaxed) + 1 > static_cast<uint64_t>(bucket_num) * MAX_LOAD_FACTOR) {
+        Resize();
+    }
+    if (old_table_.load(std::memory_order_relaxed) != nullptr) {
+        Migrate(MIGRATE_BUCKET_NUM);
+    }
+}
+
+bool PkHashIndex::RemoveFrom(BucketTable* table, uint64_t h, const Slice& key) {
+    uint32_t hash = static_cast<uint32_t>(h >> 32);
+    std::atomic<HashNode*>* pre = &table->buckets[h & table->mask];
+    HashNode* node = pre->load(std::memory_order_acquire);
+    while (node != nullptr) {
+        if (Match(node, hash, key)) {
+            // keep node->next so that the readers on the node can go on
+            pre->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(retired_mu_);
+            retired_nodes_.emplace_back(gc_version_->load(std::memory_order_relaxed), node);
+            return true;
+        }
+        pre = &node->next;
+        node = pre->load(std::memory_order_acquire);
+    }
+    return false;
+}
+
+bool PkHashIndex::Remove(const Slice& key) {
+    uint64_t h = Hash(key);
+    // Remove is excluded from Insert, so the tables are not switched or migrated meanwhile
+    BucketTable* old_table = old_table_.load(std::memory_order_acquire);
+    if (old_table != nullptr && RemoveFrom(old_table, h, key)) {
+        return true;
+    }
+    return RemoveFrom(table_.load(std::memory_order_acquire), h, key);
+}
+
+void PkHashIndex::Resize() {
+    std::lock_guard<std::mutex> lock(migrate_mu_);
+    if (old_table_.load(std::memory_order_relaxed) != nullptr) {
+        // the last resizing is not finished, it is finished by the coming inserts
+        return;
+    }
+    BucketTable* old_table = table_.load(std::memory_order_relaxed);
+    uint32_t old_bucket_num = old_table->mask + 1;
+    if (size_.load(std::memory_order_relaxed) <= static_cast<uint64_t>(old_bucket_num) * MAX_LOAD_FACTOR) {
+        // another writer has resized it
+        return;
+    }
+    BucketTable* new_table = NewTable(old_bucket_num * 2);
+    {
+        // wait for the inserts into the old table, the later ones go to the new table
+        std::lock_guard<::openmldb::base::SharedSpinMutex> resize_lock(resize_mu_);
+        old_table_.store(old_table, std::memory_order_release);
+        table_.store(new_table, std::memory_order_release);
+    }
+    migrate_pos_ = 0;
+    DEBUGLOG("resize pk hash index from %u to %u buckets", old_bucket_num, new_table->mask + 1);
+}
+
+void PkHashIndex::Migrate(uint32_t bucket_num) {
+    std::unique_lock<std::mutex> lock(migrate_mu_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // another writer is migrating
+        return;
+    }
+    BucketTable* old_table = old_table_.load(std::memory_order_relaxed);
+    if (old_table == nullptr) {
+        return;
+    }
+    BucketTable* table = table_.load(std::memory_order_relaxed);
+    std::vector<HashNode*> moved;
+    uint32_t end = std::min(migrate_pos_ + bucket_num, old_table->mask + 1);
+    for (; migrate_pos_ < end; migrate_pos_++) {
+        std::atomic<HashNode*>& old_bucket = old_table->buckets[migrate_pos_];
+        HashNode* node = old_bucket.load(std::memory_order_acquire);
+        // readers may be walking the old chains, so the nodes are copied rather than relinked
+        while (node != nullptr) {
+            uint64_t h = Hash(Slice(node->key, node->key_size));
+            std::atomic<HashNode*>& bucket = table->buckets[h & table->mask];
+            HashNode* new_node = NewNode(node->hash, node->key, node->key_size, node->value);
+            HashNode* head = bucket.load(std::memory_order_relaxed);
+            do {
+                new_node->next.store(head, std::memory_order_relaxed);
+            } while (
+                !bucket.compare_exchange_weak(head, new_node, std::memory_order_release, std::memory_order_relaxed));
+            moved.push_back(node);
+            node = node->next.load(std::memory_order_relaxed);
+        }
+        // the copies are visible to a reader which finds the bucket empty
+        old_bucket.store(nullptr, std::memory_order_release);
+    }
+    bool finished = migrate_pos_ > old_table->mask;
+    if (finished) {
+        old_table_.store(nullptr, std::memory_order_release);
+    }
+    // the version is taken after the unlink, a reader pinning it can not see the retired memory
+    uint64_t version = gc_version_->load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> retired_lock(retired_mu_);
+    for (auto node : moved) {
+        retired_nodes_.emplace_back(version, node);
+    }
+    if (finished) {
+        retired_tables_.emplace_back(version, old_table);
+    }
+}
+
+void PkHashIndex::Reclaim(uint64_t version) {
+    std::lock_guard<std::mutex> lock(retired_mu_);
+    while (!retired_nodes_.empty() && retired_nodes_.front().first <= version) {
+        FreeNode(retired_nodes_.front().second);
+        retired_nodes_.pop_front();
+    }
+    while (!retired_tables_.empty() && retired_tables_.front().first <= version) {
+        FreeTable(retired_tables_.front().second);
+        retired_tables_.pop_front();
+    }
+}
+
+void PkHashIndex::Clear() {
+    for (BucketTable* table : {old_table_.load(std::memory_order_relaxed), table_.load(std::memory_order_relaxed)}) {
+        if (table == nullptr) {
+            continue;
+        }
+        for (uint32_t i = 0; i <= table->mask; i++) {
+            HashNode* node = table->buckets[i].load(std::memory_order_relaxed);
+            while (node != nullptr) {
+                HashNode* tmp = node;
+                node = node->next.load(std::memory_order_relaxed);
+                FreeNode(tmp);
+            }
+            table->buckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    BucketTable* old_table = old_table_.exchange(nullptr, std::memory_order_relaxed);
+    if (old_table != nullptr) {
+        FreeTable(old_table);
+    }
+    size_.store(0, std::memory_order_relaxed);
+    Reclaim(UINT64_MAX);
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_PK_HASH_INDEX_H_
+#define SRC_STORAGE_PK_HASH_INDEX_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "base/slab_allocator.h"
+#include "base/slice.h"
+#include "base/spinlock.h"
+
+namespace openmldb {
+namespace storage {
+
+using ::openmldb::base::SlabAllocator;
+using ::openmldb::base::Slice;
+
+// PkHashIndex maps the pk of a segment to its key entry so that point lookups
+// need not chase pointers through the key skiplist. It does not own the key
+// memory, the key must stay alive until the node of it is reclaimed.
+//
+// Get is lock free. Insert can run concurrently with Get and other Insert, but
+// Remove must be excluded from Insert by the caller. The buckets are doubled
+// when the load factor is exceeded. The nodes are moved to the new buckets
+// incrementally, every Insert moves a few buckets of the old table until it is
+// empty, and Get and Remove look into both tables in the meantime. Removed
+// nodes and the buckets replaced by resizing are retired with the current gc
+// version and freed by Reclaim, as readers may still be walking them. So the
+// readers and writers must pin the gc version when they use the index.
+class PkHashIndex {
+ public:
+    static constexpr uint32_t INIT_BUCKET_NUM = 1024;
+    static constexpr uint32_t MAX_LOAD_FACTOR = 2;
+    // the buckets of the old table moved by an Insert while resizing
+    static constexpr uint32_t MIGRATE_BUCKET_NUM = 16;
+
+    PkHashIndex(const std::atomic<uint64_t>* gc_version, SlabAllocator* allocator);
+    ~PkHashIndex();
+
+    PkHashIndex(const PkHashIndex&) = delete;
+    PkHashIndex& operator=(const PkHashIndex&) = delete;
+
+    bool Get(const Slice& key, void*& value) const;  // NOLINT
+
+    // the caller must make sure that the key does not exist
+    void Insert(const Slice& key, void* value);
+
+    bool Remove(const Slice& key);
+
+    // free the nodes and buckets retired at or before the version
+    void Reclaim(uint64_t version);
+
+    // remove all keys and free all memory, need no concurrent readers and writers
+    void Clear();
+
+    uint64_t GetSize() const { return size_.load(std::memory_order_relaxed); }
+
+    uint32_t GetBucketNum() const { return table_.load(std::memory_order_relaxed)->mask + 1; }
+
+    uint64_t GetByteSize() const { return byte_size_.load(std::memory_order_relaxed); }
+
+    bool IsResizing() const { return old_table_.load(std::memory_order_relaxed) != nullptr; }
+
+ private:
+    struct HashNode {
+        std::atomic<HashNode*> next;
+        void* value;
+        const char* key;
+        uint32_t key_size;
+        uint32_t hash;
+    };
+
+    struct BucketTable {
+        uint32_t mask;
+        std::atomic<HashNode*>* buckets;
+    };
+
+    static uint64_t Hash(const Slice& key);
+    static bool Match(const HashNode* node, uint32_t hash, const Slice& key);
+    static bool Find(const BucketTable* table, uint64_t h, const Slice& key, void*& value);  // NOLINT
+    bool RemoveFrom(BucketTable* table, uint64_t h, const Slice& key);
+
+    BucketTable* NewTable(uint32_t bucket_num);
+    void FreeTable(BucketTable* table);
+    HashNode* NewNode(uint32_t hash, const char* key, uint32_t key_size, void* value);
+    void FreeNode(HashNode* node);
+    // start resizing if the load factor is exceeded
+    void Resize();
+    // move the next bucket_num buckets of the old table to the new one
+    void Migrate(uint32_t bucket_num);
+
+ private:
+    std::atomic<BucketTable*> table_;
+    // the table being moved to table_, nullptr if no resizing is running
+    std::atomic<BucketTable*> old_table_;
+    // Insert holds it in shared mode, the switch of tables holds it exclusively
+    ::openmldb::base::SharedSpinMutex resize_mu_;
+    // guard the start of resizing and migrate_pos_
+    std::mutex migrate_mu_;
+    // the next bucket of old_table_ to move
+    uint32_t migrate_pos_;
+    std::atomic<uint64_t> size_;
+    std::atomic<uint64_t> byte_size_;
+    const std::atomic<uint64_t>* gc_version_;
+    SlabAllocator* allocator_;
+    std::mutex retired_mu_;
+    std::deque<std::pair<uint64_t, HashNode*>> retired_nodes_;
+    std::deque<std::pair<uint64_t, BucketTable*>> retired_tables_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_PK_HASH_INDEX_H_
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pk_hash_index.h"
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace storage {
+
+class PkHashIndexTest : public ::testing::Test {
+ public:
+    PkHashIndexTest() {}
+    ~PkHashIndexTest() {}
+};
+
+TEST_F(PkHashIndexTest, InsertAndGet) {
+    std::atomic<uint64_t> gc_version(0);
+    PkHashIndex index(&gc_version, nullptr);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 10000; i++) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    for (int i = 0; i < 10000; i++) {
+        index.Insert(Slice(keys[i]), reinterpret_cast<void*>(i + 1));
+    }
+    ASSERT_EQ(10000u, index.GetSize());
+    // the buckets are doubled as keys are inserted
+    ASSERT_GE(index.GetBucketNum() * PkHashIndex::MAX_LOAD_FACTOR, 10000u);
+    for (int i = 0; i < 10000; i++) {
+        void* value = nullptr;
+        ASSERT_TRUE(index.Get(Slice(keys[i]), value));
+        ASSERT_EQ(reinterpret_cast<void*>(i + 1), value);
+    }
+    void* value = nullptr;
+    ASSERT_FALSE(index.Get(Slice("key10000"), value));
+    ASSERT_FALSE(index.Get(Slice("key"), value));
+}
+
+TEST_F(PkHashIndexTest, RemoveAndReclaim) {
+    std::atomic<uint64_t> gc_version(0);
+    SlabAllocator allocator;
+    PkHashIndex index(&gc_version, &allocator);
+    // the index refers to the keys, they must not be moved by reallocating
+    std::vector<std::string> keys;
+    keys.reserve(100);
+    for (int i = 0; i < 100; i++) {
+        keys.push_back("key" + std::to_string(i));
+        index.Insert(Slice(keys[i]), reinterpret_cast<void*>(i + 1));
+    }
+    uint64_t byte_size = index.GetByteSize();
+    gc_version.store(1);
+    ASSERT_TRUE(index.Remove(Slice(keys[10])));
+    ASSERT_FALSE(index.Remove(Slice(keys[10])));
+    ASSERT_EQ(99u, index.GetSize());
+    void* value = nullptr;
+    ASSERT_FALSE(index.Get(Slice(keys[10]), value));
+    ASSERT_TRUE(index.Get(Slice(keys[11]), value));
+    // the removed node is freed only after its version is reclaimed
+    index.Reclaim(0);
+    ASSERT_EQ(byte_size, index.GetByteSize());
+    index.Reclaim(1);
+    ASSERT_GT(byte_size, index.GetByteSize());
+    index.Clear();
+    ASSERT_EQ(0u, index.GetSize());
+    ASSERT_FALSE(index.Get(Slice(keys[11]), value));
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
+TEST_F(PkHashIndexTest, IncrementalResize) {
+    std::atomic<uint64_t> gc_version(0);
+    SlabAllocator allocator;
+    PkHashIndex index(&gc_version, &allocator);
+    std::vector<std::string> keys;
+    uint32_t key_num = PkHashIndex::INIT_BUCKET_NUM * PkHashIndex::MAX_LOAD_FACTOR + 1;
+    for (uint32_t i = 0; i < key_num + 100; i++) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    for (uint32_t i = 0; i < key_num; i++) {
+        index.Insert(Slice(keys[i]), reinterpret_cast<void*>(i + 1));
+    }
+    // the insert exceeding the load factor starts resizing and moves a few buckets only
+    ASSERT_TRUE(index.IsResizing());
+    ASSERT_EQ(PkHashIndex::INIT_BUCKET_NUM * 2, index.GetBucketNum());
+    for (uint32_t i = 0; i < key_num; i++) {
+        void* value = nullptr;
+        ASSERT_TRUE(index.Get(Slice(keys[i]), value));
+        ASSERT_EQ(reinterpret_cast<void*>(i + 1), value);
+    }
+    // the keys are removed from either table
+    gc_version.store(1);
+    for (uint32_t i = 0; i < key_num; i += 2) {
+        ASSERT_TRUE(index.Remove(Slice(keys[i])));
+    }
+    ASSERT_EQ(static_cast<uint64_t>(key_num / 2), index.GetSize());
+    for (uint32_t i = key_num; i < keys.size(); i++) {
+        index.Insert(Slice(keys[i]), reinterpret_cast<void*>(i + 1));
+    }
+    ASSERT_FALSE(index.IsResizing());
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        void* value = nullptr;
+        ASSERT_EQ(i >= key_num || i % 2 == 1, index.Get(Slice(keys[i]), value));
+    }
+    // the nodes moved and the old buckets are freed by reclaiming
+    uint64_t byte_size = index.GetByteSize();
+    index.Reclaim(1);
+    ASSERT_GT(byte_size, index.GetByteSize());
+    index.Clear();
+    ASSERT_EQ(0u, allocator.GetAllocatedBytes());
+}
+
+TEST_F(PkHashIndexTest, Concurrent) {
+    std::atomic<uint64_t> gc_version(0);
+    PkHashIndex index(&gc_version, nullptr);
+    uint32_t thread_num = 4;
+    uint32_t key_num = 100000;
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < key_num; i++) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        // a key must stay visible once it is found, even though the index is resized
+        bool found = false;
+        while (!done.load()) {
+            void* value = nullptr;
+            if (found) {
+                ASSERT_TRUE(index.Get(Slice(keys[0]), value));
+            } else {
+                found = index.Get(Slice(keys[0]), value);
+            }
+        }
+    });
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&index, &keys, i, thread_num, key_num] {
+            for (uint32_t j = i; j < key_num; j += thread_num) {
+                index.Insert(Slice(keys[j]), reinterpret_cast<void*>(j + 1));
+                void* value = nullptr;
+                ASSERT_TRUE(index.Get(Slice(keys[j]), value));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    done.store(true);
+    reader.join();
+    ASSERT_EQ(key_num, index.GetSize());
+    for (uint32_t i = 0; i < key_num; i++) {
+        void* value = nullptr;
+        ASSERT_TRUE(index.Get(Slice(keys[i]), value));
+        ASSERT_EQ(reinterpret_cast<void*>(i + 1), value);
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,7 +16,9 @@
 
 #include "storage/segment.h"
 
+#include <algorithm>
 #include <memory>
+#include <shared_mutex>  // NOLINT
 
 #include "base/glog_wrapper.h"
 #include "base/strings.h"
@@ -26,7 +28,7 @@
 
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
-DECLARE_uint32(gc_deleted_pk_version_delta);
+DECLARE_bool(enable_memtable_slab_alloc);
 
 namespace openmldb {
 namespace storage {
@@ -38,40 +40,71 @@ Segment::Segment()
       idx_cnt_(0),
       idx_byte_size_(0),
       pk_cnt_(0),
+      frozen_byte_size_(0),
+      retired_byte_size_(0),
       ts_cnt_(1),
-      gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      allocator_(FLAGS_enable_memtable_slab_alloc ? new SlabAllocator() : nullptr),
+      block_allocator_(nullptr),
+      own_epoch_(new ::openmldb::base::EpochManager()),
+      epoch_(own_epoch_.get()),
+      hash_index_(nullptr),
+      expire_wheel_(nullptr),
+      wheel_paused_(false) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     key_entry_max_height_ = (uint8_t)FLAGS_skiplist_max_height;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
 
-Segment::Segment(uint8_t height)
+Segment::Segment(uint8_t height, bool enable_hash_index, ::openmldb::base::EpochManager* epoch)
     : entries_(nullptr),
       mu_(),
       idx_cnt_(0),
       idx_byte_size_(0),
       pk_cnt_(0),
+      frozen_byte_size_(0),
+      retired_byte_size_(0),
       key_entry_max_height_(height),
       ts_cnt_(1),
-      gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      allocator_(FLAGS_enable_memtable_slab_alloc ? new SlabAllocator() : nullptr),
+      block_allocator_(nullptr),
+      own_epoch_(epoch == nullptr ? new ::openmldb::base::EpochManager() : nullptr),
+      epoch_(epoch == nullptr ? own_epoch_.get() : epoch),
+      hash_index_(nullptr),
+      expire_wheel_(nullptr),
+      wheel_paused_(false) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
+    if (enable_hash_index) {
+        hash_index_ = new PkHashIndex(epoch_->GetEpochCounter(), allocator_);
+    }
 }
 
-Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
+Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec, bool enable_hash_index,
+                 ::openmldb::base::EpochManager* epoch)
     : entries_(nullptr),
       mu_(),
       idx_cnt_(0),
       idx_byte_size_(0),
       pk_cnt_(0),
+      frozen_byte_size_(0),
+      retired_byte_size_(0),
       key_entry_max_height_(height),
       ts_cnt_(ts_idx_vec.size()),
-      gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      allocator_(FLAGS_enable_memtable_slab_alloc ? new SlabAllocator() : nullptr),
+      block_allocator_(nullptr),
+      own_epoch_(epoch == nullptr ? new ::openmldb::base::EpochManager() : nullptr),
+      epoch_(epoch == nullptr ? own_epoch_.get() : epoch),
+      hash_index_(nullptr),
+      expire_wheel_(nullptr),
+      wheel_paused_(false) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
+    if (enable_hash_index) {
+        hash_index_ = new PkHashIndex(epoch_->GetEpochCounter(), allocator_);
+    }
     for (uint32_t i = 0; i < ts_idx_vec.size(); i++) {
         ts_idx_map_[ts_idx_vec[i]] = i;
         idx_cnt_vec_.push_back(std::make_shared<std::atomic<uint64_t>>(0));
@@ -79,60 +112,140 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
 }
 
 Segment::~Segment() {
+    for (auto& retired : retired_) {
+        FreeRetired(&retired);
+    }
+    FreeRetired(&retiring_);
+    delete hash_index_;
+    delete expire_wheel_;
     delete entries_;
     delete entry_free_list_;
+    delete allocator_;
+}
+
+Slice Segment::CopyKey(const Slice& key) {
+    char* pk = nullptr;
+    if (allocator_ != nullptr) {
+        pk = reinterpret_cast<char*>(allocator_->Allocate(key.size()));
+    } else {
+        pk = new char[key.size()];
+    }
+    memcpy(pk, key.data(), key.size());
+    return Slice(pk, key.size());
+}
+
+void Segment::FreeKey(const Slice& key) {
+    if (allocator_ != nullptr) {
+        allocator_->Free(const_cast<char*>(key.data()), key.size());
+    } else {
+        delete[] key.data();
+    }
+}
+
+KeyEntry* Segment::NewKeyEntry() {
+    if (allocator_ != nullptr) {
+        void* mem = allocator_->Allocate(sizeof(KeyEntry));
+        return new (mem) KeyEntry(key_entry_max_height_);
+    }
+    return new KeyEntry(key_entry_max_height_);
+}
+
+void Segment::FreeKeyEntry(KeyEntry* entry) {
+    if (allocator_ != nullptr) {
+        entry->~KeyEntry();
+        allocator_->Free(entry, sizeof(KeyEntry));
+    } else {
+        delete entry;
+    }
+}
+
+KeyEntry** Segment::NewKeyEntryArray() {
+    KeyEntry** entry_arr = nullptr;
+    if (allocator_ != nullptr) {
+        entry_arr = reinterpret_cast<KeyEntry**>(allocator_->Allocate(sizeof(KeyEntry*) * ts_cnt_));
+    } else {
+        entry_arr = new KeyEntry*[ts_cnt_];
+    }
+    for (uint32_t i = 0; i < ts_cnt_; i++) {
+        entry_arr[i] = NewKeyEntry();
+    }
+    return entry_arr;
+}
+
+void Segment::FreeKeyEntryArray(KeyEntry** entry_arr) {
+    if (allocator_ != nullptr) {
+        allocator_->Free(entry_arr, sizeof(KeyEntry*) * ts_cnt_);
+    } else {
+        delete[] entry_arr;
+    }
 }
 
 uint64_t Segment::Release() {
     uint64_t cnt = 0;
+    if (hash_index_ != nullptr) {
+        // the hash index refers to the keys which are freed below
+        hash_index_->Clear();
+    }
+    if (expire_wheel_ != nullptr) {
+        expire_wheel_->Clear();
+    }
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
-        delete[] it->GetKey().data();
+        FreeKey(it->GetKey());
         if (it->GetValue() != nullptr) {
             if (ts_cnt_ > 1) {
                 KeyEntry** entry_arr = reinterpret_cast<KeyEntry**>(it->GetValue());
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    cnt += entry_arr[i]->Release();
-                    delete entry_arr[i];
+                    cnt += entry_arr[i]->Release(allocator_, block_allocator_);
+                    FreeKeyEntry(entry_arr[i]);
                 }
-                delete[] entry_arr;
+                FreeKeyEntryArray(entry_arr);
             } else {
                 KeyEntry* entry = reinterpret_cast<KeyEntry*>(it->GetValue());
-                cnt += entry->Release();
-                delete entry;
+                cnt += entry->Release(allocator_, block_allocator_);
+                FreeKeyEntry(entry);
             }
         }
         it->Next();
     }
-    entries_->Clear();
+    entries_->Clear(allocator_);
     delete it;
 
     KeyEntryNodeList::Iterator* f_it = entry_free_list_->NewIterator();
     f_it->SeekToFirst();
     while (f_it->Valid()) {
         ::openmldb::base::Node<Slice, void*>* node = f_it->GetValue();
-        delete[] node->GetKey().data();
+        FreeKey(node->GetKey());
         if (ts_cnt_ > 1) {
             KeyEntry** entry_arr = reinterpret_cast<KeyEntry**>(node->GetValue());
             for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr[i]->Release();
-                delete entry_arr[i];
+                entry_arr[i]->Release(allocator_, block_allocator_);
+                FreeKeyEntry(entry_arr[i]);
             }
-            delete[] entry_arr;
+            FreeKeyEntryArray(entry_arr);
         } else {
             KeyEntry* entry = reinterpret_cast<KeyEntry*>(node->GetValue());
-            entry->Release();
-            delete entry;
+            entry->Release(allocator_, block_allocator_);
+            FreeKeyEntry(entry);
         }
-        delete node;
+        ::openmldb::base::Node<Slice, void*>::Free(allocator_, node);
         f_it->Next();
     }
     delete f_it;
     entry_free_list_->Clear();
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        for (auto& retired : retired_) {
+            FreeRetired(&retired);
+        }
+        retired_.clear();
+        FreeRetired(&retiring_);
+    }
     idx_cnt_.store(0);
     idx_byte_size_.store(0);
     pk_cnt_.store(0);
+    frozen_byte_size_.store(0);
     for (auto& idx_cnt : idx_cnt_vec_) {
         idx_cnt->store(0);
     }
@@ -140,7 +253,7 @@ uint64_t Segment::Release() {
 }
 
 void Segment::ReleaseAndCount() {
-    uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
+    uint64_t cur_version = epoch_->GetEpoch();
     uint64_t gc_idx_cnt = 0;
     uint64_t gc_record_cnt = 0;
     uint64_t gc_record_byte_size = 0;
@@ -176,19 +289,20 @@ void Segment::ReleaseAndCount(const std::vector<size_t>& id_vec) {
                 if (ts_it->Valid()) {
                     uint64_t ts = ts_it->GetKey();
                     auto data_node = entry->entries.Split(ts);
-                    FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+                    RetireList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
                 }
             }
         }
         it->Next();
     }
+    ReclaimRetired();
 }
 
 void Segment::Put(const Slice& key, uint64_t time, const char* data, uint32_t size) {
     if (ts_cnt_ > 1) {
         return;
     }
-    auto* db = new DataBlock(1, data, size);
+    auto* db = DataBlock::New(block_allocator_, 1, data, size);
     Put(key, time, db);
 }
 
@@ -196,77 +310,132 @@ void Segment::Put(const Slice& key, uint64_t time, DataBlock* row) {
     if (ts_cnt_ > 1) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mu_);
+    std::shared_lock<::openmldb::base::SharedSpinMutex> lock(mu_);
     PutUnlock(key, time, row);
 }
 
-void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+void* Segment::GetOrCreateEntry(const Slice& key, uint32_t& byte_size) {
+    // the nodes and buckets of hash index retired by gc are freed once no one pins the epoch. The
+    // key entry itself is safe without it, it is removed under the exclusive lock of mu_
+    ::openmldb::base::EpochGuard guard(epoch_);
     void* entry = nullptr;
-    uint32_t byte_size = 0;
-    int ret = entries_->Get(key, entry);
-    if (ret < 0 || entry == nullptr) {
-        char* pk = new char[key.size()];
-        memcpy(pk, key.data(), key.size());
-        // need to delete memory when free node
-        Slice skey(pk, key.size());
-        entry = (void*)new KeyEntry(key_entry_max_height_);  // NOLINT
-        uint8_t height = entries_->Insert(skey, entry);
+    if (GetEntry(key, entry)) {
+        return entry;
+    }
+    // need to free memory when free node
+    Slice skey = CopyKey(key);
+    if (ts_cnt_ > 1) {
+        entry = (void*)NewKeyEntryArray();  // NOLINT
+    } else {
+        entry = (void*)NewKeyEntry();  // NOLINT
+    }
+    void* new_entry = entry;
+    uint8_t height = entries_->InsertIfAbsentConcurrently(skey, entry, allocator_);
+    if (height == 0) {
+        // the key has been inserted by another writer
+        FreeKey(skey);
+        if (ts_cnt_ > 1) {
+            KeyEntry** entry_arr = reinterpret_cast<KeyEntry**>(new_entry);
+            for (uint32_t i = 0; i < ts_cnt_; i++) {
+                FreeKeyEntry(entry_arr[i]);
+            }
+            FreeKeyEntryArray(entry_arr);
+        } else {
+            FreeKeyEntry(reinterpret_cast<KeyEntry*>(new_entry));
+        }
+        return entry;
+    }
+    if (hash_index_ != nullptr) {
+        hash_index_->Insert(skey, entry);
+    }
+    if (ts_cnt_ > 1) {
+        byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+    } else {
         byte_size += GetRecordPkIdxSize(height, key.size(), key_entry_max_height_);
-        pk_cnt_.fetch_add(1, std::memory_order_relaxed);
     }
+    pk_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+bool Segment::GetEntry(const Slice& key, void*& entry) {
+    if (hash_index_ != nullptr) {
+        return hash_index_->Get(key, entry) && entry != nullptr;
+    }
+    return entries_->Get(key, entry) == 0 && entry != nullptr;
+}
+
+void Segment::EnableExpireWheel(uint64_t bucket_width) {
+    if (ts_cnt_ > 1 || expire_wheel_ != nullptr) {
+        return;
+    }
+    expire_wheel_ = new ExpireWheel(bucket_width);
+}
+
+::openmldb::base::Node<Slice, void*>* Segment::RemoveEntry(const Slice& key) {
+    ::openmldb::base::Node<Slice, void*>* entry_node = entries_->Remove(key);
+    if (entry_node != nullptr && hash_index_ != nullptr) {
+        hash_index_->Remove(key);
+    }
+    return entry_node;
+}
+
+void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
+    uint32_t byte_size = 0;
+    KeyEntry* entry = reinterpret_cast<KeyEntry*>(GetOrCreateEntry(key, byte_size));
     idx_cnt_.fetch_add(1, std::memory_order_relaxed);
-    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);  // NOLINT
-    ((KeyEntry*)entry)                                               // NOLINT
-        ->count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t old_ts = entry->UpdateEarliestTs(time);
+    if (expire_wheel_ != nullptr && expire_wheel_->NeedAdd(old_ts, time)) {
+        expire_wheel_->Add(key, time);
+    }
+    uint8_t height = entry->entries.InsertConcurrently(time, row, allocator_);
+    entry->count_.fetch_add(1, std::memory_order_relaxed);
     byte_size += GetRecordTsIdxSize(height);
     idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
 }
 
 void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row) {
-    void* key_entry_or_list = nullptr;
-    uint32_t byte_size = 0;
-    std::lock_guard<std::mutex> lock(mu_);  // TODO(hw): need lock?
-    int ret = entries_->Get(key, key_entry_or_list);
+    std::shared_lock<::openmldb::base::SharedSpinMutex> lock(mu_);
     if (ts_cnt_ == 1) {
         PutUnlock(key, time, row);
-    } else {
-        if (ret < 0 || key_entry_or_list == nullptr) {
-            char* pk = new char[key.size()];
-            memcpy(pk, key.data(), key.size());
-            Slice skey(pk, key.size());
-            auto** entry_arr_tmp = new KeyEntry*[ts_cnt_];
-            for (uint32_t i = 0; i < ts_cnt_; i++) {
-                entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
-            }
-            auto entry_arr = (void*)entry_arr_tmp;  // NOLINT
-            uint8_t height = entries_->Insert(skey, entry_arr);
-            byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
-            pk_cnt_.fetch_add(1, std::memory_order_relaxed);
-        }
-        uint8_t height = ((KeyEntry**)key_entry_or_list)[key_entry_id]->entries.Insert(  // NOLINT
-            time, row);
-        ((KeyEntry**)key_entry_or_list)[key_entry_id]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
-        byte_size += GetRecordTsIdxSize(height);
-        idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
-        idx_cnt_vec_[key_entry_id]->fetch_add(1, std::memory_order_relaxed);
+        return;
     }
+    uint32_t byte_size = 0;
+    KeyEntry** entry_arr = reinterpret_cast<KeyEntry**>(GetOrCreateEntry(key, byte_size));
+    entry_arr[key_entry_id]->UpdateEarliestTs(time);
+    uint8_t height = entry_arr[key_entry_id]->entries.InsertConcurrently(time, row, allocator_);
+    entry_arr[key_entry_id]->count_.fetch_add(1, std::memory_order_relaxed);
+    byte_size += GetRecordTsIdxSize(height);
+    idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    idx_cnt_vec_[key_entry_id]->fetch_add(1, std::memory_order_relaxed);
 }
 
 void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row) {
-    uint32_t ts_size = ts_map.size();
-    if (ts_size == 0) {
+    if (ts_map.empty()) {
+        return;
+    }
+    std::shared_lock<::openmldb::base::SharedSpinMutex> lock(mu_);
+    PutUnlock(key, ts_map, row);
+}
+
+void Segment::PutBatch(const std::vector<BatchRow>& rows) {
+    std::shared_lock<::openmldb::base::SharedSpinMutex> lock(mu_);
+    for (const auto& row : rows) {
+        PutUnlock(row.key, *row.ts_map, row.row);
+    }
+}
+
+void Segment::PutUnlock(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row) {
+    if (ts_map.empty()) {
         return;
     }
     if (ts_cnt_ == 1) {
         auto pos = ts_map.find(ts_idx_map_.begin()->first);
         if (pos != ts_map.end()) {
-            Put(key, pos->second, row);
+            PutUnlock(key, pos->second, row);
         }
         return;
     }
-    void* entry_arr = nullptr;
-    std::lock_guard<std::mutex> lock(mu_);
+    KeyEntry** entry_arr = nullptr;
     for (const auto& kv : ts_map) {
         uint32_t byte_size = 0;
         auto pos = ts_idx_map_.find(kv.first);
@@ -274,25 +443,11 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
             continue;
         }
         if (entry_arr == nullptr) {
-            int ret = entries_->Get(key, entry_arr);
-            if (ret < 0 || entry_arr == nullptr) {
-                char* pk = new char[key.size()];
-                memcpy(pk, key.data(), key.size());
-                Slice skey(pk, key.size());
-                KeyEntry** entry_arr_tmp = new KeyEntry*[ts_cnt_];
-                for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
-                }
-                entry_arr = (void*)entry_arr_tmp;  // NOLINT
-                uint8_t height = entries_->Insert(skey, entry_arr);
-                byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
-                pk_cnt_.fetch_add(1, std::memory_order_relaxed);
-            }
+            entry_arr = reinterpret_cast<KeyEntry**>(GetOrCreateEntry(key, byte_size));
         }
-        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.Insert(  // NOLINT
-            kv.second, row);
-        ((KeyEntry**)entry_arr)[pos->second]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
+        entry_arr[pos->second]->UpdateEarliestTs(kv.second);
+        uint8_t height = entry_arr[pos->second]->entries.InsertConcurrently(kv.second, row, allocator_);
+        entry_arr[pos->second]->count_.fetch_add(1, std::memory_order_relaxed);
         byte_size += GetRecordTsIdxSize(height);
         idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
         idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
@@ -302,46 +457,114 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
 bool Segment::Delete(const Slice& key) {
     ::openmldb::base::Node<Slice, void*>* entry_node = nullptr;
     {
-        std::lock_guard<std::mutex> lock(mu_);
-        entry_node = entries_->Remove(key);
+        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+        entry_node = RemoveEntry(key);
         if (entry_node == nullptr) {
             return false;
         }
     }
     {
         std::lock_guard<std::mutex> lock(gc_mu_);
-        entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+        entry_free_list_->Insert(epoch_->GetEpoch(), entry_node);
     }
     return true;
 }
 
-void Segment::FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,
-                       uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+void Segment::RetireList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,
+                         uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    if (node == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    retiring_.nodes.push_back(node);
     while (node != nullptr) {
         gc_idx_cnt++;
-        ::openmldb::base::Node<uint64_t, DataBlock*>* tmp = node;
-        idx_byte_size_.fetch_sub(GetRecordTsIdxSize(tmp->Height()));
-        node = node->GetNextNoBarrier(0);
-        DEBUGLOG("delete key %lu with height %u", tmp->GetKey(), tmp->Height());
-        if (tmp->GetValue()->dim_cnt_down > 1) {
-            tmp->GetValue()->dim_cnt_down--;
+        idx_byte_size_.fetch_sub(GetRecordTsIdxSize(node->Height()));
+        CountRetired(GetRecordTsIdxSize(node->Height()));
+        DataBlock* block = node->GetValue();
+        // the block is freed with the list which unlinks it at last
+        if (block->dim_cnt_down > 1) {
+            block->dim_cnt_down--;
         } else {
-            DEBUGLOG("delele data block for key %lu", tmp->GetKey());
-            gc_record_byte_size += GetRecordSize(tmp->GetValue()->size);
-            delete tmp->GetValue();
+            gc_record_byte_size += GetRecordSize(block->size);
+            CountRetired(GetRecordSize(block->size));
+            retiring_.blocks.push_back(block);
             gc_record_cnt++;
         }
-        delete tmp;
+        node = node->GetNextNoBarrier(0);
+    }
+}
+
+void Segment::RetireFrozen(FrozenBlock* block, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                           uint64_t& gc_record_byte_size) {
+    if (block == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gc_mu_);
+    while (block != nullptr) {
+        gc_idx_cnt += block->GetCount();
+        gc_record_cnt += block->GetOwnedCount();
+        gc_record_byte_size += block->GetByteSize();
+        frozen_byte_size_.fetch_sub(block->GetByteSize(), std::memory_order_relaxed);
+        CountRetired(block->GetByteSize());
+        retiring_.frozen.push_back(block);
+        block = block->GetNext();
     }
 }
 
+void Segment::ReclaimRetired() {
+    std::vector<Retired> reclaimed;
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        if (!retiring_.Empty()) {
+            // the memory is unlinked before, a reader pinning this epoch or a later one can not see it
+            retiring_.epoch = epoch_->GetEpoch();
+            retired_.push_back(std::move(retiring_));
+            retiring_ = Retired();
+            epoch_->Advance();
+        }
+        if (retired_.empty()) {
+            return;
+        }
+        uint64_t safe_epoch = epoch_->GetSafeEpoch();
+        while (!retired_.empty() && retired_.front().epoch < safe_epoch) {
+            reclaimed.push_back(std::move(retired_.front()));
+            retired_.pop_front();
+        }
+    }
+    for (auto& retired : reclaimed) {
+        FreeRetired(&retired);
+    }
+}
+
+void Segment::FreeRetired(Retired* retired) {
+    for (auto node : retired->nodes) {
+        while (node != nullptr) {
+            ::openmldb::base::Node<uint64_t, DataBlock*>* tmp = node;
+            node = node->GetNextNoBarrier(0);
+            ::openmldb::base::Node<uint64_t, DataBlock*>::Free(allocator_, tmp);
+        }
+    }
+    for (auto block : retired->blocks) {
+        DataBlock::Free(block_allocator_, block);
+    }
+    for (auto block : retired->frozen) {
+        delete block;
+    }
+    retired->nodes.clear();
+    retired->blocks.clear();
+    retired->frozen.clear();
+    retired_byte_size_.fetch_sub(retired->byte_size, std::memory_order_relaxed);
+    retired->byte_size = 0;
+}
+
 void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                         uint64_t& gc_record_byte_size) {
     if (entry_node == nullptr) {
         return;
     }
     // free pk memory
-    delete[] entry_node->GetKey().data();
+    FreeKey(entry_node->GetKey());
     if (ts_cnt_ > 1) {
         KeyEntry** entry_arr = (KeyEntry**)entry_node->GetValue();  // NOLINT
         for (uint32_t i = 0; i < ts_cnt_; i++) {
@@ -352,13 +575,13 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
             if (it->Valid()) {
                 uint64_t ts = it->GetKey();
                 ::openmldb::base::Node<uint64_t, DataBlock*>* data_node = entry->entries.Split(ts);
-                FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+                RetireList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             }
             delete it;
-            delete entry;
+            FreeKeyEntry(entry);
             idx_cnt_vec_[i]->fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
         }
-        delete[] entry_arr;
+        FreeKeyEntryArray(entry_arr);
         uint64_t byte_size =
             GetRecordPkMultiIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_, ts_cnt_);
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
@@ -370,10 +593,12 @@ void Segment::FreeEntry(::openmldb::base::Node<Slice, void*>* entry_node, uint64
         if (it->Valid()) {
             uint64_t ts = it->GetKey();
             ::openmldb::base::Node<uint64_t, DataBlock*>* data_node = entry->entries.Split(ts);
-            FreeList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            RetireList(data_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         }
         delete it;
-        delete entry;
+        FreeFrozen(entry->frozen_.exchange(nullptr, std::memory_order_relaxed), gc_idx_cnt, gc_record_cnt,
+                   gc_record_byte_size);
+        FreeKeyEntry(entry);
         uint64_t byte_size =
             GetRecordPkIdxSize(entry_node->Height(), entry_node->GetKey().size(), key_entry_max_height_);
         idx_byte_size_.fetch_sub(byte_size, std::memory_order_relaxed);
@@ -388,10 +613,13 @@ void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt, uint64_t&
         std::lock_guard<std::mutex> lock(gc_mu_);
         node = entry_free_list_->Split(version);
     }
+    if (hash_index_ != nullptr) {
+        hash_index_->Reclaim(version);
+    }
     while (node != nullptr) {
         ::openmldb::base::Node<Slice, void*>* entry_node = node->GetValue();
         FreeEntry(entry_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        delete entry_node;
+        ::openmldb::base::Node<Slice, void*>::Free(allocator_, entry_node);
         ::openmldb::base::Node<uint64_t, ::openmldb::base::Node<Slice, void*>*>* tmp = node;
         node = node->GetNextNoBarrier(0);
         delete tmp;
@@ -400,115 +628,154 @@ void Segment::GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt, uint64_t&
 }
 
 void Segment::GcFreeList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
-    uint64_t cur_version = gc_version_.load(std::memory_order_relaxed);
-    if (cur_version < FLAGS_gc_deleted_pk_version_delta) {
-        return;
-    }
-    uint64_t free_list_version = cur_version - FLAGS_gc_deleted_pk_version_delta;
-    GcEntryFreeList(free_list_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    // the entries removed before the safe epoch are not reachable by any reader
+    uint64_t safe_epoch = epoch_->GetSafeEpoch();
+    GcEntryFreeList(safe_epoch - 1, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    // the rows of the freed entries may be still referred by the other indexes, so they are retired too
+    ReclaimRetired();
 }
 
-void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                        uint64_t& gc_record_byte_size) {
+bool Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                        uint64_t& gc_record_byte_size, const GcBudget& budget) {
     uint64_t cur_time = ::baidu::common::timer::get_micros() / 1000;
     switch (ttl_st.ttl_type) {
         case ::openmldb::storage::TTLType::kAbsoluteTime: {
             if (ttl_st.abs_ttl == 0) {
-                return;
+                return true;
             }
             uint64_t expire_time = cur_time - ttl_offset_ - ttl_st.abs_ttl;
-            Gc4TTL(expire_time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            break;
+            return Gc4TTL(expire_time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
         }
         case ::openmldb::storage::TTLType::kLatestTime: {
             if (ttl_st.lat_ttl == 0) {
-                return;
+                return true;
             }
-            Gc4Head(ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            break;
+            return Gc4Head(ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
         }
         case ::openmldb::storage::TTLType::kAbsAndLat: {
             if (ttl_st.abs_ttl == 0 || ttl_st.lat_ttl == 0) {
-                return;
+                return true;
             }
             uint64_t expire_time = cur_time - ttl_offset_ - ttl_st.abs_ttl;
-            Gc4TTLAndHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            break;
+            return Gc4TTLAndHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
         }
         case ::openmldb::storage::TTLType::kAbsOrLat: {
             if (ttl_st.abs_ttl == 0 && ttl_st.lat_ttl == 0) {
-                return;
+                return true;
             }
             uint64_t expire_time = ttl_st.abs_ttl == 0 ? 0 : cur_time - ttl_offset_ - ttl_st.abs_ttl;
-            Gc4TTLOrHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-            break;
+            return Gc4TTLOrHead(expire_time, ttl_st.lat_ttl, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
         }
         default:
             PDLOG(WARNING, "ttl type %d is unsupported", ttl_st.ttl_type);
     }
+    return true;
 }
 
-void Segment::ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                        uint64_t& gc_record_byte_size) {
+bool Segment::ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                        uint64_t& gc_record_byte_size, const GcBudget& budget) {
     if (ttl_st_map.empty()) {
-        return;
+        return true;
     }
     if (ts_cnt_ <= 1) {
-        ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        return;
+        return ExecuteGc(ttl_st_map.begin()->second, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
     }
     bool need_gc = false;
     for (const auto& kv : ttl_st_map) {
         if (ts_idx_map_.find(kv.first) == ts_idx_map_.end()) {
-            return;
+            return true;
         }
         if (kv.second.NeedGc()) {
             need_gc = true;
         }
     }
     if (!need_gc) {
-        return;
+        return true;
+    }
+    return GcAllType(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
+}
+
+void Segment::SeekGcCursor(KeyEntries::Iterator* it) {
+    if (gc_cursor_.empty()) {
+        it->SeekToFirst();
+    } else {
+        it->Seek(Slice(gc_cursor_));
+    }
+}
+
+bool Segment::CheckGcBudget(const GcBudget& budget, uint64_t key_cnt, KeyEntries::Iterator* it) {
+    // make progress in every round
+    if (key_cnt == 0) {
+        return false;
+    }
+    bool exhausted = budget.max_key_cnt > 0 && key_cnt >= budget.max_key_cnt;
+    // check the time every 64 keys
+    if (!exhausted && budget.deadline > 0 && (key_cnt & 0x3F) == 0) {
+        exhausted = ::baidu::common::timer::get_micros() >= budget.deadline;
+    }
+    if (exhausted) {
+        gc_cursor_.assign(it->GetKey().data(), it->GetKey().size());
     }
-    GcAllType(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    return exhausted;
 }
 
-void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+bool Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size,
+                      const GcBudget& budget) {
     if (keep_cnt == 0) {
         PDLOG(WARNING, "[Gc4Head] segment gc4head is disabled");
-        return;
+        return true;
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    bool finished = true;
+    uint64_t key_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (CheckGcBudget(budget, key_cnt++, it)) {
+            finished = false;
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+        it->Next();
+        if (entry->GetCount() <= keep_cnt) {
+            continue;
+        }
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = nullptr;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByPos(keep_cnt);
-            }
+            std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+            node = entry->entries.SplitByPos(keep_cnt);
+            entry->ResetEarliestTs();
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
-        it->Next();
+    }
+    if (finished) {
+        gc_cursor_.clear();
     }
     DEBUGLOG("[Gc4Head] segment gc keep cnt %lu consumed %lu, count %lu", keep_cnt,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    ReclaimRetired();
+    return finished;
 }
 
-void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                        uint64_t& gc_record_byte_size) {
+bool Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                        uint64_t& gc_record_byte_size, const GcBudget& budget) {
     uint64_t old = gc_idx_cnt;
     uint64_t consumed = ::baidu::common::timer::get_micros();
+    bool finished = true;
+    uint64_t key_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (CheckGcBudget(budget, key_cnt++, it)) {
+            finished = false;
+            break;
+        }
         KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -526,69 +793,68 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             bool continue_flag = false;
             switch (kv.second.ttl_type) {
                 case ::openmldb::storage::TTLType::kAbsoluteTime: {
-                    node = entry->entries.GetLast();
-                    if (node == nullptr || node->GetKey() > kv.second.abs_ttl) {
+                    if (entry->GetEarliestTs() > kv.second.abs_ttl) {
                         continue_flag = true;
                     } else {
-                        node = nullptr;
-                        std::lock_guard<std::mutex> lock(mu_);
-                        SplitList(entry, kv.second.abs_ttl, &node);
-                        if (entry->entries.IsEmpty()) {
+                        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+                        node = entry->entries.Split(kv.second.abs_ttl);
+                        entry->ResetEarliestTs();
+                        if (entry->IsEmpty()) {
                             empty_cnt++;
                         }
                     }
                     break;
                 }
                 case ::openmldb::storage::TTLType::kLatestTime: {
-                    std::lock_guard<std::mutex> lock(mu_);
-                    if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                        node = entry->entries.SplitByPos(kv.second.lat_ttl);
+                    if (entry->GetCount() <= kv.second.lat_ttl) {
+                        continue_flag = true;
+                        break;
                     }
+                    std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+                    node = entry->entries.SplitByPos(kv.second.lat_ttl);
+                    entry->ResetEarliestTs();
                     break;
                 }
                 case ::openmldb::storage::TTLType::kAbsAndLat: {
-                    node = entry->entries.GetLast();
-                    if (node == nullptr || node->GetKey() > kv.second.abs_ttl) {
+                    if (entry->GetEarliestTs() > kv.second.abs_ttl || entry->GetCount() <= kv.second.lat_ttl) {
                         continue_flag = true;
                     } else {
-                        node = nullptr;
-                        std::lock_guard<std::mutex> lock(mu_);
-                        if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                            node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
-                        }
+                        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+                        node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
+                        entry->ResetEarliestTs();
                     }
                     break;
                 }
                 case ::openmldb::storage::TTLType::kAbsOrLat: {
-                    node = entry->entries.GetLast();
-                    if (node == nullptr) {
+                    bool expired = (kv.second.abs_ttl > 0 && entry->GetEarliestTs() <= kv.second.abs_ttl) ||
+                                   (kv.second.lat_ttl > 0 && entry->GetCount() > kv.second.lat_ttl);
+                    if (!expired) {
                         continue_flag = true;
                     } else {
-                        node = nullptr;
-                        std::lock_guard<std::mutex> lock(mu_);
-                        if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                            if (kv.second.abs_ttl == 0) {
-                                node = entry->entries.SplitByPos(kv.second.lat_ttl);
-                            } else if (kv.second.lat_ttl == 0) {
-                                node = entry->entries.Split(kv.second.abs_ttl);
-                            } else {
-                                node = entry->entries.SplitByKeyOrPos(kv.second.abs_ttl, kv.second.lat_ttl);
-                            }
+                        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+                        if (kv.second.abs_ttl == 0) {
+                            node = entry->entries.SplitByPos(kv.second.lat_ttl);
+                        } else if (kv.second.lat_ttl == 0) {
+                            node = entry->entries.Split(kv.second.abs_ttl);
+                        } else {
+                            node = entry->entries.SplitByKeyOrPos(kv.second.abs_ttl, kv.second.lat_ttl);
                         }
-                        if (entry->entries.IsEmpty()) {
+                        entry->ResetEarliestTs();
+                        if (entry->IsEmpty()) {
                             empty_cnt++;
                         }
                     }
                     break;
                 }
                 default:
-                    return;
+                    continue_flag = true;
+                    break;
             }
             if (continue_flag) {
                 continue;
             }
             uint64_t entry_gc_idx_cnt = 0;
-            FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+            RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
             idx_cnt_vec_[pos->second]->fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
             gc_idx_cnt += entry_gc_idx_cnt;
@@ -597,181 +863,515 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             bool is_empty = true;
             ::openmldb::base::Node<Slice, void*>* entry_node = nullptr;
             {
-                std::lock_guard<std::mutex> lock(mu_);
+                std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
-                    if (!entry_arr[i]->entries.IsEmpty()) {
+                    if (!entry_arr[i]->IsEmpty()) {
                         is_empty = false;
                         break;
                     }
                 }
                 if (is_empty) {
-                    entry_node = entries_->Remove(key);
+                    entry_node = RemoveEntry(key);
                 }
             }
             if (entry_node != nullptr) {
                 std::lock_guard<std::mutex> lock(gc_mu_);
-                entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+                entry_free_list_->Insert(epoch_->GetEpoch(), entry_node);
             }
         }
     }
+    if (finished) {
+        gc_cursor_.clear();
+    }
     DEBUGLOG("[GcAll] segment gc consumed %lu, count %lu", (::baidu::common::timer::get_micros() - consumed) / 1000,
              gc_idx_cnt - old);
     delete it;
+    ReclaimRetired();
+    return finished;
 }
 
-void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node) {
-    // skip entry that ocupied by reader
-    if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-        *node = entry->entries.Split(ts);
+bool Segment::NeedGcFrozen(KeyEntry* entry, uint64_t ts) {
+    FrozenBlock* block = entry->frozen_.load(std::memory_order_acquire);
+    while (block != nullptr) {
+        if (block->GetMaxTime() <= ts) {
+            return true;
+        }
+        block = block->GetNext();
     }
+    return false;
 }
 
-// fast gc with no global pause
-void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                     uint64_t& gc_record_byte_size) {
+void Segment::SplitFrozen(KeyEntry* entry, uint64_t ts, FrozenBlock** block) {
+    // only the blocks in which all rows expire are dropped
+    FrozenBlock* pre = nullptr;
+    FrozenBlock* cur = entry->frozen_.load(std::memory_order_relaxed);
+    while (cur != nullptr && cur->GetMaxTime() > ts) {
+        pre = cur;
+        cur = cur->GetNext();
+    }
+    if (pre == nullptr) {
+        entry->frozen_.store(nullptr, std::memory_order_release);
+    } else {
+        pre->SetNext(nullptr);
+    }
+    *block = cur;
+}
+
+void Segment::FreeFrozen(FrozenBlock* block, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                         uint64_t& gc_record_byte_size) {
+    while (block != nullptr) {
+        FrozenBlock* tmp = block;
+        block = block->GetNext();
+        gc_idx_cnt += tmp->GetCount();
+        gc_record_cnt += tmp->GetOwnedCount();
+        gc_record_byte_size += tmp->GetByteSize();
+        frozen_byte_size_.fetch_sub(tmp->GetByteSize(), std::memory_order_relaxed);
+        delete tmp;
+    }
+}
+
+void Segment::Freeze(uint64_t time, uint32_t fixed_len, uint64_t& freeze_cnt, uint64_t& freed_byte_size,
+                     uint64_t& frozen_byte_size) {
+    if (ts_cnt_ > 1) {
+        return;
+    }
     uint64_t consumed = ::baidu::common::timer::get_micros();
-    uint64_t old = gc_idx_cnt;
-    KeyEntries::Iterator* it = entries_->NewIterator();
+    uint64_t old = freeze_cnt;
+    std::unique_ptr<KeyEntries::Iterator> it(entries_->NewIterator());
     it->SeekToFirst();
     while (it->Valid()) {
-        KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-        Slice key = it->GetKey();
+        KeyEntry* entry = reinterpret_cast<KeyEntry*>(it->GetValue());
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == nullptr) {
-            continue;
-        } else if (node->GetKey() > time) {
+        FreezeEntry(entry, time, fixed_len, freeze_cnt, freed_byte_size, frozen_byte_size);
+    }
+    ReclaimRetired();
+    DEBUGLOG("[Freeze] segment freeze with time %lu consumed %lu, count %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, freeze_cnt - old);
+}
+
+void Segment::FreezeEntry(KeyEntry* entry, uint64_t time, uint32_t fixed_len, uint64_t& freeze_cnt,
+                          uint64_t& freed_byte_size, uint64_t& frozen_byte_size) {
+    std::vector<std::pair<uint64_t, Slice>> rows;
+    std::unique_ptr<TimeEntries::Iterator> ts_it(entry->entries.NewIterator());
+    ts_it->Seek(time);
+    while (ts_it->Valid()) {
+        rows.emplace_back(ts_it->GetKey(), Slice(ts_it->GetValue()->data, ts_it->GetValue()->size));
+        ts_it->Next();
+    }
+    if (rows.empty()) {
+        return;
+    }
+    uint64_t hot_cnt = rows.size();
+    // rows older than the frozen ones may be put later, the frozen blocks overlapped
+    // with them are decoded and built again so that blocks keep in order of time
+    FrozenBlock* head = entry->frozen_.load(std::memory_order_acquire);
+    FrozenBlock* rest = head;
+    std::vector<std::unique_ptr<std::string>> buffers;
+    while (rest != nullptr && rest->GetMaxTime() >= rows[hot_cnt - 1].first) {
+        std::vector<uint64_t> times;
+        std::vector<uint32_t> offsets;
+        buffers.emplace_back(new std::string());
+        if (!rest->Decode(&times, &offsets, buffers.back().get())) {
+            PDLOG(WARNING, "fail to decode frozen block, skip freezing");
+            return;
+        }
+        for (uint32_t i = 0; i < times.size(); i++) {
+            rows.emplace_back(times[i], Slice(buffers.back()->data() + offsets[i], offsets[i + 1] - offsets[i]));
+        }
+        rest = rest->GetNext();
+    }
+    if (rest != head) {
+        std::stable_sort(rows.begin(), rows.end(),
+                         [](const std::pair<uint64_t, Slice>& a, const std::pair<uint64_t, Slice>& b) {
+                             return a.first > b.first;
+                         });
+    }
+    std::vector<FrozenBlock*> blocks;
+    for (size_t pos = 0; pos < rows.size(); pos += FrozenBlock::MAX_ROW_CNT) {
+        size_t end = std::min(rows.size(), pos + FrozenBlock::MAX_ROW_CNT);
+        std::vector<std::pair<uint64_t, Slice>> block_rows(rows.begin() + pos, rows.begin() + end);
+        blocks.push_back(FrozenBlock::Build(block_rows, fixed_len));
+    }
+    for (size_t i = 0; i + 1 < blocks.size(); i++) {
+        blocks[i]->SetNext(blocks[i + 1]);
+    }
+    blocks.back()->SetNext(rest);
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = nullptr;
+    bool frozen = false;
+    {
+        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+        if (entry->frozen_.load(std::memory_order_relaxed) == head) {
+            // rows may be put after they are collected
+            uint64_t cnt = 0;
+            for (ts_it->Seek(time); ts_it->Valid(); ts_it->Next()) {
+                cnt++;
+            }
+            if (cnt == hot_cnt) {
+                node = entry->entries.Split(time);
+                entry->frozen_.store(blocks.front(), std::memory_order_release);
+                frozen = true;
+            }
+        }
+    }
+    if (!frozen) {
+        blocks.back()->SetNext(nullptr);
+        KeyEntry::FreeFrozen(blocks.front());
+        return;
+    }
+    // readers may be still on the old rows and blocks, they are retired instead of being freed
+    uint64_t owned_cnt = 0;
+    std::unique_lock<std::mutex> gc_lock(gc_mu_);
+    retiring_.nodes.push_back(node);
+    for (; node != nullptr; node = node->GetNextNoBarrier(0)) {
+        idx_byte_size_.fetch_sub(GetRecordTsIdxSize(node->Height()), std::memory_order_relaxed);
+        CountRetired(GetRecordTsIdxSize(node->Height()));
+        if (node->GetValue()->dim_cnt_down > 1) {
+            node->GetValue()->dim_cnt_down--;
+        } else {
+            freed_byte_size += GetRecordSize(node->GetValue()->size);
+            CountRetired(GetRecordSize(node->GetValue()->size));
+            retiring_.blocks.push_back(node->GetValue());
+            owned_cnt++;
+        }
+    }
+    for (FrozenBlock* block = head; block != rest; block = block->GetNext()) {
+        owned_cnt += block->GetOwnedCount();
+        freed_byte_size += block->GetByteSize();
+        frozen_byte_size_.fetch_sub(block->GetByteSize(), std::memory_order_relaxed);
+        CountRetired(block->GetByteSize());
+        retiring_.frozen.push_back(block);
+    }
+    gc_lock.unlock();
+    // the owned rows are assigned to the oldest blocks first as they are the first to expire
+    for (auto iter = blocks.rbegin(); iter != blocks.rend(); iter++) {
+        uint32_t cnt = std::min(owned_cnt, static_cast<uint64_t>((*iter)->GetCount()));
+        (*iter)->SetOwnedCount(cnt);
+        owned_cnt -= cnt;
+        frozen_byte_size += (*iter)->GetByteSize();
+        frozen_byte_size_.fetch_add((*iter)->GetByteSize(), std::memory_order_relaxed);
+    }
+    freeze_cnt += hot_cnt;
+}
+
+void Segment::Thaw(uint64_t& thaw_cnt, uint64_t& record_cnt, uint64_t& record_byte_size,
+                   uint64_t& freed_byte_size) {
+    if (ts_cnt_ > 1 || GetFrozenByteSize() == 0) {
+        return;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = thaw_cnt;
+    std::unique_ptr<KeyEntries::Iterator> it(entries_->NewIterator());
+    it->SeekToFirst();
+    while (it->Valid()) {
+        KeyEntry* entry = reinterpret_cast<KeyEntry*>(it->GetValue());
+        it->Next();
+        ThawEntry(entry, thaw_cnt, record_cnt, record_byte_size, freed_byte_size);
+    }
+    ReclaimRetired();
+    PDLOG(INFO, "thaw %lu frozen rows consumed %lu ms", thaw_cnt - old,
+          (::baidu::common::timer::get_micros() - consumed) / 1000);
+}
+
+void Segment::ThawEntry(KeyEntry* entry, uint64_t& thaw_cnt, uint64_t& record_cnt, uint64_t& record_byte_size,
+                        uint64_t& freed_byte_size) {
+    FrozenBlock* head = entry->frozen_.load(std::memory_order_acquire);
+    if (head == nullptr) {
+        return;
+    }
+    std::vector<std::pair<uint64_t, DataBlock*>> rows;
+    uint64_t new_record_cnt = 0;
+    for (FrozenBlock* block = head; block != nullptr; block = block->GetNext()) {
+        std::vector<uint64_t> times;
+        std::vector<uint32_t> offsets;
+        std::string data;
+        if (!block->Decode(&times, &offsets, &data)) {
+            PDLOG(WARNING, "fail to decode frozen block, skip thawing");
+            for (auto& row : rows) {
+                DataBlock::Free(block_allocator_, row.second);
+            }
+            return;
+        }
+        for (uint32_t i = 0; i < times.size(); i++) {
+            rows.emplace_back(times[i], DataBlock::New(block_allocator_, 1, data.data() + offsets[i],
+                                                       offsets[i + 1] - offsets[i]));
+        }
+        // the other rows are still owned by the data blocks of other indexes, each
+        // thawed copy becomes a record of its own
+        new_record_cnt += block->GetCount() - block->GetOwnedCount();
+    }
+    {
+        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+        if (entry->frozen_.load(std::memory_order_relaxed) != head) {
+            for (auto& row : rows) {
+                DataBlock::Free(block_allocator_, row.second);
+            }
+            return;
+        }
+        for (auto& row : rows) {
+            uint8_t height = entry->entries.InsertConcurrently(row.first, row.second, allocator_);
+            idx_byte_size_.fetch_add(GetRecordTsIdxSize(height), std::memory_order_relaxed);
+        }
+        // a reader which loads the chain before may see the thawed rows twice until it ends
+        entry->frozen_.store(nullptr, std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        for (FrozenBlock* block = head; block != nullptr; block = block->GetNext()) {
+            freed_byte_size += block->GetByteSize();
+            frozen_byte_size_.fetch_sub(block->GetByteSize(), std::memory_order_relaxed);
+            CountRetired(block->GetByteSize());
+            retiring_.frozen.push_back(block);
+        }
+    }
+    for (auto& row : rows) {
+        record_byte_size += GetRecordSize(row.second->size);
+    }
+    record_cnt += new_record_cnt;
+    thaw_cnt += rows.size();
+}
+
+uint64_t Segment::Gc4TTLEntry(const Slice& key, KeyEntry* entry, uint64_t time, uint64_t& gc_idx_cnt,
+                              uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
+    ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
+    bool need_split = node != nullptr && node->GetKey() <= time;
+    bool need_gc_frozen = NeedGcFrozen(entry, time);
+    if (!need_split && !need_gc_frozen) {
+        if (node != nullptr) {
             DEBUGLOG(
                 "[Gc4TTL] segment gc with key %lu need not ttl, last node "
                 "key %lu",
                 time, node->GetKey());
-            continue;
         }
-        node = nullptr;
-        ::openmldb::base::Node<Slice, void*>* entry_node = nullptr;
-        {
-            std::lock_guard<std::mutex> lock(mu_);
-            SplitList(entry, time, &node);
-            if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
-            }
+        return entry->GetEarliestTs();
+    }
+    node = nullptr;
+    FrozenBlock* frozen = nullptr;
+    ::openmldb::base::Node<Slice, void*>* entry_node = nullptr;
+    uint64_t earliest_ts = UINT64_MAX;
+    {
+        std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+        if (need_split) {
+            node = entry->entries.Split(time);
         }
-        if (entry_node != nullptr) {
-            std::lock_guard<std::mutex> lock(gc_mu_);
-            entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+        if (need_gc_frozen) {
+            SplitFrozen(entry, time, &frozen);
         }
-        uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
-        gc_idx_cnt += entry_gc_idx_cnt;
+        entry->ResetEarliestTs();
+        if (entry->IsEmpty()) {
+            entry_node = RemoveEntry(key);
+        }
+        if (entry_node == nullptr) {
+            earliest_ts = entry->GetEarliestTs();
+        }
+    }
+    if (entry_node != nullptr) {
+        std::lock_guard<std::mutex> lock(gc_mu_);
+        entry_free_list_->Insert(epoch_->GetEpoch(), entry_node);
+    }
+    uint64_t entry_gc_idx_cnt = 0;
+    RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    RetireFrozen(frozen, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+    gc_idx_cnt += entry_gc_idx_cnt;
+    return earliest_ts;
+}
+
+// fast gc with no global pause
+bool Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                     uint64_t& gc_record_byte_size, const GcBudget& budget) {
+    if (expire_wheel_ != nullptr) {
+        return Gc4TTLByWheel(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    bool finished = true;
+    uint64_t key_cnt = 0;
+    KeyEntries::Iterator* it = entries_->NewIterator();
+    SeekGcCursor(it);
+    while (it->Valid()) {
+        if (CheckGcBudget(budget, key_cnt++, it)) {
+            finished = false;
+            break;
+        }
+        KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
+        Slice key = it->GetKey();
+        it->Next();
+        if (entry->GetEarliestTs() > time) {
+            continue;
+        }
+        Gc4TTLEntry(key, entry, time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    if (finished) {
+        gc_cursor_.clear();
     }
     DEBUGLOG("[Gc4TTL] segment gc with key %lu ,consumed %lu, count %lu", time,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    ReclaimRetired();
+    return finished;
 }
 
-void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                            uint64_t& gc_record_byte_size) {
+bool Segment::Gc4TTLByWheel(uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                            uint64_t& gc_record_byte_size, const GcBudget& budget) {
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    std::vector<std::string> keys;
+    bool finished = expire_wheel_->Pop(time, budget.max_key_cnt, &keys);
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (budget.deadline > 0 && i > 0 && (i & 0x3F) == 0 &&
+            ::baidu::common::timer::get_micros() >= budget.deadline) {
+            // put the keys left back, they are taken first in the next round
+            for (; i < keys.size(); i++) {
+                expire_wheel_->Add(Slice(keys[i]), time);
+            }
+            finished = false;
+            break;
+        }
+        Slice key(keys[i]);
+        void* value = nullptr;
+        // the key has been deleted or it's a stale one
+        if (!GetEntry(key, value)) {
+            continue;
+        }
+        KeyEntry* entry = reinterpret_cast<KeyEntry*>(value);
+        uint64_t earliest_ts = Gc4TTLEntry(key, entry, time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        if (earliest_ts == UINT64_MAX) {
+            continue;
+        }
+        if (expire_wheel_->IsCollected(earliest_ts, time)) {
+            expire_wheel_->AddDeferred(key, earliest_ts);
+        } else {
+            expire_wheel_->Add(key, earliest_ts);
+        }
+    }
+    if (finished) {
+        expire_wheel_->FlushDeferred();
+    }
+    DEBUGLOG("[Gc4TTL] segment gc by expire wheel with key %lu, visit %lu keys, consumed %lu, count %lu", time,
+             keys.size(), (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
+    idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    wheel_paused_ = !finished;
+    ReclaimRetired();
+    return finished;
+}
+
+bool Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                            uint64_t& gc_record_byte_size, const GcBudget& budget) {
     if (time == 0 || keep_cnt == 0) {
         PDLOG(INFO, "[Gc4TTLAndHead] segment gc4ttlandhead is disabled");
-        return;
+        return true;
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    bool finished = true;
+    uint64_t key_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (CheckGcBudget(budget, key_cnt++, it)) {
+            finished = false;
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
         it->Next();
-        if (node == nullptr) {
-            continue;
-        } else if (node->GetKey() > time) {
+        if (entry->GetEarliestTs() > time || entry->GetCount() <= keep_cnt) {
             DEBUGLOG(
-                "[Gc4TTLAndHead] segment gc with key %lu need not ttl, last "
-                "node key %lu",
-                time, node->GetKey());
+                "[Gc4TTLAndHead] segment gc with key %lu need not ttl, earliest "
+                "ts %lu",
+                time, entry->GetEarliestTs());
             continue;
         }
-        node = nullptr;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = nullptr;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
-            }
+            std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+            node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
+            entry->ResetEarliestTs();
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
     }
+    if (finished) {
+        gc_cursor_.clear();
+    }
     DEBUGLOG(
         "[Gc4TTLAndHead] segment gc time %lu and keep cnt %lu consumed %lu, "
         "count %lu",
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    ReclaimRetired();
+    return finished;
 }
 
-void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
-                           uint64_t& gc_record_byte_size) {
+bool Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                           uint64_t& gc_record_byte_size, const GcBudget& budget) {
     if (time == 0 && keep_cnt == 0) {
         PDLOG(INFO, "[Gc4TTLOrHead] segment gc4ttlorhead is disabled");
-        return;
+        return true;
     } else if (time == 0) {
-        Gc4Head(keep_cnt, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        return;
+        return Gc4Head(keep_cnt, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
     } else if (keep_cnt == 0) {
-        Gc4TTL(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
-        return;
+        return Gc4TTL(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size, budget);
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    bool finished = true;
+    uint64_t key_cnt = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
-    it->SeekToFirst();
+    SeekGcCursor(it);
     while (it->Valid()) {
+        if (CheckGcBudget(budget, key_cnt++, it)) {
+            finished = false;
+            break;
+        }
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
-        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
-        if (node == nullptr) {
+        if (entry->GetEarliestTs() > time && entry->GetCount() <= keep_cnt) {
             continue;
         }
-        node = nullptr;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = nullptr;
         ::openmldb::base::Node<Slice, void*>* entry_node = nullptr;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            if (entry->refs_.load(std::memory_order_acquire) <= 0) {
-                node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
-            }
-            if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
+            std::lock_guard<::openmldb::base::SharedSpinMutex> lock(mu_);
+            node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
+            entry->ResetEarliestTs();
+            if (entry->IsEmpty()) {
+                entry_node = RemoveEntry(key);
             }
         }
         if (entry_node != nullptr) {
             std::lock_guard<std::mutex> lock(gc_mu_);
-            entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+            entry_free_list_->Insert(epoch_->GetEpoch(), entry_node);
         }
         uint64_t entry_gc_idx_cnt = 0;
-        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        RetireList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
         entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
         gc_idx_cnt += entry_gc_idx_cnt;
     }
+    if (finished) {
+        gc_cursor_.clear();
+    }
     DEBUGLOG(
         "[Gc4TTLAndHead] segment gc time %lu and keep cnt %lu consumed %lu, "
         "count %lu",
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
     delete it;
+    ReclaimRetired();
+    return finished;
 }
 
 int Segment::GetCount(const Slice& key, uint64_t& count) {
     if (ts_cnt_ > 1) {
         return -1;
     }
+    ::openmldb::base::EpochGuard guard(epoch_);
     void* entry = nullptr;
-    if (entries_->Get(key, entry) < 0 || entry == nullptr) {
+    if (!GetEntry(key, entry)) {
         return -1;
     }
     count = ((KeyEntry*)entry)->count_.load(std::memory_order_relaxed);  // NOLINT
@@ -786,8 +1386,9 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
     if (ts_cnt_ == 1) {
         return GetCount(key, count);
     }
+    ::openmldb::base::EpochGuard guard(epoch_);
     void* entry_arr = nullptr;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == nullptr) {
+    if (!GetEntry(key, entry_arr)) {
         return -1;
     }
     count = ((KeyEntry**)entry_arr)[pos->second]->count_.load(  // NOLINT
@@ -800,12 +1401,13 @@ MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
     if (entries_ == nullptr || ts_cnt_ > 1) {
         return new MemTableIterator(nullptr);
     }
+    // pin the epoch before the entry is looked up
+    MemTableIterator* it = new MemTableIterator(epoch_);
     void* entry = nullptr;
-    if (entries_->Get(key, entry) < 0 || entry == nullptr) {
-        return new MemTableIterator(nullptr);
+    if (GetEntry(key, entry)) {
+        it->SetIterator(((KeyEntry*)entry)->NewIterator());  // NOLINT
     }
-    ticket.Push((KeyEntry*)entry);                                           // NOLINT
-    return new MemTableIterator(((KeyEntry*)entry)->entries.NewIterator());  // NOLINT
+    return it;
 }
 
 MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& ticket) {
@@ -816,15 +1418,15 @@ MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& t
     if (ts_cnt_ == 1) {
         return NewIterator(key, ticket);
     }
+    MemTableIterator* it = new MemTableIterator(epoch_);
     void* entry_arr = nullptr;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == nullptr) {
-        return new MemTableIterator(nullptr);
+    if (GetEntry(key, entry_arr)) {
+        it->SetIterator(((KeyEntry**)entry_arr)[pos->second]->NewIterator());  // NOLINT
     }
-    ticket.Push(((KeyEntry**)entry_arr)[pos->second]);                                         // NOLINT
-    return new MemTableIterator(((KeyEntry**)entry_arr)[pos->second]->entries.NewIterator());  // NOLINT
+    return it;
 }
 
-MemTableIterator::MemTableIterator(TimeEntries::Iterator* it) : it_(it) {}
+MemTableIterator::MemTableIterator(::openmldb::base::EpochManager* epoch) : guard_(epoch), it_(nullptr) {}
 
 MemTableIterator::~MemTableIterator() {
     if (it_ != nullptr) {
@@ -854,7 +1456,7 @@ void MemTableIterator::Next() {
 }
 
 ::openmldb::base::Slice MemTableIterator::GetValue() const {
-    return ::openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
+    return it_->GetValue();
 }
 
 uint64_t MemTableIterator::GetKey() const { return it_->GetKey(); }
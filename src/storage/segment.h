@@ -18,15 +18,23 @@
 #define SRC_STORAGE_SEGMENT_H_
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <string>
 #include <vector>
 
+#include "base/epoch.h"
 #include "base/skiplist.h"
+#include "base/slab_allocator.h"
 #include "base/slice.h"
+#include "base/spinlock.h"
 #include "proto/tablet.pb.h"
+#include "storage/expire_wheel.h"
+#include "storage/frozen_block.h"
 #include "storage/iterator.h"
+#include "storage/pk_hash_index.h"
 #include "storage/schema.h"
 #include "storage/ticket.h"
 
@@ -35,6 +43,7 @@ namespace storage {
 
 typedef google::protobuf::RepeatedPtrField<::openmldb::api::TSDimension> TSDimensions;
 
+using ::openmldb::base::SlabAllocator;
 using ::openmldb::base::Slice;
 
 class Segment;
@@ -43,16 +52,19 @@ class Ticket;
 struct DataBlock {
     // dimension count down
     uint8_t dim_cnt_down;
+    // the block and its data are placed in one slab allocation
+    bool in_slab;
     uint32_t size;
     char* data;
 
-    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len) : dim_cnt_down(dim_cnt), size(len), data(nullptr) {
+    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len)
+        : dim_cnt_down(dim_cnt), in_slab(false), size(len), data(nullptr) {
         data = new char[len];
         memcpy(data, input, len);
     }
 
     DataBlock(uint8_t dim_cnt, char* input, uint32_t len, bool skip_copy)
-        : dim_cnt_down(dim_cnt), size(len), data(nullptr) {
+        : dim_cnt_down(dim_cnt), in_slab(false), size(len), data(nullptr) {
         if (skip_copy) {
             data = input;
         } else {
@@ -62,9 +74,39 @@ struct DataBlock {
     }
 
     ~DataBlock() {
-        delete[] data;
+        if (!in_slab) {
+            delete[] data;
+        }
         data = nullptr;
     }
+
+    // allocate the block from allocator if it is not null, or else from heap
+    static DataBlock* New(SlabAllocator* allocator, uint8_t dim_cnt, const char* input, uint32_t len) {
+        if (allocator == nullptr) {
+            return new DataBlock(dim_cnt, input, len);
+        }
+        char* mem = reinterpret_cast<char*>(allocator->Allocate(sizeof(DataBlock) + len));
+        char* payload = mem + sizeof(DataBlock);
+        memcpy(payload, input, len);
+        return new (mem) DataBlock(dim_cnt, len, payload);
+    }
+
+    static void Free(SlabAllocator* allocator, DataBlock* block) {
+        if (block == nullptr) {
+            return;
+        }
+        if (!block->in_slab) {
+            delete block;
+            return;
+        }
+        size_t byte_size = sizeof(DataBlock) + block->size;
+        block->~DataBlock();
+        allocator->Free(block, byte_size);
+    }
+
+ private:
+    DataBlock(uint8_t dim_cnt, uint32_t len, char* payload)
+        : dim_cnt_down(dim_cnt), in_slab(true), size(len), data(payload) {}
 };
 
 // the desc time comparator
@@ -82,9 +124,95 @@ struct TimeComparator {
 static const TimeComparator tcmp;
 typedef ::openmldb::base::Skiplist<uint64_t, DataBlock*, TimeComparator> TimeEntries;
 
+// TimeEntryIterator iterates the rows of a key entry. The rows in time entries and
+// the ones in frozen blocks are merged in descending order of time
+class TimeEntryIterator {
+ public:
+    TimeEntryIterator(TimeEntries::Iterator* it, FrozenBlock* frozen)
+        : it_(it), frozen_it_(frozen), has_frozen_(frozen != nullptr), cur_frozen_(false), at_last_(false),
+          exhausted_(false) {}
+    ~TimeEntryIterator() { delete it_; }
+
+    bool Valid() const { return !exhausted_ && (it_->Valid() || (has_frozen_ && frozen_it_.Valid())); }
+
+    void Next() {
+        if (at_last_) {
+            exhausted_ = true;
+            return;
+        }
+        if (cur_frozen_) {
+            frozen_it_.Next();
+        } else {
+            it_->Next();
+        }
+        Update();
+    }
+
+    const uint64_t& GetKey() const { return cur_frozen_ ? frozen_it_.GetKey() : it_->GetKey(); }
+
+    // the value of a frozen row is only valid until the iterator leaves its frozen block
+    Slice GetValue() const {
+        if (cur_frozen_) {
+            return frozen_it_.GetValue();
+        }
+        DataBlock* block = it_->GetValue();
+        return Slice(block->data, block->size);
+    }
+
+    bool IsFrozen() const { return cur_frozen_; }
+
+    void Seek(uint64_t time) {
+        Reset();
+        it_->Seek(time);
+        if (has_frozen_) {
+            frozen_it_.Seek(time);
+        }
+        Update();
+    }
+
+    void SeekToFirst() {
+        Reset();
+        it_->SeekToFirst();
+        if (has_frozen_) {
+            frozen_it_.SeekToFirst();
+        }
+        Update();
+    }
+
+    void SeekToLast() {
+        Reset();
+        it_->SeekToLast();
+        if (has_frozen_) {
+            frozen_it_.SeekToLast();
+        }
+        cur_frozen_ = has_frozen_ && frozen_it_.Valid() && (!it_->Valid() || frozen_it_.GetKey() < it_->GetKey());
+        at_last_ = true;
+    }
+
+ private:
+    void Reset() {
+        at_last_ = false;
+        exhausted_ = false;
+    }
+
+    void Update() {
+        cur_frozen_ = has_frozen_ && frozen_it_.Valid() && (!it_->Valid() || frozen_it_.GetKey() > it_->GetKey());
+    }
+
+ private:
+    TimeEntries::Iterator* it_;
+    FrozenBlockIterator frozen_it_;
+    bool has_frozen_;
+    bool cur_frozen_;
+    bool at_last_;
+    bool exhausted_;
+};
+
+// MemTableIterator pins the epoch of segment in its lifetime, so that the rows it
+// may visit are not freed by gc
 class MemTableIterator : public TableIterator {
  public:
-    explicit MemTableIterator(TimeEntries::Iterator* it);
+    explicit MemTableIterator(::openmldb::base::EpochManager* epoch);
     virtual ~MemTableIterator();
     void Seek(const uint64_t time) override;
     bool Valid() override;
@@ -95,17 +223,46 @@ class MemTableIterator : public TableIterator {
     void SeekToLast() override;
 
  private:
-    TimeEntries::Iterator* it_;
+    friend Segment;
+    void SetIterator(TimeEntryIterator* it) { it_ = it; }
+
+ private:
+    ::openmldb::base::EpochGuard guard_;
+    TimeEntryIterator* it_;
 };
 
 class KeyEntry {
  public:
-    KeyEntry() : entries(12, 4, tcmp), refs_(0), count_(0) {}
-    explicit KeyEntry(uint8_t height) : entries(height, 4, tcmp), refs_(0), count_(0) {}
-    ~KeyEntry() {}
+    KeyEntry() : entries(12, 4, tcmp), count_(0), earliest_ts_(UINT64_MAX), frozen_(nullptr) {}
+    explicit KeyEntry(uint8_t height)
+        : entries(height, 4, tcmp), count_(0), earliest_ts_(UINT64_MAX), frozen_(nullptr) {}
+    ~KeyEntry() { FreeFrozen(frozen_.load(std::memory_order_relaxed)); }
+
+    // iterate the rows in time entries and frozen blocks
+    TimeEntryIterator* NewIterator() {
+        return new TimeEntryIterator(entries.NewIterator(), frozen_.load(std::memory_order_acquire));
+    }
+
+    bool IsEmpty() { return entries.IsEmpty() && frozen_.load(std::memory_order_relaxed) == nullptr; }
+
+    // free the chain of frozen blocks and return the count of rows in them
+    static uint64_t FreeFrozen(FrozenBlock* block) {
+        uint64_t cnt = 0;
+        while (block != nullptr) {
+            FrozenBlock* tmp = block;
+            block = block->GetNext();
+            cnt += tmp->GetCount();
+            delete tmp;
+        }
+        return cnt;
+    }
 
     // just return the count of datablock
-    uint64_t Release() {
+    uint64_t Release() { return Release(nullptr, nullptr); }
+
+    // allocator is the one of the time entry nodes and block_allocator is the one of data blocks,
+    // they are null if slab allocation is disabled
+    uint64_t Release(SlabAllocator* allocator, SlabAllocator* block_allocator) {
         uint64_t cnt = 0;
         TimeEntries::Iterator* it = entries.NewIterator();
         it->SeekToFirst();
@@ -116,25 +273,52 @@ class KeyEntry {
             if (block->dim_cnt_down > 1) {
                 block->dim_cnt_down--;
             } else {
-                delete block;
+                DataBlock::Free(block_allocator, block);
             }
             it->Next();
         }
-        entries.Clear();
+        entries.Clear(allocator);
         delete it;
+        cnt += FreeFrozen(frozen_.exchange(nullptr, std::memory_order_relaxed));
         return cnt;
     }
 
-    void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t GetCount() { return count_.load(std::memory_order_relaxed); }
 
-    void UnRef() { refs_.fetch_sub(1, std::memory_order_relaxed); }
+    // no row of the entry is older than it, gc skips the entry if it has not expired
+    uint64_t GetEarliestTs() { return earliest_ts_.load(std::memory_order_relaxed); }
 
-    uint64_t GetCount() { return count_.load(std::memory_order_relaxed); }
+    // called before a row of time ts is inserted, return the earliest ts before it
+    uint64_t UpdateEarliestTs(uint64_t ts) {
+        uint64_t cur = earliest_ts_.load(std::memory_order_relaxed);
+        while (ts < cur && !earliest_ts_.compare_exchange_weak(cur, ts, std::memory_order_relaxed)) {
+        }
+        return cur;
+    }
+
+    // recompute it after rows are removed, need to hold the mu_ of segment exclusively
+    void ResetEarliestTs() {
+        uint64_t ts = UINT64_MAX;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = entries.GetLast();
+        if (node != nullptr) {
+            ts = node->GetKey();
+        }
+        FrozenBlock* block = frozen_.load(std::memory_order_relaxed);
+        while (block != nullptr && block->GetNext() != nullptr) {
+            block = block->GetNext();
+        }
+        if (block != nullptr && block->GetMinTime() < ts) {
+            ts = block->GetMinTime();
+        }
+        earliest_ts_.store(ts, std::memory_order_relaxed);
+    }
 
  public:
     TimeEntries entries;
-    std::atomic<uint64_t> refs_;
     std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> earliest_ts_;
+    // the chain of frozen blocks from the newest to the oldest
+    std::atomic<FrozenBlock*> frozen_;
     friend Segment;
 };
 
@@ -145,11 +329,30 @@ struct SliceComparator {
 typedef ::openmldb::base::Skiplist<::openmldb::base::Slice, void*, SliceComparator> KeyEntries;
 typedef ::openmldb::base::Skiplist<uint64_t, ::openmldb::base::Node<Slice, void*>*, TimeComparator> KeyEntryNodeList;
 
+// GcBudget limits a gc round of segment. the round stops once it has visited max_key_cnt keys
+// or the time passes deadline in microseconds, 0 means no limit
+struct GcBudget {
+    GcBudget() : max_key_cnt(0), deadline(0) {}
+    GcBudget(uint64_t key_cnt, uint64_t time) : max_key_cnt(key_cnt), deadline(time) {}
+
+    uint64_t max_key_cnt;
+    uint64_t deadline;
+};
+
+// Segment frees the memory unlinked by gc through epoch based reclamation. Readers pin
+// the epoch instead of the key entries, the unlinked nodes, data blocks and frozen blocks
+// are retired with the epoch after the unlink and freed once no reader pins an epoch
+// not later than it. gc of a segment runs on one thread at a time.
 class Segment {
  public:
     Segment();
-    explicit Segment(uint8_t height);
-    Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec);
+    // enable_hash_index adds a hash index of pk in front of the key skiplist for point lookups,
+    // the skiplist is still kept for traversing and gc. epoch is shared by the segments whose
+    // data blocks are shared, the segment uses its own one if it is null
+    explicit Segment(uint8_t height, bool enable_hash_index = false,
+                     ::openmldb::base::EpochManager* epoch = nullptr);
+    Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec, bool enable_hash_index = false,
+            ::openmldb::base::EpochManager* epoch = nullptr);
     ~Segment();
 
     // Put time data
@@ -157,38 +360,75 @@ class Segment {
 
     void Put(const Slice& key, uint64_t time, DataBlock* row);
 
+    // need to hold mu_ in shared mode, puts are applied concurrently
     void PutUnlock(const Slice& key, uint64_t time, DataBlock* row);
 
+    void PutUnlock(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row);
+
     void BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row);
 
     void Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, DataBlock* row);
 
+    // a row of batch put, the ts map is owned by the caller
+    struct BatchRow {
+        Slice key;
+        const std::map<int32_t, uint64_t>* ts_map;
+        DataBlock* row;
+    };
+
+    // put the rows with mu_ acquired once
+    void PutBatch(const std::vector<BatchRow>& rows);
+
     bool Delete(const Slice& key);
 
     uint64_t Release();
 
-    void ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt,                          // NOLINT
-                   uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size);            // NOLINT
-    void ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
-                   uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size);            // NOLINT
+    // gc runs in rounds limited by the budget. a round starts from the key where the last one
+    // stopped, and returns true if it reaches the last key so that the next round starts over
+    bool ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt,                          // NOLINT
+                   uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size,             // NOLINT
+                   const GcBudget& budget = GcBudget());
+    bool ExecuteGc(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
+                   uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size,             // NOLINT
+                   const GcBudget& budget = GcBudget());
 
-    void Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
+    bool Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
                 uint64_t& gc_record_cnt,                    // NOLINT
-                uint64_t& gc_record_byte_size);             // NOLINT
-    void Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt,   // NOLINT
+                uint64_t& gc_record_byte_size,              // NOLINT
+                const GcBudget& budget = GcBudget());
+    bool Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt,   // NOLINT
                  uint64_t& gc_record_cnt,                   // NOLINT
-                 uint64_t& gc_record_byte_size);            // NOLINT
-    void Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt,
+                 uint64_t& gc_record_byte_size,             // NOLINT
+                 const GcBudget& budget = GcBudget());
+    bool Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt,
                        uint64_t& gc_idx_cnt,            // NOLINT
                        uint64_t& gc_record_cnt,         // NOLINT
-                       uint64_t& gc_record_byte_size);  // NOLINT
-    void Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt,
+                       uint64_t& gc_record_byte_size,   // NOLINT
+                       const GcBudget& budget = GcBudget());
+    bool Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt,
                       uint64_t& gc_idx_cnt,                                            // NOLINT
                       uint64_t& gc_record_cnt,                                         // NOLINT
-                      uint64_t& gc_record_byte_size);                                  // NOLINT
-    void GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
+                      uint64_t& gc_record_byte_size,                                   // NOLINT
+                      const GcBudget& budget = GcBudget());
+    bool GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& gc_idx_cnt,  // NOLINT
                    uint64_t& gc_record_cnt,                                            // NOLINT
-                   uint64_t& gc_record_byte_size);                                     // NOLINT
+                   uint64_t& gc_record_byte_size,                                      // NOLINT
+                   const GcBudget& budget = GcBudget());
+    // true if no gc round is in progress, the next round starts a new pass from the first key
+    bool IsGcPassStart() { return gc_cursor_.empty() && !wheel_paused_; }
+    // freeze the rows of which time is not greater than time into compressed blocks. fixed_len
+    // is the length of the fixed part of rows. freed_byte_size is the size of the rows and the
+    // old blocks freed and frozen_byte_size is the size of new blocks. only for single ts segment
+    void Freeze(uint64_t time, uint32_t fixed_len, uint64_t& freeze_cnt,  // NOLINT
+                uint64_t& freed_byte_size,                                // NOLINT
+                uint64_t& frozen_byte_size);                              // NOLINT
+    // move the frozen rows back to the time entries, which is done once the ttl type can not
+    // drop frozen rows any more. record_cnt and record_byte_size are the records and bytes the
+    // rows take as data blocks, freed_byte_size is the size of the frozen blocks freed
+    void Thaw(uint64_t& thaw_cnt, uint64_t& record_cnt,  // NOLINT
+              uint64_t& record_byte_size,                // NOLINT
+              uint64_t& freed_byte_size);                // NOLINT
+    // ticket is kept for the interface of table, the iterator pins the epoch by itself
     MemTableIterator* NewIterator(const Slice& key, Ticket& ticket);                   // NOLINT
     MemTableIterator* NewIterator(const Slice& key, uint32_t idx,
                                   Ticket& ticket);  // NOLINT
@@ -221,30 +461,128 @@ class Segment {
 
     const std::map<uint32_t, uint32_t>& GetTsIdxMap() const { return ts_idx_map_; }
 
-    inline uint64_t GetIdxByteSize() { return idx_byte_size_.load(std::memory_order_relaxed); }
+    inline uint64_t GetIdxByteSize() {
+        uint64_t byte_size = idx_byte_size_.load(std::memory_order_relaxed);
+        if (hash_index_ != nullptr) {
+            byte_size += hash_index_->GetByteSize();
+        }
+        return byte_size;
+    }
 
     inline uint64_t GetPkCnt() { return pk_cnt_.load(std::memory_order_relaxed); }
 
+    inline uint64_t GetFrozenByteSize() { return frozen_byte_size_.load(std::memory_order_relaxed); }
+
+    inline uint64_t GetRetiredByteSize() { return retired_byte_size_.load(std::memory_order_relaxed); }
+
+    // the bytes held by the segment, which are the index structures, the frozen blocks and the memory
+    // retired by gc. the live data blocks are shared by segments, so they are counted by the table
+    inline uint64_t GetMemByteSize() { return GetIdxByteSize() + GetFrozenByteSize() + GetRetiredByteSize(); }
+
+    // free the deleted keys and the memory retired before that no reader can see
     void GcFreeList(uint64_t& entry_gc_idx_cnt,      // NOLINT
                     uint64_t& gc_record_cnt,         // NOLINT
                     uint64_t& gc_record_byte_size);  // NOLINT
 
     KeyEntries* GetKeyEntries() { return entries_; }
 
+    // it's null if the hash index is disabled
+    PkHashIndex* GetHashIndex() { return hash_index_; }
+
     int GetCount(const Slice& key, uint64_t& count);                // NOLINT
     int GetCount(const Slice& key, uint32_t idx, uint64_t& count);  // NOLINT
 
-    void IncrGcVersion() { gc_version_.fetch_add(1, std::memory_order_relaxed); }
+    // advance the epoch so that the memory retired before can be freed
+    void IncrGcVersion() { epoch_->Advance(); }
+
+    ::openmldb::base::EpochManager* GetEpochManager() { return epoch_; }
 
     void ReleaseAndCount();
 
     void ReleaseAndCount(const std::vector<size_t>& id_vec);
 
+    // the allocator of index structures, it's null if slab allocation is disabled
+    SlabAllocator* GetAllocator() { return allocator_; }
+
+    // data blocks may be shared by segments of different indexes, so they are allocated
+    // from the allocator of table which is set here
+    void SetBlockAllocator(SlabAllocator* block_allocator) { block_allocator_ = block_allocator; }
+
+    // let Gc4TTL visit only the keys in the expired buckets of an expire wheel instead of all keys.
+    // it only works with one ts and must be called before any put
+    void EnableExpireWheel(uint64_t bucket_width);
+    ExpireWheel* GetExpireWheel() { return expire_wheel_; }
+
  private:
-    void FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
-                  uint64_t& gc_record_cnt,         // NOLINT
-                  uint64_t& gc_record_byte_size);  // NOLINT
-    void SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node);
+    // get the entry of key, it's KeyEntry* if ts_cnt_ is 1 or else KeyEntry**.
+    // create it if the key does not exist and add its byte size to byte_size
+    void* GetOrCreateEntry(const Slice& key, uint32_t& byte_size);  // NOLINT
+    // look up the entry of key through the hash index if it's enabled
+    bool GetEntry(const Slice& key, void*& entry);  // NOLINT
+    // need to hold mu_ exclusively
+    ::openmldb::base::Node<Slice, void*>* RemoveEntry(const Slice& key);
+    Slice CopyKey(const Slice& key);
+    void FreeKey(const Slice& key);
+    KeyEntry* NewKeyEntry();
+    void FreeKeyEntry(KeyEntry* entry);
+    KeyEntry** NewKeyEntryArray();
+    void FreeKeyEntryArray(KeyEntry** entry_arr);
+
+    // the memory unlinked by a gc call, it's retired with the epoch after the unlink
+    struct Retired {
+        Retired() : epoch(0), byte_size(0) {}
+        bool Empty() const { return nodes.empty() && blocks.empty() && frozen.empty(); }
+
+        uint64_t epoch;
+        uint64_t byte_size;
+        // the lists split from time entries
+        std::vector<::openmldb::base::Node<uint64_t, DataBlock*>*> nodes;
+        // the data blocks no longer referred by any index
+        std::vector<DataBlock*> blocks;
+        std::vector<FrozenBlock*> frozen;
+    };
+
+    // count the rows of the list split by gc and retire its memory. a data block is retired
+    // by the list which unlinks it at last, as readers may reach it through the other lists
+    void RetireList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
+                    uint64_t& gc_record_cnt,                                                  // NOLINT
+                    uint64_t& gc_record_byte_size);                                           // NOLINT
+    void RetireFrozen(FrozenBlock* block, uint64_t& gc_idx_cnt,  // NOLINT
+                      uint64_t& gc_record_cnt,                   // NOLINT
+                      uint64_t& gc_record_byte_size);            // NOLINT
+    // tag the memory retired by the current gc call and free the retired memory no reader can see
+    void ReclaimRetired();
+
+    // need to hold gc_mu_
+    void CountRetired(uint64_t byte_size) {
+        retiring_.byte_size += byte_size;
+        retired_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    }
+    void FreeRetired(Retired* retired);
+    bool NeedGcFrozen(KeyEntry* entry, uint64_t ts);
+    void SplitFrozen(KeyEntry* entry, uint64_t ts, FrozenBlock** block);
+    void FreeFrozen(FrozenBlock* block, uint64_t& gc_idx_cnt,  // NOLINT
+                    uint64_t& gc_record_cnt,                   // NOLINT
+                    uint64_t& gc_record_byte_size);            // NOLINT
+    void FreezeEntry(KeyEntry* entry, uint64_t time, uint32_t fixed_len, uint64_t& freeze_cnt,  // NOLINT
+                     uint64_t& freed_byte_size,                                                // NOLINT
+                     uint64_t& frozen_byte_size);                                              // NOLINT
+    void ThawEntry(KeyEntry* entry, uint64_t& thaw_cnt, uint64_t& record_cnt,  // NOLINT
+                   uint64_t& record_byte_size,                                 // NOLINT
+                   uint64_t& freed_byte_size);                                 // NOLINT
+
+    // gc the rows of entry at or before time, return the earliest ts left or UINT64_MAX if the entry is removed
+    uint64_t Gc4TTLEntry(const Slice& key, KeyEntry* entry, uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
+                         uint64_t& gc_record_cnt,                                                 // NOLINT
+                         uint64_t& gc_record_byte_size);                                          // NOLINT
+    bool Gc4TTLByWheel(uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,  // NOLINT
+                       uint64_t& gc_record_byte_size,                                 // NOLINT
+                       const GcBudget& budget);
+
+    // seek to the key where the last gc round stopped
+    void SeekGcCursor(KeyEntries::Iterator* it);
+    // return true and keep the current key of it as the cursor if the budget is used up
+    bool CheckGcBudget(const GcBudget& budget, uint64_t key_cnt, KeyEntries::Iterator* it);
 
     void GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt,  // NOLINT
                          uint64_t& gc_record_cnt,                 // NOLINT
@@ -255,19 +593,37 @@ class Segment {
 
  private:
     KeyEntries* entries_;
-    // only Put need mutex
-    std::mutex mu_;
+    // Put holds it in shared mode and inserts into skiplists concurrently,
+    // Delete and gc hold it exclusively when they unlink nodes
+    ::openmldb::base::SharedSpinMutex mu_;
+    // guards the free list of key entries and the retired memory
     std::mutex gc_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
     std::atomic<uint64_t> pk_cnt_;
+    std::atomic<uint64_t> frozen_byte_size_;
+    // the bytes of the memory retired by gc but not freed yet
+    std::atomic<uint64_t> retired_byte_size_;
     uint8_t key_entry_max_height_;
+    // the removed key entries tagged with the epoch after the removal, guarded by gc_mu_
     KeyEntryNodeList* entry_free_list_;
     uint32_t ts_cnt_;
-    std::atomic<uint64_t> gc_version_;
     std::map<uint32_t, uint32_t> ts_idx_map_;
     std::vector<std::shared_ptr<std::atomic<uint64_t>>> idx_cnt_vec_;
     uint64_t ttl_offset_;
+    SlabAllocator* allocator_;
+    SlabAllocator* block_allocator_;
+    std::unique_ptr<::openmldb::base::EpochManager> own_epoch_;
+    ::openmldb::base::EpochManager* epoch_;
+    PkHashIndex* hash_index_;
+    ExpireWheel* expire_wheel_;
+    // the key from which the next gc round starts, only accessed by the gc thread
+    std::string gc_cursor_;
+    // the last gc round by expire wheel was stopped by the budget
+    bool wheel_paused_;
+    // the memory retired by the gc calls running and the one tagged with epochs, guarded by gc_mu_
+    Retired retiring_;
+    std::deque<Retired> retired_;
 };
 
 }  // namespace storage
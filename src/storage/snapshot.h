@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "log/log_writer.h"
 #include "proto/tablet.pb.h"
@@ -39,6 +40,13 @@ class Snapshot {
                          uint64_t& latest_offset) = 0;  // NOLINT
     uint64_t GetOffset() { return offset_; }
     int GenManifest(const std::string& snapshot_name, uint64_t key_count, uint64_t offset, uint64_t term);
+    // the manifest of a snapshot of several part files, snapshot_name is the first of them. the deltas are
+    // loaded after the parts
+    int GenManifest(const std::string& snapshot_name, uint64_t key_count, uint64_t offset, uint64_t term,
+                    const std::vector<std::string>& parts, const std::vector<std::string>& deltas = {});
+    // the files of the snapshot in the manifest, the base files and then the deltas. a snapshot of one file
+    // has no parts
+    static std::vector<std::string> GetSnapshotFiles(const ::openmldb::api::Manifest& manifest);
     static int GetLocalManifest(const std::string& full_path,
                                 ::openmldb::api::Manifest& manifest);  // NOLINT
 
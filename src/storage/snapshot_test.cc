@@ -35,6 +35,7 @@
 #include "log/status.h"
 #include "proto/tablet.pb.h"
 #include "storage/binlog.h"
+#include "storage/flat_snapshot.h"
 #include "storage/mem_table.h"
 #include "storage/mem_table_snapshot.h"
 #include "storage/ticket.h"
@@ -42,6 +43,10 @@
 
 DECLARE_string(db_root_path);
 DECLARE_string(snapshot_compression);
+DECLARE_uint32(binlog_recover_thread_num);
+DECLARE_uint32(make_snapshot_thread_num);
+DECLARE_bool(make_flat_snapshot);
+DECLARE_uint32(snapshot_max_delta_num);
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -1703,6 +1708,534 @@ TEST_F(SnapshotTest, Recover_large_snapshot_and_binlog) {
     delete it;
 }
 
+// write the rows of two indexes to the binlog, the keys are deleted now and then
+void WriteRecoverBinlog(const std::string& binlog_dir, LogParts* log_part, uint64_t entry_cnt, uint32_t key_cnt) {
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    auto meta = ::openmldb::test::GetTableMeta({"card", "merchant", "value"});
+    ::openmldb::codec::SDKCodec sdk_codec(meta);
+    for (uint64_t i = 0; i < entry_cnt; i++) {
+        offset++;
+        ::openmldb::api::LogEntry entry;
+        entry.set_log_index(offset);
+        std::string card = "card" + std::to_string(i % key_cnt);
+        if (i % 97 == 0) {
+            entry.set_method_type(::openmldb::api::MethodType::kDelete);
+            ::openmldb::api::Dimension* dim = entry.add_dimensions();
+            dim->set_key(card);
+            dim->set_idx(0);
+        } else {
+            std::string merchant = "merchant" + std::to_string(i % (key_cnt / 3 + 1));
+            // the rows of a key share a ts now and then, so they are ordered by the replay
+            entry.set_ts(i / 2000 + 1);
+            std::string result;
+            sdk_codec.EncodeRow({card, merchant, "value" + std::to_string(i)}, &result);
+            entry.set_value(result);
+            ::openmldb::api::Dimension* d1 = entry.add_dimensions();
+            d1->set_key(card);
+            d1->set_idx(0);
+            ::openmldb::api::Dimension* d2 = entry.add_dimensions();
+            d2->set_key(merchant);
+            d2->set_idx(1);
+        }
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ASSERT_TRUE(wh->Write(slice).ok());
+        if (offset % 100000 == 0) {
+            RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+        }
+    }
+    wh->Sync();
+    delete wh;
+}
+
+std::shared_ptr<MemTable> RecoverWithThread(const std::string& binlog_dir, LogParts* log_part, uint32_t thread_num,
+                                            uint64_t* latest_offset, uint64_t* consumed) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("card", 0));
+    mapping.insert(std::make_pair("merchant", 1));
+    auto table = std::make_shared<MemTable>("test", 5, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    FLAGS_binlog_recover_thread_num = thread_num;
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    Binlog binlog(log_part, binlog_dir);
+    binlog.RecoverFromBinlog(table, 0, *latest_offset);
+    *consumed = ::baidu::common::timer::get_micros() - start_time;
+    return table;
+}
+
+std::vector<std::string> ScanKey(std::shared_ptr<MemTable> table, uint32_t idx, const std::string& key) {
+    std::vector<std::string> rows;
+    Ticket ticket;
+    TableIterator* it = table->NewIterator(idx, key, ticket);
+    it->SeekToFirst();
+    while (it->Valid()) {
+        rows.push_back(std::to_string(it->GetKey()) + ":" + it->GetValue().ToString());
+        it->Next();
+    }
+    delete it;
+    return rows;
+}
+
+TEST_F(SnapshotTest, Recover_binlog_parallel) {
+    uint32_t old_thread_num = FLAGS_binlog_recover_thread_num;
+    std::string binlog_dir = FLAGS_db_root_path + "/5_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t entry_cnt = 250000;
+    uint32_t key_cnt = 1000;
+    WriteRecoverBinlog(binlog_dir, log_part, entry_cnt, key_cnt);
+    uint64_t latest_offset = 0;
+    uint64_t consumed = 0;
+    auto expect = RecoverWithThread(binlog_dir, log_part, 1, &latest_offset, &consumed);
+    ASSERT_EQ(entry_cnt, latest_offset);
+    for (uint32_t thread_num : {2, 4, 7}) {
+        latest_offset = 0;
+        auto table = RecoverWithThread(binlog_dir, log_part, thread_num, &latest_offset, &consumed);
+        ASSERT_EQ(entry_cnt, latest_offset);
+        ASSERT_EQ(entry_cnt, table->GetRecoverOffset());
+        ASSERT_EQ(entry_cnt, table->GetRecoverCnt());
+        ASSERT_EQ(expect->GetRecordCnt(), table->GetRecordCnt());
+        for (uint32_t i = 0; i < key_cnt; i++) {
+            std::string card = "card" + std::to_string(i);
+            ASSERT_EQ(ScanKey(expect, 0, card), ScanKey(table, 0, card));
+            std::string merchant = "merchant" + std::to_string(i);
+            ASSERT_EQ(ScanKey(expect, 1, merchant), ScanKey(table, 1, merchant));
+        }
+    }
+    FLAGS_binlog_recover_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, DISABLED_Recover_binlog_thread_perf) {
+    uint32_t old_thread_num = FLAGS_binlog_recover_thread_num;
+    std::string binlog_dir = FLAGS_db_root_path + "/6_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t entry_cnt = 500000;
+    WriteRecoverBinlog(binlog_dir, log_part, entry_cnt, 100000);
+    for (uint32_t thread_num : {1, 2, 4, 8}) {
+        uint64_t latest_offset = 0;
+        uint64_t consumed = 0;
+        auto table = RecoverWithThread(binlog_dir, log_part, thread_num, &latest_offset, &consumed);
+        ASSERT_EQ(entry_cnt, latest_offset);
+        std::cout << "recover " << entry_cnt << " entries with " << thread_num << " threads, use time in us: "
+                  << consumed << std::endl;
+    }
+    FLAGS_binlog_recover_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+void WriteKVBinlog(WriteHandle* wh, uint64_t* offset, uint32_t cnt, uint32_t key_cnt, const std::string& value) {
+    uint64_t ts = ::baidu::common::timer::get_micros() / 1000;
+    for (uint32_t i = 0; i < cnt; i++) {
+        (*offset)++;
+        auto entry = ::openmldb::test::PackKVEntry(*offset, "key" + std::to_string(i % key_cnt), value, ts + i, 1);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ASSERT_TRUE(wh->Write(slice).ok());
+    }
+    wh->Sync();
+}
+
+TEST_F(SnapshotTest, MakeSnapshotParts) {
+    uint32_t old_thread_num = FLAGS_make_snapshot_thread_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/7_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/7_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    WriteKVBinlog(wh, &offset, 20000, 100, "value");
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 7, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(7, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    FLAGS_make_snapshot_thread_num = 4;
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(20000u, offset_value);
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(20000u, manifest.count());
+    ASSERT_EQ(4, manifest.parts_size());
+    ASSERT_EQ(manifest.name(), manifest.parts(0));
+    std::vector<std::string> files;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+    ASSERT_EQ(5u, files.size());
+    {
+        auto recovered =
+            std::make_shared<MemTable>("test", 7, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        recovered->Init();
+        MemTableSnapshot recover_snapshot(7, 0, log_part, FLAGS_db_root_path);
+        recover_snapshot.Init();
+        uint64_t latest_offset = 0;
+        ASSERT_TRUE(recover_snapshot.Recover(recovered, latest_offset));
+        ASSERT_EQ(20000u, latest_offset);
+        ASSERT_EQ(20000u, recovered->GetRecordCnt());
+    }
+
+    // the parts of the old snapshot are filtered into a snapshot of one file
+    WriteKVBinlog(wh, &offset, 1000, 100, "value");
+    offset++;
+    ::openmldb::api::LogEntry delete_entry;
+    delete_entry.set_log_index(offset);
+    delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    ::openmldb::api::Dimension* dimension = delete_entry.add_dimensions();
+    dimension->set_key("key0");
+    dimension->set_idx(0);
+    std::string buffer;
+    delete_entry.SerializeToString(&buffer);
+    ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    wh->Sync();
+    FLAGS_make_snapshot_thread_num = 1;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(offset, offset_value);
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    // key0 has 200 rows in the old snapshot and 10 rows after it
+    ASSERT_EQ(21000u - 210u, manifest.count());
+    ASSERT_EQ(0, manifest.parts_size());
+    files.clear();
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+    ASSERT_EQ(2u, files.size());
+    delete wh;
+    FLAGS_make_snapshot_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, DISABLED_MakeSnapshotThreadPerf) {
+    uint32_t old_thread_num = FLAGS_make_snapshot_thread_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/8_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/8_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    uint32_t entry_cnt = 200000;
+    WriteKVBinlog(wh, &offset, entry_cnt, 10000, std::string(100, 'v'));
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 8, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    for (uint32_t thread_num : {1, 4, 16}) {
+        ::openmldb::base::RemoveDir(snapshot_path);
+        MemTableSnapshot snapshot(8, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        FLAGS_make_snapshot_thread_num = thread_num;
+        uint64_t offset_value = 0;
+        uint64_t start_time = ::baidu::common::timer::get_micros();
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+        uint64_t consumed = ::baidu::common::timer::get_micros() - start_time;
+        ASSERT_EQ(offset, offset_value);
+        ::openmldb::api::Manifest manifest;
+        ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+        ASSERT_EQ(entry_cnt, manifest.count());
+        std::cout << "make snapshot of " << entry_cnt << " entries with " << thread_num
+                  << " threads, compression " << FLAGS_snapshot_compression << ", use time in us: " << consumed
+                  << std::endl;
+    }
+    delete wh;
+    FLAGS_make_snapshot_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+std::shared_ptr<MemTable> RecoverSnapshot(LogParts* log_part, uint32_t tid, uint64_t* consumed) {
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", tid, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(tid, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    uint64_t latest_offset = 0;
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    snapshot.Recover(table, latest_offset);
+    *consumed = ::baidu::common::timer::get_micros() - start_time;
+    return table;
+}
+
+TEST_F(SnapshotTest, Recover_flat_snapshot) {
+    uint32_t old_thread_num = FLAGS_make_snapshot_thread_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/9_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/9_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    WriteKVBinlog(wh, &offset, 20000, 100, "value");
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 9, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(9, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    FLAGS_make_snapshot_thread_num = 2;
+    FLAGS_make_flat_snapshot = true;
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(2, manifest.parts_size());
+    for (const auto& name : manifest.parts()) {
+        ASSERT_TRUE(::openmldb::base::IsExists(snapshot_path + name + FLAT_SNAPSHOT_SUFFIX));
+    }
+    uint64_t consumed = 0;
+    auto flat_table = RecoverSnapshot(log_part, 9, &consumed);
+    ASSERT_EQ(20000u, flat_table->GetRecordCnt());
+    // a flat copy of crc mismatch is skipped, the snapshot file is loaded instead
+    {
+        std::string flat_path = snapshot_path + manifest.parts(0) + FLAT_SNAPSHOT_SUFFIX;
+        FILE* fd = fopen(flat_path.c_str(), "r+b");
+        ASSERT_TRUE(fd != NULL);
+        ASSERT_EQ(0, fseek(fd, 0, SEEK_END));
+        long size = ftell(fd);  // NOLINT
+        ASSERT_EQ(0, fseek(fd, size - 1, SEEK_SET));
+        ASSERT_EQ(1u, fwrite("x", 1, 1, fd));
+        fclose(fd);
+    }
+    auto fallback_table = RecoverSnapshot(log_part, 9, &consumed);
+    ASSERT_EQ(20000u, fallback_table->GetRecordCnt());
+    // load the snapshot files without the flat copies
+    for (const auto& name : manifest.parts()) {
+        ASSERT_EQ(0, unlink((snapshot_path + name + FLAT_SNAPSHOT_SUFFIX).c_str()));
+    }
+    auto log_table = RecoverSnapshot(log_part, 9, &consumed);
+    ASSERT_EQ(20000u, log_table->GetRecordCnt());
+    for (uint32_t i = 0; i < 100; i++) {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_EQ(ScanKey(log_table, 0, key), ScanKey(flat_table, 0, key));
+    }
+
+    // the flat copies of the old snapshot are removed with it
+    ASSERT_GT(FlatSnapshotWriter::Convert(snapshot_path + manifest.parts(0),
+                                          MemTableSnapshot::IsCompressed(manifest.parts(0)),
+                                          snapshot_path + manifest.parts(0) + FLAT_SNAPSHOT_SUFFIX),
+              0);
+    WriteKVBinlog(wh, &offset, 1000, 100, "value");
+    FLAGS_make_snapshot_thread_num = 1;
+    FLAGS_make_flat_snapshot = false;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    std::vector<std::string> files;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+    ASSERT_EQ(2u, files.size());
+    delete wh;
+    FLAGS_make_snapshot_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, DISABLED_Recover_flat_snapshot_perf) {
+    uint32_t old_thread_num = FLAGS_make_snapshot_thread_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/10_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/10_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    uint32_t entry_cnt = 500000;
+    WriteKVBinlog(wh, &offset, entry_cnt, 100000, std::string(100, 'v'));
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 10, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(10, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    FLAGS_make_snapshot_thread_num = 1;
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    uint64_t consumed = 0;
+    auto log_table = RecoverSnapshot(log_part, 10, &consumed);
+    ASSERT_EQ(entry_cnt, log_table->GetRecordCnt());
+    std::cout << "load snapshot of " << entry_cnt << " entries, compression " << FLAGS_snapshot_compression
+              << ", use time in us: " << consumed << std::endl;
+    std::string path = snapshot_path + manifest.name();
+    ASSERT_EQ(static_cast<int64_t>(entry_cnt),
+              FlatSnapshotWriter::Convert(path, MemTableSnapshot::IsCompressed(path), path + FLAT_SNAPSHOT_SUFFIX));
+    auto flat_table = RecoverSnapshot(log_part, 10, &consumed);
+    ASSERT_EQ(entry_cnt, flat_table->GetRecordCnt());
+    std::cout << "load flat snapshot of " << entry_cnt << " entries, use time in us: " << consumed << std::endl;
+    delete wh;
+    FLAGS_make_snapshot_thread_num = old_thread_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, MakeSnapshotDelta) {
+    uint32_t old_thread_num = FLAGS_make_snapshot_thread_num;
+    uint32_t old_delta_num = FLAGS_snapshot_max_delta_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/11_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/11_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    WriteKVBinlog(wh, &offset, 10000, 100, "value");
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 11, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    MemTableSnapshot snapshot(11, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    FLAGS_make_snapshot_thread_num = 2;
+    FLAGS_snapshot_max_delta_num = 2;
+    uint64_t offset_value = 0;
+    // the first snapshot is a full one
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(2, manifest.parts_size());
+    ASSERT_EQ(0, manifest.deltas_size());
+    std::vector<std::string> base_parts(manifest.parts().begin(), manifest.parts().end());
+
+    // the binlog after it is written to deltas, the base files are kept
+    for (int i = 1; i <= 2; i++) {
+        WriteKVBinlog(wh, &offset, 1000, 100, "value");
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+        ASSERT_EQ(offset, offset_value);
+        manifest.Clear();
+        ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+        ASSERT_EQ(10000u + i * 1000u, manifest.count());
+        ASSERT_EQ(offset, manifest.offset());
+        ASSERT_EQ(base_parts, std::vector<std::string>(manifest.parts().begin(), manifest.parts().end()));
+        ASSERT_EQ(i, manifest.deltas_size());
+        std::vector<std::string> files;
+        ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+        ASSERT_EQ(3u + i, files.size());
+        if (i == 1) {
+            // nothing is written if there is no binlog after the last delta
+            ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+            ASSERT_EQ(offset, offset_value);
+            manifest.Clear();
+            ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+            ASSERT_EQ(1, manifest.deltas_size());
+        }
+    }
+    {
+        uint64_t consumed = 0;
+        auto recovered = RecoverSnapshot(log_part, 11, &consumed);
+        ASSERT_EQ(12000u, recovered->GetRecordCnt());
+    }
+
+    // the deltas are merged once there are snapshot_max_delta_num of them
+    WriteKVBinlog(wh, &offset, 1000, 100, "value");
+    FLAGS_make_snapshot_thread_num = 1;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(13000u, manifest.count());
+    ASSERT_EQ(0, manifest.parts_size());
+    ASSERT_EQ(0, manifest.deltas_size());
+    std::vector<std::string> files;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+    ASSERT_EQ(2u, files.size());
+
+    // a delete in the binlog makes a full snapshot as the key has to be removed from the base
+    WriteKVBinlog(wh, &offset, 1000, 100, "value");
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    ASSERT_EQ(1, manifest.deltas_size());
+    offset++;
+    ::openmldb::api::LogEntry delete_entry;
+    delete_entry.set_log_index(offset);
+    delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    ::openmldb::api::Dimension* dimension = delete_entry.add_dimensions();
+    dimension->set_key("key0");
+    dimension->set_idx(0);
+    std::string buffer;
+    delete_entry.SerializeToString(&buffer);
+    ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    wh->Sync();
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ASSERT_EQ(offset, offset_value);
+    manifest.Clear();
+    ASSERT_EQ(0, GetManifest(snapshot_path + "MANIFEST", &manifest));
+    // key0 has 140 rows in the base and the delta
+    ASSERT_EQ(14000u - 140u, manifest.count());
+    ASSERT_EQ(0, manifest.deltas_size());
+    files.clear();
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_path, files));
+    ASSERT_EQ(2u, files.size());
+    delete wh;
+    FLAGS_make_snapshot_thread_num = old_thread_num;
+    FLAGS_snapshot_max_delta_num = old_delta_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
+// the bytes of the snapshot files written by the last MakeSnapshot
+uint64_t GetWrittenSize(const std::string& snapshot_path) {
+    ::openmldb::api::Manifest manifest;
+    if (GetManifest(snapshot_path + "MANIFEST", &manifest) != 0) {
+        return 0;
+    }
+    std::vector<std::string> files;
+    if (manifest.deltas_size() > 0) {
+        files.push_back(manifest.deltas(manifest.deltas_size() - 1));
+    } else {
+        files = Snapshot::GetSnapshotFiles(manifest);
+    }
+    uint64_t total = 0;
+    for (const auto& name : files) {
+        uint64_t size = 0;
+        ::openmldb::base::GetFileSize(snapshot_path + name, size);
+        total += size;
+    }
+    return total;
+}
+
+TEST_F(SnapshotTest, MakeSnapshotDeltaWriteSize) {
+    uint32_t old_delta_num = FLAGS_snapshot_max_delta_num;
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    std::string log_path = FLAGS_db_root_path + "/12_0/binlog/";
+    std::string snapshot_path = FLAGS_db_root_path + "/12_0/snapshot/";
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, log_path, binlog_index, offset);
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto table = std::make_shared<MemTable>("test", 12, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    // a steady ingest on a large table, a snapshot is made after each round
+    WriteKVBinlog(wh, &offset, 100000, 10000, std::string(100, 'v'));
+    uint32_t rounds = 8;
+    for (uint32_t round = 0; round < rounds; round++) {
+        WriteKVBinlog(wh, &offset, 5000, 10000, std::string(100, 'v'));
+    }
+    std::map<uint32_t, uint64_t> written_size;
+    for (uint32_t delta_num : {0, 4}) {
+        ::openmldb::base::RemoveDir(snapshot_path);
+        MemTableSnapshot snapshot(12, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        FLAGS_snapshot_max_delta_num = delta_num;
+        uint64_t offset_value = 0;
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 100000));
+        for (uint32_t round = 1; round <= rounds; round++) {
+            ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 100000 + round * 5000));
+            written_size[delta_num] += GetWrittenSize(snapshot_path);
+        }
+        ASSERT_EQ(offset, offset_value);
+        uint64_t consumed = 0;
+        auto recovered = RecoverSnapshot(log_part, 12, &consumed);
+        ASSERT_EQ(offset, recovered->GetRecordCnt());
+    }
+    // the delta snapshots write less than the full ones of the same rounds
+    ASSERT_GT(written_size[4], 0u);
+    ASSERT_LT(written_size[4], written_size[0]);
+    delete wh;
+    FLAGS_snapshot_max_delta_num = old_delta_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
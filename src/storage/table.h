@@ -38,6 +38,13 @@ using Schema = google::protobuf::RepeatedPtrField<openmldb::common::ColumnDesc>;
 
 enum TableStat { kUndefined = 0, kNormal, kLoading, kMakingSnapshot, kSnapshotPaused };
 
+// a row of batch put, the value and the dimensions are owned by the caller
+struct BatchPutRow {
+    uint64_t time;
+    ::openmldb::base::Slice value;
+    const Dimensions* dimensions;
+};
+
 class Table {
  public:
     Table();
@@ -53,6 +60,21 @@ class Table {
 
     virtual bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) = 0;
 
+    // put the row held by the caller, the table which stores the row in its own memory may skip a copy
+    virtual bool Put(uint64_t time, const char* value, uint32_t size, const Dimensions& dimensions) {
+        return Put(time, std::string(value, size), dimensions);
+    }
+
+    // put the rows of a batch, this one puts them one by one and stops at the first failure
+    virtual bool PutBatch(const std::vector<BatchPutRow>& rows) {
+        for (const auto& row : rows) {
+            if (!Put(row.time, row.value.data(), row.value.size(), *row.dimensions)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     bool Put(const ::openmldb::api::LogEntry& entry) {
         return Put(entry.ts(), entry.value(), entry.dimensions());
     }
@@ -106,6 +128,14 @@ class Table {
 
     inline void SetDiskused(uint64_t size) { diskused_.store(size, std::memory_order_relaxed); }
 
+    // the progress of the binlog recovery, the offset and the count of the entries replayed
+    inline void SetRecoverProgress(uint64_t offset, uint64_t cnt) {
+        recover_offset_.store(offset, std::memory_order_relaxed);
+        recover_cnt_.store(cnt, std::memory_order_relaxed);
+    }
+    inline uint64_t GetRecoverOffset() const { return recover_offset_.load(std::memory_order_relaxed); }
+    inline uint64_t GetRecoverCnt() const { return recover_cnt_.load(std::memory_order_relaxed); }
+
     inline const ::openmldb::type::CompressType GetCompressType() { return compress_type_; }
 
     void AddVersionSchema(const ::openmldb::api::TableMeta& table_meta);
@@ -190,6 +220,8 @@ class Table {
     bool is_leader_;
     uint64_t ttl_offset_;
     std::atomic<uint32_t> table_status_;
+    std::atomic<uint64_t> recover_offset_{0};
+    std::atomic<uint64_t> recover_cnt_{0};
     TableIndex table_index_;
     ::openmldb::type::CompressType compress_type_;
     std::shared_ptr<::openmldb::api::TableMeta> table_meta_;
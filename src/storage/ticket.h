@@ -17,27 +17,19 @@
 #ifndef SRC_STORAGE_TICKET_H_
 #define SRC_STORAGE_TICKET_H_
 
-#include <vector>
-
 #include "storage/segment.h"
 
 namespace openmldb {
 namespace storage {
 
-class KeyEntry;
-
+// Ticket used to pin the key entries read by iterators. Iterators pin the epoch of
+// segment by themselves now, it's kept for the interface of Table
 class Ticket {
  public:
-    Ticket();
-    ~Ticket();
+    Ticket() {}
+    ~Ticket() {}
     Ticket(const Ticket&) = delete;
     Ticket& operator=(const Ticket& s) = delete;
-
-    void Push(KeyEntry* entry);
-    void Pop();
-
- private:
-    std::vector<KeyEntry*> entries_;
 };
 
 }  // namespace storage
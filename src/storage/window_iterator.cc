@@ -16,6 +16,9 @@
 
 #include "storage/window_iterator.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <string>
 #include "base/hash.h"
 
@@ -45,7 +48,16 @@ const uint64_t& MemTableWindowIterator::GetKey() const {
 }
 
 const ::hybridse::codec::Row& MemTableWindowIterator::GetValue() {
-    row_.Reset(reinterpret_cast<const int8_t*>(it_->GetValue()->data), it_->GetValue()->size);
+    Slice value = it_->GetValue();
+    if (it_->IsFrozen()) {
+        // the rows are held by the callers after the iterator moves on, while the decoded
+        // frozen block is released once the iterator leaves it. So the frozen row is copied
+        int8_t* copyed_row_data = reinterpret_cast<int8_t*>(malloc(value.size()));
+        memcpy(copyed_row_data, value.data(), value.size());
+        row_.Reset(::hybridse::base::RefCountedSlice::CreateManaged(copyed_row_data, value.size()));
+        return row_;
+    }
+    row_.Reset(reinterpret_cast<const int8_t*>(value.data()), value.size());
     return row_;
 }
 
@@ -75,7 +87,7 @@ MemTableKeyIterator::MemTableKeyIterator(Segment** segments, uint32_t seg_cnt, :
       ttl_type_(ttl_type),
       expire_time_(expire_time),
       expire_cnt_(expire_cnt),
-      ticket_(),
+      guard_(segments[0]->GetEpochManager()),
       ts_idx_(0) {
     uint32_t idx = 0;
     if (segments_[0]->GetTsIdx(ts_index, idx) == 0) {
@@ -88,7 +100,6 @@ MemTableKeyIterator::~MemTableKeyIterator() {
 }
 
 void MemTableKeyIterator::SeekToFirst() {
-    ticket_.Pop();
     if (pk_it_ != nullptr) {
         delete pk_it_;
         pk_it_ = nullptr;
@@ -107,7 +118,6 @@ void MemTableKeyIterator::Seek(const std::string& key) {
         delete pk_it_;
         pk_it_ = nullptr;
     }
-    ticket_.Pop();
     if (seg_cnt_ > 1) {
         seg_idx_ = ::openmldb::base::hash(key.c_str(), key.length(), SEED) % seg_cnt_;
     }
@@ -128,18 +138,17 @@ void MemTableKeyIterator::Next() {
 }
 
 ::hybridse::vm::RowIterator* MemTableKeyIterator::GetRawValue() {
-    TimeEntries::Iterator* it = nullptr;
+    TimeEntryIterator* it = nullptr;
     if (segments_[seg_idx_]->GetTsCnt() > 1) {
         KeyEntry* entry = ((KeyEntry**)pk_it_->GetValue())[ts_idx_];  // NOLINT
-        it = entry->entries.NewIterator();
-        ticket_.Push(entry);
+        it = entry->NewIterator();
     } else {
         it = ((KeyEntry*)pk_it_->GetValue())  // NOLINT
-                 ->entries.NewIterator();
-        ticket_.Push((KeyEntry*)pk_it_->GetValue());  // NOLINT
+                 ->NewIterator();
     }
     it->SeekToFirst();
-    return new MemTableWindowIterator(it, ttl_type_, expire_time_, expire_cnt_);
+    return new MemTableWindowIterator(it, segments_[seg_idx_]->GetEpochManager(), ttl_type_, expire_time_,
+                                      expire_cnt_);
 }
 
 std::unique_ptr<::hybridse::vm::RowIterator> MemTableKeyIterator::GetValue() {
@@ -153,7 +162,6 @@ const hybridse::codec::Row MemTableKeyIterator::GetKey() {
 
 void MemTableKeyIterator::NextPK() {
     do {
-        ticket_.Pop();
         if (pk_it_->Valid()) {
             pk_it_->Next();
         }
@@ -18,17 +18,20 @@
 
 #include <memory>
 #include <string>
+
+#include "base/epoch.h"
 #include "storage/segment.h"
 #include "vm/catalog.h"
 
 namespace openmldb {
 namespace storage {
 
+// MemTableWindowIterator pins the epoch by itself as it may outlive the key iterator creating it
 class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
  public:
-    MemTableWindowIterator(TimeEntries::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
-                           uint64_t expire_cnt)
-        : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+    MemTableWindowIterator(TimeEntryIterator* it, ::openmldb::base::EpochManager* epoch,
+                           ::openmldb::storage::TTLType ttl_type, uint64_t expire_time, uint64_t expire_cnt)
+        : guard_(epoch), it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
 
     ~MemTableWindowIterator();
 
@@ -47,7 +50,8 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
     bool IsSeekable() const override { return true; }
 
  private:
-    TimeEntries::Iterator* it_;
+    ::openmldb::base::EpochGuard guard_;
+    TimeEntryIterator* it_;
     uint32_t record_idx_;
     TTLSt expire_value_;
     ::hybridse::codec::Row row_;
@@ -81,11 +85,11 @@ class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
     uint32_t const seg_cnt_;
     uint32_t seg_idx_;
     KeyEntries::Iterator* pk_it_;
-    TimeEntries::Iterator* it_;
+    TimeEntryIterator* it_;
     ::openmldb::storage::TTLType ttl_type_;
     uint64_t expire_time_;
     uint64_t expire_cnt_;
-    Ticket ticket_;
+    ::openmldb::base::EpochGuard guard_;
     uint32_t ts_idx_;
 };
 
@@ -16,24 +16,55 @@
 
 #include "tablet/file_receiver.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "base/file_util.h"
 #include "base/glog_wrapper.h"
 #include "base/strings.h"
+#include "bvar/bvar.h"
 
 namespace openmldb {
 namespace tablet {
 
+// the bytes of snapshot and index files received by the tablet, exposed in /vars
+static bvar::Adder<uint64_t> g_file_receive_bytes("file_receive_bytes");
+static bvar::PerSecond<bvar::Adder<uint64_t>> g_file_receive_bytes_second("file_receive_bytes_second",
+                                                                           &g_file_receive_bytes);
+
 FileReceiver::FileReceiver(const std::string& file_name, const std::string& dir_name, const std::string& path)
-    : file_name_(file_name), dir_name_(dir_name), path_(path), size_(0), block_id_(0), file_(NULL) {}
+    : file_name_(file_name),
+      dir_name_(dir_name),
+      path_(path),
+      block_id_(0),
+      fd_(-1),
+      has_file_size_(false),
+      file_size_(0),
+      received_size_(0),
+      completed_(false) {}
 
 FileReceiver::~FileReceiver() {
-    if (file_) fclose(file_);
+    if (fd_ >= 0) close(fd_);
 }
 
 bool FileReceiver::Init() {
-    if (file_) {
-        fclose(file_);
-        file_ = NULL;
+    has_file_size_ = false;
+    file_size_ = 0;
+    return Open(0);
+}
+
+bool FileReceiver::Init(uint64_t file_size, uint64_t resume_offset) {
+    has_file_size_ = true;
+    file_size_ = file_size;
+    return Open(resume_offset);
+}
+
+bool FileReceiver::Open(uint64_t resume_offset) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
     }
     if (path_.back() != '/') {
         path_.append("/");
@@ -43,43 +74,106 @@ bool FileReceiver::Init() {
         return false;
     }
     std::string full_path = path_ + file_name_ + ".tmp";
-    FILE* file = fopen(full_path.c_str(), "wb");
-    if (file == NULL) {
+    int fd = open(full_path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
         PDLOG(WARNING, "fail to open file %s", full_path.c_str());
         return false;
     }
-    file_ = file;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        PDLOG(WARNING, "fail to stat file %s", full_path.c_str());
+        close(fd);
+        return false;
+    }
+    uint64_t existing_size = st.st_size;
+    // the bytes after the offset may have holes of the blocks not received, so they are written again
+    if (resume_offset == 0 || resume_offset > file_size_ || existing_size < resume_offset) {
+        if (resume_offset > 0) {
+            PDLOG(WARNING, "file %s has %lu bytes, less than %lu bytes acked. it is received again",
+                  full_path.c_str(), existing_size, resume_offset);
+        }
+        resume_offset = 0;
+        if (ftruncate(fd, 0) != 0) {
+            PDLOG(WARNING, "fail to truncate file %s", full_path.c_str());
+            close(fd);
+            return false;
+        }
+    } else {
+        PDLOG(INFO, "file %s is resumed at %lu", full_path.c_str(), resume_offset);
+    }
+    fd_ = fd;
     block_id_ = 0;
+    received_size_ = resume_offset;
+    pending_blocks_.clear();
+    completed_ = has_file_size_ && received_size_ == file_size_;
     return true;
 }
 
 uint64_t FileReceiver::GetBlockId() { return block_id_; }
 
+uint64_t FileReceiver::GetReceivedSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return received_size_;
+}
+
 int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
-    if (file_ == NULL) {
-        PDLOG(WARNING, "file is NULL");
+    if (fd_ < 0) {
+        PDLOG(WARNING, "file is not opened");
         return -1;
     }
     if (block_id <= block_id_) {
         DEBUGLOG("block id %lu has been received", block_id);
         return 0;
     }
-
-#ifdef __APPLE__
-    size_t r = fwrite(data.c_str(), 1, data.size(), file_);
-#else
-    // linux
-    size_t r = fwrite_unlocked(data.c_str(), 1, data.size(), file_);
-#endif
-    if (r < data.size()) {
+    ssize_t r = pwrite(fd_, data.c_str(), data.size(), received_size_);
+    if (r < 0 || static_cast<size_t>(r) < data.size()) {
         PDLOG(WARNING, "write error. name %s%s", path_.c_str(), file_name_.c_str());
         return -1;
     }
-    size_ += r;
+    g_file_receive_bytes << r;
+    received_size_ += r;
     block_id_ = block_id;
     return 0;
 }
 
+int FileReceiver::WriteBlock(const std::string& data, uint64_t offset) {
+    if (fd_ < 0 || !has_file_size_ || offset + data.size() > file_size_) {
+        PDLOG(WARNING, "invalid block of %lu bytes at offset %lu. name %s%s", data.size(), offset, path_.c_str(),
+              file_name_.c_str());
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (completed_ || offset < received_size_ || pending_blocks_.count(offset) > 0) {
+            DEBUGLOG("block at offset %lu has been received", offset);
+            return 0;
+        }
+    }
+    // the blocks are written outside the lock, a block sent twice at the same time is written twice
+    ssize_t r = pwrite(fd_, data.c_str(), data.size(), offset);
+    if (r < 0 || static_cast<size_t>(r) < data.size()) {
+        PDLOG(WARNING, "write error. name %s%s", path_.c_str(), file_name_.c_str());
+        return -1;
+    }
+    g_file_receive_bytes << r;
+    std::lock_guard<std::mutex> lock(mu_);
+    if (offset == received_size_) {
+        received_size_ += data.size();
+        auto it = pending_blocks_.begin();
+        while (it != pending_blocks_.end() && it->first == received_size_) {
+            received_size_ += it->second;
+            it = pending_blocks_.erase(it);
+        }
+    } else if (offset > received_size_) {
+        pending_blocks_.emplace(offset, data.size());
+    }
+    if (!completed_ && received_size_ == file_size_) {
+        completed_ = true;
+        return 1;
+    }
+    return 0;
+}
+
 void FileReceiver::SaveFile() {
     std::string full_path = path_ + file_name_;
     std::string tmp_file_path = full_path + ".tmp";
@@ -88,7 +182,7 @@ void FileReceiver::SaveFile() {
         rename(full_path.c_str(), backup_file.c_str());
     }
     rename(tmp_file_path.c_str(), full_path.c_str());
-    PDLOG(INFO, "file %s received. size %lu", full_path.c_str(), size_);
+    PDLOG(INFO, "file %s received. size %lu", full_path.c_str(), GetReceivedSize());
 }
 
 }  // namespace tablet
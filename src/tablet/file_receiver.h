@@ -16,11 +16,17 @@
 
 #pragma once
 
+#include <map>
+#include <mutex>  // NOLINT
 #include <string>
 
 namespace openmldb {
 namespace tablet {
 
+// FileReceiver writes a file sent by FileSender to a tmp file and renames it in SaveFile.
+// The blocks are written in order of block id by WriteData, or at their offsets by
+// WriteBlock which may be called by several threads at the same time once the size of
+// the file is given in Init.
 class FileReceiver {
  public:
     FileReceiver(const std::string& file_name, const std::string& dir_name, const std::string& path);
@@ -28,17 +34,35 @@ class FileReceiver {
     FileReceiver(const FileReceiver&) = delete;
     FileReceiver& operator=(const FileReceiver&) = delete;
     bool Init();
+    // the bytes before resume_offset are kept if the tmp file left by the last receiver has them, it's
+    // truncated otherwise
+    bool Init(uint64_t file_size, uint64_t resume_offset = 0);
     int WriteData(const std::string& data, uint64_t block_id);
+    // return 1 if the block is the last one to complete the file, 0 if it is written or received before
+    // and -1 on error
+    int WriteBlock(const std::string& data, uint64_t offset);
     void SaveFile();
     uint64_t GetBlockId();
+    // the bytes from the start of the file that have been written
+    uint64_t GetReceivedSize();
+    bool HasFileSize() const { return has_file_size_; }
+    uint64_t GetFileSize() const { return file_size_; }
 
  private:
+    bool Open(uint64_t resume_offset);
+
     std::string file_name_;
     std::string dir_name_;
     std::string path_;
-    uint64_t size_;
     uint64_t block_id_;
-    FILE* file_;
+    int fd_;
+    bool has_file_size_;
+    uint64_t file_size_;
+    std::mutex mu_;
+    uint64_t received_size_;
+    // the blocks written after a missing one, offset -> size
+    std::map<uint64_t, uint64_t> pending_blocks_;
+    bool completed_;
 };
 
 }  // namespace tablet
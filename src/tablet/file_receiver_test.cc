@@ -0,0 +1,156 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tablet/file_receiver.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "base/file_util.h"
+#include "gtest/gtest.h"
+#include "test/util.h"
+
+namespace openmldb {
+namespace tablet {
+
+class FileReceiverTest : public ::testing::Test {
+ public:
+    FileReceiverTest() {}
+    ~FileReceiverTest() {}
+};
+
+std::string GenContent(uint64_t size) {
+    std::string content;
+    content.reserve(size);
+    for (uint64_t i = 0; i < size; i++) {
+        content.push_back('a' + i % 26);
+    }
+    return content;
+}
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+TEST_F(FileReceiverTest, WriteBlockOutOfOrder) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.GetTempPath("receiver") + "/";
+    std::string content = GenContent(10000);
+    FileReceiver receiver("data.sdb", "", path);
+    ASSERT_TRUE(receiver.Init(content.size()));
+    // the last block first, received_size stays until the first block is written
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(8192), 8192));
+    ASSERT_EQ(0u, receiver.GetReceivedSize());
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(0, 4096), 0));
+    ASSERT_EQ(4096u, receiver.GetReceivedSize());
+    // the missing block completes the file with the pending one after it
+    ASSERT_EQ(1, receiver.WriteBlock(content.substr(4096, 4096), 4096));
+    ASSERT_EQ(content.size(), receiver.GetReceivedSize());
+    receiver.SaveFile();
+    ASSERT_FALSE(::openmldb::base::IsExists(path + "data.sdb.tmp"));
+    ASSERT_EQ(content, ReadFile(path + "data.sdb"));
+}
+
+TEST_F(FileReceiverTest, WriteBlockDuplicate) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.GetTempPath("receiver") + "/";
+    std::string content = GenContent(12288);
+    FileReceiver receiver("data.sdb", "", path);
+    ASSERT_TRUE(receiver.Init(content.size()));
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(0, 4096), 0));
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(8192), 8192));
+    // a block received before is skipped, whether it is written in order or pending
+    ASSERT_EQ(0, receiver.WriteBlock(std::string(4096, 'x'), 0));
+    ASSERT_EQ(0, receiver.WriteBlock(std::string(4096, 'x'), 8192));
+    ASSERT_EQ(4096u, receiver.GetReceivedSize());
+    ASSERT_EQ(1, receiver.WriteBlock(content.substr(4096, 4096), 4096));
+    // the file is completed only once
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(4096, 4096), 4096));
+    ASSERT_EQ(content.size(), receiver.GetReceivedSize());
+    receiver.SaveFile();
+    ASSERT_EQ(content, ReadFile(path + "data.sdb"));
+}
+
+TEST_F(FileReceiverTest, WriteBlockExactMultiple) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.GetTempPath("receiver") + "/";
+    uint64_t block_size = 4096;
+    std::string content = GenContent(block_size * 4);
+    FileReceiver receiver("data.sdb", "", path);
+    ASSERT_TRUE(receiver.Init(content.size()));
+    for (uint64_t offset = 0; offset < content.size(); offset += block_size) {
+        int expect = offset + block_size == content.size() ? 1 : 0;
+        ASSERT_EQ(expect, receiver.WriteBlock(content.substr(offset, block_size), offset));
+    }
+    ASSERT_EQ(content.size(), receiver.GetReceivedSize());
+    // a block beyond the file size is rejected
+    ASSERT_EQ(-1, receiver.WriteBlock(content.substr(0, block_size), content.size()));
+    ASSERT_EQ(-1, receiver.WriteBlock(content.substr(0, block_size), content.size() - 1));
+    receiver.SaveFile();
+    ASSERT_EQ(content, ReadFile(path + "data.sdb"));
+}
+
+TEST_F(FileReceiverTest, ResumeAfterRestart) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.GetTempPath("receiver") + "/";
+    std::string content = GenContent(12288);
+    {
+        FileReceiver receiver("data.sdb", "", path);
+        ASSERT_TRUE(receiver.Init(content.size()));
+        ASSERT_EQ(0, receiver.WriteBlock(content.substr(0, 4096), 0));
+        ASSERT_EQ(0, receiver.WriteBlock(content.substr(8192), 8192));
+        ASSERT_EQ(4096u, receiver.GetReceivedSize());
+    }
+    {
+        // the tmp file has fewer bytes than acked, it is received again
+        FileReceiver receiver("data.sdb", "", path);
+        ASSERT_TRUE(receiver.Init(content.size(), content.size() + 1));
+        ASSERT_EQ(0u, receiver.GetReceivedSize());
+        ASSERT_EQ(0, receiver.WriteBlock(content.substr(0, 4096), 0));
+    }
+    // the bytes acked are kept by the new receiver, the ones after them are written again
+    FileReceiver receiver("data.sdb", "", path);
+    ASSERT_TRUE(receiver.Init(content.size(), 4096));
+    ASSERT_EQ(4096u, receiver.GetReceivedSize());
+    ASSERT_EQ(0, receiver.WriteBlock(content.substr(4096, 4096), 4096));
+    ASSERT_EQ(1, receiver.WriteBlock(content.substr(8192), 8192));
+    receiver.SaveFile();
+    ASSERT_EQ(content, ReadFile(path + "data.sdb"));
+}
+
+TEST_F(FileReceiverTest, WriteBlockWithoutFileSize) {
+    ::openmldb::test::TempPath tmp_path;
+    std::string path = tmp_path.GetTempPath("receiver") + "/";
+    FileReceiver receiver("data.sdb", "", path);
+    ASSERT_TRUE(receiver.Init());
+    ASSERT_EQ(-1, receiver.WriteBlock("data", 0));
+    // a receiver of the old protocol writes the blocks in the order of block id
+    ASSERT_EQ(0, receiver.WriteData("data", 1));
+    ASSERT_EQ(0, receiver.WriteData("data", 1));
+    ASSERT_EQ(4u, receiver.GetReceivedSize());
+}
+
+}  // namespace tablet
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
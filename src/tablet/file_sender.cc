@@ -16,18 +16,24 @@
 
 #include "tablet/file_sender.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "base/file_util.h"
 #include "base/glog_wrapper.h"
 #include "boost/algorithm/string/predicate.hpp"
+#include "bvar/bvar.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
+#include "log/crc32c.h"
 
 DECLARE_int32(send_file_max_try);
-DECLARE_uint32(stream_block_size);
-DECLARE_int32(stream_bandwidth_limit);
+DECLARE_uint32(send_file_stream_num);
 DECLARE_uint32(stream_block_size);
 DECLARE_int32(stream_bandwidth_limit);
 DECLARE_int32(stream_close_wait_time_ms);
@@ -38,6 +44,12 @@ DECLARE_int32(request_timeout_ms);
 namespace openmldb {
 namespace tablet {
 
+// the bytes of snapshot and index files sent by the tablet, exposed in /vars
+static bvar::Adder<uint64_t> g_file_send_bytes("file_send_bytes");
+static bvar::PerSecond<bvar::Adder<uint64_t>> g_file_send_bytes_second("file_send_bytes_second",
+                                                                        &g_file_send_bytes);
+static bvar::Adder<uint64_t> g_file_send_wait_us("file_send_bandwidth_wait_us");
+
 FileSender::FileSender(uint32_t tid, uint32_t pid, common::StorageMode storage_mode, const std::string& endpoint)
     : tid_(tid),
       pid_(pid),
@@ -45,7 +57,7 @@ FileSender::FileSender(uint32_t tid, uint32_t pid, common::StorageMode storage_m
       endpoint_(endpoint),
       cur_try_time_(0),
       max_try_time_(FLAGS_send_file_max_try),
-      limit_time_(0),
+      acked_size_(0),
       channel_(NULL),
       stub_(NULL) {}
 
@@ -54,13 +66,14 @@ FileSender::~FileSender() {
     delete stub_;
 }
 
+::openmldb::base::TokenBucket* FileSender::GetBandwidthLimiter() {
+    static ::openmldb::base::TokenBucket limiter(0, FLAGS_stream_block_size);
+    // the flags may be changed at runtime, the bucket follows them
+    limiter.Reset(FLAGS_stream_bandwidth_limit > 0 ? FLAGS_stream_bandwidth_limit : 0, FLAGS_stream_block_size);
+    return &limiter;
+}
+
 bool FileSender::Init() {
-    // compute the used time(microseconds) that send a block by limit bandwidth.
-    // limit_time = (FLAGS_stream_block_size / FLAGS_stream_bandwidth_limit) *
-    // 1000 * 1000
-    if (FLAGS_stream_bandwidth_limit > 0) {
-        limit_time_ = (FLAGS_stream_block_size * 1000000) / FLAGS_stream_bandwidth_limit;
-    }
     channel_ = new brpc::Channel();
     brpc::ChannelOptions options;
     options.timeout_ms = FLAGS_request_timeout_ms;
@@ -74,12 +87,48 @@ bool FileSender::Init() {
     return true;
 }
 
+int FileSender::InitReceiver(const std::string& file_name, const std::string& dir_name, uint64_t file_size,
+                             bool resume, uint64_t* received_size) {
+    ::openmldb::api::SendDataRequest request;
+    request.set_tid(tid_);
+    request.set_pid(pid_);
+    request.set_storage_mode(storage_mode_);
+    request.set_file_name(file_name);
+    if (!dir_name.empty()) {
+        request.set_dir_name(dir_name);
+    }
+    request.set_block_id(0);
+    request.set_block_size(0);
+    request.set_file_size(file_size);
+    request.set_resume(resume);
+    if (resume) {
+        // the receiver which lost the last try checks its tmp file against the bytes it has acked
+        request.set_offset(acked_size_.load(std::memory_order_relaxed));
+    }
+    brpc::Controller cntl;
+    ::openmldb::api::SendDataResponse response;
+    stub_->SendData(&cntl, &request, &response, NULL);
+    if (cntl.Failed()) {
+        PDLOG(WARNING, "init file receiver failed. tid %u pid %u file %s error msg %s", tid_, pid_,
+              file_name.c_str(), cntl.ErrorText().c_str());
+        return -1;
+    } else if (response.code() != 0) {
+        PDLOG(WARNING, "init file receiver failed. tid %u pid %u file %s error msg %s", tid_, pid_,
+              file_name.c_str(), response.msg().c_str());
+        return -1;
+    }
+    // a receiver which does not know resume starts from the beginning
+    *received_size = std::min(response.received_size(), file_size);
+    acked_size_.store(*received_size, std::memory_order_relaxed);
+    return 0;
+}
+
 int FileSender::WriteData(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
-                          uint64_t block_id) {
+                          uint64_t block_id, uint64_t offset, uint64_t file_size) {
     if (buffer == NULL) {
         return -1;
     }
-    uint64_t cur_time = ::baidu::common::timer::get_micros();
+    g_file_send_wait_us << GetBandwidthLimiter()->Acquire(len);
     ::openmldb::api::SendDataRequest request;
     request.set_tid(tid_);
     request.set_pid(pid_);
@@ -90,14 +139,14 @@ int FileSender::WriteData(const std::string& file_name, const std::string& dir_n
     }
     request.set_block_id(block_id);
     request.set_block_size(len);
-    brpc::Controller cntl;
-    if (block_id > 0) {
-        cntl.request_attachment().append(buffer, len);
-    }
-    if (len > 0 && len < FLAGS_stream_block_size) {
+    request.set_offset(offset);
+    request.set_crc(::openmldb::log::Mask(::openmldb::log::Value(buffer, len)));
+    if (offset + len == file_size) {
         request.set_eof(true);
     }
-    ::openmldb::api::GeneralResponse response;
+    brpc::Controller cntl;
+    cntl.request_attachment().append(buffer, len);
+    ::openmldb::api::SendDataResponse response;
     stub_->SendData(&cntl, &request, &response, NULL);
     if (cntl.Failed()) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s", tid_, pid_, file_name.c_str(),
@@ -108,11 +157,12 @@ int FileSender::WriteData(const std::string& file_name, const std::string& dir_n
               response.msg().c_str());
         return -1;
     }
-    uint64_t time_used = ::baidu::common::timer::get_micros() - cur_time;
-    if (limit_time_ > time_used && len > FLAGS_stream_block_size / 2) {
-        uint64_t sleep_time = limit_time_ - time_used;
-        DEBUGLOG("sleep %lu us, limit_time %lu time_used %lu", sleep_time, limit_time_, time_used);
-        std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
+    g_file_send_bytes << len;
+    if (response.has_received_size()) {
+        uint64_t acked_size = acked_size_.load(std::memory_order_relaxed);
+        while (acked_size < response.received_size() &&
+               !acked_size_.compare_exchange_weak(acked_size, response.received_size(), std::memory_order_relaxed)) {
+        }
     }
     return 0;
 }
@@ -140,8 +190,10 @@ int FileSender::SendFile(const std::string& file_name, const std::string& dir_na
             PDLOG(INFO, "retry to send file %s to %s. total size[%lu]", full_path.c_str(), endpoint_.c_str(),
                   file_size);
         }
+        // a retry continues from the bytes received in the last try
+        bool resume = try_times < FLAGS_send_file_max_try;
         try_times--;
-        if (SendFileInternal(file_name, dir_name, full_path, file_size) < 0) {
+        if (SendFileInternal(file_name, dir_name, full_path, file_size, resume) < 0) {
             continue;
         }
         if (CheckFile(file_name, dir_name, file_size) < 0) {
@@ -153,57 +205,82 @@ int FileSender::SendFile(const std::string& file_name, const std::string& dir_na
 }
 
 int FileSender::SendFileInternal(const std::string& file_name, const std::string& dir_name,
-                                 const std::string& full_path, uint64_t file_size) {
-    FILE* file = fopen(full_path.c_str(), "rb");
-    if (file == NULL) {
+                                 const std::string& full_path, uint64_t file_size, bool resume) {
+    int fd = open(full_path.c_str(), O_RDONLY);
+    if (fd < 0) {
         PDLOG(WARNING, "fail to open file %s", full_path.c_str());
         return -1;
     }
-    char buffer[FLAGS_stream_block_size];
-
-    uint64_t block_num = file_size / FLAGS_stream_block_size + 1;
+    uint64_t received_size = 0;
+    if (InitReceiver(file_name, dir_name, file_size, resume, &received_size) < 0) {
+        PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
+        close(fd);
+        return -1;
+    }
+    uint64_t block_size = FLAGS_stream_block_size;
+    uint64_t block_num = (file_size + block_size - 1) / block_size;
+    // the block ids start from 1 as block 0 creates the receiver
+    uint64_t start_block = received_size / block_size;
     uint64_t report_block_num = block_num / 100;
-    int ret = 0;
-    uint64_t block_count = 0;
-    do {
-        if (block_count == 0 && WriteData(file_name, dir_name, buffer, 0, block_count) < 0) {
-            PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
-            ret = -1;
-            break;
-        }
-        block_count++;
-
-#ifdef __APPLE__
-        size_t len = fread(buffer, 1, FLAGS_stream_block_size, file);
-#else
-        size_t len = fread_unlocked(buffer, 1, FLAGS_stream_block_size, file);
-#endif
-        if (len < FLAGS_stream_block_size) {
-            if (feof(file)) {
-                if (len > 0) {
-                    ret = WriteData(file_name, dir_name, buffer, len, block_count);
-                }
+    uint32_t stream_num = std::max(1u, FLAGS_send_file_stream_num);
+    if (block_num - start_block < stream_num) {
+        stream_num = std::max<uint64_t>(1, block_num - start_block);
+    }
+    if (start_block > 0) {
+        PDLOG(INFO, "resume to send file %s from block %lu. tid[%u] pid[%u]", file_name.c_str(), start_block, tid_,
+              pid_);
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::atomic<uint64_t> next_block(start_block);
+    std::atomic<bool> has_error(false);
+    // each stream takes the next block in turn, so the blocks arrive nearly in order
+    auto send_blocks = [&]() {
+        std::string buffer(block_size, '\0');
+        while (!has_error.load(std::memory_order_relaxed)) {
+            uint64_t block = next_block.fetch_add(1, std::memory_order_relaxed);
+            if (block >= block_num) {
                 break;
             }
-            PDLOG(WARNING, "read file %s error. error message: %s", file_name.c_str(), strerror(errno));
-            ret = -1;
-            break;
-        }
-        if (WriteData(file_name, dir_name, buffer, len, block_count) < 0) {
-            PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
-            ret = -1;
-            break;
-        }
-        if (report_block_num == 0 || block_count % report_block_num == 0) {
-            PDLOG(INFO,
-                  "send block num[%lu] total block num[%lu]. tid[%u] pid[%u] "
-                  "file[%s] endpoint[%s]",
-                  block_count, block_num, tid_, pid_, file_name.c_str(), endpoint_.c_str());
+            uint64_t offset = block * block_size;
+            size_t len = std::min(block_size, file_size - offset);
+            ssize_t read_len = pread(fd, &buffer[0], len, offset);
+            if (read_len < 0 || static_cast<size_t>(read_len) != len) {
+                PDLOG(WARNING, "read file %s error. error message: %s", file_name.c_str(), strerror(errno));
+                has_error.store(true, std::memory_order_relaxed);
+                break;
+            }
+            if (WriteData(file_name, dir_name, buffer.data(), len, block + 1, offset, file_size) < 0) {
+                PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
+                has_error.store(true, std::memory_order_relaxed);
+                break;
+            }
+            if (report_block_num == 0 || (block + 1) % report_block_num == 0) {
+                PDLOG(INFO,
+                      "send block num[%lu] total block num[%lu]. tid[%u] pid[%u] "
+                      "file[%s] endpoint[%s]",
+                      block + 1, block_num, tid_, pid_, file_name.c_str(), endpoint_.c_str());
+            }
         }
-    } while (true);
-    fclose(file);
+    };
+    std::vector<std::thread> streams;
+    for (uint32_t i = 1; i < stream_num; i++) {
+        streams.emplace_back(send_blocks);
+    }
+    send_blocks();
+    for (auto& stream : streams) {
+        stream.join();
+    }
+    close(fd);
+    if (has_error.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros() - start_time;
+    uint64_t sent_size = file_size - std::min(file_size, start_block * block_size);
+    PDLOG(INFO, "send %lu bytes of file %s with %u streams, use %lu ms, %.2f MB/s. tid[%u] pid[%u]", sent_size,
+          file_name.c_str(), stream_num, consumed / 1000,
+          consumed > 0 ? sent_size * 1000000.0 / consumed / 1024 / 1024 : 0.0, tid_, pid_);
     std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_stream_close_wait_time_ms));
-    return ret;
+    return 0;
 }
 
 int FileSender::CheckFile(const std::string& file_name, const std::string& dir_name, uint64_t file_size) {
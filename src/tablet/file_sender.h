@@ -19,13 +19,19 @@
 #include <brpc/channel.h>
 #include <brpc/controller.h>
 
+#include <atomic>
 #include <string>
 
+#include "base/token_bucket.h"
 #include "proto/tablet.pb.h"
 
 namespace openmldb {
 namespace tablet {
 
+// FileSender sends a file to the tablet at endpoint block by block. The blocks of a file are
+// sent by send_file_stream_num streams in parallel, and the bytes sent by all the senders of
+// the tablet are limited to stream_bandwidth_limit per second. A failed try continues from the
+// bytes the receiver has got.
 class FileSender {
  public:
     FileSender(uint32_t tid, uint32_t pid, common::StorageMode storage_mode, const std::string& endpoint);
@@ -34,12 +40,18 @@ class FileSender {
     int SendFile(const std::string& file_name, const std::string& dir_name, const std::string& full_path);
     int SendFile(const std::string& file_name, const std::string& full_path);
     int SendFileInternal(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
-                         uint64_t file_size);
+                         uint64_t file_size, bool resume);
     int SendDir(const std::string& dir_name, const std::string& full_path);
+    // send block 0 which creates the receiver, received_size is the bytes it has got if it resumes
+    int InitReceiver(const std::string& file_name, const std::string& dir_name, uint64_t file_size, bool resume,
+                     uint64_t* received_size);
     int WriteData(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
-                  uint64_t block_id);
+                  uint64_t block_id, uint64_t offset, uint64_t file_size);
     int CheckFile(const std::string& file_name, const std::string& dir_name, uint64_t file_size);
 
+    // the limiter shared by all the senders of the tablet
+    static ::openmldb::base::TokenBucket* GetBandwidthLimiter();
+
  private:
     uint32_t tid_;
     uint32_t pid_;
@@ -47,7 +59,8 @@ class FileSender {
     std::string endpoint_;
     uint32_t cur_try_time_;
     uint32_t max_try_time_;
-    uint64_t limit_time_;
+    // the bytes from the start of the file that the receiver has acked
+    std::atomic<uint64_t> acked_size_;
     brpc::Channel* channel_;
     ::openmldb::api::TabletServer_Stub* stub_;
 };
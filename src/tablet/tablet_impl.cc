@@ -47,6 +47,7 @@
 #include "base/status.h"
 #include "base/strings.h"
 #include "brpc/controller.h"
+#include "bthread/bthread.h"
 #include "butil/iobuf.h"
 #include "codec/codec.h"
 #include "codec/row_codec.h"
@@ -56,6 +57,7 @@
 #include "glog/logging.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/text_format.h"
+#include "log/crc32c.h"
 #include "schema/schema_adapter.h"
 #include "storage/binlog.h"
 #include "storage/segment.h"
@@ -73,10 +75,14 @@ using ::openmldb::storage::DiskTable;
 DECLARE_int32(gc_interval);
 DECLARE_int32(gc_pool_size);
 DECLARE_int32(disk_gc_interval);
+DECLARE_uint32(gc_round_interval_ms);
 DECLARE_int32(statdb_ttl);
 DECLARE_uint32(scan_max_bytes_size);
 DECLARE_uint32(scan_reserve_size);
 DECLARE_uint32(max_memory_mb);
+DECLARE_uint32(mem_table_soft_limit_mb);
+DECLARE_uint32(mem_table_hard_limit_mb);
+DECLARE_uint32(mem_table_throttle_max_us);
 DECLARE_double(mem_release_rate);
 DECLARE_string(db_root_path);
 DECLARE_string(ssd_root_path);
@@ -99,6 +105,9 @@ DECLARE_uint32(task_check_interval);
 DECLARE_uint32(load_index_max_wait_time);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
+DECLARE_uint32(sql_cache_capacity_mb);
+DECLARE_string(jit_object_cache_dir);
+DECLARE_uint32(jit_object_cache_capacity_mb);
 DECLARE_string(snapshot_compression);
 DECLARE_string(file_compression);
 
@@ -210,12 +219,21 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     } else {
         options.SetClusterOptimized(false);
     }
+    options.SetSqlCacheCapacity(static_cast<uint64_t>(FLAGS_sql_cache_capacity_mb) * 1024 * 1024);
+    options.jit_options().SetObjectCacheDir(FLAGS_jit_object_cache_dir);
+    options.jit_options().SetObjectCacheCapacity(static_cast<uint64_t>(FLAGS_jit_object_cache_capacity_mb) * 1024 *
+                                                 1024);
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(
         std::shared_ptr<::hybridse::vm::Tablet>(new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
+#ifdef ZSTD_ENABLE
+    std::set<std::string> snapshot_compression_set{"off", "zlib", "snappy", "zstd"};
+#else
     std::set<std::string> snapshot_compression_set{"off", "zlib", "snappy"};
+#endif
     if (snapshot_compression_set.find(FLAGS_snapshot_compression) == snapshot_compression_set.end()) {
-        LOG(ERROR) << "wrong snapshot_compression: " << FLAGS_snapshot_compression;
+        LOG(ERROR) << "wrong snapshot_compression: " << FLAGS_snapshot_compression
+                   << (FLAGS_snapshot_compression == "zstd" ? ", zstd is not enabled in this build" : "");
         return false;
     }
     std::set<std::string> file_compression_set{"off", "zlib", "lz4"};
@@ -747,6 +765,24 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         response->set_msg("exceed max memory");
         return;
     }
+    if (!CheckTableMemLimit(tid, pid, table)) {
+        response->set_code(::openmldb::base::ReturnCode::kExceedMaxMemory);
+        response->set_msg("exceed table memory limit");
+        return;
+    }
+    // the value in attachment is used in place if it is in one block, which saves the copy of parsing
+    // the request and the copy into the log entry
+    ::openmldb::base::Slice value(request->value());
+    std::string attachment_value;
+    if (request->use_attachment()) {
+        const butil::IOBuf& buf = static_cast<brpc::Controller*>(controller)->request_attachment();
+        if (buf.backing_block_num() == 1) {
+            value.reset(buf.backing_block(0).data(), buf.size());
+        } else {
+            buf.copy_to(&attachment_value);
+            value.reset(attachment_value.data(), attachment_value.size());
+        }
+    }
     bool ok = false;
     if (request->dimensions_size() > 0) {
         int32_t ret_code = CheckDimessionPut(request, table->GetIdxCnt());
@@ -757,7 +793,7 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         }
         DLOG(INFO) << "put data to tid " << tid << " pid " << pid << " with key "
                    << request->dimensions(0).key();
-        ok = table->Put(request->time(), request->value(), request->dimensions());
+        ok = table->Put(request->time(), value.data(), value.size(), request->dimensions());
     }
     if (!ok) {
         response->set_code(::openmldb::base::ReturnCode::kPutFailed);
@@ -776,7 +812,6 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         }
         entry.set_pk(request->pk());
         entry.set_ts(request->time());
-        entry.set_value(request->value());
         entry.set_term(replicator->GetLeaderTerm());
         if (request->dimensions_size() > 0) {
             entry.mutable_dimensions()->CopyFrom(request->dimensions());
@@ -788,17 +823,32 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
         // Aggregator update assumes that binlog_offset is strictly increasing
         // so the update should be protected within the replicator lock
         // in case there will be other Put jump into the middle
-        auto update_aggr = [this, &request, &ok, &entry]() {
-            ok = UpdateAggrs(request->tid(), request->pid(), request->value(),
-                    request->dimensions(), entry.log_index());
+        auto update_aggr = [this, &request, &ok, &entry, &value]() {
+            if (!request->use_attachment()) {
+                ok = UpdateAggrs(request->tid(), request->pid(), request->value(), request->dimensions(),
+                                 entry.log_index());
+            } else if (GetAggregators(request->tid(), request->pid())) {
+                // the aggregators take the row as string
+                ok = UpdateAggrs(request->tid(), request->pid(), value.ToString(), request->dimensions(),
+                                 entry.log_index());
+            }
         };
         UpdateAggrClosure closure(update_aggr);
-        replicator->AppendEntry(entry, &closure);
+        bool written = false;
+        bool appended = replicator->AppendEntry(entry, value, &closure, &written);
         if (!ok) {
             response->set_code(::openmldb::base::ReturnCode::kError);
             response->set_msg("update aggr failed");
             return;
         }
+        if (!appended && written) {
+            // the row is in table and binlog, a retry of client would put it twice
+            response->set_code(::openmldb::base::ReturnCode::kEntryNotDurable);
+            response->set_msg("the row is written but not durable as the table requires");
+        } else if (!appended) {
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entry to replicator");
+        }
     } while (false);
 
     uint64_t end_time = ::baidu::common::timer::get_micros();
@@ -831,6 +881,136 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
     }
 }
 
+void TabletImpl::PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                          ::openmldb::api::PutBatchResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    if (follower_.load(std::memory_order_relaxed)) {
+        response->set_code(::openmldb::base::ReturnCode::kIsFollowerCluster);
+        response->set_msg("is follower cluster");
+        return;
+    }
+    uint32_t tid = request->tid();
+    uint32_t pid = request->pid();
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    if (!table) {
+        PDLOG(WARNING, "table does not exist. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table does not exist");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::openmldb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    if (table->GetStorageMode() == ::openmldb::common::StorageMode::kMemory &&
+            memory_used_.load(std::memory_order_relaxed) > FLAGS_max_memory_mb) {
+        PDLOG(WARNING, "current memory %lu MB exceed max memory limit %lu MB. tid %u, pid %u",
+                memory_used_.load(std::memory_order_relaxed), FLAGS_max_memory_mb, tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kExceedMaxMemory);
+        response->set_msg("exceed max memory");
+        return;
+    }
+    if (!CheckTableMemLimit(tid, pid, table)) {
+        response->set_code(::openmldb::base::ReturnCode::kExceedMaxMemory);
+        response->set_msg("exceed table memory limit");
+        return;
+    }
+    std::vector<::openmldb::storage::BatchPutRow> rows;
+    rows.reserve(request->rows_size());
+    for (const auto& row : request->rows()) {
+        if (row.dimensions_size() == 0 || CheckDimessionPut(&row, table->GetIdxCnt()) != 0) {
+            response->set_code(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
+            response->set_msg("invalid dimension parameter");
+            return;
+        }
+        rows.push_back({static_cast<uint64_t>(row.time()), ::openmldb::base::Slice(row.value()), &row.dimensions()});
+    }
+    // the rows of memory table are checked before the binlog is written, so the batch goes to neither the binlog
+    // nor the table if any of them is invalid
+    std::shared_ptr<MemTable> mem_table;
+    std::vector<MemTable::ParsedRow> parsed_rows;
+    if (table->GetStorageMode() == ::openmldb::common::StorageMode::kMemory) {
+        mem_table = std::dynamic_pointer_cast<MemTable>(table);
+        if (!mem_table->ParseBatch(rows, &parsed_rows)) {
+            response->set_code(::openmldb::base::ReturnCode::kPutFailed);
+            response->set_msg("put failed");
+            return;
+        }
+    }
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(tid, pid);
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", tid, pid);
+    } else if (!rows.empty()) {
+        std::vector<::openmldb::api::LogEntry> entries(rows.size());
+        std::vector<::openmldb::base::Slice> values;
+        values.reserve(rows.size());
+        uint64_t term = replicator->GetLeaderTerm();
+        for (int i = 0; i < request->rows_size(); i++) {
+            const auto& row = request->rows(i);
+            entries[i].set_ts(row.time());
+            entries[i].set_term(term);
+            entries[i].mutable_dimensions()->CopyFrom(row.dimensions());
+            values.push_back(rows[i].value);
+        }
+        bool ok = true;
+        auto update_aggr = [this, &request, &ok, &entries, tid, pid]() {
+            for (int i = 0; i < request->rows_size() && ok; i++) {
+                ok = UpdateAggrs(tid, pid, request->rows(i).value(), request->rows(i).dimensions(),
+                                 entries[i].log_index());
+            }
+        };
+        UpdateAggrClosure closure(update_aggr);
+        size_t written = 0;
+        bool appended = replicator->AppendEntryBatch(&entries, values, &closure, &written);
+        if (FLAGS_binlog_notify_on_put) {
+            replicator->Notify();
+        }
+        // the table has the rows in the binlog only, it's all of them unless the binlog failed to truncate
+        if (!appended) {
+            rows.resize(written);
+            if (mem_table) {
+                parsed_rows.resize(written);
+            }
+        }
+        if (!ok) {
+            response->set_code(::openmldb::base::ReturnCode::kError);
+            response->set_msg("update aggr failed");
+        } else if (!appended && written == entries.size()) {
+            response->set_code(::openmldb::base::ReturnCode::kEntryNotDurable);
+            response->set_msg("the rows are written but not durable as the table requires");
+        } else if (!appended) {
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entry to replicator");
+        }
+    }
+    if (mem_table) {
+        mem_table->PutBatch(rows, parsed_rows);
+    } else if (!table->PutBatch(rows)) {
+        response->set_code(::openmldb::base::ReturnCode::kPutFailed);
+        response->set_msg("put failed");
+        return;
+    }
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_put_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[put batch]. row cnt %d time %lu. tid %u, pid %u", request->rows_size(),
+              end_time - start_time, tid, pid);
+    }
+    // update global var in standalone mode
+    if (!IsClusterMode() && table->GetDB() == openmldb::nameserver::INFORMATION_SCHEMA_DB &&
+        table->GetName() == openmldb::nameserver::GLOBAL_VARIABLES) {
+        UpdateGlobalVarTable();
+    }
+}
+
 int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::string& msg) {
     msg.clear();
     if (table_meta->name().empty()) {
@@ -2249,6 +2429,16 @@ void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api:
         PDLOG(INFO, "first sync log_index! log_offset[%lu] tid[%u] pid[%u]", last_log_offset, tid, pid);
         return;
     }
+    if (request->pre_log_index() > last_log_offset) {
+        // the requests may arrive out of order when the leader sends them in pipeline, the entries
+        // must not be applied before the previous ones
+        DEBUGLOG("pre log index %lu is greater than log offset %lu. tid %u pid %u", request->pre_log_index(),
+                 last_log_offset, tid, pid);
+        response->set_code(::openmldb::base::ReturnCode::kPreLogIndexMismatch);
+        response->set_msg("pre log index mismatch");
+        response->set_log_offset(last_log_offset);
+        return;
+    }
     for (int32_t i = 0; i < request->entries_size(); i++) {
         const auto& entry = request->entries(i);
         if (entry.log_index() <= last_log_offset) {
@@ -2410,6 +2600,10 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                 status->set_offset(replicator->GetOffset());
             }
             status->set_record_cnt(table->GetRecordCnt());
+            if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+                status->set_recover_offset(table->GetRecoverOffset());
+                status->set_recover_cnt(table->GetRecoverCnt());
+            }
             if (table->GetStorageMode() == common::kMemory) {
                 if (MemTable* mem_table = dynamic_cast<MemTable*>(table.get())) {
                     status->set_is_expire(mem_table->GetExpireStatus());
@@ -2417,6 +2611,10 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                     status->set_record_idx_byte_size(mem_table->GetRecordIdxByteSize());
                     status->set_record_pk_cnt(mem_table->GetRecordPkCnt());
                     status->set_skiplist_height(mem_table->GetKeyEntryHeight());
+                    status->set_gc_consumed_time(mem_table->GetGcConsumedTime());
+                    status->set_gc_record_cnt(mem_table->GetGcRecordCnt());
+                    status->set_gc_idx_cnt(mem_table->GetGcIdxCnt());
+                    status->set_mem_byte_size(mem_table->GetMemByteSize());
                     uint64_t record_idx_cnt = 0;
                     auto indexs = table->GetAllIndex();
                     for (const auto& index_def : indexs) {
@@ -2432,6 +2630,12 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                             }
                         }
                         delete[] stats;
+                        std::vector<uint64_t> seg_sizes;
+                        if (mem_table->GetSegmentMemByteSize(index_def->GetId(), &seg_sizes)) {
+                            for (uint64_t seg_size : seg_sizes) {
+                                ts_idx_status->add_seg_mem_byte_sizes(seg_size);
+                            }
+                        }
                     }
                     status->set_idx_cnt(record_idx_cnt);
                 }
@@ -2626,7 +2830,7 @@ void TabletImpl::SchedMakeSnapshot() {
 }
 
 void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::SendDataRequest* request,
-                          ::openmldb::api::GeneralResponse* response, Closure* done) {
+                          ::openmldb::api::SendDataResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
     brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
     uint32_t tid = request->tid();
@@ -2659,6 +2863,21 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
                 response->set_msg("table already exists");
                 return;
             }
+            if (iter != file_receiver_map_.end() && request->resume() && request->has_file_size() &&
+                iter->second->HasFileSize() && iter->second->GetFileSize() == request->file_size()) {
+                // continue from the bytes received in the last try
+                response->set_received_size(iter->second->GetReceivedSize());
+                response->set_code(::openmldb::base::ReturnCode::kOk);
+                response->set_msg("ok");
+                PDLOG(INFO, "file receiver resumes at %lu. tid %u, pid %u, file_name %s",
+                      response->received_size(), tid, pid, request->file_name().c_str());
+                return;
+            }
+            if (iter != file_receiver_map_.end() && request->has_file_size()) {
+                // the blocks of the last try may still be written by the old receiver
+                file_receiver_map_.erase(iter);
+                iter = file_receiver_map_.end();
+            }
             if (iter == file_receiver_map_.end()) {
                 std::string path = GetDBPath(db_root_path, tid, pid) + "/";
                 std::string dir_name;
@@ -2675,7 +2894,11 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
                     std::make_pair(combine_key, std::make_shared<FileReceiver>(request->file_name(), dir_name, path)));
                 iter = file_receiver_map_.find(combine_key);
             }
-            if (!iter->second->Init()) {
+            // the receiver is lost if the tablet restarts, the new one keeps the bytes acked in the last try
+            uint64_t resume_offset = request->resume() && request->has_offset() ? request->offset() : 0;
+            bool init_ok = request->has_file_size() ? iter->second->Init(request->file_size(), resume_offset)
+                                                    : iter->second->Init();
+            if (!init_ok) {
                 PDLOG(WARNING, "file receiver init failed. tid %u, pid %u, file_name %s", tid, pid,
                       request->file_name().c_str());
                 response->set_code(::openmldb::base::ReturnCode::kFileReceiverInitFailed);
@@ -2684,8 +2907,16 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
                 return;
             }
             PDLOG(INFO, "file receiver init ok. tid %u, pid %u, file_name %s", tid, pid, request->file_name().c_str());
+            uint64_t received_size = iter->second->GetReceivedSize();
+            if (request->has_file_size() && request->file_size() == received_size) {
+                // an empty file or the one received before has no block after the first one
+                iter->second->SaveFile();
+                file_receiver_map_.erase(iter);
+            }
+            response->set_received_size(received_size);
             response->set_code(::openmldb::base::ReturnCode::kOk);
             response->set_msg("ok");
+            return;
         } else if (iter == file_receiver_map_.end()) {
             PDLOG(WARNING, "cannot find receiver. tid %u, pid %u, file_name %s", tid, pid,
                   request->file_name().c_str());
@@ -2701,6 +2932,44 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
         response->set_msg("cannot find receiver");
         return;
     }
+    if (request->has_offset()) {
+        std::string data = cntl->request_attachment().to_string();
+        if (data.length() != request->block_size()) {
+            PDLOG(WARNING, "receive data error. tid %u, pid %u, file_name %s, expected length %u real length %u",
+                  tid, pid, request->file_name().c_str(), request->block_size(), data.length());
+            response->set_code(::openmldb::base::ReturnCode::kReceiveDataError);
+            response->set_msg("receive data error");
+            return;
+        }
+        if (request->has_crc() && ::openmldb::log::Mask(::openmldb::log::Value(data.data(), data.size())) !=
+                                      request->crc()) {
+            PDLOG(WARNING, "block crc mismatch. tid %u, pid %u, file_name %s, offset %lu", tid, pid,
+                  request->file_name().c_str(), request->offset());
+            response->set_code(::openmldb::base::ReturnCode::kBlockCrcMismatch);
+            response->set_msg("block crc mismatch");
+            return;
+        }
+        int ret = receiver->WriteBlock(data, request->offset());
+        if (ret < 0) {
+            PDLOG(WARNING, "receiver write block failed. tid %u, pid %u, file_name %s, offset %lu", tid, pid,
+                  request->file_name().c_str(), request->offset());
+            response->set_code(::openmldb::base::ReturnCode::kWriteDataFailed);
+            response->set_msg("write data failed");
+            return;
+        }
+        if (ret > 0) {
+            receiver->SaveFile();
+            std::lock_guard<std::mutex> lock(mu_);
+            auto iter = file_receiver_map_.find(combine_key);
+            if (iter != file_receiver_map_.end() && iter->second == receiver) {
+                file_receiver_map_.erase(iter);
+            }
+        }
+        response->set_received_size(receiver->GetReceivedSize());
+        response->set_msg("ok");
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+        return;
+    }
     if (receiver->GetBlockId() == request->block_id()) {
         response->set_msg("ok");
         response->set_code(::openmldb::base::ReturnCode::kOk);
@@ -2838,6 +3107,7 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
         full_path.append("snapshot/");
         std::string manifest_file = full_path + "MANIFEST";
         std::string snapshot_file;
+        std::vector<std::string> snapshot_files;
         {
             int fd = open(manifest_file.c_str(), O_RDONLY);
             if (fd < 0) {
@@ -2853,11 +3123,19 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
                 break;
             }
             snapshot_file = manifest.name();
+            snapshot_files = ::openmldb::storage::Snapshot::GetSnapshotFiles(manifest);
         }
         if (table->GetStorageMode() == common::kMemory) {
-            // send snapshot file
-            if (sender.SendFile(snapshot_file, full_path + snapshot_file) < 0) {
-                PDLOG(WARNING, "send snapshot failed. tid[%u] pid[%u]", tid, pid);
+            // send snapshot files, the manifest is sent after all of them
+            bool send_ok = true;
+            for (const auto& file : snapshot_files) {
+                if (sender.SendFile(file, full_path + file) < 0) {
+                    PDLOG(WARNING, "send snapshot %s failed. tid[%u] pid[%u]", file.c_str(), tid, pid);
+                    send_ok = false;
+                    break;
+                }
+            }
+            if (!send_ok) {
                 break;
             }
         } else {
@@ -3528,10 +3806,12 @@ int32_t TabletImpl::GetSnapshotOffset(uint32_t tid, uint32_t pid, openmldb::comm
         PDLOG(WARNING, "parse manifest failed");
         return 0;
     }
-    std::string snapshot_file = db_path + "/snapshot/" + manifest.name();
-    if (!::openmldb::base::IsExists(snapshot_file)) {
-        PDLOG(WARNING, "snapshot file[%s] does not exist", snapshot_file.c_str());
-        return 0;
+    for (const auto& file : ::openmldb::storage::Snapshot::GetSnapshotFiles(manifest)) {
+        std::string snapshot_file = db_path + "/snapshot/" + file;
+        if (!::openmldb::base::IsExists(snapshot_file)) {
+            PDLOG(WARNING, "snapshot file[%s] does not exist", snapshot_file.c_str());
+            return 0;
+        }
     }
     offset = manifest.offset();
     term = manifest.term();
@@ -3892,6 +4172,7 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
     if (!zk_cluster_.empty() && table_meta->mode() == ::openmldb::api::TableMode::kTableLeader) {
         replicator->SetLeaderTerm(table_meta->term());
     }
+    replicator->SetDurability(table_meta->binlog_durability());
 
     ::openmldb::storage::Snapshot* snapshot_ptr = nullptr;
     if (table_meta->storage_mode() == openmldb::common::StorageMode::kMemory) {
@@ -4126,7 +4407,18 @@ void TabletImpl::GcTable(uint32_t tid, uint32_t pid, bool execute_once) {
     std::shared_ptr<Table> table = GetTable(tid, pid);
     if (table) {
         int32_t gc_interval = table->GetStorageMode() == common::kMemory ? FLAGS_gc_interval : FLAGS_disk_gc_interval;
+        MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+        if (execute_once && mem_table != nullptr) {
+            // finish the whole pass at once
+            mem_table->SchedFullGc();
+            return;
+        }
         table->SchedGc();
+        if (mem_table != nullptr && !mem_table->IsGcFinished()) {
+            // the round was stopped by the budget, continue it soon
+            gc_pool_.DelayTask(FLAGS_gc_round_interval_ms, boost::bind(&TabletImpl::GcTable, this, tid, pid, false));
+            return;
+        }
         if (!execute_once) {
             gc_pool_.DelayTask(gc_interval * 60 * 1000, boost::bind(&TabletImpl::GcTable, this, tid, pid, false));
         }
@@ -4134,6 +4426,52 @@ void TabletImpl::GcTable(uint32_t tid, uint32_t pid, bool execute_once) {
     }
 }
 
+void TabletImpl::MemLimitGcTable(uint32_t tid, uint32_t pid) {
+    GcTable(tid, pid, true);
+    std::shared_ptr<Table> table = GetTable(tid, pid);
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    if (mem_table != nullptr) {
+        mem_table->ClearMemGc();
+    }
+}
+
+bool TabletImpl::CheckTableMemLimit(uint32_t tid, uint32_t pid, const std::shared_ptr<Table>& table) {
+    if (FLAGS_mem_table_soft_limit_mb == 0 && FLAGS_mem_table_hard_limit_mb == 0) {
+        return true;
+    }
+    MemTable* mem_table = dynamic_cast<MemTable*>(table.get());
+    if (mem_table == nullptr) {
+        return true;
+    }
+    uint64_t mem_byte_size = mem_table->GetMemByteSize();
+    uint64_t hard_limit = static_cast<uint64_t>(FLAGS_mem_table_hard_limit_mb) << 20;
+    uint64_t soft_limit = static_cast<uint64_t>(FLAGS_mem_table_soft_limit_mb) << 20;
+    if (hard_limit > 0 && mem_byte_size > hard_limit) {
+        if (mem_table->TryMarkMemGc()) {
+            gc_pool_.AddTask(boost::bind(&TabletImpl::MemLimitGcTable, this, tid, pid));
+        }
+        PDLOG(WARNING, "table memory %lu bytes exceed the hard limit %u MB. tid %u, pid %u", mem_byte_size,
+              FLAGS_mem_table_hard_limit_mb, tid, pid);
+        return false;
+    }
+    if (soft_limit == 0 || mem_byte_size <= soft_limit) {
+        return true;
+    }
+    if (mem_table->TryMarkMemGc()) {
+        PDLOG(INFO, "table memory %lu bytes exceed the soft limit %u MB, start gc. tid %u, pid %u", mem_byte_size,
+              FLAGS_mem_table_soft_limit_mb, tid, pid);
+        gc_pool_.AddTask(boost::bind(&TabletImpl::MemLimitGcTable, this, tid, pid));
+    }
+    uint64_t delay = FLAGS_mem_table_throttle_max_us;
+    if (hard_limit > soft_limit) {
+        delay = delay * (mem_byte_size - soft_limit) / (hard_limit - soft_limit);
+    }
+    if (delay > 0) {
+        bthread_usleep(delay);
+    }
+    return true;
+}
+
 std::shared_ptr<Snapshot> TabletImpl::GetSnapshot(uint32_t tid, uint32_t pid) {
     std::lock_guard<SpinMutex> spin_lock(spin_mutex_);
     return GetSnapshotUnLock(tid, pid);
@@ -5385,6 +5723,7 @@ void TabletImpl::CreateProcedure(RpcController* controller, const openmldb::api:
     // build for single request
     ::hybridse::vm::RequestRunSession session;
     session.SetOptions(options);
+    session.SetSpName(sp_name);
     bool ok = engine_->Get(sql, db_name, session, status);
     if (!ok || session.GetCompileInfo() == nullptr) {
         response->set_msg(status.str());
@@ -5396,6 +5735,7 @@ void TabletImpl::CreateProcedure(RpcController* controller, const openmldb::api:
     // build for batch request
     ::hybridse::vm::BatchRequestRunSession batch_session;
     batch_session.SetOptions(options);
+    batch_session.SetSpName(sp_name);
     for (auto i = 0; i < sp_info.input_schema_size(); ++i) {
         bool is_constant = sp_info.input_schema().Get(i).is_constant();
         if (is_constant) {
@@ -5519,6 +5859,7 @@ void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureI
     // build for single request
     ::hybridse::vm::RequestRunSession session;
     session.SetOptions(options);
+    session.SetSpName(sp_name);
     bool ok = engine_->Get(sql, db_name, session, status);
     if (!ok || session.GetCompileInfo() == nullptr) {
         LOG(WARNING) << "fail to compile sql " << sql;
@@ -5527,6 +5868,7 @@ void TabletImpl::CreateProcedure(const std::shared_ptr<hybridse::sdk::ProcedureI
     // build for batch request
     ::hybridse::vm::BatchRequestRunSession batch_session;
     batch_session.SetOptions(options);
+    batch_session.SetSpName(sp_name);
     for (auto i = 0; i < sp_info->GetInputSchema().GetColumnCnt(); ++i) {
         bool is_constant = sp_info->GetInputSchema().IsConstant(i);
         if (is_constant) {
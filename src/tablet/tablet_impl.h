@@ -85,6 +85,10 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
              ::openmldb::api::PutResponse* response, Closure* done);
 
+    // put the rows to the table at once, and append them to binlog as a group
+    void PutBatch(RpcController* controller, const ::openmldb::api::PutBatchRequest* request,
+                  ::openmldb::api::PutBatchResponse* response, Closure* done);
+
     void Get(RpcController* controller, const ::openmldb::api::GetRequest* request,
              ::openmldb::api::GetResponse* response, Closure* done);
 
@@ -144,7 +148,7 @@ class TabletImpl : public ::openmldb::api::TabletServer {
                       ::openmldb::api::GeneralResponse* response, Closure* done);
 
     void SendData(RpcController* controller, const ::openmldb::api::SendDataRequest* request,
-                  ::openmldb::api::GeneralResponse* response, Closure* done);
+                  ::openmldb::api::SendDataResponse* response, Closure* done);
 
     void GetTaskStatus(RpcController* controller, const ::openmldb::api::TaskStatusRequest* request,
                        ::openmldb::api::TaskStatusResponse* response, Closure* done);
@@ -311,6 +315,12 @@ class TabletImpl : public ::openmldb::api::TabletServer {
 
     void GcTable(uint32_t tid, uint32_t pid, bool execute_once);
 
+    // the gc triggered by the soft memory limit of table
+    void MemLimitGcTable(uint32_t tid, uint32_t pid);
+
+    // check the memory of table before put, return false if the hard limit is exceeded
+    bool CheckTableMemLimit(uint32_t tid, uint32_t pid, const std::shared_ptr<Table>& table);
+
     void GcTableSnapshot(uint32_t tid, uint32_t pid);
 
     int CheckTableMeta(const openmldb::api::TableMeta* table_meta,
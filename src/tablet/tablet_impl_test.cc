@@ -24,6 +24,8 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <fstream>
+#include <iterator>
 #include <utility>
 
 #include "absl/cleanup/cleanup.h"
@@ -37,6 +39,7 @@
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "gtest/gtest.h"
+#include "log/crc32c.h"
 #include "log/log_reader.h"
 #include "log/log_writer.h"
 #include "proto/tablet.pb.h"
@@ -5451,10 +5454,127 @@ TEST_P(TabletImplTest, PutCompress) {
     }
 }
 
+TEST_P(TabletImplTest, PutWithAttachment) {
+    ::openmldb::common::StorageMode storage_mode = GetParam();
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    ASSERT_EQ(0, CreateDefaultTable("", "t0", id, 1, 0, 0, kAbsoluteTime, storage_mode, &tablet));
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    for (uint32_t size : {1024, 10240}) {
+        std::string key = "key" + std::to_string(size);
+        std::string value(size, 'v');
+        {
+            ::openmldb::api::PutRequest prequest;
+            PackDefaultDimension(key, &prequest);
+            prequest.set_time(now);
+            prequest.set_tid(id);
+            prequest.set_pid(1);
+            prequest.set_use_attachment(true);
+            brpc::Controller cntl;
+            cntl.request_attachment().append(::openmldb::test::EncodeKV(key, value));
+            ::openmldb::api::PutResponse presponse;
+            MockClosure closure;
+            tablet.Put(&cntl, &prequest, &presponse, &closure);
+            ASSERT_EQ(0, presponse.code());
+        }
+        {
+            ::openmldb::api::GetRequest request;
+            request.set_tid(id);
+            request.set_pid(1);
+            request.set_key(key);
+            request.set_ts(0);
+            ::openmldb::api::GetResponse response;
+            MockClosure closure;
+            tablet.Get(NULL, &request, &response, &closure);
+            ASSERT_EQ(0, response.code());
+            ASSERT_EQ(value, ::openmldb::test::DecodeV(response.value()));
+        }
+    }
+}
+
+TEST_P(TabletImplTest, PutBatch) {
+    ::openmldb::common::StorageMode storage_mode = GetParam();
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    ASSERT_EQ(0, CreateDefaultTable("", "t0", id, 1, 0, 0, kAbsoluteTime, storage_mode, &tablet));
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    ::openmldb::api::PutBatchRequest request;
+    request.set_tid(id);
+    request.set_pid(1);
+    for (int i = 0; i < 100; i++) {
+        auto row = request.add_rows();
+        PackDefaultDimension("key" + std::to_string(i % 10), row);
+        row->set_time(now - i);
+        row->set_value(::openmldb::test::EncodeKV("key" + std::to_string(i % 10), "value" + std::to_string(i)));
+    }
+    ::openmldb::api::PutBatchResponse response;
+    MockClosure closure;
+    tablet.PutBatch(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+    for (int i = 0; i < 10; i++) {
+        ::openmldb::api::CountRequest crequest;
+        crequest.set_tid(id);
+        crequest.set_pid(1);
+        crequest.set_key("key" + std::to_string(i));
+        ::openmldb::api::CountResponse cresponse;
+        tablet.Count(NULL, &crequest, &cresponse, &closure);
+        ASSERT_EQ(0, cresponse.code());
+        ASSERT_EQ(10u, cresponse.count());
+        ::openmldb::api::GetRequest grequest;
+        grequest.set_tid(id);
+        grequest.set_pid(1);
+        grequest.set_key("key" + std::to_string(i));
+        grequest.set_ts(0);
+        ::openmldb::api::GetResponse gresponse;
+        tablet.Get(NULL, &grequest, &gresponse, &closure);
+        ASSERT_EQ(0, gresponse.code());
+        ASSERT_EQ("value" + std::to_string(i), ::openmldb::test::DecodeV(gresponse.value()));
+    }
+    // a batch with an invalid row is rejected
+    auto row = request.add_rows();
+    row->set_time(now);
+    row->set_value(::openmldb::test::EncodeKV("key", "value"));
+    tablet.PutBatch(NULL, &request, &response, &closure);
+    ASSERT_NE(0, response.code());
+}
+
 INSTANTIATE_TEST_CASE_P(TabletMemAndHDD, TabletImplTest,
                         ::testing::Values(::openmldb::common::kMemory,/*::openmldb::common::kSSD,*/
                                           ::openmldb::common::kHDD));
 
+TEST_F(TabletImplTest, DISABLED_PutBatchPerf) {
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t row_num = 25600;
+    std::string value = ::openmldb::test::EncodeKV("key", std::string(100, 'v'));
+    for (int batch_size : {1, 16, 256}) {
+        uint32_t id = counter++;
+        ASSERT_EQ(0, CreateDefaultTable("", "t0", id, 1, 0, 0, kAbsoluteTime, common::kMemory, &tablet));
+        uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+        uint64_t start = ::baidu::common::timer::get_micros();
+        for (uint32_t i = 0; i < row_num; i += batch_size) {
+            ::openmldb::api::PutBatchRequest request;
+            request.set_tid(id);
+            request.set_pid(1);
+            for (int j = 0; j < batch_size; j++) {
+                auto row = request.add_rows();
+                PackDefaultDimension("key" + std::to_string((i + j) % 100), row);
+                row->set_time(now);
+                row->set_value(value);
+            }
+            ::openmldb::api::PutBatchResponse response;
+            MockClosure closure;
+            tablet.PutBatch(NULL, &request, &response, &closure);
+            ASSERT_EQ(0, response.code());
+        }
+        uint64_t consumed = ::baidu::common::timer::get_micros() - start;
+        printf("batch size %d, put %u rows in %lu us, %lu rows/s\n", batch_size, row_num, consumed,
+               row_num * 1000000ul / (consumed + 1));
+    }
+}
+
 TEST_F(TabletImplTest, CreateAggregator) {
     TabletImpl tablet;
     tablet.Init("");
@@ -6133,6 +6253,75 @@ TEST_F(TabletImplTest, AggregatorDeleteKey) {
     }
 }
 
+TEST_F(TabletImplTest, SendDataByOffset) {
+    TabletImpl tablet;
+    tablet.Init("");
+    uint32_t id = counter++;
+    std::string content;
+    for (int i = 0; i < 10000; i++) {
+        content.push_back('a' + i % 26);
+    }
+    uint32_t block_size = 4096;
+    auto send_block = [&tablet, id](uint64_t offset, const std::string& data, uint32_t crc) {
+        ::openmldb::api::SendDataRequest request;
+        request.set_tid(id);
+        request.set_pid(0);
+        request.set_file_name("snapshot.sdb");
+        request.set_block_id(offset / 4096 + 1);
+        request.set_block_size(data.size());
+        request.set_offset(offset);
+        request.set_crc(crc);
+        ::openmldb::api::SendDataResponse response;
+        brpc::Controller cntl;
+        cntl.request_attachment().append(data);
+        MockClosure closure;
+        tablet.SendData(&cntl, &request, &response, &closure);
+        return response.code();
+    };
+    auto init = [&tablet, id, &content](bool resume, uint64_t* received_size) {
+        ::openmldb::api::SendDataRequest request;
+        request.set_tid(id);
+        request.set_pid(0);
+        request.set_file_name("snapshot.sdb");
+        request.set_block_id(0);
+        request.set_file_size(content.size());
+        request.set_resume(resume);
+        ::openmldb::api::SendDataResponse response;
+        brpc::Controller cntl;
+        MockClosure closure;
+        tablet.SendData(&cntl, &request, &response, &closure);
+        *received_size = response.received_size();
+        return response.code();
+    };
+    auto crc = [](const std::string& data) {
+        return ::openmldb::log::Mask(::openmldb::log::Value(data.data(), data.size()));
+    };
+    uint64_t received_size = 0;
+    ASSERT_EQ(0, init(false, &received_size));
+    ASSERT_EQ(0u, received_size);
+    std::string block0 = content.substr(0, block_size);
+    std::string block1 = content.substr(block_size, block_size);
+    std::string block2 = content.substr(block_size * 2);
+    ASSERT_EQ(0, send_block(block_size, block1, crc(block1)));
+    // a block of crc mismatch is not written
+    ASSERT_EQ(::openmldb::base::ReturnCode::kBlockCrcMismatch, send_block(0, block0, crc(block0) + 1));
+    ASSERT_EQ(0, init(true, &received_size));
+    ASSERT_EQ(0u, received_size);
+    ASSERT_EQ(0, send_block(0, block0, crc(block0)));
+    // the retry continues from the bytes received
+    ASSERT_EQ(0, init(true, &received_size));
+    ASSERT_EQ(block_size * 2ul, received_size);
+    ASSERT_EQ(0, send_block(block_size * 2, block2, crc(block2)));
+    std::string path = FLAGS_db_root_path + "/" + std::to_string(id) + "_0/snapshot/snapshot.sdb";
+    ASSERT_TRUE(::openmldb::base::IsExists(path));
+    std::ifstream in(path, std::ios::binary);
+    std::string received((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(content, received);
+    // the receiver is removed once the file is saved, a resume starts a new one
+    ASSERT_EQ(0, init(true, &received_size));
+    ASSERT_EQ(0u, received_size);
+}
+
 }  // namespace tablet
 }  // namespace openmldb
 
@@ -56,6 +56,10 @@ void LogExporter::ReadManifest() {
     }
     std::string snapshot_name = manifest.name();
     snapshot_path_ = table_dir_path_ + "/snapshot/" + snapshot_name;
+    snapshot_paths_.clear();
+    for (const auto& file : ::openmldb::storage::Snapshot::GetSnapshotFiles(manifest)) {
+        snapshot_paths_.push_back(table_dir_path_ + "/snapshot/" + file);
+    }
     offset_ = manifest.offset();
     PDLOG(INFO, "Snapshot's offset: %lu, path: %s.", offset_, snapshot_path_.c_str());
 }
@@ -72,8 +76,8 @@ void LogExporter::ExportTable() {
         std::string log = log_dir + ptr->d_name;
         file_path.emplace_back(log);
     }
-    if (snapshot_path_.length()) {
-        ReadSnapshot();
+    for (const auto& path : snapshot_paths_) {
+        ReadSnapshot(path);
     }
     (void) closedir(dir);
     // Sorts binlog files and performs binary search
@@ -171,17 +175,18 @@ void LogExporter::ReadLog(const std::string &log_path) {
     offset_ += success_cnt;
 }
 
-void LogExporter::ReadSnapshot() {
-    FILE* fd_r = fopen(snapshot_path_.c_str(), "rb");
+void LogExporter::ReadSnapshot(const std::string& path) {
+    FILE* fd_r = fopen(path.c_str(), "rb");
     if (fd_r == NULL) {
-        PDLOG(ERROR, "fopen failed: %s", snapshot_path_.c_str());
+        PDLOG(ERROR, "fopen failed: %s", path.c_str());
         return;
     }
-    SequentialFile* rf = NewSeqFile(snapshot_path_, fd_r);
+    SequentialFile* rf = NewSeqFile(path, fd_r);
     std::string scratch;
     bool is_compress = false;
-    if (snapshot_path_.find(openmldb::log::ZLIB_COMPRESS_SUFFIX) != std::string::npos ||
-        snapshot_path_.find(openmldb::log::SNAPPY_COMPRESS_SUFFIX) != std::string::npos) {
+    if (path.find(openmldb::log::ZLIB_COMPRESS_SUFFIX) != std::string::npos ||
+        path.find(openmldb::log::SNAPPY_COMPRESS_SUFFIX) != std::string::npos ||
+        path.find(openmldb::log::ZSTD_COMPRESS_SUFFIX) != std::string::npos) {
         is_compress = true;
     }
     Reader reader(rf, NULL, true, 0, is_compress);
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "common/timer.h"
+#include "proto/tablet.pb.h"
+#include "storage/flat_snapshot.h"
+#include "storage/mem_table_snapshot.h"
+
+using ::openmldb::storage::FLAT_SNAPSHOT_SUFFIX;
+using ::openmldb::storage::FlatSnapshotWriter;
+using ::openmldb::storage::MemTableSnapshot;
+using ::openmldb::storage::Snapshot;
+
+namespace openmldb {
+namespace tools {
+
+// write the flat copy of each file of the snapshot in snapshot_path, which is the snapshot directory of a
+// memory table. the tablet loads the copies instead of the files when it recovers the table
+int ConvertSnapshot(const std::string& snapshot_path) {
+    ::openmldb::api::Manifest manifest;
+    if (Snapshot::GetLocalManifest(snapshot_path + "/MANIFEST", manifest) != 0) {
+        printf("fail to read the manifest in %s\n", snapshot_path.c_str());
+        return -1;
+    }
+    uint64_t total = 0;
+    for (const auto& name : Snapshot::GetSnapshotFiles(manifest)) {
+        std::string path = snapshot_path + "/" + name;
+        std::string flat_path = path + FLAT_SNAPSHOT_SUFFIX;
+        uint64_t start_time = ::baidu::common::timer::get_micros();
+        int64_t cnt = FlatSnapshotWriter::Convert(path, MemTableSnapshot::IsCompressed(path), flat_path + ".tmp");
+        if (cnt < 0 || rename((flat_path + ".tmp").c_str(), flat_path.c_str()) != 0) {
+            printf("fail to convert %s\n", path.c_str());
+            return -1;
+        }
+        printf("convert %s with %ld records, use %lu ms\n", path.c_str(), cnt,
+               (::baidu::common::timer::get_micros() - start_time) / 1000);
+        total += cnt;
+    }
+    if (total != manifest.count()) {
+        printf("the count of records is %lu but %lu in the manifest\n", total, manifest.count());
+        return -1;
+    }
+    return 0;
+}
+
+}  // namespace tools
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::google::SetUsageMessage("snapshot_converter <snapshot_path>");
+    ::google::ParseCommandLineFlags(&argc, &argv, true);
+    if (argc < 2) {
+        printf("usage: snapshot_converter <snapshot_path>\n");
+        return 1;
+    }
+    return openmldb::tools::ConvertSnapshot(argv[1]) == 0 ? 0 : 1;
+}